@@ -0,0 +1,554 @@
+#include "archive.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "meta_reader.h"
+
+namespace {
+constexpr char kArchiveMagic[4] = {'S', 'P', 'A', '1'};
+
+/// Loads the span and size of the header at `header`, for slot `slot`
+/// of `num_slots`.  Returns true if it starts a batch: its magic is
+/// right, its span fits in the file, and its size in its span.
+///
+/// Returns false for the end slot too, after setting `*done` if it's
+/// valid: the last slot, counting the slots before it.
+bool LoadSlotHeader(const uint8_t *header, size_t slot, size_t num_slots,
+                    size_t slot_size, uint32_t *span, uint64_t *size,
+                    bool *done) {
+  memcpy(span, header + 4, sizeof(*span));
+  memcpy(size, header + 8, sizeof(*size));
+  if (memcmp(header, kArchiveMagic, sizeof(kArchiveMagic)) != 0)
+    return false;
+
+  if (*span == 0) {
+    *done = *size == slot && slot + 1 == num_slots;
+    return false;
+  }
+
+  return *span <= num_slots - slot &&
+         *size <= *span * slot_size - kArchiveSlotHeaderSize;
+}
+}  // namespace
+
+ArchiveWriter::ArchiveWriter(const ArchiveOptions &options)
+    : options_(options) {
+  assert(options_.depth > 0 && options_.slot_size > kArchiveSlotHeaderSize);
+
+  std::vector<iovec> registered;
+
+  for (size_t i = 0; i <= options_.depth; i++) {
+    buffers_.emplace_back(options_.slot_size);
+    in_flight_.push_back(0);
+  }
+
+  // The last buffer grows for batches that span slots: only the slot
+  // buffers are registered.
+  for (size_t i = 0; i < options_.depth; i++)
+    registered.push_back(iovec{buffers_[i].data(), options_.slot_size});
+
+  queue_.init(options_.depth + 1, registered.data(), options_.depth,
+              options_.use_uring);
+  return;
+}
+
+ArchiveWriter::~ArchiveWriter() {
+  if (fd_ >= 0) close();
+  return;
+}
+
+bool ArchiveWriter::open(const char *path) {
+  assert(fd_ < 0);
+
+  fd_ = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  next_slot_ = 0;
+  ok_ = fd_ >= 0;
+  return ok_;
+}
+
+bool ArchiveWriter::end_record() {
+  size_t before = batch.finished_size();
+
+  // Records bigger than a batch's 4 GiB regions don't fit anywhere.
+  if (!batch.end_record()) return ok_ = false;
+
+  size_t record = batch.finished_size() - before;
+
+  if (kArchiveSlotHeaderSize + batch.finished_size() + record >
+      options_.slot_size)
+    return flush();
+
+  return ok_;
+}
+
+bool ArchiveWriter::flush() {
+  if (batch.count() == 0) return ok_;
+
+  size_t slot_size = options_.slot_size;
+  size_t size = kArchiveSlotHeaderSize + batch.finished_size();
+  uint64_t span = (size + slot_size - 1) / slot_size;
+  size_t tag = (span == 1) ? next_buffer_ : options_.depth;
+
+  if (span == 1) next_buffer_ = (next_buffer_ + 1) % options_.depth;
+
+  while (in_flight_[tag] != 0)
+    if (!reap()) return false;
+
+  WriteBuffer *out = &buffers_[tag];
+
+  out->reset();
+  store_header(out, span, batch.finished_size());
+  batch.finish(out);
+  // Slot buffers never grow: their memory is registered.
+  assert(tag == options_.depth || out->capacity() == slot_size);
+
+  return submit(tag, span);
+}
+
+void ArchiveWriter::store_header(WriteBuffer *out, uint32_t span,
+                                 uint64_t size) {
+  uint8_t *header = (uint8_t *)out->reserve(kArchiveSlotHeaderSize);
+
+  memcpy(header, kArchiveMagic, sizeof(kArchiveMagic));
+  memcpy(header + 4, &span, sizeof(span));
+  memcpy(header + 8, &size, sizeof(size));
+  out->commit(kArchiveSlotHeaderSize);
+  return;
+}
+
+bool ArchiveWriter::submit(size_t tag, size_t span) {
+  WriteBuffer *out = &buffers_[tag];
+
+  while (!queue_.write(fd_, (tag < options_.depth) ? (int)tag : -1,
+                       out->data(), out->written(),
+                       next_slot_ * options_.slot_size, tag)) {
+    if (queue_.in_flight() == 0 || !reap()) return ok_ = false;
+  }
+
+  in_flight_[tag] = out->written();
+  next_slot_ += span;
+  return ok_;
+}
+
+bool ArchiveWriter::reap() {
+  uint64_t tag;
+  int64_t result;
+
+  if (!queue_.wait(&tag, &result) || tag >= in_flight_.size()) {
+    ok_ = false;
+    return false;
+  }
+
+  ok_ &= result >= 0 && (size_t)result == in_flight_[tag];
+  in_flight_[tag] = 0;
+  return true;
+}
+
+bool ArchiveWriter::close() {
+  if (fd_ < 0) return false;
+
+  // The end slot, after the last batch.
+  if (flush()) {
+    size_t tag = next_buffer_;
+
+    while (in_flight_[tag] != 0)
+      if (!reap()) break;
+
+    buffers_[tag].reset();
+    store_header(&buffers_[tag], 0, next_slot_);
+    submit(tag, 1);
+  }
+
+  while (queue_.in_flight() > 0)
+    if (!reap()) break;
+
+  // Pad the last slots.
+  ok_ &= ftruncate(fd_, next_slot_ * options_.slot_size) == 0;
+  ok_ &= ::close(fd_) == 0;
+  fd_ = -1;
+  return ok_;
+}
+
+ArchiveReader::ArchiveReader(const ArchiveOptions &options)
+    : options_(options) {
+  assert(options_.depth > 0 && options_.slot_size > kArchiveSlotHeaderSize);
+
+  std::vector<iovec> registered;
+
+  for (size_t i = 0; i < options_.depth; i++) {
+    buffers_.emplace_back(options_.slot_size);
+    ready_.push_back(false);
+    registered.push_back(iovec{buffers_[i].data(), options_.slot_size});
+  }
+
+  queue_.init(options_.depth, registered.data(), options_.depth,
+              options_.use_uring);
+  return;
+}
+
+ArchiveReader::~ArchiveReader() {
+  uint64_t tag;
+  int64_t result;
+
+  // The kernel may still write to the buffers.
+  while (queue_.wait(&tag, &result)) {
+  }
+
+  if (fd_ >= 0) close(fd_);
+  return;
+}
+
+bool ArchiveReader::open(const char *path) {
+  struct stat st;
+
+  assert(fd_ < 0);
+  fd_ = ::open(path, O_RDONLY);
+  if (fd_ < 0 || fstat(fd_, &st) != 0 ||
+      (size_t)st.st_size % options_.slot_size != 0)
+    return false;
+
+  num_slots_ = st.st_size / options_.slot_size;
+  for (size_t slot = 0; slot < options_.depth && slot < num_slots_; slot++) {
+    if (!queue_.read(fd_, slot, buffer(slot), options_.slot_size,
+                     slot * options_.slot_size, slot))
+      return false;
+  }
+
+  return true;
+}
+
+bool ArchiveReader::wait_slot(size_t slot) {
+  size_t index = slot % options_.depth;
+
+  while (!ready_[index]) {
+    uint64_t tag;
+    int64_t result;
+
+    if (!queue_.wait(&tag, &result) || tag >= options_.depth ||
+        result != (int64_t)options_.slot_size)
+      return false;
+
+    ready_[tag] = true;
+  }
+
+  return true;
+}
+
+bool ArchiveReader::release(size_t slot) {
+  size_t index = slot % options_.depth;
+  size_t next = slot + options_.depth;
+
+  ready_[index] = false;
+  if (next >= num_slots_) return true;
+
+  return queue_.read(fd_, index, buffer(next), options_.slot_size,
+                     next * options_.slot_size, index);
+}
+
+bool ArchiveReader::next(BatchReader *out) {
+  size_t slot_size = options_.slot_size;
+
+  if (held_ != kNone) {
+    ok_ &= release(held_);
+    held_ = kNone;
+  }
+
+  if (!ok_ || done_ || fd_ < 0 || current_ == num_slots_)
+    return ok_ = false;
+
+  if (!wait_slot(current_)) return ok_ = false;
+
+  const uint8_t *header = buffer(current_);
+  uint32_t span;
+  uint64_t size;
+
+  if (!LoadSlotHeader(header, current_, num_slots_, slot_size, &span, &size,
+                      &done_))
+    return ok_ = false;
+
+  if (span == 1) {
+    held_ = current_++;
+    return ok_ = out->init(header + kArchiveSlotHeaderSize, size);
+  }
+
+  // Gather the span's slots, in order, as they come in.
+  size_t remaining = size;
+  size_t offset = kArchiveSlotHeaderSize;
+
+  oversize_.reset();
+  for (size_t slot = current_; slot < current_ + span; slot++) {
+    size_t piece = std::min(remaining, slot_size - offset);
+
+    if (!wait_slot(slot)) return ok_ = false;
+
+    memcpy(oversize_.reserve(piece), buffer(slot) + offset, piece);
+    oversize_.commit(piece);
+    remaining -= piece;
+    offset = 0;
+    if (!release(slot)) return ok_ = false;
+  }
+
+  current_ += span;
+  return ok_ = out->init(oversize_.data(), size);
+}
+
+MappedArchiveReader::MappedArchiveReader(const ArchiveOptions &options)
+    : options_(options) {
+  assert(options_.slot_size > kArchiveSlotHeaderSize);
+  return;
+}
+
+bool MappedArchiveReader::open(const char *path) {
+  if (!file_.open(path) || file_.size() % options_.slot_size != 0)
+    return ok_ = false;
+
+  num_slots_ = file_.size() / options_.slot_size;
+  advised_ = std::min(options_.depth * options_.slot_size, file_.size());
+  file_.advise(0, file_.size(), MADV_SEQUENTIAL);
+  file_.will_need(0, advised_);
+  return true;
+}
+
+bool MappedArchiveReader::next_batch() {
+  size_t slot_size = options_.slot_size;
+
+  if (!ok_ || done_ || current_ == num_slots_) return ok_ = false;
+
+  const uint8_t *header = file_.data() + current_ * slot_size;
+  uint32_t span;
+  uint64_t size;
+
+  if (!LoadSlotHeader(header, current_, num_slots_, slot_size, &span, &size,
+                      &done_))
+    return ok_ = false;
+
+  current_ += span;
+
+  // Keep `depth` slots past this batch on their way in.
+  size_t ahead = std::min((current_ + options_.depth) * slot_size,
+                          file_.size());
+
+  if (ahead > advised_) {
+    file_.will_need(advised_, ahead - advised_);
+    advised_ = ahead;
+  }
+
+#ifdef MADV_POPULATE_READ
+  // Map the batch's pages in one call, rather than a fault per page
+  // as the caller walks it.
+  file_.advise(header - file_.data(), span * slot_size, MADV_POPULATE_READ);
+#endif
+  record_ = 0;
+  batch_end_ = header + kArchiveSlotHeaderSize + size;
+  meta_prefetched_ = data_prefetched_ = header;
+  return ok_ = batch_.init(header + kArchiveSlotHeaderSize, size);
+}
+
+void MappedArchiveReader::prefetch(const BatchRecord &record) {
+  constexpr size_t kLine = 64;
+  const uint8_t *meta_end = record.meta + record.meta_size;
+  const uint8_t *data_end = record.data + record.data_size;
+  const uint8_t *meta_target =
+      meta_end + std::min<size_t>(kPrefetchDistance, batch_end_ - meta_end);
+  const uint8_t *data_target =
+      data_end + std::min<size_t>(kPrefetchDistance, batch_end_ - data_end);
+
+  // Start at the record, the first time in a batch.
+  meta_prefetched_ = std::max(meta_prefetched_, record.meta);
+  data_prefetched_ = std::max(data_prefetched_, record.data);
+
+  for (; meta_prefetched_ < meta_target; meta_prefetched_ += kLine)
+    __builtin_prefetch(meta_prefetched_);
+  for (; data_prefetched_ < data_target; data_prefetched_ += kLine)
+    __builtin_prefetch(data_prefetched_);
+}
+
+bool MappedArchiveReader::next(BatchRecord *out) {
+  if (!ok_) return false;
+
+  while (record_ == batch_.count())
+    if (!next_batch()) return false;
+
+  if (!batch_.record(record_++, out)) return ok_ = false;
+
+  prefetch(*out);
+  return true;
+}
+
+namespace {
+/// Writes `count` records to `writer`: record `i` has `i % 7` varint
+/// fields, and every 50th record also has a `big`-byte string.
+/// Appends each record's data size to `sizes`.
+void WriteRecords(ArchiveWriter *writer, size_t count, size_t big,
+                  std::vector<size_t> *sizes) {
+  std::string filler(big, 'x');
+
+  for (size_t i = 0; i < count; i++) {
+    MetaWriter &meta = writer->batch.meta;
+    DataWriter &data = writer->batch.data;
+    size_t begin = data.buf.written();
+
+    for (size_t field = 1; field <= i % 7; field++)
+      meta.field(field, data.varint(i * field));
+    if (i % 50 == 49) meta.string(8, data.string(filler));
+
+    meta.close(data.buf.written() - begin);
+    sizes->push_back(data.buf.written() - begin);
+    writer->end_record();
+  }
+}
+
+/// Returns true if `record`'s data size is `sizes[count]`, and its
+/// metadata ends with that size.
+bool CheckRecord(const BatchRecord &record, size_t count,
+                 const std::vector<size_t> &sizes) {
+  MetaReader meta(record.meta, record.meta_size);
+  MetaInstruction insn;
+  uint64_t close = UINT64_MAX;
+
+  while (meta.next(&insn)) close = insn.literal;
+  return count < sizes.size() && record.data_size == sizes[count] &&
+         close == record.data_size;
+}
+
+/// Reads the archive at `path` back with an `ArchiveReader`, and
+/// returns the number of records, or `SIZE_MAX` on errors or if a
+/// record fails `CheckRecord`.
+size_t CountRecords(const char *path, const ArchiveOptions &options,
+                    const std::vector<size_t> &sizes) {
+  ArchiveReader reader(options);
+  BatchReader batch;
+  BatchRecord record;
+  size_t count = 0;
+
+  if (!reader.open(path)) return SIZE_MAX;
+
+  while (reader.next(&batch)) {
+    while (batch.next(&record)) {
+      if (!CheckRecord(record, count, sizes)) return SIZE_MAX;
+      count++;
+    }
+  }
+
+  return reader.done() ? count : SIZE_MAX;
+}
+
+/// Same, with a `MappedArchiveReader`, whose records must point into
+/// the mapping.
+size_t CountMappedRecords(const char *path, const ArchiveOptions &options,
+                          const std::vector<size_t> &sizes) {
+  MappedArchiveReader reader(options);
+  BatchRecord record;
+  size_t count = 0;
+
+  if (!reader.open(path)) return SIZE_MAX;
+
+  const uint8_t *begin = reader.file().data();
+  const uint8_t *end = begin + reader.file().size();
+
+  while (reader.next(&record)) {
+    if (!CheckRecord(record, count, sizes) || record.meta < begin ||
+        record.data < begin || record.data + record.data_size > end)
+      return SIZE_MAX;
+
+    count++;
+  }
+
+  return reader.done() ? count : SIZE_MAX;
+}
+}  // namespace
+
+void ArchiveSelfTest() {
+  char path[] = "/tmp/archive_XXXXXX";
+  int fd = mkstemp(path);
+
+  assert(fd >= 0);
+  ::close(fd);
+
+  for (bool use_uring : {true, false}) {
+    ArchiveOptions options;
+    std::vector<size_t> sizes;
+    size_t count;
+    bool ok;
+
+    options.slot_size = 4096;
+    options.depth = 2;
+    options.use_uring = use_uring;
+
+    // Records are about 10 bytes each, and every 50th is bigger than
+    // a slot.
+    {
+      ArchiveWriter writer(options);
+
+      ok = writer.open(path);
+      assert(ok && (use_uring || !writer.uring()));
+      WriteRecords(&writer, 2000, 5000, &sizes);
+      ok = writer.close();
+      assert(ok && writer.slots() > 40);
+    }
+
+    count = CountRecords(path, options, sizes);
+    assert(count == 2000);
+    count = CountMappedRecords(path, options, sizes);
+    assert(count == 2000);
+
+    // Deeper read-ahead reads the same archive.
+    options.depth = 5;
+    count = CountRecords(path, options, sizes);
+    assert(count == 2000);
+
+    // Truncated and corrupted archives fail.
+    struct stat st;
+
+    ok = stat(path, &st) == 0 && truncate(path, st.st_size - 1) == 0;
+    assert(ok && CountRecords(path, options, sizes) == SIZE_MAX);
+    assert(CountMappedRecords(path, options, sizes) == SIZE_MAX);
+    ok = truncate(path, st.st_size - options.slot_size) == 0;
+    assert(ok && CountRecords(path, options, sizes) == SIZE_MAX);
+    assert(CountMappedRecords(path, options, sizes) == SIZE_MAX);
+    ok = truncate(path, st.st_size) == 0;
+    assert(ok && CountRecords(path, options, sizes) == SIZE_MAX);
+    assert(CountMappedRecords(path, options, sizes) == SIZE_MAX);
+
+    {
+      ArchiveWriter writer(options);
+
+      sizes.clear();
+      ok = writer.open(path);
+      WriteRecords(&writer, 500, 5000, &sizes);
+      ok &= writer.close();
+      assert(ok && CountRecords(path, options, sizes) == 500);
+      assert(CountMappedRecords(path, options, sizes) == 500);
+    }
+
+    fd = ::open(path, O_WRONLY);
+    ok = fd >= 0 && pwrite(fd, "X", 1, 0) == 1;
+    ::close(fd);
+    assert(ok && CountRecords(path, options, sizes) == SIZE_MAX);
+    assert(CountMappedRecords(path, options, sizes) == SIZE_MAX);
+
+    // An empty archive is just its end slot.
+    {
+      ArchiveWriter writer(options);
+
+      ok = writer.open(path) && writer.close();
+      assert(ok && writer.slots() == 1);
+      assert(CountRecords(path, options, sizes) == 0);
+      assert(CountMappedRecords(path, options, sizes) == 0);
+    }
+
+    (void)count;
+    (void)ok;
+  }
+
+  unlink(path);
+  return;
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "batch.h"
+#include "io_queue.h"
+#include "mapped_file.h"
+#include "write_buffer.h"
+
+/// Archives store batches (see `batch.h`) in a file of fixed-size
+/// slots, so they're written and read back in large blocks at known
+/// offsets, asynchronously with an `IoQueue`.  Each batch starts a
+/// slot:
+///
+///   "SPA1"                   4-byte magic
+///   span                     uint32_t, number of slots for the batch
+///   size                     uint64_t, size of the batch container
+///   container                size bytes
+///   padding                  zeros, to the end of the span's slots
+///
+/// Integers are little-endian, and the file is a whole number of
+/// slots.  Batches fill one slot, except for records too big for
+/// one, whose batches span several.  The last slot ends the archive,
+/// so truncated archives are detected: its header has a span of 0,
+/// and the number of slots before it as its size.
+constexpr size_t kArchiveSlotHeaderSize = 16;
+
+struct ArchiveOptions {
+  /// Slot size, and the size of every read and write (except for
+  /// batches that span several slots).
+  size_t slot_size{1 << 20};
+
+  /// Slot buffers: writes in flight for `ArchiveWriter`s, and reads
+  /// ahead of the caller for `ArchiveReader`s.  2 is double
+  /// buffering.
+  unsigned depth{4};
+
+  /// False forces the synchronous `IoQueue` fallback.
+  bool use_uring{true};
+};
+
+/// An `ArchiveWriter` encodes records into a `BatchWriter`, and writes
+/// each batch to the archive file as soon as it's full, from one of
+/// `depth` registered slot buffers: while the kernel writes a slot,
+/// the caller encodes the next batch.
+///
+/// Encode each record to `batch.meta` and `batch.data`, then call
+/// `end_record` (not `batch.end_record`).
+struct ArchiveWriter {
+  explicit ArchiveWriter(const ArchiveOptions &options = {});
+
+  /// `ArchiveWriter`s own an `IoQueue`: they can't be copied or moved.
+  ArchiveWriter(const ArchiveWriter &) = delete;
+  ArchiveWriter(ArchiveWriter &&) = delete;
+  ArchiveWriter &operator=(const ArchiveWriter &) = delete;
+  ArchiveWriter &operator=(ArchiveWriter &&) = delete;
+
+  /// `close`s the archive, if open.
+  ~ArchiveWriter();
+
+  /// Creates (or truncates) the archive at `path`.
+  ///
+  /// Returns false if the file can't be opened.
+  bool open(const char *path);
+
+  /// Ends the record written to `batch` since the last one, and
+  /// writes the batch out if the next record, if as big as this one,
+  /// wouldn't fit in its slot.
+  ///
+  /// Returns false if a write has failed so far.
+  bool end_record();
+
+  /// Writes the last batch and the end slot, waits for every write,
+  /// and closes the file.  Doesn't `fsync`.
+  ///
+  /// Returns false if any write failed: the archive is incomplete.
+  bool close();
+
+  /// Returns true if writes go through io_uring.
+  bool uring() const { return queue_.uring(); }
+
+  /// Number of slots written (or in flight) so far, including the
+  /// end slot after `close`.
+  size_t slots() const { return next_slot_; }
+
+  BatchWriter batch;
+
+ private:
+  /// Writes the current batch, if it has any records.
+  bool flush();
+
+  /// Appends a slot header to `out`.
+  static void store_header(WriteBuffer *out, uint32_t span, uint64_t size);
+
+  /// Writes buffer `tag` to the next `span` slots.
+  bool submit(size_t tag, size_t span);
+
+  /// Waits for one write to complete.
+  bool reap();
+
+  ArchiveOptions options_;
+  IoQueue queue_;
+  int fd_{-1};
+  /// `depth` slot buffers, then one for batches that span slots.
+  std::vector<WriteBuffer> buffers_;
+  /// Expected size of the write in flight from each buffer, or 0.
+  std::vector<size_t> in_flight_;
+  size_t next_buffer_{0};
+  size_t next_slot_{0};
+  bool ok_{true};
+};
+
+/// An `ArchiveReader` reads the batches of an archive in order, with
+/// `depth` slot reads in flight ahead of the caller, into registered
+/// buffers: the caller decodes a batch while the next slots come in.
+struct ArchiveReader {
+  explicit ArchiveReader(const ArchiveOptions &options = {});
+
+  /// `ArchiveReader`s own an `IoQueue`: they can't be copied or moved.
+  ArchiveReader(const ArchiveReader &) = delete;
+  ArchiveReader(ArchiveReader &&) = delete;
+  ArchiveReader &operator=(const ArchiveReader &) = delete;
+  ArchiveReader &operator=(ArchiveReader &&) = delete;
+
+  /// Waits for the reads in flight, and closes the file.
+  ~ArchiveReader();
+
+  /// Opens the archive at `path`, with the same slot size it was
+  /// written with, and starts reading ahead.
+  ///
+  /// Returns false if the file can't be opened, or isn't a whole
+  /// number of slots.
+  bool open(const char *path);
+
+  /// Reads the next batch into `out`, which is valid until the next
+  /// call.
+  ///
+  /// Returns false at the end slot (`done()` is then true), and on
+  /// read errors or malformed slots.
+  bool next(BatchReader *out);
+
+  /// Returns true once `next` has reached the end slot.
+  bool done() const { return done_; }
+
+  /// Returns true if reads go through io_uring.
+  bool uring() const { return queue_.uring(); }
+
+ private:
+  static constexpr size_t kNone = SIZE_MAX;
+
+  /// Waits until `slot` is in its buffer.
+  bool wait_slot(size_t slot);
+
+  /// Reuses the buffer of `slot` for the read of `slot + depth`.
+  bool release(size_t slot);
+
+  uint8_t *buffer(size_t slot) {
+    return (uint8_t *)buffers_[slot % options_.depth].data();
+  }
+
+  ArchiveOptions options_;
+  IoQueue queue_;
+  int fd_{-1};
+  std::vector<WriteBuffer> buffers_;
+  std::vector<bool> ready_;
+  /// For batches that span slots.
+  WriteBuffer oversize_;
+  size_t num_slots_{0};
+  size_t current_{0};
+  /// Slot that `out` points into, released by the next `next`.
+  size_t held_{kNone};
+  bool ok_{true};
+  bool done_{false};
+};
+
+/// A `MappedArchiveReader` reads the records of an archive in place,
+/// in a `MappedFile`: nothing is copied, batches that span slots are
+/// already contiguous in the file, and records (and the strings viewed
+/// in them) stay valid as long as the reader.
+///
+/// The reader drives the kernel's readahead from its position: the
+/// file is advised `MADV_SEQUENTIAL`, the `depth` slots after the
+/// current batch `MADV_WILLNEED`, so they're read in while the caller
+/// decodes, and the current batch `MADV_POPULATE_READ` (on kernels
+/// since 5.14), so its pages are mapped without a fault each.  Within
+/// a batch, each record returned prefetches the next
+/// `kPrefetchDistance` bytes of the metadata and data regions into
+/// the cache, ahead of the caller's walk of its instructions.
+struct MappedArchiveReader {
+  static constexpr size_t kPrefetchDistance = 1024;
+
+  /// Reads archives written with `options.slot_size`, advising
+  /// `options.depth` slots ahead.  `options.use_uring` doesn't apply.
+  explicit MappedArchiveReader(const ArchiveOptions &options = {});
+
+  /// Maps the archive at `path`, and starts reading ahead.
+  ///
+  /// Returns false if the file can't be mapped, or isn't a whole
+  /// number of slots.
+  bool open(const char *path);
+
+  /// Finds the next record, across batches.
+  ///
+  /// Returns false at the end slot (`done()` is then true), and on
+  /// malformed slots or batches.
+  bool next(BatchRecord *out);
+
+  /// Returns true once `next` has reached the end slot.
+  bool done() const { return done_; }
+
+  const MappedFile &file() const { return file_; }
+
+ private:
+  /// Moves to the batch in the next slot, and advises the slots after
+  /// it.
+  bool next_batch();
+
+  /// Prefetches both regions up to `kPrefetchDistance` bytes past
+  /// `record`, within the batch.
+  inline void prefetch(const BatchRecord &record);
+
+  ArchiveOptions options_;
+  MappedFile file_;
+  BatchReader batch_;
+  size_t record_{0};
+  size_t num_slots_{0};
+  size_t current_{0};
+  /// Offset up to which the file has been advised `MADV_WILLNEED`.
+  size_t advised_{0};
+  const uint8_t *batch_end_{nullptr};
+  const uint8_t *meta_prefetched_{nullptr};
+  const uint8_t *data_prefetched_{nullptr};
+  bool ok_{true};
+  bool done_{false};
+};
+
+/// Writes, reads and rejects small archives, through both `IoQueue`
+/// backends and mapped.
+void ArchiveSelfTest();
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 
@@ -11,18 +12,23 @@
 /// `BaseMetaWriter`s wrap a `WriteBuffer` with utility methods to
 /// emit metadata "instructions".  Directly go through the `buf`
 /// member to access the underlying `WriteBuffer`.
-struct BaseMetaWriter {
-  BaseMetaWriter() = delete;
+///
+/// `kChecked` writers grow their buffer on demand; unchecked ones
+/// (`UncheckedBaseMetaWriter`) skip the capacity check, and rely on
+/// the caller to `reserve` enough room in `buf` beforehand.
+template <bool kChecked>
+struct BasicBaseMetaWriter {
+  BasicBaseMetaWriter() = delete;
 
-  explicit BaseMetaWriter(WriteBuffer buf_) : buf(std::move(buf_)) {}
-  explicit BaseMetaWriter(size_t capacity) : buf(capacity) {}
+  explicit BasicBaseMetaWriter(WriteBuffer buf_) : buf(std::move(buf_)) {}
+  explicit BasicBaseMetaWriter(size_t capacity) : buf(capacity) {}
 
-  BaseMetaWriter(const BaseMetaWriter &) = delete;
-  BaseMetaWriter(BaseMetaWriter &&) = default;
-  BaseMetaWriter &operator=(const BaseMetaWriter &) = delete;
-  BaseMetaWriter &operator=(BaseMetaWriter &&) = delete;
+  BasicBaseMetaWriter(const BasicBaseMetaWriter &) = delete;
+  BasicBaseMetaWriter(BasicBaseMetaWriter &&) = default;
+  BasicBaseMetaWriter &operator=(const BasicBaseMetaWriter &) = delete;
+  BasicBaseMetaWriter &operator=(BasicBaseMetaWriter &&) = delete;
 
-  ~BaseMetaWriter() = default;
+  ~BasicBaseMetaWriter() = default;
 
   /// Emits a skip opcode for `num_skipped` fields. 0 is a no-op.
   inline void skip(uint32_t num_skipped);
@@ -31,6 +37,10 @@ struct BaseMetaWriter {
   /// followed by a non-zero field width.
   inline void one_field(uint8_t num_skipped, uint8_t data_width);
 
+  /// Emits a single field after `num_skipped` fields (any count),
+  /// as a `OneField` with as short a `SkipN` as possible before it.
+  inline void skip_one_field(uint32_t num_skipped, uint8_t data_width);
+
   /// Emits two non-zero field widths.
   inline void two_fields(uint8_t data_width1, uint8_t data_width2);
 
@@ -50,6 +60,25 @@ struct BaseMetaWriter {
   /// size.
   inline void field_n(uint8_t optional_data_width, uint64_t data_size);
 
+  /// Emits a run of `count` (at least `kMinRunFields`) fields with the
+  /// same non-zero width.
+  inline void run_fields(uint8_t data_width, uint32_t count);
+
+  /// Fewest and most fields in a `RunFields` instruction.
+  static constexpr uint32_t kMinRunFields = 3;
+  static constexpr uint32_t kMaxRunFields = kMinRunFields + (1UL << 28) - 1;
+
+  /// Returns the number of bytes `run_fields(..., count)` emits.
+  static constexpr size_t run_fields_size(uint32_t count);
+
+  /// Returns the number of bytes `skip(num_skipped)` emits, or 0 if
+  /// `num_skipped` is 0 (a no-op skip that callers can elide).
+  static constexpr size_t skip_size(uint32_t num_skipped);
+
+  /// Returns the number of bytes `skip_one_field(num_skipped, ...)`
+  /// emits.
+  static constexpr size_t one_field_size(uint32_t num_skipped);
+
   /// Helpers for the high-level emitters above.
 
   /// Returns the immediate value for a machine word width in {0, 1,
@@ -71,10 +100,26 @@ struct BaseMetaWriter {
   /// payload in [0, 2^56 - 1].
   void imm_nonzero_width(Opcode op, uint8_t imm1, uint64_t literal);
 
+  /// Largest `reserve` the emitters make (for `imm_nonzero_width`).
+  static constexpr size_t kMaxReserve = 9;
+
   WriteBuffer buf;
+
+ private:
+  inline void *reserve(size_t count) {
+    if constexpr (kChecked) {
+      return buf.reserve(count);
+    } else {
+      return buf.reserve_unchecked(count);
+    }
+  }
 };
 
-inline void BaseMetaWriter::skip(uint32_t num_skipped) {
+using BaseMetaWriter = BasicBaseMetaWriter<true>;
+using UncheckedBaseMetaWriter = BasicBaseMetaWriter<false>;
+
+template <bool kChecked>
+inline void BasicBaseMetaWriter<kChecked>::skip(uint32_t num_skipped) {
   assert(num_skipped < (1UL << 28));
 
   uint8_t low = (num_skipped < 4) ? num_skipped : 3;
@@ -83,7 +128,9 @@ inline void BaseMetaWriter::skip(uint32_t num_skipped) {
   return;
 }
 
-inline void BaseMetaWriter::one_field(uint8_t num_skipped, uint8_t data_width) {
+template <bool kChecked>
+inline void BasicBaseMetaWriter<kChecked>::one_field(uint8_t num_skipped,
+                                                     uint8_t data_width) {
   assert(num_skipped < 4);
   assert(data_width > 0 && data_width <= 8 &&
          (data_width & (data_width - 1)) == 0);
@@ -93,8 +140,27 @@ inline void BaseMetaWriter::one_field(uint8_t num_skipped, uint8_t data_width) {
   return;
 }
 
-inline void BaseMetaWriter::two_fields(uint8_t data_width1,
-                                       uint8_t data_width2) {
+template <bool kChecked>
+inline void BasicBaseMetaWriter<kChecked>::skip_one_field(
+    uint32_t num_skipped, uint8_t data_width) {
+  if (num_skipped <= 3) {
+    one_field(num_skipped, data_width);
+  } else if (skip_size(num_skipped) == skip_size(num_skipped - 3)) {
+    // Same size either way; keep the field's own skip at 0, like
+    // hand-written code.
+    skip(num_skipped);
+    one_field(0, data_width);
+  } else {
+    skip(num_skipped - 3);
+    one_field(3, data_width);
+  }
+
+  return;
+}
+
+template <bool kChecked>
+inline void BasicBaseMetaWriter<kChecked>::two_fields(uint8_t data_width1,
+                                                      uint8_t data_width2) {
   assert(data_width1 > 0 && data_width1 <= 8 &&
          (data_width1 & (data_width1 - 1)) == 0);
   assert(data_width2 > 0 && data_width2 <= 8 &&
@@ -105,8 +171,9 @@ inline void BaseMetaWriter::two_fields(uint8_t data_width1,
   return;
 }
 
-inline void BaseMetaWriter::open_field(uint32_t len_hint,
-                                       uint8_t optional_data_width) {
+template <bool kChecked>
+inline void BasicBaseMetaWriter<kChecked>::open_field(
+    uint32_t len_hint, uint8_t optional_data_width) {
   assert(len_hint < (1UL << 28));
   assert(optional_data_width <= 4 &&
          (optional_data_width & (optional_data_width - 1)) == 0);
@@ -116,8 +183,9 @@ inline void BaseMetaWriter::open_field(uint32_t len_hint,
   return;
 }
 
-inline void BaseMetaWriter::field_close(uint8_t data_width,
-                                        uint64_t sequence_size) {
+template <bool kChecked>
+inline void BasicBaseMetaWriter<kChecked>::field_close(uint8_t data_width,
+                                                       uint64_t sequence_size) {
   assert(data_width <= 4 && (data_width & (data_width - 1)) == 0);
   assert(sequence_size < (1UL << 56));
 
@@ -126,8 +194,9 @@ inline void BaseMetaWriter::field_close(uint8_t data_width,
   return;
 }
 
-inline void BaseMetaWriter::field_separate(uint8_t data_width,
-                                           uint64_t message_size) {
+template <bool kChecked>
+inline void BasicBaseMetaWriter<kChecked>::field_separate(
+    uint8_t data_width, uint64_t message_size) {
   assert(data_width <= 4 && (data_width & (data_width - 1)) == 0);
   assert(message_size < (1UL << 56));
 
@@ -136,8 +205,9 @@ inline void BaseMetaWriter::field_separate(uint8_t data_width,
   return;
 }
 
-inline void BaseMetaWriter::field_n(uint8_t optional_data_width,
-                                    uint64_t data_size) {
+template <bool kChecked>
+inline void BasicBaseMetaWriter<kChecked>::field_n(uint8_t optional_data_width,
+                                                   uint64_t data_size) {
   assert(optional_data_width <= 4 &&
          (optional_data_width & (optional_data_width - 1)) == 0);
   assert(data_size < (1UL << 56));
@@ -148,14 +218,57 @@ inline void BaseMetaWriter::field_n(uint8_t optional_data_width,
   return;
 }
 
-inline uint8_t BaseMetaWriter::immediate_for_zeroable_width(
+template <bool kChecked>
+inline void BasicBaseMetaWriter<kChecked>::run_fields(uint8_t data_width,
+                                                      uint32_t count) {
+  assert(count >= kMinRunFields && count <= kMaxRunFields);
+
+  imm_width(Opcode::RunFields, immediate_for_nonzero_width(data_width),
+            count - kMinRunFields);
+  return;
+}
+
+template <bool kChecked>
+constexpr size_t BasicBaseMetaWriter<kChecked>::run_fields_size(
+    uint32_t count) {
+  uint32_t literal = count - kMinRunFields;
+
+  if (literal == 0) return 1;
+  if (literal < (1UL << 7)) return 2;
+  if (literal < (1UL << 14)) return 3;
+  return 5;
+}
+
+template <bool kChecked>
+constexpr size_t BasicBaseMetaWriter<kChecked>::skip_size(
+    uint32_t num_skipped) {
+  if (num_skipped == 0) return 0;
+
+  // The first 3 skips go in the immediate.
+  uint32_t literal = num_skipped - (num_skipped < 3 ? num_skipped : 3);
+  if (literal == 0) return 1;
+  if (literal < (1UL << 7)) return 2;
+  if (literal < (1UL << 14)) return 3;
+  return 5;
+}
+
+template <bool kChecked>
+constexpr size_t BasicBaseMetaWriter<kChecked>::one_field_size(
+    uint32_t num_skipped) {
+  return 1 + (num_skipped <= 3 ? 0 : skip_size(num_skipped - 3));
+}
+
+template <bool kChecked>
+inline uint8_t BasicBaseMetaWriter<kChecked>::immediate_for_zeroable_width(
     uint8_t data_width) {
   assert(data_width <= 4 && (data_width & (data_width - 1)) == 0);
   // We want the identify for [0, 2], and 4 -> 3.
   return data_width - (data_width / 4);
 }
 
-inline uint8_t BaseMetaWriter::immediate_for_nonzero_width(uint8_t data_width) {
+template <bool kChecked>
+inline uint8_t BasicBaseMetaWriter<kChecked>::immediate_for_nonzero_width(
+    uint8_t data_width) {
   assert(data_width <= 8 && data_width > 0 &&
          (data_width & (data_width - 1)) == 0);
   //  1 -> 0
@@ -165,12 +278,14 @@ inline uint8_t BaseMetaWriter::immediate_for_nonzero_width(uint8_t data_width) {
   return (data_width / 2) - (data_width / 8);
 }
 
-inline void BaseMetaWriter::imm_imm(Opcode op, uint8_t imm1, uint8_t imm2) {
+template <bool kChecked>
+inline void BasicBaseMetaWriter<kChecked>::imm_imm(Opcode op, uint8_t imm1,
+                                                   uint8_t imm2) {
   assert(imm1 < 4);
   assert(imm2 < 4);
 
   uint8_t encoded = (uint8_t)op | (imm2 << 3) | (imm1 << 5);
-  memcpy(buf.reserve(1), &encoded, 1);
+  memcpy(reserve(1), &encoded, 1);
 
   buf.commit(1);
   return;
@@ -0,0 +1,193 @@
+#include "batch.h"
+
+#include <assert.h>
+#include <cstring>
+#include <string>
+
+namespace {
+constexpr char kBatchMagic[4] = {'S', 'P', 'B', '1'};
+
+void store32(uint8_t *dst, uint32_t value) {
+  memcpy(dst, &value, sizeof(value));
+}
+}  // namespace
+
+bool BatchWriter::end_record() {
+  size_t meta_end = meta.base.buf.written();
+  size_t data_end = data.buf.written();
+
+  if (meta_end > UINT32_MAX || data_end > UINT32_MAX || count_ >= UINT32_MAX)
+    return false;
+
+  uint8_t *entry = (uint8_t *)index_.reserve(kBatchIndexEntrySize);
+
+  store32(entry, meta_end);
+  store32(entry + 4, data_end);
+  index_.commit(kBatchIndexEntrySize);
+
+  meta_end_ = meta_end;
+  data_end_ = data_end;
+  count_++;
+  return true;
+}
+
+bool BatchWriter::append(const void *meta_bytes, size_t meta_size,
+                         const void *data_bytes, size_t data_size) {
+  if (meta_size > UINT32_MAX - meta_end_ || data_size > UINT32_MAX - data_end_)
+    return false;
+
+  memcpy(meta.base.buf.reserve(meta_size), meta_bytes, meta_size);
+  meta.base.buf.commit(meta_size);
+  memcpy(data.buf.reserve(data_size), data_bytes, data_size);
+  data.buf.commit(data_size);
+  return end_record();
+}
+
+size_t BatchWriter::finished_size() const {
+  return kBatchHeaderSize + index_.written() + meta_end_ + data_end_;
+}
+
+void BatchWriter::finish(WriteBuffer *out) {
+  size_t size = finished_size();
+  uint8_t *dst = (uint8_t *)out->reserve(size);
+
+  memcpy(dst, kBatchMagic, sizeof(kBatchMagic));
+  store32(dst + 4, count_);
+  dst += kBatchHeaderSize;
+  memcpy(dst, index_.data(), index_.written());
+  dst += index_.written();
+  memcpy(dst, meta.base.buf.data(), meta_end_);
+  dst += meta_end_;
+  memcpy(dst, data.buf.data(), data_end_);
+  out->commit(size);
+
+  meta.base.buf.reset();
+  data.buf.reset();
+  index_.reset();
+  count_ = 0;
+  meta_end_ = 0;
+  data_end_ = 0;
+  return;
+}
+
+bool BatchReader::init(const void *bytes, size_t size) {
+  const uint8_t *src = (const uint8_t *)bytes;
+
+  *this = BatchReader();
+  if (size < kBatchHeaderSize || memcmp(src, kBatchMagic, 4) != 0)
+    return false;
+
+  size_t count = load32(src + 4);
+  size_t index_size = kBatchIndexEntrySize * count;
+
+  if (index_size > size - kBatchHeaderSize) return false;
+
+  const uint8_t *index = src + kBatchHeaderSize;
+  size_t meta_size = 0;
+  size_t data_size = 0;
+
+  if (count > 0) {
+    const uint8_t *last = index + index_size - kBatchIndexEntrySize;
+
+    meta_size = load32(last);
+    data_size = load32(last + 4);
+  }
+
+  if (kBatchHeaderSize + index_size + meta_size + data_size != size)
+    return false;
+
+  index_ = index;
+  meta_ = index + index_size;
+  data_ = meta_ + meta_size;
+  count_ = count;
+  meta_size_ = meta_size;
+  data_size_ = data_size;
+  return true;
+}
+
+void BatchSelfTest() {
+  BatchWriter writer(16, 16);
+  WriteBuffer out(16);
+
+  // Three records: empty, one field, and a copy of the second.
+  writer.meta.close(0);
+  assert(writer.end_record());
+
+  size_t meta_begin = writer.meta.base.buf.written();
+
+  writer.meta.field(1, writer.data.varint(300));
+  writer.meta.close(writer.data.buf.written());
+  assert(writer.end_record());
+
+  std::string meta_copy(
+      (const char *)writer.meta.base.buf.data() + meta_begin,
+      writer.meta.base.buf.written() - meta_begin);
+  std::string data_copy((const char *)writer.data.buf.data(),
+                        writer.data.buf.written());
+
+  assert(writer.append(meta_copy.data(), meta_copy.size(), data_copy.data(),
+                       data_copy.size()));
+  assert(writer.count() == 3);
+
+  size_t size = writer.finished_size();
+  writer.finish(&out);
+  (void)size;
+  assert(out.written() == size && writer.count() == 0);
+  assert(writer.finished_size() == kBatchHeaderSize);
+
+  BatchReader reader;
+  BatchRecord record;
+
+  assert(reader.init(out.data(), out.written()));
+  assert(reader.count() == 3);
+  assert(reader.record(0, &record));
+  assert(record.meta_size == meta_begin && record.data_size == 0);
+  assert(reader.record(2, &record));
+  assert(record.meta_size == meta_copy.size());
+  assert(record.data_size == data_copy.size());
+  assert(memcmp(record.meta, meta_copy.data(), meta_copy.size()) == 0);
+  assert(memcmp(record.data, data_copy.data(), data_copy.size()) == 0);
+  assert(!reader.record(3, &record));
+
+  // Sequential reads cover both regions exactly.
+  size_t meta_total = 0;
+  size_t data_total = 0;
+
+  reader.seek(0);
+  while (reader.next(&record)) {
+    meta_total += record.meta_size;
+    data_total += record.data_size;
+  }
+
+  (void)meta_total;
+  (void)data_total;
+  assert(kBatchHeaderSize + 3 * kBatchIndexEntrySize + meta_total +
+             data_total ==
+         out.written());
+
+  // An empty batch is valid.
+  WriteBuffer empty(16);
+
+  writer.finish(&empty);
+  assert(reader.init(empty.data(), empty.written()) && reader.count() == 0);
+  assert(!reader.next(&record));
+
+  // Bad magic, truncation, trailing bytes, and out of order entries.
+  std::string bytes((const char *)out.data(), out.written());
+
+  assert(!reader.init(bytes.data(), 4));
+  assert(!reader.init(bytes.data(), bytes.size() - 1));
+  assert(!reader.init((bytes + "x").data(), bytes.size() + 1));
+  bytes[0] = 'X';
+  assert(!reader.init(bytes.data(), bytes.size()));
+  bytes[0] = 'S';
+
+  // Record 1 ends past the meta region, so records 1 and 2 are bad.
+  uint32_t late = 1000;
+  memcpy(&bytes[kBatchHeaderSize + kBatchIndexEntrySize], &late, 4);
+  assert(reader.init(bytes.data(), bytes.size()));
+  assert(reader.record(0, &record));
+  assert(!reader.record(1, &record));
+  assert(!reader.record(2, &record));
+  return;
+}
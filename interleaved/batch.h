@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "data_writer.h"
+#include "meta_writer.h"
+#include "write_buffer.h"
+
+/// Batches pack many top-level split messages ("records") into one
+/// container: every record's metadata stream back to back in a meta
+/// region, every data stream in a data region, and an index of where
+/// each record ends in both regions.
+///
+/// The container is laid out as:
+///
+///   "SPB1"                   4-byte magic
+///   count                    uint32_t, number of records
+///   index[count]             {uint32_t meta_end, uint32_t data_end}
+///   meta region              the metadata streams, in record order
+///   data region              the data streams, in record order
+///
+/// Integers are little-endian.  Record `i` spans `[index[i - 1].end,
+/// index[i].end)` in each region (from 0 for the first record), so the
+/// region sizes are the last record's ends, and each region holds at
+/// most 4 GiB.
+constexpr size_t kBatchHeaderSize = 8;
+constexpr size_t kBatchIndexEntrySize = 8;
+
+/// A `BatchWriter` builds a container one record at a time.  Encode
+/// each record to `meta` and `data` (e.g., with
+/// `codegen::EncodeMessage`), then call `end_record`; or copy an
+/// already encoded record with `append`.
+struct BatchWriter {
+  /// Starts with room for this many bytes in each region.
+  explicit BatchWriter(size_t meta_capacity = 1024,
+                       size_t data_capacity = 4096)
+      : meta(meta_capacity), data(data_capacity), index_(256) {}
+
+  /// `BatchWriter`s are move-only, like `WriteBuffer`s.
+  BatchWriter(const BatchWriter &) = delete;
+  BatchWriter(BatchWriter &&) = default;
+  BatchWriter &operator=(const BatchWriter &) = delete;
+  BatchWriter &operator=(BatchWriter &&) = delete;
+
+  ~BatchWriter() = default;
+
+  /// Ends the record written to `meta` and `data` since the last
+  /// record.
+  ///
+  /// Returns false if either region would exceed 4 GiB: the record
+  /// isn't added, and `finish` drops its bytes.
+  bool end_record();
+
+  /// Appends a record with the `meta_size` bytes of metadata at
+  /// `meta_bytes`, and the `data_size` bytes of data at `data_bytes`.
+  ///
+  /// Returns false if either region would exceed 4 GiB.
+  bool append(const void *meta_bytes, size_t meta_size,
+              const void *data_bytes, size_t data_size);
+
+  /// Number of records so far.
+  size_t count() const { return count_; }
+
+  /// Size of the container `finish` would write.
+  size_t finished_size() const;
+
+  /// Appends the container to `out`, and resets the writer for the
+  /// next batch (keeping its buffers).
+  void finish(WriteBuffer *out);
+
+  MetaWriter meta;
+  DataWriter data;
+
+ private:
+  WriteBuffer index_;
+  size_t count_{0};
+  uint32_t meta_end_{0};
+  uint32_t data_end_{0};
+};
+
+/// One record in a batch: pointers into the container.
+struct BatchRecord {
+  const uint8_t *meta;
+  size_t meta_size;
+  const uint8_t *data;
+  size_t data_size;
+};
+
+/// A `BatchReader` reads the records of a container in place, either
+/// in constant time by index, or sequentially with `next`.
+struct BatchReader {
+  BatchReader() = default;
+
+  /// Reads the `size`-byte container at `bytes`, which must outlive
+  /// the reader.  Only checks the header and the region sizes: the
+  /// index entries are checked as they're read.
+  ///
+  /// Returns false if the container is malformed.
+  bool init(const void *bytes, size_t size);
+
+  /// Number of records.
+  size_t count() const { return count_; }
+
+  /// Finds record `i`.
+  ///
+  /// Returns false if `i` is out of range, or its index entries are
+  /// out of order or past their region.
+  inline bool record(size_t i, BatchRecord *out) const;
+
+  /// Moves the cursor for `next` to record `i`.
+  void seek(size_t i) { cursor_ = i; }
+
+  /// Finds the record at the cursor, and advances the cursor.
+  ///
+  /// Returns false at the end of the batch, or on a malformed entry.
+  bool next(BatchRecord *out) { return record(cursor_++, out); }
+
+ private:
+  static inline uint32_t load32(const uint8_t *src) {
+    uint32_t ret;
+
+    memcpy(&ret, src, sizeof(ret));
+    return ret;
+  }
+
+  const uint8_t *index_{nullptr};
+  const uint8_t *meta_{nullptr};
+  const uint8_t *data_{nullptr};
+  size_t count_{0};
+  size_t meta_size_{0};
+  size_t data_size_{0};
+  size_t cursor_{0};
+};
+
+bool BatchReader::record(size_t i, BatchRecord *out) const {
+  if (__builtin_expect(i >= count_, 0)) return false;
+
+  const uint8_t *entry = index_ + kBatchIndexEntrySize * i;
+  uint32_t meta_begin = (i == 0) ? 0 : load32(entry - kBatchIndexEntrySize);
+  uint32_t data_begin = (i == 0) ? 0 : load32(entry - 4);
+  uint32_t meta_end = load32(entry);
+  uint32_t data_end = load32(entry + 4);
+
+  if (__builtin_expect(meta_begin > meta_end || meta_end > meta_size_ ||
+                           data_begin > data_end || data_end > data_size_,
+                       0))
+    return false;
+
+  out->meta = meta_ + meta_begin;
+  out->meta_size = meta_end - meta_begin;
+  out->data = data_ + data_begin;
+  out->data_size = data_end - data_begin;
+  return true;
+}
+
+/// Builds, reads, and rejects small hand-written batches.
+void BatchSelfTest();
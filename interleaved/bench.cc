@@ -0,0 +1,263 @@
+#include "bench.h"
+
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define BENCH_TSC 1
+#endif
+
+namespace {
+uint64_t monotonic_ns() {
+  timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return 1000000000ULL * ts.tv_sec + ts.tv_nsec;
+}
+
+#ifdef BENCH_TSC
+/// The TSC is only a clock if it ticks at a constant rate, in all
+/// power states (CPUID 0x80000007, EDX bit 8).
+bool invariant_tsc() {
+  unsigned eax, ebx, ecx, edx;
+
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+  return (edx & (1U << 8)) != 0;
+}
+
+const bool use_tsc = invariant_tsc();
+
+uint64_t tsc() {
+  // Don't let the timed code move across the timestamps.
+  _mm_lfence();
+  uint64_t ret = __rdtsc();
+  _mm_lfence();
+  return ret;
+}
+#else
+const bool use_tsc = false;
+
+uint64_t tsc() { return monotonic_ns(); }
+#endif
+
+double calibrate() {
+  if (!use_tsc) return 1.0;
+
+  uint64_t ns_begin = monotonic_ns();
+  uint64_t tsc_begin = tsc();
+  uint64_t ns_end;
+
+  // 20 ms is enough for a rate accurate to ~0.01%.
+  do {
+    ns_end = monotonic_ns();
+  } while (ns_end - ns_begin < 20000000);
+
+  uint64_t tsc_end = tsc();
+  return (double)(ns_end - ns_begin) / (tsc_end - tsc_begin);
+}
+
+uint64_t measure_overhead() {
+  std::vector<uint64_t> samples(1001);
+
+  for (uint64_t &sample : samples) {
+    uint64_t begin = BenchClock::ticks();
+    sample = BenchClock::ticks() - begin;
+  }
+
+  std::nth_element(samples.begin(), samples.begin() + samples.size() / 2,
+                   samples.end());
+  return samples[samples.size() / 2];
+}
+
+/// Returns the sample at percentile `p` (nearest rank) of the sorted
+/// `samples`.
+uint64_t percentile(const std::vector<uint64_t> &samples, double p) {
+  size_t rank = (size_t)(p * samples.size() / 100 + 0.999999);
+
+  if (rank > 0) rank--;
+  return samples[std::min(rank, samples.size() - 1)];
+}
+}  // namespace
+
+uint64_t BenchClock::ticks() { return use_tsc ? tsc() : monotonic_ns(); }
+
+double BenchClock::ns_per_tick() {
+  static const double rate = calibrate();
+
+  return rate;
+}
+
+uint64_t BenchClock::overhead() {
+  static const uint64_t overhead = measure_overhead();
+
+  return overhead;
+}
+
+PerfCounters::PerfCounters(PerfCounters &&other) {
+  memcpy(fds_, other.fds_, sizeof(fds_));
+  std::fill(other.fds_, other.fds_ + kNumCounters, -1);
+}
+
+PerfCounters &PerfCounters::operator=(PerfCounters &&other) {
+  std::swap(fds_, other.fds_);
+  return *this;
+}
+
+PerfCounters::~PerfCounters() {
+  for (int fd : fds_) {
+    if (fd >= 0) close(fd);
+  }
+}
+
+bool PerfCounters::open() {
+#if defined(__linux__)
+  static const struct {
+    uint32_t type;
+    uint64_t config;
+  } kEvents[kNumCounters] = {
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+      {PERF_TYPE_HW_CACHE,
+       PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+  };
+  int fds[kNumCounters];
+
+  for (size_t i = 0; i < kNumCounters; i++) {
+    perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = kEvents[i].type;
+    attr.config = kEvents[i].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fds[i] < 0) {
+      for (size_t j = 0; j < i; j++) close(fds[j]);
+      return false;
+    }
+  }
+
+  *this = PerfCounters();
+  memcpy(fds_, fds, sizeof(fds_));
+  return true;
+#else
+  return false;
+#endif
+}
+
+void PerfCounters::start() {
+#if defined(__linux__)
+  if (!available()) return;
+
+  for (int fd : fds_) ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+  for (int fd : fds_) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+
+void PerfCounters::stop(uint64_t values[kNumCounters]) {
+#if defined(__linux__)
+  if (!available()) return;
+
+  for (int fd : fds_) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  for (size_t i = 0; i < kNumCounters; i++) {
+    if (read(fds_[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+      values[i] = 0;
+  }
+#else
+  (void)values;
+#endif
+}
+
+void BenchSummarize(std::vector<uint64_t> *samples, BenchStats *stats) {
+  double scale = BenchClock::ns_per_tick();
+  uint64_t total = 0;
+
+  stats->count = samples->size();
+  if (samples->empty()) return;
+
+  std::sort(samples->begin(), samples->end());
+  for (uint64_t sample : *samples) total += sample;
+
+  stats->mean_ns = scale * total / samples->size();
+  stats->p50_ns = scale * percentile(*samples, 50);
+  stats->p99_ns = scale * percentile(*samples, 99);
+  stats->p999_ns = scale * percentile(*samples, 99.9);
+  return;
+}
+
+void BenchReport(const char *name, size_t bytes, const BenchStats &stats) {
+  printf("%-48s %10.0f ns/msg %9.1f MB/s  p50 %.0f  p99 %.0f  p999 %.0f ns",
+         name, stats.mean_ns, 1e3 * bytes / stats.mean_ns, stats.p50_ns,
+         stats.p99_ns, stats.p999_ns);
+  if (stats.has_counters) {
+    printf("  (%.0f insns, %.1f br-miss, %.1f L1D-miss)",
+           stats.counters[PerfCounters::kInstructions],
+           stats.counters[PerfCounters::kBranchMisses],
+           stats.counters[PerfCounters::kL1DMisses]);
+  }
+
+  printf("\n");
+  fflush(stdout);
+  return;
+}
+
+void BenchSelfTest() {
+  uint64_t begin = BenchClock::ticks();
+  uint64_t end = BenchClock::ticks();
+
+  (void)begin;
+  (void)end;
+  assert(end >= begin);
+  assert(BenchClock::ns_per_tick() > 0);
+
+  std::vector<uint64_t> samples;
+  BenchStats stats;
+
+  for (uint64_t i = 1000; i > 0; i--) samples.push_back(i);
+
+  // Back from nanoseconds to ticks.
+  BenchSummarize(&samples, &stats);
+  stats.mean_ns /= BenchClock::ns_per_tick();
+  stats.p50_ns /= BenchClock::ns_per_tick();
+  stats.p99_ns /= BenchClock::ns_per_tick();
+  stats.p999_ns /= BenchClock::ns_per_tick();
+
+  assert(stats.count == 1000);
+  assert(samples.front() == 1 && samples.back() == 1000);
+  assert(stats.mean_ns > 500.49 && stats.mean_ns < 500.51);
+  assert(stats.p50_ns > 499.99 && stats.p50_ns < 500.01);
+  assert(stats.p99_ns > 989.99 && stats.p99_ns < 990.01);
+  assert(stats.p999_ns > 998.99 && stats.p999_ns < 999.01);
+
+  // Either the counters work, or they do nothing.
+  PerfCounters counters;
+  uint64_t values[PerfCounters::kNumCounters] = {42, 42, 42};
+
+  if (counters.open()) {
+    counters.start();
+    counters.stop(values);
+    assert(values[PerfCounters::kInstructions] < 100000);
+  } else {
+    counters.start();
+    counters.stop(values);
+    assert(!counters.available() && values[0] == 42);
+  }
+
+  return;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Benchmark support for `test.cc`: a low-overhead timer, per-call
+/// latency percentiles, and optional hardware counters, so that
+/// encode and decode numbers can be compared with the protobuf
+/// `cpp-benchmark` table in the README.
+
+/// Monotonic timestamps: `rdtsc` (fenced) on x86-64, and
+/// `clock_gettime(CLOCK_MONOTONIC)` elsewhere.
+struct BenchClock {
+  static uint64_t ticks();
+
+  /// Nanoseconds per tick.  The TSC's rate is calibrated against
+  /// `CLOCK_MONOTONIC` on the first call.
+  static double ns_per_tick();
+
+  /// Median number of ticks between two back-to-back `ticks()`,
+  /// subtracted from each latency sample.
+  static uint64_t overhead();
+};
+
+/// Hardware counters for the calling thread, via `perf_event_open`:
+/// retired instructions, branch misses, and L1D read misses.
+///
+/// Counters are optional: `open` fails (e.g., in containers, or with
+/// `perf_event_paranoid` > 2), and benchmarks then only report times.
+class PerfCounters {
+ public:
+  enum Counter { kInstructions, kBranchMisses, kL1DMisses, kNumCounters };
+
+  PerfCounters() = default;
+
+  /// `PerfCounters` are move-only: they own file descriptors.
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters(PerfCounters &&);
+  PerfCounters &operator=(const PerfCounters &) = delete;
+  PerfCounters &operator=(PerfCounters &&);
+
+  ~PerfCounters();
+
+  /// Opens all the counters, disabled.
+  ///
+  /// Returns false (and leaves the counters closed) if any of them
+  /// is unavailable.
+  bool open();
+
+  bool available() const { return fds_[0] >= 0; }
+
+  /// Resets and enables the counters.  No-op if not `available()`.
+  void start();
+
+  /// Disables the counters, and stores their values in `values`.
+  /// No-op if not `available()`.
+  void stop(uint64_t values[kNumCounters]);
+
+ private:
+  int fds_[kNumCounters]{-1, -1, -1};
+};
+
+/// Summary of one benchmark: the mean and percentiles of the per-call
+/// latencies, net of the timer's overhead.
+struct BenchStats {
+  size_t count{0};
+  double mean_ns{0};
+  double p50_ns{0};
+  double p99_ns{0};
+  double p999_ns{0};
+
+  /// Per-call averages, if `has_counters`.
+  bool has_counters{false};
+  double counters[PerfCounters::kNumCounters]{};
+};
+
+/// Computes the mean and percentiles (nearest rank) of the latency
+/// `samples`, in ticks; `samples` is sorted in place.
+void BenchSummarize(std::vector<uint64_t> *samples, BenchStats *stats);
+
+/// Calls `fn()` `niter / 8` times to warm up, then `niter` times, each
+/// timed separately, with `counters` (if available) measuring the
+/// whole timed loop, timer included.
+template <typename Fn>
+BenchStats RunBench(size_t niter, PerfCounters *counters, Fn fn) {
+  std::vector<uint64_t> samples(niter);
+  uint64_t values[PerfCounters::kNumCounters];
+  BenchStats stats;
+  uint64_t overhead = BenchClock::overhead();
+
+  for (size_t i = 0; i < niter / 8; i++) fn();
+
+  counters->start();
+  for (size_t i = 0; i < niter; i++) {
+    uint64_t t0 = BenchClock::ticks();
+    fn();
+    uint64_t t1 = BenchClock::ticks();
+
+    samples[i] = (t1 - t0 > overhead) ? t1 - t0 - overhead : 0;
+  }
+
+  counters->stop(values);
+  BenchSummarize(&samples, &stats);
+  if (counters->available()) {
+    stats.has_counters = true;
+    for (size_t i = 0; i < PerfCounters::kNumCounters; i++)
+      stats.counters[i] = (double)values[i] / niter;
+  }
+
+  return stats;
+}
+
+/// Prints one line for `stats`: ns/msg, MB/s of `bytes` per call, the
+/// latency percentiles, and counters per message, if any.
+void BenchReport(const char *name, size_t bytes, const BenchStats &stats);
+
+void BenchSelfTest();
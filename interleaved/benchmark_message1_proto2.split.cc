@@ -0,0 +1,731 @@
+// Generated by splitc from benchmark_message1_proto2.proto.  Do not edit.
+#include "benchmark_message1_proto2.split.h"
+
+#include "parallel_encode.h"
+#include "split_literal_meta.h"
+
+namespace benchmarks::proto2 {
+namespace {
+template <typename Meta, typename Data>
+void EncodeFieldsImpl(const GoogleMessage1SubMessage &message, Meta *meta, Data *data,
+                      const codegen::ParallelOptions &parallel) {
+  (void)parallel;
+  if (message.has_field1) {
+    meta->field(1, data->varint((uint64_t)(int64_t)message.field1));
+  }
+
+  if (message.has_field2) {
+    meta->field(2, data->varint((uint64_t)(int64_t)message.field2));
+  }
+
+  if (message.has_field3) {
+    meta->field(3, data->varint((uint64_t)(int64_t)message.field3));
+  }
+
+  if (message.has_field12) {
+    meta->field(12, data->fixed(message.field12));
+  }
+
+  if (message.has_field13) {
+    meta->field(13, data->varint((uint64_t)(int64_t)message.field13));
+  }
+
+  if (message.has_field14) {
+    meta->field(14, data->varint((uint64_t)(int64_t)message.field14));
+  }
+
+  if (message.has_field15) {
+    meta->string(15, data->string(message.field15));
+  }
+
+  if (message.has_field16) {
+    meta->field(16, data->varint((uint64_t)(int64_t)message.field16));
+  }
+
+  if (message.has_field19) {
+    meta->field(19, data->varint((uint64_t)(int64_t)message.field19));
+  }
+
+  if (message.has_field20) {
+    meta->field(20, data->fixed(message.field20));
+  }
+
+  if (message.has_field21) {
+    meta->field(21, data->fixed(message.field21));
+  }
+
+  if (message.has_field22) {
+    meta->field(22, data->varint((uint64_t)(int64_t)message.field22));
+  }
+
+  if (message.has_field23) {
+    meta->field(23, data->fixed(message.field23));
+  }
+
+  if (message.has_field28) {
+    meta->field(28, data->fixed(message.field28));
+  }
+
+  if (message.has_field203) {
+    meta->field(203, data->fixed(message.field203));
+  }
+
+  if (message.has_field204) {
+    meta->field(204, data->varint((uint64_t)(int64_t)message.field204));
+  }
+
+  if (message.has_field205) {
+    meta->string(205, data->string(message.field205));
+  }
+
+  if (message.has_field206) {
+    meta->field(206, data->fixed(message.field206));
+  }
+
+  if (message.has_field207) {
+    meta->field(207, data->varint((uint64_t)(int64_t)message.field207));
+  }
+
+  if (message.has_field300) {
+    meta->field(300, data->varint((uint64_t)(int64_t)message.field300));
+  }
+}
+}  // namespace
+
+void EncodeFields(const GoogleMessage1SubMessage &message, MetaWriter *meta,
+                  DataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage1SubMessage &message, UncheckedMetaWriter *meta,
+                  UncheckedDataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage1SubMessage &message, SplitLiteralMetaWriter *meta,
+                  DataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage1SubMessage &message, MetaWriter *meta,
+                  DataWriter *data,
+                  const codegen::ParallelOptions &options) {
+  EncodeFieldsImpl(message, meta, data, options);
+}
+
+void AddEncodeBounds(const GoogleMessage1SubMessage &message,
+                     codegen::EncodeBounds *bounds) {
+  codegen::AddFieldBounds(8, bounds, message.has_field1);
+  codegen::AddFieldBounds(8, bounds, message.has_field2);
+  codegen::AddFieldBounds(8, bounds, message.has_field3);
+  codegen::AddStringBounds(message.field15.size(), bounds, message.has_field15);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field12);
+  codegen::AddFieldBounds(8, bounds, message.has_field13);
+  codegen::AddFieldBounds(8, bounds, message.has_field14);
+  codegen::AddFieldBounds(8, bounds, message.has_field16);
+  codegen::AddFieldBounds(8, bounds, message.has_field19);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field20);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field28);
+  codegen::AddFieldBounds(sizeof(uint64_t), bounds, message.has_field21);
+  codegen::AddFieldBounds(8, bounds, message.has_field22);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field23);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field206);
+  codegen::AddFieldBounds(sizeof(uint32_t), bounds, message.has_field203);
+  codegen::AddFieldBounds(8, bounds, message.has_field204);
+  codegen::AddStringBounds(message.field205.size(), bounds,
+                           message.has_field205);
+  codegen::AddFieldBounds(8, bounds, message.has_field207);
+  codegen::AddFieldBounds(8, bounds, message.has_field300);
+}
+
+bool DecodeField(uint32_t field, size_t width, const uint8_t *src,
+                 GoogleMessage1SubMessage *message) {
+  switch (field) {
+    case 1:
+      message->has_field1 = true;
+      return codegen::DecodeValue(src, width, &message->field1);
+    case 2:
+      message->has_field2 = true;
+      return codegen::DecodeValue(src, width, &message->field2);
+    case 3:
+      message->has_field3 = true;
+      return codegen::DecodeValue(src, width, &message->field3);
+    case 15:
+      message->has_field15 = true;
+      return codegen::DecodeValue(src, width, &message->field15);
+    case 12:
+      message->has_field12 = true;
+      return codegen::DecodeValue(src, width, &message->field12);
+    case 13:
+      message->has_field13 = true;
+      return codegen::DecodeValue(src, width, &message->field13);
+    case 14:
+      message->has_field14 = true;
+      return codegen::DecodeValue(src, width, &message->field14);
+    case 16:
+      message->has_field16 = true;
+      return codegen::DecodeValue(src, width, &message->field16);
+    case 19:
+      message->has_field19 = true;
+      return codegen::DecodeValue(src, width, &message->field19);
+    case 20:
+      message->has_field20 = true;
+      return codegen::DecodeValue(src, width, &message->field20);
+    case 28:
+      message->has_field28 = true;
+      return codegen::DecodeValue(src, width, &message->field28);
+    case 21:
+      message->has_field21 = true;
+      return codegen::DecodeValue(src, width, &message->field21);
+    case 22:
+      message->has_field22 = true;
+      return codegen::DecodeValue(src, width, &message->field22);
+    case 23:
+      message->has_field23 = true;
+      return codegen::DecodeValue(src, width, &message->field23);
+    case 206:
+      message->has_field206 = true;
+      return codegen::DecodeValue(src, width, &message->field206);
+    case 203:
+      message->has_field203 = true;
+      return codegen::DecodeValue(src, width, &message->field203);
+    case 204:
+      message->has_field204 = true;
+      return codegen::DecodeValue(src, width, &message->field204);
+    case 205:
+      message->has_field205 = true;
+      return codegen::DecodeValue(src, width, &message->field205);
+    case 207:
+      message->has_field207 = true;
+      return codegen::DecodeValue(src, width, &message->field207);
+    case 300:
+      message->has_field300 = true;
+      return codegen::DecodeValue(src, width, &message->field300);
+    default:
+      return true;
+  }
+}
+
+bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+                size_t depth, MetaReader *meta, DataReader *data,
+                GoogleMessage1SubMessage *) {
+  switch (field) {
+    default:
+      return codegen::DecodeOpen(field, len_hint, first_width, depth, meta,
+                                 data, (codegen::Ignored *)nullptr);
+  }
+}
+
+namespace {
+template <typename Meta, typename Data>
+void EncodeFieldsImpl(const GoogleMessage1 &message, Meta *meta, Data *data,
+                      const codegen::ParallelOptions &parallel) {
+  (void)parallel;
+  if (message.has_field1) {
+    meta->string(1, data->string(message.field1));
+  }
+
+  if (message.has_field2) {
+    meta->field(2, data->varint((uint64_t)(int64_t)message.field2));
+  }
+
+  if (message.has_field3) {
+    meta->field(3, data->varint((uint64_t)(int64_t)message.field3));
+  }
+
+  if (message.has_field4) {
+    meta->string(4, data->string(message.field4));
+  }
+
+  if (!message.field5.empty()) {
+    codegen::EncodeRun(meta, data, 5, true, message.field5.size(), [&](size_t i) {
+      meta->field(1, data->fixed(message.field5[i]));
+    });
+  }
+
+  if (message.has_field6) {
+    meta->field(6, data->varint((uint64_t)(int64_t)message.field6));
+  }
+
+  if (message.has_field7) {
+    meta->string(7, data->string(message.field7));
+  }
+
+  if (message.has_field9) {
+    meta->string(9, data->string(message.field9));
+  }
+
+  if (message.has_field12) {
+    meta->field(12, data->fixed(message.field12));
+  }
+
+  if (message.has_field13) {
+    meta->field(13, data->fixed(message.field13));
+  }
+
+  if (message.has_field14) {
+    meta->field(14, data->fixed(message.field14));
+  }
+
+  if (message.has_field15) {
+    codegen::EncodeRun(meta, data, 15, false, 1, [&](size_t) {
+      EncodeFields(message.field15, meta, data);
+    });
+  }
+
+  if (message.has_field16) {
+    meta->field(16, data->varint((uint64_t)(int64_t)message.field16));
+  }
+
+  if (message.has_field17) {
+    meta->field(17, data->fixed(message.field17));
+  }
+
+  if (message.has_field18) {
+    meta->string(18, data->string(message.field18));
+  }
+
+  if (message.has_field22) {
+    meta->field(22, data->varint((uint64_t)(int64_t)message.field22));
+  }
+
+  if (message.has_field23) {
+    meta->field(23, data->varint((uint64_t)(int64_t)message.field23));
+  }
+
+  if (message.has_field24) {
+    meta->field(24, data->fixed(message.field24));
+  }
+
+  if (message.has_field25) {
+    meta->field(25, data->varint((uint64_t)(int64_t)message.field25));
+  }
+
+  if (message.has_field29) {
+    meta->field(29, data->varint((uint64_t)(int64_t)message.field29));
+  }
+
+  if (message.has_field30) {
+    meta->field(30, data->fixed(message.field30));
+  }
+
+  if (message.has_field59) {
+    meta->field(59, data->fixed(message.field59));
+  }
+
+  if (message.has_field60) {
+    meta->field(60, data->varint((uint64_t)(int64_t)message.field60));
+  }
+
+  if (message.has_field67) {
+    meta->field(67, data->varint((uint64_t)(int64_t)message.field67));
+  }
+
+  if (message.has_field68) {
+    meta->field(68, data->varint((uint64_t)(int64_t)message.field68));
+  }
+
+  if (message.has_field78) {
+    meta->field(78, data->fixed(message.field78));
+  }
+
+  if (message.has_field80) {
+    meta->field(80, data->fixed(message.field80));
+  }
+
+  if (message.has_field81) {
+    meta->field(81, data->fixed(message.field81));
+  }
+
+  if (message.has_field100) {
+    meta->field(100, data->varint((uint64_t)(int64_t)message.field100));
+  }
+
+  if (message.has_field101) {
+    meta->field(101, data->varint((uint64_t)(int64_t)message.field101));
+  }
+
+  if (message.has_field102) {
+    meta->string(102, data->string(message.field102));
+  }
+
+  if (message.has_field103) {
+    meta->string(103, data->string(message.field103));
+  }
+
+  if (message.has_field104) {
+    meta->field(104, data->varint((uint64_t)(int64_t)message.field104));
+  }
+
+  if (message.has_field128) {
+    meta->field(128, data->varint((uint64_t)(int64_t)message.field128));
+  }
+
+  if (message.has_field129) {
+    meta->string(129, data->string(message.field129));
+  }
+
+  if (message.has_field130) {
+    meta->field(130, data->varint((uint64_t)(int64_t)message.field130));
+  }
+
+  if (message.has_field131) {
+    meta->field(131, data->varint((uint64_t)(int64_t)message.field131));
+  }
+
+  if (message.has_field150) {
+    meta->field(150, data->varint((uint64_t)(int64_t)message.field150));
+  }
+
+  if (message.has_field271) {
+    meta->field(271, data->varint((uint64_t)(int64_t)message.field271));
+  }
+
+  if (message.has_field272) {
+    meta->field(272, data->varint((uint64_t)(int64_t)message.field272));
+  }
+
+  if (message.has_field280) {
+    meta->field(280, data->varint((uint64_t)(int64_t)message.field280));
+  }
+}
+}  // namespace
+
+void EncodeFields(const GoogleMessage1 &message, MetaWriter *meta,
+                  DataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage1 &message, UncheckedMetaWriter *meta,
+                  UncheckedDataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage1 &message, SplitLiteralMetaWriter *meta,
+                  DataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage1 &message, MetaWriter *meta,
+                  DataWriter *data,
+                  const codegen::ParallelOptions &options) {
+  EncodeFieldsImpl(message, meta, data, options);
+}
+
+void AddEncodeBounds(const GoogleMessage1 &message,
+                     codegen::EncodeBounds *bounds) {
+  codegen::AddStringBounds(message.field1.size(), bounds, message.has_field1);
+  codegen::AddStringBounds(message.field9.size(), bounds, message.has_field9);
+  codegen::AddStringBounds(message.field18.size(), bounds, message.has_field18);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field80);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field81);
+  codegen::AddFieldBounds(8, bounds, message.has_field2);
+  codegen::AddFieldBounds(8, bounds, message.has_field3);
+  codegen::AddFieldBounds(8, bounds, message.has_field280);
+  codegen::AddFieldBounds(8, bounds, message.has_field6);
+  codegen::AddFieldBounds(8, bounds, message.has_field22);
+  codegen::AddStringBounds(message.field4.size(), bounds, message.has_field4);
+  codegen::AddRunBounds(message.field5.size(), bounds);
+  codegen::AddFieldBounds(sizeof(uint64_t), bounds, message.field5.size());
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field59);
+  codegen::AddStringBounds(message.field7.size(), bounds, message.has_field7);
+  codegen::AddFieldBounds(8, bounds, message.has_field16);
+  codegen::AddFieldBounds(8, bounds, message.has_field130);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field12);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field17);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field13);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field14);
+  codegen::AddFieldBounds(8, bounds, message.has_field104);
+  codegen::AddFieldBounds(8, bounds, message.has_field100);
+  codegen::AddFieldBounds(8, bounds, message.has_field101);
+  codegen::AddStringBounds(message.field102.size(), bounds,
+                           message.has_field102);
+  codegen::AddStringBounds(message.field103.size(), bounds,
+                           message.has_field103);
+  codegen::AddFieldBounds(8, bounds, message.has_field29);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field30);
+  codegen::AddFieldBounds(8, bounds, message.has_field60);
+  codegen::AddFieldBounds(8, bounds, message.has_field271);
+  codegen::AddFieldBounds(8, bounds, message.has_field272);
+  codegen::AddFieldBounds(8, bounds, message.has_field150);
+  codegen::AddFieldBounds(8, bounds, message.has_field23);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field24);
+  codegen::AddFieldBounds(8, bounds, message.has_field25);
+  if (message.has_field15) {
+    codegen::AddRunBounds(1, bounds);
+    AddEncodeBounds(message.field15, bounds);
+  }
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field78);
+  codegen::AddFieldBounds(8, bounds, message.has_field67);
+  codegen::AddFieldBounds(8, bounds, message.has_field68);
+  codegen::AddFieldBounds(8, bounds, message.has_field128);
+  codegen::AddStringBounds(message.field129.size(), bounds,
+                           message.has_field129);
+  codegen::AddFieldBounds(8, bounds, message.has_field131);
+}
+
+bool DecodeField(uint32_t field, size_t width, const uint8_t *src,
+                 GoogleMessage1 *message) {
+  switch (field) {
+    case 1:
+      message->has_field1 = true;
+      return codegen::DecodeValue(src, width, &message->field1);
+    case 9:
+      message->has_field9 = true;
+      return codegen::DecodeValue(src, width, &message->field9);
+    case 18:
+      message->has_field18 = true;
+      return codegen::DecodeValue(src, width, &message->field18);
+    case 80:
+      message->has_field80 = true;
+      return codegen::DecodeValue(src, width, &message->field80);
+    case 81:
+      message->has_field81 = true;
+      return codegen::DecodeValue(src, width, &message->field81);
+    case 2:
+      message->has_field2 = true;
+      return codegen::DecodeValue(src, width, &message->field2);
+    case 3:
+      message->has_field3 = true;
+      return codegen::DecodeValue(src, width, &message->field3);
+    case 280:
+      message->has_field280 = true;
+      return codegen::DecodeValue(src, width, &message->field280);
+    case 6:
+      message->has_field6 = true;
+      return codegen::DecodeValue(src, width, &message->field6);
+    case 22:
+      message->has_field22 = true;
+      return codegen::DecodeValue(src, width, &message->field22);
+    case 4:
+      message->has_field4 = true;
+      return codegen::DecodeValue(src, width, &message->field4);
+    case 59:
+      message->has_field59 = true;
+      return codegen::DecodeValue(src, width, &message->field59);
+    case 7:
+      message->has_field7 = true;
+      return codegen::DecodeValue(src, width, &message->field7);
+    case 16:
+      message->has_field16 = true;
+      return codegen::DecodeValue(src, width, &message->field16);
+    case 130:
+      message->has_field130 = true;
+      return codegen::DecodeValue(src, width, &message->field130);
+    case 12:
+      message->has_field12 = true;
+      return codegen::DecodeValue(src, width, &message->field12);
+    case 17:
+      message->has_field17 = true;
+      return codegen::DecodeValue(src, width, &message->field17);
+    case 13:
+      message->has_field13 = true;
+      return codegen::DecodeValue(src, width, &message->field13);
+    case 14:
+      message->has_field14 = true;
+      return codegen::DecodeValue(src, width, &message->field14);
+    case 104:
+      message->has_field104 = true;
+      return codegen::DecodeValue(src, width, &message->field104);
+    case 100:
+      message->has_field100 = true;
+      return codegen::DecodeValue(src, width, &message->field100);
+    case 101:
+      message->has_field101 = true;
+      return codegen::DecodeValue(src, width, &message->field101);
+    case 102:
+      message->has_field102 = true;
+      return codegen::DecodeValue(src, width, &message->field102);
+    case 103:
+      message->has_field103 = true;
+      return codegen::DecodeValue(src, width, &message->field103);
+    case 29:
+      message->has_field29 = true;
+      return codegen::DecodeValue(src, width, &message->field29);
+    case 30:
+      message->has_field30 = true;
+      return codegen::DecodeValue(src, width, &message->field30);
+    case 60:
+      message->has_field60 = true;
+      return codegen::DecodeValue(src, width, &message->field60);
+    case 271:
+      message->has_field271 = true;
+      return codegen::DecodeValue(src, width, &message->field271);
+    case 272:
+      message->has_field272 = true;
+      return codegen::DecodeValue(src, width, &message->field272);
+    case 150:
+      message->has_field150 = true;
+      return codegen::DecodeValue(src, width, &message->field150);
+    case 23:
+      message->has_field23 = true;
+      return codegen::DecodeValue(src, width, &message->field23);
+    case 24:
+      message->has_field24 = true;
+      return codegen::DecodeValue(src, width, &message->field24);
+    case 25:
+      message->has_field25 = true;
+      return codegen::DecodeValue(src, width, &message->field25);
+    case 78:
+      message->has_field78 = true;
+      return codegen::DecodeValue(src, width, &message->field78);
+    case 67:
+      message->has_field67 = true;
+      return codegen::DecodeValue(src, width, &message->field67);
+    case 68:
+      message->has_field68 = true;
+      return codegen::DecodeValue(src, width, &message->field68);
+    case 128:
+      message->has_field128 = true;
+      return codegen::DecodeValue(src, width, &message->field128);
+    case 129:
+      message->has_field129 = true;
+      return codegen::DecodeValue(src, width, &message->field129);
+    case 131:
+      message->has_field131 = true;
+      return codegen::DecodeValue(src, width, &message->field131);
+    default:
+      return true;
+  }
+}
+
+bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+                size_t depth, MetaReader *meta, DataReader *data,
+                GoogleMessage1 *message) {
+  switch (field) {
+    case 5:
+      return codegen::DecodeAppend(meta, data, first_width, depth,
+                                   &message->field5);
+    case 15:
+      message->has_field15 = true;
+      return codegen::DecodeOne(meta, data, first_width, depth,
+                                &message->field15);
+    default:
+      return codegen::DecodeOpen(field, len_hint, first_width, depth, meta,
+                                 data, (codegen::Ignored *)nullptr);
+  }
+}
+
+namespace {
+const FieldSchema kGoogleMessage1SubMessageFields[] = {
+    {1, FieldKind::Varint, false, nullptr},
+    {2, FieldKind::Varint, false, nullptr},
+    {3, FieldKind::Varint, false, nullptr},
+    {12, FieldKind::Bool, false, nullptr},
+    {13, FieldKind::Varint, false, nullptr},
+    {14, FieldKind::Varint, false, nullptr},
+    {15, FieldKind::Bytes, false, nullptr},
+    {16, FieldKind::Varint, false, nullptr},
+    {19, FieldKind::Varint, false, nullptr},
+    {20, FieldKind::Bool, false, nullptr},
+    {21, FieldKind::Fixed64, false, nullptr},
+    {22, FieldKind::Varint, false, nullptr},
+    {23, FieldKind::Bool, false, nullptr},
+    {28, FieldKind::Bool, false, nullptr},
+    {203, FieldKind::Fixed32, false, nullptr},
+    {204, FieldKind::Varint, false, nullptr},
+    {205, FieldKind::Bytes, false, nullptr},
+    {206, FieldKind::Bool, false, nullptr},
+    {207, FieldKind::Varint, false, nullptr},
+    {300, FieldKind::Varint, false, nullptr},
+};
+
+const uint16_t kGoogleMessage1SubMessageIndex[] = {
+    0, 1, 2, 3, 0, 0, 0, 0, 0, 0, 0, 0, 4, 5, 6, 7,
+    8, 0, 0, 9, 10, 11, 12, 13, 0, 0, 0, 0, 14, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 15, 16, 17, 18, 19,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 20,
+};
+}  // namespace
+
+const MessageSchema kGoogleMessage1SubMessageSchema = {
+    "GoogleMessage1SubMessage", kGoogleMessage1SubMessageFields, 20,
+    kGoogleMessage1SubMessageIndex, 301};
+
+namespace {
+const FieldSchema kGoogleMessage1Fields[] = {
+    {1, FieldKind::Bytes, false, nullptr},
+    {2, FieldKind::Varint, false, nullptr},
+    {3, FieldKind::Varint, false, nullptr},
+    {4, FieldKind::Bytes, false, nullptr},
+    {5, FieldKind::Fixed64, true, nullptr},
+    {6, FieldKind::Varint, false, nullptr},
+    {7, FieldKind::Bytes, false, nullptr},
+    {9, FieldKind::Bytes, false, nullptr},
+    {12, FieldKind::Bool, false, nullptr},
+    {13, FieldKind::Bool, false, nullptr},
+    {14, FieldKind::Bool, false, nullptr},
+    {15, FieldKind::Message, false, &kGoogleMessage1SubMessageSchema},
+    {16, FieldKind::Varint, false, nullptr},
+    {17, FieldKind::Bool, false, nullptr},
+    {18, FieldKind::Bytes, false, nullptr},
+    {22, FieldKind::Varint, false, nullptr},
+    {23, FieldKind::Varint, false, nullptr},
+    {24, FieldKind::Bool, false, nullptr},
+    {25, FieldKind::Varint, false, nullptr},
+    {29, FieldKind::Varint, false, nullptr},
+    {30, FieldKind::Bool, false, nullptr},
+    {59, FieldKind::Bool, false, nullptr},
+    {60, FieldKind::Varint, false, nullptr},
+    {67, FieldKind::Varint, false, nullptr},
+    {68, FieldKind::Varint, false, nullptr},
+    {78, FieldKind::Bool, false, nullptr},
+    {80, FieldKind::Bool, false, nullptr},
+    {81, FieldKind::Bool, false, nullptr},
+    {100, FieldKind::Varint, false, nullptr},
+    {101, FieldKind::Varint, false, nullptr},
+    {102, FieldKind::Bytes, false, nullptr},
+    {103, FieldKind::Bytes, false, nullptr},
+    {104, FieldKind::Varint, false, nullptr},
+    {128, FieldKind::Varint, false, nullptr},
+    {129, FieldKind::Bytes, false, nullptr},
+    {130, FieldKind::Varint, false, nullptr},
+    {131, FieldKind::Varint, false, nullptr},
+    {150, FieldKind::Varint, false, nullptr},
+    {271, FieldKind::Varint, false, nullptr},
+    {272, FieldKind::Varint, false, nullptr},
+    {280, FieldKind::Varint, false, nullptr},
+};
+
+const uint16_t kGoogleMessage1Index[] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 0, 8, 0, 0, 9, 10, 11, 12,
+    13, 14, 15, 0, 0, 0, 16, 17, 18, 19, 0, 0, 0, 20, 21, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 22, 23, 0, 0, 0,
+    0, 0, 0, 24, 25, 0, 0, 0, 0, 0, 0, 0, 0, 0, 26, 0,
+    27, 28, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 29, 30, 31, 32, 33, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    34, 35, 36, 37, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 38, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 39,
+    40, 0, 0, 0, 0, 0, 0, 0, 41,
+};
+}  // namespace
+
+const MessageSchema kGoogleMessage1Schema = {
+    "GoogleMessage1", kGoogleMessage1Fields, 41,
+    kGoogleMessage1Index, 281};
+
+}  // namespace benchmarks::proto2
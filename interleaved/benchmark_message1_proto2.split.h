@@ -0,0 +1,382 @@
+// Generated by splitc from benchmark_message1_proto2.proto.  Do not edit.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "codegen_runtime.h"
+#include "message_view.h"
+#include "schema.h"
+
+namespace benchmarks::proto2 {
+struct GoogleMessage1SubMessage {
+  int32_t field1{0};
+  int32_t field2{0};
+  int32_t field3{0};
+  std::string field15;
+  bool field12{true};
+  int64_t field13{};
+  int64_t field14{};
+  int32_t field16{};
+  int32_t field19{2};
+  bool field20{true};
+  bool field28{true};
+  uint64_t field21{};
+  int32_t field22{};
+  bool field23{false};
+  bool field206{false};
+  uint32_t field203{};
+  int32_t field204{};
+  std::string field205;
+  uint64_t field207{};
+  uint64_t field300{};
+  bool has_field1{false};
+  bool has_field2{false};
+  bool has_field3{false};
+  bool has_field15{false};
+  bool has_field12{false};
+  bool has_field13{false};
+  bool has_field14{false};
+  bool has_field16{false};
+  bool has_field19{false};
+  bool has_field20{false};
+  bool has_field28{false};
+  bool has_field21{false};
+  bool has_field22{false};
+  bool has_field23{false};
+  bool has_field206{false};
+  bool has_field203{false};
+  bool has_field204{false};
+  bool has_field205{false};
+  bool has_field207{false};
+  bool has_field300{false};
+};
+
+struct GoogleMessage1 {
+  std::string field1;
+  std::string field9;
+  std::string field18;
+  bool field80{false};
+  bool field81{true};
+  int32_t field2{};
+  int32_t field3{};
+  int32_t field280{};
+  int32_t field6{0};
+  int64_t field22{};
+  std::string field4;
+  std::vector<uint64_t> field5;
+  bool field59{false};
+  std::string field7;
+  int32_t field16{};
+  int32_t field130{0};
+  bool field12{true};
+  bool field17{true};
+  bool field13{true};
+  bool field14{true};
+  int32_t field104{0};
+  int32_t field100{0};
+  int32_t field101{0};
+  std::string field102;
+  std::string field103;
+  int32_t field29{0};
+  bool field30{false};
+  int32_t field60{-1};
+  int32_t field271{-1};
+  int32_t field272{-1};
+  int32_t field150{};
+  int32_t field23{0};
+  bool field24{false};
+  int32_t field25{0};
+  GoogleMessage1SubMessage field15;
+  bool field78{};
+  int32_t field67{0};
+  int32_t field68{};
+  int32_t field128{0};
+  std::string field129{"xxxxxxxxxxxxxxxxxxxxx"};
+  int32_t field131{0};
+  bool has_field1{false};
+  bool has_field9{false};
+  bool has_field18{false};
+  bool has_field80{false};
+  bool has_field81{false};
+  bool has_field2{false};
+  bool has_field3{false};
+  bool has_field280{false};
+  bool has_field6{false};
+  bool has_field22{false};
+  bool has_field4{false};
+  bool has_field59{false};
+  bool has_field7{false};
+  bool has_field16{false};
+  bool has_field130{false};
+  bool has_field12{false};
+  bool has_field17{false};
+  bool has_field13{false};
+  bool has_field14{false};
+  bool has_field104{false};
+  bool has_field100{false};
+  bool has_field101{false};
+  bool has_field102{false};
+  bool has_field103{false};
+  bool has_field29{false};
+  bool has_field30{false};
+  bool has_field60{false};
+  bool has_field271{false};
+  bool has_field272{false};
+  bool has_field150{false};
+  bool has_field23{false};
+  bool has_field24{false};
+  bool has_field25{false};
+  bool has_field15{false};
+  bool has_field78{false};
+  bool has_field67{false};
+  bool has_field68{false};
+  bool has_field128{false};
+  bool has_field129{false};
+  bool has_field131{false};
+};
+
+struct GoogleMessage1SubMessageView : codegen::MessageView {
+  using MessageView::MessageView;
+
+  int32_t field1() const { return value<int32_t>(1, 0); }
+  bool has_field1() const { return has(1); }
+
+  int32_t field2() const { return value<int32_t>(2, 0); }
+  bool has_field2() const { return has(2); }
+
+  int32_t field3() const { return value<int32_t>(3, 0); }
+  bool has_field3() const { return has(3); }
+
+  std::string_view field15() const { return bytes(15); }
+  bool has_field15() const { return has(15); }
+
+  bool field12() const { return value<bool>(12, true); }
+  bool has_field12() const { return has(12); }
+
+  int64_t field13() const { return value<int64_t>(13, {}); }
+  bool has_field13() const { return has(13); }
+
+  int64_t field14() const { return value<int64_t>(14, {}); }
+  bool has_field14() const { return has(14); }
+
+  int32_t field16() const { return value<int32_t>(16, {}); }
+  bool has_field16() const { return has(16); }
+
+  int32_t field19() const { return value<int32_t>(19, 2); }
+  bool has_field19() const { return has(19); }
+
+  bool field20() const { return value<bool>(20, true); }
+  bool has_field20() const { return has(20); }
+
+  bool field28() const { return value<bool>(28, true); }
+  bool has_field28() const { return has(28); }
+
+  uint64_t field21() const { return value<uint64_t>(21, {}); }
+  bool has_field21() const { return has(21); }
+
+  int32_t field22() const { return value<int32_t>(22, {}); }
+  bool has_field22() const { return has(22); }
+
+  bool field23() const { return value<bool>(23, false); }
+  bool has_field23() const { return has(23); }
+
+  bool field206() const { return value<bool>(206, false); }
+  bool has_field206() const { return has(206); }
+
+  uint32_t field203() const { return value<uint32_t>(203, {}); }
+  bool has_field203() const { return has(203); }
+
+  int32_t field204() const { return value<int32_t>(204, {}); }
+  bool has_field204() const { return has(204); }
+
+  std::string_view field205() const { return bytes(205); }
+  bool has_field205() const { return has(205); }
+
+  uint64_t field207() const { return value<uint64_t>(207, {}); }
+  bool has_field207() const { return has(207); }
+
+  uint64_t field300() const { return value<uint64_t>(300, {}); }
+  bool has_field300() const { return has(300); }
+};
+
+struct GoogleMessage1View : codegen::MessageView {
+  using MessageView::MessageView;
+
+  std::string_view field1() const { return bytes(1); }
+  bool has_field1() const { return has(1); }
+
+  std::string_view field9() const { return bytes(9); }
+  bool has_field9() const { return has(9); }
+
+  std::string_view field18() const { return bytes(18); }
+  bool has_field18() const { return has(18); }
+
+  bool field80() const { return value<bool>(80, false); }
+  bool has_field80() const { return has(80); }
+
+  bool field81() const { return value<bool>(81, true); }
+  bool has_field81() const { return has(81); }
+
+  int32_t field2() const { return value<int32_t>(2, {}); }
+  bool has_field2() const { return has(2); }
+
+  int32_t field3() const { return value<int32_t>(3, {}); }
+  bool has_field3() const { return has(3); }
+
+  int32_t field280() const { return value<int32_t>(280, {}); }
+  bool has_field280() const { return has(280); }
+
+  int32_t field6() const { return value<int32_t>(6, 0); }
+  bool has_field6() const { return has(6); }
+
+  int64_t field22() const { return value<int64_t>(22, {}); }
+  bool has_field22() const { return has(22); }
+
+  std::string_view field4() const { return bytes(4); }
+  bool has_field4() const { return has(4); }
+
+  codegen::RunView field5() const {
+    codegen::RunView view;
+
+    run(5, &view);
+    return view;
+  }
+
+  bool field59() const { return value<bool>(59, false); }
+  bool has_field59() const { return has(59); }
+
+  std::string_view field7() const { return bytes(7); }
+  bool has_field7() const { return has(7); }
+
+  int32_t field16() const { return value<int32_t>(16, {}); }
+  bool has_field16() const { return has(16); }
+
+  int32_t field130() const { return value<int32_t>(130, 0); }
+  bool has_field130() const { return has(130); }
+
+  bool field12() const { return value<bool>(12, true); }
+  bool has_field12() const { return has(12); }
+
+  bool field17() const { return value<bool>(17, true); }
+  bool has_field17() const { return has(17); }
+
+  bool field13() const { return value<bool>(13, true); }
+  bool has_field13() const { return has(13); }
+
+  bool field14() const { return value<bool>(14, true); }
+  bool has_field14() const { return has(14); }
+
+  int32_t field104() const { return value<int32_t>(104, 0); }
+  bool has_field104() const { return has(104); }
+
+  int32_t field100() const { return value<int32_t>(100, 0); }
+  bool has_field100() const { return has(100); }
+
+  int32_t field101() const { return value<int32_t>(101, 0); }
+  bool has_field101() const { return has(101); }
+
+  std::string_view field102() const { return bytes(102); }
+  bool has_field102() const { return has(102); }
+
+  std::string_view field103() const { return bytes(103); }
+  bool has_field103() const { return has(103); }
+
+  int32_t field29() const { return value<int32_t>(29, 0); }
+  bool has_field29() const { return has(29); }
+
+  bool field30() const { return value<bool>(30, false); }
+  bool has_field30() const { return has(30); }
+
+  int32_t field60() const { return value<int32_t>(60, -1); }
+  bool has_field60() const { return has(60); }
+
+  int32_t field271() const { return value<int32_t>(271, -1); }
+  bool has_field271() const { return has(271); }
+
+  int32_t field272() const { return value<int32_t>(272, -1); }
+  bool has_field272() const { return has(272); }
+
+  int32_t field150() const { return value<int32_t>(150, {}); }
+  bool has_field150() const { return has(150); }
+
+  int32_t field23() const { return value<int32_t>(23, 0); }
+  bool has_field23() const { return has(23); }
+
+  bool field24() const { return value<bool>(24, false); }
+  bool has_field24() const { return has(24); }
+
+  int32_t field25() const { return value<int32_t>(25, 0); }
+  bool has_field25() const { return has(25); }
+
+  GoogleMessage1SubMessageView field15() const {
+    GoogleMessage1SubMessageView view;
+
+    submessage(15, &view);
+    return view;
+  }
+  bool field15(GoogleMessage1SubMessageView *view) const {
+    return submessage(15, view);
+  }
+  bool has_field15() const { return has(15); }
+
+  bool field78() const { return value<bool>(78, {}); }
+  bool has_field78() const { return has(78); }
+
+  int32_t field67() const { return value<int32_t>(67, 0); }
+  bool has_field67() const { return has(67); }
+
+  int32_t field68() const { return value<int32_t>(68, {}); }
+  bool has_field68() const { return has(68); }
+
+  int32_t field128() const { return value<int32_t>(128, 0); }
+  bool has_field128() const { return has(128); }
+
+  std::string_view field129() const { return bytes(129, "xxxxxxxxxxxxxxxxxxxxx"); }
+  bool has_field129() const { return has(129); }
+
+  int32_t field131() const { return value<int32_t>(131, 0); }
+  bool has_field131() const { return has(131); }
+};
+
+void EncodeFields(const GoogleMessage1SubMessage &message, MetaWriter *meta,
+                  DataWriter *data);
+void EncodeFields(const GoogleMessage1SubMessage &message, UncheckedMetaWriter *meta,
+                  UncheckedDataWriter *data);
+void EncodeFields(const GoogleMessage1SubMessage &message, SplitLiteralMetaWriter *meta,
+                  DataWriter *data);
+void EncodeFields(const GoogleMessage1SubMessage &message, MetaWriter *meta,
+                  DataWriter *data,
+                  const codegen::ParallelOptions &options);
+void AddEncodeBounds(const GoogleMessage1SubMessage &message,
+                     codegen::EncodeBounds *bounds);
+bool DecodeField(uint32_t field, size_t width, const uint8_t *src,
+                 GoogleMessage1SubMessage *message);
+bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+                size_t depth, MetaReader *meta, DataReader *data,
+                GoogleMessage1SubMessage *message);
+
+void EncodeFields(const GoogleMessage1 &message, MetaWriter *meta,
+                  DataWriter *data);
+void EncodeFields(const GoogleMessage1 &message, UncheckedMetaWriter *meta,
+                  UncheckedDataWriter *data);
+void EncodeFields(const GoogleMessage1 &message, SplitLiteralMetaWriter *meta,
+                  DataWriter *data);
+void EncodeFields(const GoogleMessage1 &message, MetaWriter *meta,
+                  DataWriter *data,
+                  const codegen::ParallelOptions &options);
+void AddEncodeBounds(const GoogleMessage1 &message,
+                     codegen::EncodeBounds *bounds);
+bool DecodeField(uint32_t field, size_t width, const uint8_t *src,
+                 GoogleMessage1 *message);
+bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+                size_t depth, MetaReader *meta, DataReader *data,
+                GoogleMessage1 *message);
+
+extern const MessageSchema kGoogleMessage1SubMessageSchema;
+extern const MessageSchema kGoogleMessage1Schema;
+
+}  // namespace benchmarks::proto2
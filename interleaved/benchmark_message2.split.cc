@@ -0,0 +1,752 @@
+// Generated by splitc from benchmark_message2.proto.  Do not edit.
+#include "benchmark_message2.split.h"
+
+#include "parallel_encode.h"
+#include "split_literal_meta.h"
+
+namespace benchmarks::proto2 {
+namespace {
+template <typename Meta, typename Data>
+void EncodeFieldsImpl(const GoogleMessage2GroupedMessage &message, Meta *meta, Data *data,
+                      const codegen::ParallelOptions &parallel) {
+  (void)parallel;
+  if (message.has_field1) {
+    meta->field(1, data->fixed(message.field1));
+  }
+
+  if (message.has_field2) {
+    meta->field(2, data->fixed(message.field2));
+  }
+
+  if (message.has_field3) {
+    meta->field(3, data->fixed(message.field3));
+  }
+
+  if (message.has_field4) {
+    meta->field(4, data->fixed(message.field4));
+  }
+
+  if (message.has_field5) {
+    meta->field(5, data->fixed(message.field5));
+  }
+
+  if (message.has_field6) {
+    meta->field(6, data->fixed(message.field6));
+  }
+
+  if (message.has_field7) {
+    meta->field(7, data->fixed(message.field7));
+  }
+
+  if (message.has_field8) {
+    meta->field(8, data->fixed(message.field8));
+  }
+
+  if (message.has_field9) {
+    meta->field(9, data->fixed(message.field9));
+  }
+
+  if (message.has_field10) {
+    meta->field(10, data->fixed(message.field10));
+  }
+
+  if (message.has_field11) {
+    meta->field(11, data->varint((uint64_t)(int64_t)message.field11));
+  }
+}
+}  // namespace
+
+void EncodeFields(const GoogleMessage2GroupedMessage &message, MetaWriter *meta,
+                  DataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage2GroupedMessage &message, UncheckedMetaWriter *meta,
+                  UncheckedDataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage2GroupedMessage &message, SplitLiteralMetaWriter *meta,
+                  DataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage2GroupedMessage &message, MetaWriter *meta,
+                  DataWriter *data,
+                  const codegen::ParallelOptions &options) {
+  EncodeFieldsImpl(message, meta, data, options);
+}
+
+void AddEncodeBounds(const GoogleMessage2GroupedMessage &message,
+                     codegen::EncodeBounds *bounds) {
+  codegen::AddFieldBounds(sizeof(float), bounds, message.has_field1);
+  codegen::AddFieldBounds(sizeof(float), bounds, message.has_field2);
+  codegen::AddFieldBounds(sizeof(float), bounds, message.has_field3);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field4);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field5);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field6);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field7);
+  codegen::AddFieldBounds(sizeof(float), bounds, message.has_field8);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field9);
+  codegen::AddFieldBounds(sizeof(float), bounds, message.has_field10);
+  codegen::AddFieldBounds(8, bounds, message.has_field11);
+}
+
+bool DecodeField(uint32_t field, size_t width, const uint8_t *src,
+                 GoogleMessage2GroupedMessage *message) {
+  switch (field) {
+    case 1:
+      message->has_field1 = true;
+      return codegen::DecodeValue(src, width, &message->field1);
+    case 2:
+      message->has_field2 = true;
+      return codegen::DecodeValue(src, width, &message->field2);
+    case 3:
+      message->has_field3 = true;
+      return codegen::DecodeValue(src, width, &message->field3);
+    case 4:
+      message->has_field4 = true;
+      return codegen::DecodeValue(src, width, &message->field4);
+    case 5:
+      message->has_field5 = true;
+      return codegen::DecodeValue(src, width, &message->field5);
+    case 6:
+      message->has_field6 = true;
+      return codegen::DecodeValue(src, width, &message->field6);
+    case 7:
+      message->has_field7 = true;
+      return codegen::DecodeValue(src, width, &message->field7);
+    case 8:
+      message->has_field8 = true;
+      return codegen::DecodeValue(src, width, &message->field8);
+    case 9:
+      message->has_field9 = true;
+      return codegen::DecodeValue(src, width, &message->field9);
+    case 10:
+      message->has_field10 = true;
+      return codegen::DecodeValue(src, width, &message->field10);
+    case 11:
+      message->has_field11 = true;
+      return codegen::DecodeValue(src, width, &message->field11);
+    default:
+      return true;
+  }
+}
+
+bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+                size_t depth, MetaReader *meta, DataReader *data,
+                GoogleMessage2GroupedMessage *) {
+  switch (field) {
+    default:
+      return codegen::DecodeOpen(field, len_hint, first_width, depth, meta,
+                                 data, (codegen::Ignored *)nullptr);
+  }
+}
+
+namespace {
+template <typename Meta, typename Data>
+void EncodeFieldsImpl(const GoogleMessage2_Group1 &message, Meta *meta, Data *data,
+                      const codegen::ParallelOptions &parallel) {
+  (void)parallel;
+  if (message.has_field5) {
+    meta->field(5, data->varint((uint64_t)(int64_t)message.field5));
+  }
+
+  if (message.has_field11) {
+    meta->field(11, data->fixed(message.field11));
+  }
+
+  if (message.has_field12) {
+    meta->string(12, data->string(message.field12));
+  }
+
+  if (message.has_field13) {
+    meta->string(13, data->string(message.field13));
+  }
+
+  if (!message.field14.empty()) {
+    codegen::EncodeRun(meta, data, 14, true, message.field14.size(), [&](size_t i) {
+      meta->string(1, data->string(message.field14[i]));
+    });
+  }
+
+  if (message.has_field15) {
+    meta->field(15, data->varint((uint64_t)(int64_t)message.field15));
+  }
+
+  if (message.has_field16) {
+    meta->string(16, data->string(message.field16));
+  }
+
+  if (message.has_field20) {
+    meta->field(20, data->varint((uint64_t)(int64_t)message.field20));
+  }
+
+  if (!message.field22.empty()) {
+    codegen::EncodeRun(meta, data, 22, true, message.field22.size(), [&](size_t i) {
+      meta->string(1, data->string(message.field22[i]));
+    });
+  }
+
+  if (message.has_field24) {
+    meta->string(24, data->string(message.field24));
+  }
+
+  if (message.has_field26) {
+    meta->field(26, data->fixed(message.field26));
+  }
+
+  if (message.has_field27) {
+    meta->string(27, data->string(message.field27));
+  }
+
+  if (message.has_field28) {
+    meta->field(28, data->varint((uint64_t)(int64_t)message.field28));
+  }
+
+  if (message.has_field29) {
+    meta->string(29, data->string(message.field29));
+  }
+
+  if (message.has_field31) {
+    codegen::EncodeRun(meta, data, 31, false, 1, [&](size_t) {
+      EncodeFields(message.field31, meta, data);
+    });
+  }
+
+  if (!message.field73.empty()) {
+    codegen::EncodeVarintRun(meta, data, 73, message.field73);
+  }
+}
+}  // namespace
+
+void EncodeFields(const GoogleMessage2_Group1 &message, MetaWriter *meta,
+                  DataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage2_Group1 &message, UncheckedMetaWriter *meta,
+                  UncheckedDataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage2_Group1 &message, SplitLiteralMetaWriter *meta,
+                  DataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage2_Group1 &message, MetaWriter *meta,
+                  DataWriter *data,
+                  const codegen::ParallelOptions &options) {
+  EncodeFieldsImpl(message, meta, data, options);
+}
+
+void AddEncodeBounds(const GoogleMessage2_Group1 &message,
+                     codegen::EncodeBounds *bounds) {
+  codegen::AddFieldBounds(sizeof(float), bounds, message.has_field11);
+  codegen::AddFieldBounds(sizeof(float), bounds, message.has_field26);
+  codegen::AddStringBounds(message.field12.size(), bounds, message.has_field12);
+  codegen::AddStringBounds(message.field13.size(), bounds, message.has_field13);
+  codegen::AddRunBounds(message.field14.size(), bounds);
+  for (const auto &value : message.field14)
+    codegen::AddStringBounds(value.size(), bounds);
+  codegen::AddFieldBounds(8, bounds, message.has_field15);
+  codegen::AddFieldBounds(8, bounds, message.has_field5);
+  codegen::AddStringBounds(message.field27.size(), bounds, message.has_field27);
+  codegen::AddFieldBounds(8, bounds, message.has_field28);
+  codegen::AddStringBounds(message.field29.size(), bounds, message.has_field29);
+  codegen::AddStringBounds(message.field16.size(), bounds, message.has_field16);
+  codegen::AddRunBounds(message.field22.size(), bounds);
+  for (const auto &value : message.field22)
+    codegen::AddStringBounds(value.size(), bounds);
+  codegen::AddRunBounds(message.field73.size(), bounds);
+  codegen::AddFieldBounds(8, bounds, message.field73.size());
+  codegen::AddFieldBounds(8, bounds, message.has_field20);
+  codegen::AddStringBounds(message.field24.size(), bounds, message.has_field24);
+  if (message.has_field31) {
+    codegen::AddRunBounds(1, bounds);
+    AddEncodeBounds(message.field31, bounds);
+  }
+}
+
+bool DecodeField(uint32_t field, size_t width, const uint8_t *src,
+                 GoogleMessage2_Group1 *message) {
+  switch (field) {
+    case 11:
+      message->has_field11 = true;
+      return codegen::DecodeValue(src, width, &message->field11);
+    case 26:
+      message->has_field26 = true;
+      return codegen::DecodeValue(src, width, &message->field26);
+    case 12:
+      message->has_field12 = true;
+      return codegen::DecodeValue(src, width, &message->field12);
+    case 13:
+      message->has_field13 = true;
+      return codegen::DecodeValue(src, width, &message->field13);
+    case 15:
+      message->has_field15 = true;
+      return codegen::DecodeValue(src, width, &message->field15);
+    case 5:
+      message->has_field5 = true;
+      return codegen::DecodeValue(src, width, &message->field5);
+    case 27:
+      message->has_field27 = true;
+      return codegen::DecodeValue(src, width, &message->field27);
+    case 28:
+      message->has_field28 = true;
+      return codegen::DecodeValue(src, width, &message->field28);
+    case 29:
+      message->has_field29 = true;
+      return codegen::DecodeValue(src, width, &message->field29);
+    case 16:
+      message->has_field16 = true;
+      return codegen::DecodeValue(src, width, &message->field16);
+    case 20:
+      message->has_field20 = true;
+      return codegen::DecodeValue(src, width, &message->field20);
+    case 24:
+      message->has_field24 = true;
+      return codegen::DecodeValue(src, width, &message->field24);
+    default:
+      return true;
+  }
+}
+
+bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+                size_t depth, MetaReader *meta, DataReader *data,
+                GoogleMessage2_Group1 *message) {
+  switch (field) {
+    case 14:
+      return codegen::DecodeAppend(meta, data, first_width, depth,
+                                   &message->field14);
+    case 22:
+      return codegen::DecodeAppend(meta, data, first_width, depth,
+                                   &message->field22);
+    case 73:
+      return codegen::DecodeAppend(meta, data, first_width, depth,
+                                   &message->field73);
+    case 31:
+      message->has_field31 = true;
+      return codegen::DecodeOne(meta, data, first_width, depth,
+                                &message->field31);
+    default:
+      return codegen::DecodeOpen(field, len_hint, first_width, depth, meta,
+                                 data, (codegen::Ignored *)nullptr);
+  }
+}
+
+namespace {
+template <typename Meta, typename Data>
+void EncodeFieldsImpl(const GoogleMessage2 &message, Meta *meta, Data *data,
+                      const codegen::ParallelOptions &parallel) {
+  if (message.has_field1) {
+    meta->string(1, data->string(message.field1));
+  }
+
+  if (message.has_field2) {
+    meta->string(2, data->string(message.field2));
+  }
+
+  if (message.has_field3) {
+    meta->field(3, data->varint((uint64_t)(int64_t)message.field3));
+  }
+
+  if (message.has_field4) {
+    meta->field(4, data->varint((uint64_t)(int64_t)message.field4));
+  }
+
+  if (message.has_field6) {
+    meta->string(6, data->string(message.field6));
+  }
+
+  if (!message.group1.empty()) {
+    codegen::EncodeRunParallel(meta, data, 10, message.group1, parallel);
+  }
+
+  if (message.has_field21) {
+    meta->field(21, data->varint((uint64_t)(int64_t)message.field21));
+  }
+
+  if (message.has_field25) {
+    meta->field(25, data->fixed(message.field25));
+  }
+
+  if (message.has_field30) {
+    meta->field(30, data->varint((uint64_t)(int64_t)message.field30));
+  }
+
+  if (message.has_field63) {
+    meta->field(63, data->varint((uint64_t)(int64_t)message.field63));
+  }
+
+  if (message.has_field71) {
+    meta->field(71, data->varint((uint64_t)(int64_t)message.field71));
+  }
+
+  if (message.has_field75) {
+    meta->field(75, data->fixed(message.field75));
+  }
+
+  if (message.has_field109) {
+    meta->field(109, data->varint((uint64_t)(int64_t)message.field109));
+  }
+
+  if (!message.field127.empty()) {
+    codegen::EncodeRun(meta, data, 127, true, message.field127.size(), [&](size_t i) {
+      meta->string(1, data->string(message.field127[i]));
+    });
+  }
+
+  if (!message.field128.empty()) {
+    codegen::EncodeRun(meta, data, 128, true, message.field128.size(), [&](size_t i) {
+      meta->string(1, data->string(message.field128[i]));
+    });
+  }
+
+  if (message.has_field129) {
+    meta->field(129, data->varint((uint64_t)(int64_t)message.field129));
+  }
+
+  if (!message.field130.empty()) {
+    codegen::EncodeVarintRun(meta, data, 130, message.field130);
+  }
+
+  if (message.has_field131) {
+    meta->field(131, data->varint((uint64_t)(int64_t)message.field131));
+  }
+
+  if (message.has_field205) {
+    meta->field(205, data->fixed(message.field205));
+  }
+
+  if (message.has_field206) {
+    meta->field(206, data->fixed(message.field206));
+  }
+
+  if (message.has_field210) {
+    meta->field(210, data->varint((uint64_t)(int64_t)message.field210));
+  }
+
+  if (message.has_field211) {
+    meta->field(211, data->varint((uint64_t)(int64_t)message.field211));
+  }
+
+  if (message.has_field212) {
+    meta->field(212, data->varint((uint64_t)(int64_t)message.field212));
+  }
+
+  if (message.has_field213) {
+    meta->field(213, data->varint((uint64_t)(int64_t)message.field213));
+  }
+
+  if (message.has_field216) {
+    meta->field(216, data->varint((uint64_t)(int64_t)message.field216));
+  }
+
+  if (message.has_field217) {
+    meta->field(217, data->varint((uint64_t)(int64_t)message.field217));
+  }
+
+  if (message.has_field218) {
+    meta->field(218, data->varint((uint64_t)(int64_t)message.field218));
+  }
+
+  if (message.has_field220) {
+    meta->field(220, data->varint((uint64_t)(int64_t)message.field220));
+  }
+
+  if (message.has_field221) {
+    meta->field(221, data->varint((uint64_t)(int64_t)message.field221));
+  }
+
+  if (message.has_field222) {
+    meta->field(222, data->fixed(message.field222));
+  }
+}
+}  // namespace
+
+void EncodeFields(const GoogleMessage2 &message, MetaWriter *meta,
+                  DataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage2 &message, UncheckedMetaWriter *meta,
+                  UncheckedDataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage2 &message, SplitLiteralMetaWriter *meta,
+                  DataWriter *data) {
+  EncodeFieldsImpl(message, meta, data, codegen::kSequential);
+}
+
+void EncodeFields(const GoogleMessage2 &message, MetaWriter *meta,
+                  DataWriter *data,
+                  const codegen::ParallelOptions &options) {
+  EncodeFieldsImpl(message, meta, data, options);
+}
+
+void AddEncodeBounds(const GoogleMessage2 &message,
+                     codegen::EncodeBounds *bounds) {
+  codegen::AddStringBounds(message.field1.size(), bounds, message.has_field1);
+  codegen::AddFieldBounds(8, bounds, message.has_field3);
+  codegen::AddFieldBounds(8, bounds, message.has_field4);
+  codegen::AddFieldBounds(8, bounds, message.has_field30);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field75);
+  codegen::AddStringBounds(message.field6.size(), bounds, message.has_field6);
+  codegen::AddStringBounds(message.field2.size(), bounds, message.has_field2);
+  codegen::AddFieldBounds(8, bounds, message.has_field21);
+  codegen::AddFieldBounds(8, bounds, message.has_field71);
+  codegen::AddFieldBounds(sizeof(float), bounds, message.has_field25);
+  codegen::AddFieldBounds(8, bounds, message.has_field109);
+  codegen::AddFieldBounds(8, bounds, message.has_field210);
+  codegen::AddFieldBounds(8, bounds, message.has_field211);
+  codegen::AddFieldBounds(8, bounds, message.has_field212);
+  codegen::AddFieldBounds(8, bounds, message.has_field213);
+  codegen::AddFieldBounds(8, bounds, message.has_field216);
+  codegen::AddFieldBounds(8, bounds, message.has_field217);
+  codegen::AddFieldBounds(8, bounds, message.has_field218);
+  codegen::AddFieldBounds(8, bounds, message.has_field220);
+  codegen::AddFieldBounds(8, bounds, message.has_field221);
+  codegen::AddFieldBounds(sizeof(float), bounds, message.has_field222);
+  codegen::AddFieldBounds(8, bounds, message.has_field63);
+  codegen::AddRunBounds(message.group1.size(), bounds);
+  for (const auto &value : message.group1)
+    AddEncodeBounds(value, bounds);
+  codegen::AddRunBounds(message.field128.size(), bounds);
+  for (const auto &value : message.field128)
+    codegen::AddStringBounds(value.size(), bounds);
+  codegen::AddFieldBounds(8, bounds, message.has_field131);
+  codegen::AddRunBounds(message.field127.size(), bounds);
+  for (const auto &value : message.field127)
+    codegen::AddStringBounds(value.size(), bounds);
+  codegen::AddFieldBounds(8, bounds, message.has_field129);
+  codegen::AddRunBounds(message.field130.size(), bounds);
+  codegen::AddFieldBounds(8, bounds, message.field130.size());
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field205);
+  codegen::AddFieldBounds(sizeof(bool), bounds, message.has_field206);
+}
+
+bool DecodeField(uint32_t field, size_t width, const uint8_t *src,
+                 GoogleMessage2 *message) {
+  switch (field) {
+    case 1:
+      message->has_field1 = true;
+      return codegen::DecodeValue(src, width, &message->field1);
+    case 3:
+      message->has_field3 = true;
+      return codegen::DecodeValue(src, width, &message->field3);
+    case 4:
+      message->has_field4 = true;
+      return codegen::DecodeValue(src, width, &message->field4);
+    case 30:
+      message->has_field30 = true;
+      return codegen::DecodeValue(src, width, &message->field30);
+    case 75:
+      message->has_field75 = true;
+      return codegen::DecodeValue(src, width, &message->field75);
+    case 6:
+      message->has_field6 = true;
+      return codegen::DecodeValue(src, width, &message->field6);
+    case 2:
+      message->has_field2 = true;
+      return codegen::DecodeValue(src, width, &message->field2);
+    case 21:
+      message->has_field21 = true;
+      return codegen::DecodeValue(src, width, &message->field21);
+    case 71:
+      message->has_field71 = true;
+      return codegen::DecodeValue(src, width, &message->field71);
+    case 25:
+      message->has_field25 = true;
+      return codegen::DecodeValue(src, width, &message->field25);
+    case 109:
+      message->has_field109 = true;
+      return codegen::DecodeValue(src, width, &message->field109);
+    case 210:
+      message->has_field210 = true;
+      return codegen::DecodeValue(src, width, &message->field210);
+    case 211:
+      message->has_field211 = true;
+      return codegen::DecodeValue(src, width, &message->field211);
+    case 212:
+      message->has_field212 = true;
+      return codegen::DecodeValue(src, width, &message->field212);
+    case 213:
+      message->has_field213 = true;
+      return codegen::DecodeValue(src, width, &message->field213);
+    case 216:
+      message->has_field216 = true;
+      return codegen::DecodeValue(src, width, &message->field216);
+    case 217:
+      message->has_field217 = true;
+      return codegen::DecodeValue(src, width, &message->field217);
+    case 218:
+      message->has_field218 = true;
+      return codegen::DecodeValue(src, width, &message->field218);
+    case 220:
+      message->has_field220 = true;
+      return codegen::DecodeValue(src, width, &message->field220);
+    case 221:
+      message->has_field221 = true;
+      return codegen::DecodeValue(src, width, &message->field221);
+    case 222:
+      message->has_field222 = true;
+      return codegen::DecodeValue(src, width, &message->field222);
+    case 63:
+      message->has_field63 = true;
+      return codegen::DecodeValue(src, width, &message->field63);
+    case 131:
+      message->has_field131 = true;
+      return codegen::DecodeValue(src, width, &message->field131);
+    case 129:
+      message->has_field129 = true;
+      return codegen::DecodeValue(src, width, &message->field129);
+    case 205:
+      message->has_field205 = true;
+      return codegen::DecodeValue(src, width, &message->field205);
+    case 206:
+      message->has_field206 = true;
+      return codegen::DecodeValue(src, width, &message->field206);
+    default:
+      return true;
+  }
+}
+
+bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+                size_t depth, MetaReader *meta, DataReader *data,
+                GoogleMessage2 *message) {
+  switch (field) {
+    case 10:
+      return codegen::DecodeAppend(meta, data, first_width, depth,
+                                   &message->group1);
+    case 128:
+      return codegen::DecodeAppend(meta, data, first_width, depth,
+                                   &message->field128);
+    case 127:
+      return codegen::DecodeAppend(meta, data, first_width, depth,
+                                   &message->field127);
+    case 130:
+      return codegen::DecodeAppend(meta, data, first_width, depth,
+                                   &message->field130);
+    default:
+      return codegen::DecodeOpen(field, len_hint, first_width, depth, meta,
+                                 data, (codegen::Ignored *)nullptr);
+  }
+}
+
+namespace {
+const FieldSchema kGoogleMessage2GroupedMessageFields[] = {
+    {1, FieldKind::Float, false, nullptr},
+    {2, FieldKind::Float, false, nullptr},
+    {3, FieldKind::Float, false, nullptr},
+    {4, FieldKind::Bool, false, nullptr},
+    {5, FieldKind::Bool, false, nullptr},
+    {6, FieldKind::Bool, false, nullptr},
+    {7, FieldKind::Bool, false, nullptr},
+    {8, FieldKind::Float, false, nullptr},
+    {9, FieldKind::Bool, false, nullptr},
+    {10, FieldKind::Float, false, nullptr},
+    {11, FieldKind::Varint, false, nullptr},
+};
+
+const uint16_t kGoogleMessage2GroupedMessageIndex[] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+};
+}  // namespace
+
+const MessageSchema kGoogleMessage2GroupedMessageSchema = {
+    "GoogleMessage2GroupedMessage", kGoogleMessage2GroupedMessageFields, 11,
+    kGoogleMessage2GroupedMessageIndex, 12};
+
+namespace {
+const FieldSchema kGoogleMessage2_Group1Fields[] = {
+    {5, FieldKind::Varint, false, nullptr},
+    {11, FieldKind::Float, false, nullptr},
+    {12, FieldKind::Bytes, false, nullptr},
+    {13, FieldKind::Bytes, false, nullptr},
+    {14, FieldKind::Bytes, true, nullptr},
+    {15, FieldKind::Varint, false, nullptr},
+    {16, FieldKind::Bytes, false, nullptr},
+    {20, FieldKind::Varint, false, nullptr},
+    {22, FieldKind::Bytes, true, nullptr},
+    {24, FieldKind::Bytes, false, nullptr},
+    {26, FieldKind::Float, false, nullptr},
+    {27, FieldKind::Bytes, false, nullptr},
+    {28, FieldKind::Varint, false, nullptr},
+    {29, FieldKind::Bytes, false, nullptr},
+    {31, FieldKind::Message, false, &kGoogleMessage2GroupedMessageSchema},
+    {73, FieldKind::Varint, true, nullptr},
+};
+
+const uint16_t kGoogleMessage2_Group1Index[] = {
+    0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 2, 3, 4, 5, 6,
+    7, 0, 0, 0, 8, 0, 9, 0, 10, 0, 11, 12, 13, 14, 0, 15,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 16,
+};
+}  // namespace
+
+const MessageSchema kGoogleMessage2_Group1Schema = {
+    "GoogleMessage2_Group1", kGoogleMessage2_Group1Fields, 16,
+    kGoogleMessage2_Group1Index, 74};
+
+namespace {
+const FieldSchema kGoogleMessage2Fields[] = {
+    {1, FieldKind::Bytes, false, nullptr},
+    {2, FieldKind::Bytes, false, nullptr},
+    {3, FieldKind::Varint, false, nullptr},
+    {4, FieldKind::Varint, false, nullptr},
+    {6, FieldKind::Bytes, false, nullptr},
+    {10, FieldKind::Group, true, &kGoogleMessage2_Group1Schema},
+    {21, FieldKind::Varint, false, nullptr},
+    {25, FieldKind::Float, false, nullptr},
+    {30, FieldKind::Varint, false, nullptr},
+    {63, FieldKind::Varint, false, nullptr},
+    {71, FieldKind::Varint, false, nullptr},
+    {75, FieldKind::Bool, false, nullptr},
+    {109, FieldKind::Varint, false, nullptr},
+    {127, FieldKind::Bytes, true, nullptr},
+    {128, FieldKind::Bytes, true, nullptr},
+    {129, FieldKind::Varint, false, nullptr},
+    {130, FieldKind::Varint, true, nullptr},
+    {131, FieldKind::Varint, false, nullptr},
+    {205, FieldKind::Bool, false, nullptr},
+    {206, FieldKind::Bool, false, nullptr},
+    {210, FieldKind::Varint, false, nullptr},
+    {211, FieldKind::Varint, false, nullptr},
+    {212, FieldKind::Varint, false, nullptr},
+    {213, FieldKind::Varint, false, nullptr},
+    {216, FieldKind::Varint, false, nullptr},
+    {217, FieldKind::Varint, false, nullptr},
+    {218, FieldKind::Varint, false, nullptr},
+    {220, FieldKind::Varint, false, nullptr},
+    {221, FieldKind::Varint, false, nullptr},
+    {222, FieldKind::Float, false, nullptr},
+};
+
+const uint16_t kGoogleMessage2Index[] = {
+    0, 1, 2, 3, 4, 0, 5, 0, 0, 0, 6, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 7, 0, 0, 0, 8, 0, 0, 0, 0, 9, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 10,
+    0, 0, 0, 0, 0, 0, 0, 11, 0, 0, 0, 12, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 13, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 14,
+    15, 16, 17, 18, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 19, 20, 0,
+    0, 0, 21, 22, 23, 24, 0, 0, 25, 26, 27, 0, 28, 29, 30,
+};
+}  // namespace
+
+const MessageSchema kGoogleMessage2Schema = {
+    "GoogleMessage2", kGoogleMessage2Fields, 30,
+    kGoogleMessage2Index, 223};
+
+}  // namespace benchmarks::proto2
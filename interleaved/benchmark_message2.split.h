@@ -0,0 +1,405 @@
+// Generated by splitc from benchmark_message2.proto.  Do not edit.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "codegen_runtime.h"
+#include "message_view.h"
+#include "schema.h"
+
+namespace benchmarks::proto2 {
+struct GoogleMessage2GroupedMessage {
+  float field1{};
+  float field2{};
+  float field3{0.0};
+  bool field4{};
+  bool field5{};
+  bool field6{true};
+  bool field7{false};
+  float field8{};
+  bool field9{};
+  float field10{};
+  int64_t field11{};
+  bool has_field1{false};
+  bool has_field2{false};
+  bool has_field3{false};
+  bool has_field4{false};
+  bool has_field5{false};
+  bool has_field6{false};
+  bool has_field7{false};
+  bool has_field8{false};
+  bool has_field9{false};
+  bool has_field10{false};
+  bool has_field11{false};
+};
+
+struct GoogleMessage2_Group1 {
+  float field11{};
+  float field26{};
+  std::string field12;
+  std::string field13;
+  std::vector<std::string> field14;
+  uint64_t field15{};
+  int32_t field5{};
+  std::string field27;
+  int32_t field28{};
+  std::string field29;
+  std::string field16;
+  std::vector<std::string> field22;
+  std::vector<int32_t> field73;
+  int32_t field20{0};
+  std::string field24;
+  GoogleMessage2GroupedMessage field31;
+  bool has_field11{false};
+  bool has_field26{false};
+  bool has_field12{false};
+  bool has_field13{false};
+  bool has_field15{false};
+  bool has_field5{false};
+  bool has_field27{false};
+  bool has_field28{false};
+  bool has_field29{false};
+  bool has_field16{false};
+  bool has_field20{false};
+  bool has_field24{false};
+  bool has_field31{false};
+};
+
+struct GoogleMessage2 {
+  std::string field1;
+  int64_t field3{};
+  int64_t field4{};
+  int64_t field30{};
+  bool field75{false};
+  std::string field6;
+  std::string field2;
+  int32_t field21{0};
+  int32_t field71{};
+  float field25{};
+  int32_t field109{0};
+  int32_t field210{0};
+  int32_t field211{0};
+  int32_t field212{0};
+  int32_t field213{0};
+  int32_t field216{0};
+  int32_t field217{0};
+  int32_t field218{0};
+  int32_t field220{0};
+  int32_t field221{0};
+  float field222{0.0};
+  int32_t field63{};
+  std::vector<GoogleMessage2_Group1> group1;
+  std::vector<std::string> field128;
+  int64_t field131{};
+  std::vector<std::string> field127;
+  int32_t field129{};
+  std::vector<int64_t> field130;
+  bool field205{false};
+  bool field206{false};
+  bool has_field1{false};
+  bool has_field3{false};
+  bool has_field4{false};
+  bool has_field30{false};
+  bool has_field75{false};
+  bool has_field6{false};
+  bool has_field2{false};
+  bool has_field21{false};
+  bool has_field71{false};
+  bool has_field25{false};
+  bool has_field109{false};
+  bool has_field210{false};
+  bool has_field211{false};
+  bool has_field212{false};
+  bool has_field213{false};
+  bool has_field216{false};
+  bool has_field217{false};
+  bool has_field218{false};
+  bool has_field220{false};
+  bool has_field221{false};
+  bool has_field222{false};
+  bool has_field63{false};
+  bool has_field131{false};
+  bool has_field129{false};
+  bool has_field205{false};
+  bool has_field206{false};
+};
+
+struct GoogleMessage2GroupedMessageView : codegen::MessageView {
+  using MessageView::MessageView;
+
+  float field1() const { return value<float>(1, {}); }
+  bool has_field1() const { return has(1); }
+
+  float field2() const { return value<float>(2, {}); }
+  bool has_field2() const { return has(2); }
+
+  float field3() const { return value<float>(3, 0.0); }
+  bool has_field3() const { return has(3); }
+
+  bool field4() const { return value<bool>(4, {}); }
+  bool has_field4() const { return has(4); }
+
+  bool field5() const { return value<bool>(5, {}); }
+  bool has_field5() const { return has(5); }
+
+  bool field6() const { return value<bool>(6, true); }
+  bool has_field6() const { return has(6); }
+
+  bool field7() const { return value<bool>(7, false); }
+  bool has_field7() const { return has(7); }
+
+  float field8() const { return value<float>(8, {}); }
+  bool has_field8() const { return has(8); }
+
+  bool field9() const { return value<bool>(9, {}); }
+  bool has_field9() const { return has(9); }
+
+  float field10() const { return value<float>(10, {}); }
+  bool has_field10() const { return has(10); }
+
+  int64_t field11() const { return value<int64_t>(11, {}); }
+  bool has_field11() const { return has(11); }
+};
+
+struct GoogleMessage2_Group1View : codegen::MessageView {
+  using MessageView::MessageView;
+
+  float field11() const { return value<float>(11, {}); }
+  bool has_field11() const { return has(11); }
+
+  float field26() const { return value<float>(26, {}); }
+  bool has_field26() const { return has(26); }
+
+  std::string_view field12() const { return bytes(12); }
+  bool has_field12() const { return has(12); }
+
+  std::string_view field13() const { return bytes(13); }
+  bool has_field13() const { return has(13); }
+
+  codegen::RunView field14() const {
+    codegen::RunView view;
+
+    run(14, &view);
+    return view;
+  }
+
+  uint64_t field15() const { return value<uint64_t>(15, {}); }
+  bool has_field15() const { return has(15); }
+
+  int32_t field5() const { return value<int32_t>(5, {}); }
+  bool has_field5() const { return has(5); }
+
+  std::string_view field27() const { return bytes(27); }
+  bool has_field27() const { return has(27); }
+
+  int32_t field28() const { return value<int32_t>(28, {}); }
+  bool has_field28() const { return has(28); }
+
+  std::string_view field29() const { return bytes(29); }
+  bool has_field29() const { return has(29); }
+
+  std::string_view field16() const { return bytes(16); }
+  bool has_field16() const { return has(16); }
+
+  codegen::RunView field22() const {
+    codegen::RunView view;
+
+    run(22, &view);
+    return view;
+  }
+
+  codegen::RunView field73() const {
+    codegen::RunView view;
+
+    run(73, &view);
+    return view;
+  }
+
+  int32_t field20() const { return value<int32_t>(20, 0); }
+  bool has_field20() const { return has(20); }
+
+  std::string_view field24() const { return bytes(24); }
+  bool has_field24() const { return has(24); }
+
+  GoogleMessage2GroupedMessageView field31() const {
+    GoogleMessage2GroupedMessageView view;
+
+    submessage(31, &view);
+    return view;
+  }
+  bool field31(GoogleMessage2GroupedMessageView *view) const {
+    return submessage(31, view);
+  }
+  bool has_field31() const { return has(31); }
+};
+
+struct GoogleMessage2View : codegen::MessageView {
+  using MessageView::MessageView;
+
+  std::string_view field1() const { return bytes(1); }
+  bool has_field1() const { return has(1); }
+
+  int64_t field3() const { return value<int64_t>(3, {}); }
+  bool has_field3() const { return has(3); }
+
+  int64_t field4() const { return value<int64_t>(4, {}); }
+  bool has_field4() const { return has(4); }
+
+  int64_t field30() const { return value<int64_t>(30, {}); }
+  bool has_field30() const { return has(30); }
+
+  bool field75() const { return value<bool>(75, false); }
+  bool has_field75() const { return has(75); }
+
+  std::string_view field6() const { return bytes(6); }
+  bool has_field6() const { return has(6); }
+
+  std::string_view field2() const { return bytes(2); }
+  bool has_field2() const { return has(2); }
+
+  int32_t field21() const { return value<int32_t>(21, 0); }
+  bool has_field21() const { return has(21); }
+
+  int32_t field71() const { return value<int32_t>(71, {}); }
+  bool has_field71() const { return has(71); }
+
+  float field25() const { return value<float>(25, {}); }
+  bool has_field25() const { return has(25); }
+
+  int32_t field109() const { return value<int32_t>(109, 0); }
+  bool has_field109() const { return has(109); }
+
+  int32_t field210() const { return value<int32_t>(210, 0); }
+  bool has_field210() const { return has(210); }
+
+  int32_t field211() const { return value<int32_t>(211, 0); }
+  bool has_field211() const { return has(211); }
+
+  int32_t field212() const { return value<int32_t>(212, 0); }
+  bool has_field212() const { return has(212); }
+
+  int32_t field213() const { return value<int32_t>(213, 0); }
+  bool has_field213() const { return has(213); }
+
+  int32_t field216() const { return value<int32_t>(216, 0); }
+  bool has_field216() const { return has(216); }
+
+  int32_t field217() const { return value<int32_t>(217, 0); }
+  bool has_field217() const { return has(217); }
+
+  int32_t field218() const { return value<int32_t>(218, 0); }
+  bool has_field218() const { return has(218); }
+
+  int32_t field220() const { return value<int32_t>(220, 0); }
+  bool has_field220() const { return has(220); }
+
+  int32_t field221() const { return value<int32_t>(221, 0); }
+  bool has_field221() const { return has(221); }
+
+  float field222() const { return value<float>(222, 0.0); }
+  bool has_field222() const { return has(222); }
+
+  int32_t field63() const { return value<int32_t>(63, {}); }
+  bool has_field63() const { return has(63); }
+
+  codegen::RunView group1() const {
+    codegen::RunView view;
+
+    run(10, &view);
+    return view;
+  }
+
+  codegen::RunView field128() const {
+    codegen::RunView view;
+
+    run(128, &view);
+    return view;
+  }
+
+  int64_t field131() const { return value<int64_t>(131, {}); }
+  bool has_field131() const { return has(131); }
+
+  codegen::RunView field127() const {
+    codegen::RunView view;
+
+    run(127, &view);
+    return view;
+  }
+
+  int32_t field129() const { return value<int32_t>(129, {}); }
+  bool has_field129() const { return has(129); }
+
+  codegen::RunView field130() const {
+    codegen::RunView view;
+
+    run(130, &view);
+    return view;
+  }
+
+  bool field205() const { return value<bool>(205, false); }
+  bool has_field205() const { return has(205); }
+
+  bool field206() const { return value<bool>(206, false); }
+  bool has_field206() const { return has(206); }
+};
+
+void EncodeFields(const GoogleMessage2GroupedMessage &message, MetaWriter *meta,
+                  DataWriter *data);
+void EncodeFields(const GoogleMessage2GroupedMessage &message, UncheckedMetaWriter *meta,
+                  UncheckedDataWriter *data);
+void EncodeFields(const GoogleMessage2GroupedMessage &message, SplitLiteralMetaWriter *meta,
+                  DataWriter *data);
+void EncodeFields(const GoogleMessage2GroupedMessage &message, MetaWriter *meta,
+                  DataWriter *data,
+                  const codegen::ParallelOptions &options);
+void AddEncodeBounds(const GoogleMessage2GroupedMessage &message,
+                     codegen::EncodeBounds *bounds);
+bool DecodeField(uint32_t field, size_t width, const uint8_t *src,
+                 GoogleMessage2GroupedMessage *message);
+bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+                size_t depth, MetaReader *meta, DataReader *data,
+                GoogleMessage2GroupedMessage *message);
+
+void EncodeFields(const GoogleMessage2_Group1 &message, MetaWriter *meta,
+                  DataWriter *data);
+void EncodeFields(const GoogleMessage2_Group1 &message, UncheckedMetaWriter *meta,
+                  UncheckedDataWriter *data);
+void EncodeFields(const GoogleMessage2_Group1 &message, SplitLiteralMetaWriter *meta,
+                  DataWriter *data);
+void EncodeFields(const GoogleMessage2_Group1 &message, MetaWriter *meta,
+                  DataWriter *data,
+                  const codegen::ParallelOptions &options);
+void AddEncodeBounds(const GoogleMessage2_Group1 &message,
+                     codegen::EncodeBounds *bounds);
+bool DecodeField(uint32_t field, size_t width, const uint8_t *src,
+                 GoogleMessage2_Group1 *message);
+bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+                size_t depth, MetaReader *meta, DataReader *data,
+                GoogleMessage2_Group1 *message);
+
+void EncodeFields(const GoogleMessage2 &message, MetaWriter *meta,
+                  DataWriter *data);
+void EncodeFields(const GoogleMessage2 &message, UncheckedMetaWriter *meta,
+                  UncheckedDataWriter *data);
+void EncodeFields(const GoogleMessage2 &message, SplitLiteralMetaWriter *meta,
+                  DataWriter *data);
+void EncodeFields(const GoogleMessage2 &message, MetaWriter *meta,
+                  DataWriter *data,
+                  const codegen::ParallelOptions &options);
+void AddEncodeBounds(const GoogleMessage2 &message,
+                     codegen::EncodeBounds *bounds);
+bool DecodeField(uint32_t field, size_t width, const uint8_t *src,
+                 GoogleMessage2 *message);
+bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+                size_t depth, MetaReader *meta, DataReader *data,
+                GoogleMessage2 *message);
+
+extern const MessageSchema kGoogleMessage2GroupedMessageSchema;
+extern const MessageSchema kGoogleMessage2_Group1Schema;
+extern const MessageSchema kGoogleMessage2Schema;
+
+}  // namespace benchmarks::proto2
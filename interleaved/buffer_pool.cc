@@ -0,0 +1,203 @@
+#include "buffer_pool.h"
+
+#include <assert.h>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+/// Smallest size class, 64 bytes: like `WriteBuffer`'s minimum growth.
+constexpr size_t kMinClass = 6;
+
+/// Raw `malloc`ed blocks, rather than `WriteBuffer`s, so that the free
+/// lists are plain arrays.
+struct Pool {
+  ~Pool() { clear(); }
+
+  void clear() {
+    for (FreeList &list : lists) {
+      for (size_t i = 0; i < list.count; i++) free(list.bufs[i]);
+
+      list.count = 0;
+    }
+  }
+
+  struct FreeList {
+    size_t count;
+    uint8_t *bufs[WriteBufferPool::kMaxPerClass];
+  };
+
+  /// `lists[c]` holds blocks of at least 2^c bytes.
+  FreeList lists[WriteBufferPool::kMaxClass + 1];
+};
+
+thread_local Pool pool;
+
+size_t floor_log2(size_t x) { return 63 - __builtin_clzll(x); }
+
+size_t ceil_log2(size_t x) { return (x <= 1) ? 0 : 64 - __builtin_clzll(x - 1); }
+}  // namespace
+
+void BufferSizeHint::update(size_t meta_written, size_t data_written) {
+  if (meta_avg == 0 && data_avg == 0) {
+    meta_avg = 8 * meta_written;
+    data_avg = 8 * data_written;
+    return;
+  }
+
+  meta_avg += meta_written - meta_avg / 8;
+  data_avg += data_written - data_avg / 8;
+  return;
+}
+
+size_t BufferSizeHint::meta_capacity() const {
+  return meta_avg / 8 + meta_avg / 32 + 64;
+}
+
+size_t BufferSizeHint::data_capacity() const {
+  return data_avg / 8 + data_avg / 32 + 64;
+}
+
+WriteBuffer WriteBufferPool::Acquire(size_t capacity) {
+  size_t size_class = std::max(kMinClass, ceil_log2(capacity));
+
+  if (size_class > kMaxClass) return WriteBuffer(capacity);
+
+  Pool::FreeList &list = pool.lists[size_class];
+  if (list.count == 0) return WriteBuffer(1UL << size_class);
+
+  return WriteBuffer(list.bufs[--list.count], 1UL << size_class);
+}
+
+void WriteBufferPool::Release(WriteBuffer buf) {
+  // Not `capacity()`: that also counts discarded bytes.
+  size_t capacity = buf.buf_end_ - buf.buf_;
+
+  if (buf.segmented() || capacity < (1UL << kMinClass)) return;
+
+  size_t size_class = floor_log2(capacity);
+  if (size_class > kMaxClass) return;
+
+  Pool::FreeList &list = pool.lists[size_class];
+  if (list.count >= kMaxPerClass) return;
+
+  // Steal the bytes: `buf` now destructs as empty.
+  list.bufs[list.count++] = buf.buf_;
+  buf.write_cursor_ = buf.buf_ = buf.buf_end_ = nullptr;
+  buf.remaining_ = 0;
+  return;
+}
+
+size_t WriteBufferPool::Size() {
+  size_t ret = 0;
+
+  for (const Pool::FreeList &list : pool.lists) ret += list.count;
+  return ret;
+}
+
+void WriteBufferPool::Clear() {
+  pool.clear();
+  return;
+}
+
+PooledWriters::~PooledWriters() {
+  hint->update(meta.base.buf.written(), data.buf.written());
+  WriteBufferPool::Release(std::move(meta.base.buf));
+  WriteBufferPool::Release(std::move(data.buf));
+  return;
+}
+
+void WriteBufferPool::SelfTest() {
+  Clear();
+
+  // Buffers come back from their size class.
+  {
+    WriteBuffer buf = Acquire(100);
+    const void *bytes = buf.data();
+
+    assert(buf.capacity() == 128);
+    memset(buf.reserve(10), 0, 10);
+    buf.commit(10);
+    Release(std::move(buf));
+    assert(Size() == 1);
+
+    // 65 bytes round up to the same class.
+    WriteBuffer again = Acquire(65);
+    (void)bytes;
+    assert(again.data() == bytes && again.written() == 0);
+    assert(Size() == 0);
+
+    // A buffer that grew goes to its new class.
+    again.reserve(1000);
+    assert(again.capacity() >= 1000);
+    Release(std::move(again));
+    assert(Size() == 1 && Acquire(64).capacity() == 64);
+    assert(Acquire(1000).capacity() >= 1000 && Size() == 0);
+  }
+
+  // Discarded bytes don't count toward the size class: the buffer
+  // only allocated 64.
+  {
+    WriteBuffer buf = Acquire(64);
+
+    for (size_t i = 0; i < 10; i++) {
+      memset(buf.reserve(60), 0, 60);
+      buf.commit(60);
+      buf.discard();
+    }
+
+    assert(buf.capacity() > 512);
+    Release(std::move(buf));
+    assert(Size() == 1 && Acquire(300).capacity() >= 300);
+    assert(Size() == 1 && Acquire(64).capacity() == 64 && Size() == 0);
+  }
+
+  // Segmented, tiny, and huge buffers aren't pooled, and neither are
+  // buffers past `kMaxPerClass`.
+  Release(WriteBuffer::Segmented(4096));
+  Release(WriteBuffer(16));
+  Release(Acquire(1UL << (kMaxClass + 1)));
+  assert(Size() == 0);
+  for (size_t i = 0; i < 2 * kMaxPerClass; i++) Release(WriteBuffer(256));
+  assert(Size() == kMaxPerClass);
+  Clear();
+  assert(Size() == 0);
+
+  // Hints converge to the sizes written, with some headroom.
+  {
+    BufferSizeHint hint;
+
+    assert(hint.meta_capacity() == 64 && hint.data_capacity() == 64);
+    hint.update(10, 1000);
+    assert(hint.data_capacity() >= 1000 && hint.data_capacity() < 1400);
+    for (size_t i = 0; i < 100; i++) hint.update(20, 5000);
+    assert(hint.meta_capacity() >= 20 && hint.meta_capacity() < 100);
+    assert(hint.data_capacity() >= 5000 && hint.data_capacity() < 6500);
+  }
+
+  // `PooledWriters` learn their size, and return their buffers.
+  {
+    BufferSizeHint *hint = PooledWriters::HintFor<PooledWriters>();
+
+    for (size_t i = 0; i < 3; i++) {
+      PooledWriters writers(hint);
+
+      // Every other field number, so that the metadata isn't a few
+      // `RunFields`.
+      for (uint32_t field = 1; field <= 300; field++) {
+        writers.meta.field(2 * field, writers.data.varint(field));
+      }
+
+      writers.meta.close(writers.data.buf.written());
+    }
+
+    assert(Size() == 2);
+    assert(hint->data_capacity() >= 300 && hint->meta_avg > 0);
+
+    PooledWriters writers(hint);
+    assert(writers.data.buf.capacity() >= 300);
+    assert(Size() == 0);
+  }
+
+  Clear();
+  return;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "data_writer.h"
+#include "meta_writer.h"
+#include "write_buffer.h"
+
+/// Recycles `WriteBuffer`s, so that encoding a message doesn't
+/// `malloc` (and then `realloc`) a fresh metadata and data buffer.
+///
+/// Each thread has its own free lists, one per power-of-two size
+/// class, so acquiring and releasing buffers never synchronises with
+/// other threads.  A buffer released on another thread than the one
+/// that acquired it simply joins the releasing thread's pool.
+
+/// Learned capacities for one message type: exponentially weighted
+/// moving averages of the metadata and data bytes written per message.
+///
+/// Hints aren't thread-safe; `PooledWriters::HintFor<T>()` returns a
+/// thread-local hint per message type.
+struct BufferSizeHint {
+  /// Folds in the sizes of one more message, with weight 1/8.
+  void update(size_t meta_written, size_t data_written);
+
+  /// Capacities to request for the next message: the averages, with a
+  /// quarter of headroom and some slack for the writers' `reserve`s.
+  size_t meta_capacity() const;
+  size_t data_capacity() const;
+
+  /// Averages, in 1/8ths of a byte.
+  uint64_t meta_avg{0};
+  uint64_t data_avg{0};
+};
+
+struct WriteBufferPool {
+  /// Largest pooled size class (2^kMaxClass bytes); larger buffers
+  /// are freed on release.
+  static constexpr size_t kMaxClass = 26;
+
+  /// Buffers kept per size class and thread; extra buffers are freed.
+  static constexpr size_t kMaxPerClass = 8;
+
+  /// Returns an empty linear buffer with room for at least `capacity`
+  /// bytes, from the calling thread's pool if possible.
+  static WriteBuffer Acquire(size_t capacity);
+
+  /// Resets `buf` and adds it to the calling thread's pool (or frees
+  /// it, if the pool is full).  Segmented buffers are freed.
+  static void Release(WriteBuffer buf);
+
+  /// Number of buffers in the calling thread's pool.
+  static size_t Size();
+
+  /// Frees every buffer in the calling thread's pool.
+  static void Clear();
+
+  static void SelfTest();
+};
+
+/// A `MetaWriter` and a `DataWriter` with buffers from the calling
+/// thread's pool, sized by a `BufferSizeHint`.  On destruction, the
+/// hint learns the size of what was written, and the buffers go back
+/// to the pool.
+struct PooledWriters {
+  explicit PooledWriters(BufferSizeHint *hint_)
+      : meta(WriteBufferPool::Acquire(hint_->meta_capacity())),
+        data(WriteBufferPool::Acquire(hint_->data_capacity())),
+        hint(hint_) {}
+
+  /// `PooledWriters` are neither copyable nor movable: they return
+  /// their buffers exactly once.
+  PooledWriters(const PooledWriters &) = delete;
+  PooledWriters &operator=(const PooledWriters &) = delete;
+
+  ~PooledWriters();
+
+  /// Returns the calling thread's hint for message type `T`.
+  template <typename T>
+  static BufferSizeHint *HintFor() {
+    static thread_local BufferSizeHint hint;
+
+    return &hint;
+  }
+
+  MetaWriter meta;
+  DataWriter data;
+  BufferSizeHint *hint;
+};
@@ -0,0 +1,405 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "data_reader.h"
+#include "data_writer.h"
+#include "decoder.h"
+#include "meta_reader.h"
+#include "meta_writer.h"
+
+/// Support code for the encoders and decoders that `splitc`
+/// generates from `.proto` schemas.
+///
+/// Generated code provides, for each message type `T`, in the
+/// schema's namespace:
+///
+///   // Writes the fields of `message` (but not the close).
+///   void EncodeFields(const T &message, MetaWriter *, DataWriter *);
+///   void EncodeFields(const T &message, UncheckedMetaWriter *,
+///                     UncheckedDataWriter *);
+///
+///   // Adds upper bounds for the size of `message`'s fields.
+///   void AddEncodeBounds(const T &message, codegen::EncodeBounds *);
+///
+///   // Stores a field with `width` bytes of data at `data`.
+///   bool DecodeField(uint32_t field, size_t width, const uint8_t *data,
+///                    T *message);
+///
+///   // Decodes the run of submessages opened for `field`, nested
+///   // `depth` runs deep (1 for runs in the top-level message).
+///   bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+///                   size_t depth, MetaReader *, DataReader *,
+///                   T *message);
+///
+/// Repeated scalar fields are encoded as runs of single-field
+/// submessages: each element is field 1 of its own submessage.
+///
+/// Generated code also has `EncodeFields` overloads for the writers of
+/// `split_literal_meta.h` and `parallel_encode.h`.  Generated headers
+/// only name those types, with the declarations below; the generated
+/// sources include the headers that define them.
+template <bool kChecked>
+struct BasicSplitLiteralBaseMetaWriter;
+using SplitLiteralMetaWriter =
+    BasicMetaWriter<true, BasicSplitLiteralBaseMetaWriter>;
+
+namespace codegen {
+struct ParallelOptions;
+}  // namespace codegen
+
+namespace codegen {
+/// Opens a run of `count` submessages for `field`, writes each with
+/// `encode(i)`, with separators in between, and closes the run.
+///
+/// Runs for repeated fields have a size hint (if it fits), and runs
+/// for singular fields don't.
+template <typename Meta, typename Data, typename EncodeElement>
+void EncodeRun(Meta *meta, Data *data, uint32_t field, bool repeated,
+               size_t count, EncodeElement encode) {
+  size_t run_begin = data->buf.written();
+  size_t message_begin = run_begin;
+
+  meta->open(field, (repeated && count < (1UL << 28)) ? count : 0);
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0) {
+      meta->separate(data->buf.written() - message_begin);
+      message_begin = data->buf.written();
+    }
+
+    encode(i);
+  }
+
+  meta->close(data->buf.written() - run_begin);
+  return;
+}
+
+/// Writes a repeated integer field like `EncodeRun` with a `varint`
+/// per element, into the same bytes, but packs the data in batches
+/// with `DataWriter::varints`.  `values` must not be empty.
+template <typename Meta, typename Data, typename T>
+void EncodeVarintRun(Meta *meta, Data *data, uint32_t field,
+                     const std::vector<T> &values) {
+  constexpr size_t kBatch = 256;
+  uint8_t widths[kBatch];
+  size_t count = values.size();
+  uint64_t run_size = 0;
+  // Each element's submessage is its one field, so each separator
+  // carries the previous element's width.
+  uint8_t previous = 0;
+
+  meta->open(field, count < (1UL << 28) ? count : 0);
+  for (size_t begin = 0; begin < count; begin += kBatch) {
+    size_t batch = std::min(kBatch, count - begin);
+
+    run_size += data->varints(values.data() + begin, batch, widths);
+    for (size_t i = 0; i < batch; i++) {
+      if (begin + i > 0) meta->separate(previous);
+      meta->field(1, widths[i]);
+      previous = widths[i];
+    }
+  }
+
+  meta->close(run_size);
+  return;
+}
+
+/// Writes `message` as a top-level message.
+template <typename T, typename Meta, typename Data>
+void EncodeMessage(const T &message, Meta *meta, Data *data) {
+  size_t begin = data->buf.written();
+
+  EncodeFields(message, meta, data);
+  meta->close(data->buf.written() - begin);
+  return;
+}
+
+/// Upper bounds on the size of a message in each stream.
+struct EncodeBounds {
+  size_t meta{0};
+  size_t data{0};
+};
+
+/// Upper bounds on the metadata bytes for each `MetaWriter` call,
+/// including what later calls write on its behalf.
+///
+/// `field`: a 5-byte `SkipN` and a `OneField` (or its share of a
+/// `TwoFields`, `RunFields`, `FieldN`, or folded width).
+constexpr size_t kFieldMetaBound = 6;
+/// `string`: a `SkipN` and a `FieldN` with a 56-bit literal.
+constexpr size_t kStringMetaBound = 5 + 9;
+/// `open`: a `SkipN` and an `OpenField` with a 28-bit literal.
+constexpr size_t kOpenMetaBound = 5 + 5;
+/// `separate` and `close`: a `FieldSeparate` or `FieldClose` with a
+/// 56-bit literal.
+constexpr size_t kEndMetaBound = 9;
+
+/// Adds the bounds for `count` machine word fields of up to `width`
+/// bytes each.
+inline void AddFieldBounds(size_t width, EncodeBounds *bounds,
+                           size_t count = 1) {
+  bounds->meta += count * kFieldMetaBound;
+  bounds->data += count * width;
+}
+
+/// Adds the bounds for `count` (0 or 1) string fields of `size` bytes.
+inline void AddStringBounds(size_t size, EncodeBounds *bounds,
+                            size_t count = 1) {
+  bounds->meta += count * kStringMetaBound;
+  bounds->data += count * size;
+}
+
+/// Adds the bounds for opening, separating, and closing a run of
+/// `count` submessages, but not for their fields.  Empty runs write
+/// nothing.
+inline void AddRunBounds(size_t count, EncodeBounds *bounds) {
+  bounds->meta += (count != 0) * kOpenMetaBound + count * kEndMetaBound;
+}
+
+/// Writes `message` as a top-level message, like `EncodeMessage`, but
+/// in two phases: `AddEncodeBounds` computes upper bounds for both
+/// streams, each buffer is reserved once, and the fields are written
+/// with writers that don't check capacity.
+///
+/// This is slower than `EncodeMessage` on the benchmark messages: the
+/// bounds pass walks the message a second time, which costs more than
+/// the capacity checks it saves.  The unchecked writers only pay for
+/// callers with a bound that doesn't take a walk; this checks them.
+///
+/// `meta` must be between top-level messages, as after
+/// `EncodeMessage`.
+template <typename T>
+void EncodeMessageUnchecked(const T &message, MetaWriter *meta,
+                            DataWriter *data) {
+  EncodeBounds bounds;
+
+  AddEncodeBounds(message, &bounds);
+  // Every data `reserve` is within its field's bound, but metadata
+  // emitters reserve up to `kMaxReserve` bytes to commit fewer.
+  meta->base.buf.reserve(bounds.meta + kEndMetaBound +
+                         BaseMetaWriter::kMaxReserve);
+  data->buf.reserve(bounds.data);
+
+  UncheckedMetaWriter unchecked_meta(std::move(meta->base.buf));
+  UncheckedDataWriter unchecked_data(std::move(data->buf));
+
+  EncodeMessage(message, &unchecked_meta, &unchecked_data);
+  meta->base.buf = std::move(unchecked_meta.base.buf);
+  data->buf = std::move(unchecked_data.buf);
+  return;
+}
+
+/// Decodes a scalar of `width` bytes at `data` to `out`.  Integers
+/// accept any width, floating point values only their own size.
+template <typename T>
+bool DecodeValue(const uint8_t *data, size_t width, T *out) {
+  if constexpr (std::is_same_v<T, bool>) {
+    *out = DataReader::load(data, width) != 0;
+    return true;
+  } else if constexpr (std::is_integral_v<T>) {
+    if (__builtin_expect(width != 1 && width != 2 && width != 4 && width != 8,
+                         0))
+      return false;
+
+    *out = (T)DataReader::load(data, width);
+    return true;
+  } else {
+    static_assert(std::is_floating_point_v<T>);
+    if (__builtin_expect(width != sizeof(T), 0)) return false;
+
+    memcpy(out, data, sizeof(T));
+    return true;
+  }
+}
+
+inline bool DecodeValue(const uint8_t *data, size_t width, std::string *out) {
+  out->assign((const char *)data, width);
+  return true;
+}
+
+/// The element type of a decoded run for unknown fields: everything
+/// is parsed and dropped.
+struct Ignored {};
+
+template <typename T>
+bool DecodeRun(MetaReader *meta, DataReader *data, size_t first_width,
+               size_t depth, T *(*next_element)(void *), void *state);
+
+inline bool DecodeField(uint32_t, size_t, const uint8_t *, Ignored *) {
+  return true;
+}
+
+inline bool DecodeOpen(uint32_t, uint64_t, size_t first_width, size_t depth,
+                       MetaReader *meta, DataReader *data, Ignored *) {
+  static Ignored ignored;
+
+  return DecodeRun<Ignored>(meta, data, first_width, depth,
+                            [](void *) { return &ignored; }, nullptr);
+}
+
+/// Elements of repeated scalar fields live in field 1 of their
+/// submessage; every other field is dropped.
+template <typename T>
+bool DecodeField(uint32_t field, size_t width, const uint8_t *data,
+                 T *value) {
+  if (field != 1) return true;
+  return DecodeValue(data, width, value);
+}
+
+template <typename T>
+bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t first_width,
+                size_t depth, MetaReader *meta, DataReader *data, T *) {
+  return DecodeOpen(field, len_hint, first_width, depth, meta, data,
+                    (Ignored *)nullptr);
+}
+
+/// Decodes the fields of a run of submessages, up to and including
+/// its `FieldClose`, into the elements returned by successive calls
+/// to `next_element(state)`: once for the first submessage, and once
+/// after every `FieldSeparate`.  `first_width` is the width of the
+/// first field of the run, from its `OpenField` (0 if none), and
+/// `depth` the number of runs it's nested in (0 for the top-level
+/// message).
+///
+/// Like `Decode`, run and submessage sizes are checked against the
+/// data actually consumed, and runs nested more than
+/// `decoder_internal::kMaxDepth` deep fail, rather than exhausting the
+/// stack on hostile input.
+template <typename T>
+bool DecodeRun(MetaReader *meta, DataReader *data, size_t first_width,
+               size_t depth, T *(*next_element)(void *), void *state) {
+  T *message = next_element(state);
+  uint32_t field = 1;
+  size_t run_begin = data->offset();
+  size_t message_begin = run_begin;
+  MetaInstruction insn;
+
+  auto emit = [&](size_t width) {
+    const uint8_t *src = data->read(width);
+
+    if (__builtin_expect(src == nullptr, 0)) return false;
+    return DecodeField(field++, width, src, message);
+  };
+
+  if (first_width != 0 && !emit(first_width)) return false;
+
+  while (meta->next(&insn)) {
+    switch (insn.op) {
+      case Opcode::SkipN:
+        field += insn.imm1 + insn.literal;
+        break;
+
+      case Opcode::OneField:
+        field += insn.imm1;
+        if (!emit(MetaReader::width_for_nonzero_immediate(insn.imm2)))
+          return false;
+        break;
+
+      case Opcode::TwoFields:
+        if (!emit(MetaReader::width_for_nonzero_immediate(insn.imm1)) ||
+            !emit(MetaReader::width_for_nonzero_immediate(insn.imm2)))
+          return false;
+        break;
+
+      case Opcode::OpenField:
+        if (__builtin_expect(depth == decoder_internal::kMaxDepth, 0))
+          return false;
+
+        if (!DecodeOpen(field, insn.literal,
+                        MetaReader::width_for_zeroable_immediate(insn.imm1),
+                        depth + 1, meta, data, message))
+          return false;
+        field++;
+        break;
+
+      case Opcode::FieldClose: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !emit(width)) return false;
+        return insn.literal == data->offset() - run_begin;
+      }
+
+      case Opcode::FieldSeparate: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !emit(width)) return false;
+        if (__builtin_expect(insn.literal != data->offset() - message_begin,
+                             0))
+          return false;
+
+        message = next_element(state);
+        field = 1;
+        message_begin = data->offset();
+        break;
+      }
+
+      case Opcode::RunFields: {
+        size_t width = MetaReader::width_for_nonzero_immediate(insn.imm1);
+        uint64_t count = MetaReader::run_fields_count(insn.literal);
+        // One bounds check for the whole run, whose data is contiguous.
+        const uint8_t *src = data->read(width * count);
+
+        if (__builtin_expect(src == nullptr, 0)) return false;
+        for (uint64_t i = 0; i < count; i++, src += width) {
+          if (!DecodeField(field++, width, src, message)) return false;
+        }
+
+        break;
+      }
+
+      case Opcode::FieldN: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !emit(width)) return false;
+        if (!emit(insn.literal)) return false;
+        break;
+      }
+    }
+  }
+
+  return false;
+}
+
+/// Decodes a run of submessages into a single `T`: repeated
+/// submessages are merged, like protobuf does for singular fields.
+template <typename T>
+bool DecodeOne(MetaReader *meta, DataReader *data, size_t first_width,
+               size_t depth, T *out) {
+  return DecodeRun<T>(meta, data, first_width, depth,
+                      [](void *state) { return (T *)state; }, out);
+}
+
+/// Decodes a run of submessages, appending one element to the
+/// `std::vector` `out` for each.
+template <typename Vector>
+bool DecodeAppend(MetaReader *meta, DataReader *data, size_t first_width,
+                  size_t depth, Vector *out) {
+  using T = typename Vector::value_type;
+
+  return DecodeRun<T>(meta, data, first_width, depth,
+                      [](void *state) {
+                        return &((Vector *)state)->emplace_back();
+                      },
+                      out);
+}
+
+/// Decodes the top-level message in `meta` and `data` into `out`.
+///
+/// Returns true if the streams were well-formed and the metadata
+/// stream ended with the close of the top-level message.
+template <typename T>
+bool DecodeMessage(const void *meta, size_t meta_size, const void *data,
+                   size_t data_size, T *out) {
+  MetaReader meta_reader(meta, meta_size);
+  DataReader data_reader(data, data_size);
+
+  return DecodeOne(&meta_reader, &data_reader, 0, 0, out) &&
+         meta_reader.done();
+}
+}  // namespace codegen
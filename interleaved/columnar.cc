@@ -0,0 +1,289 @@
+#include "columnar.h"
+
+#include <assert.h>
+#include <string>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "data_writer.h"
+#include "decoder.h"
+#include "layout.h"
+
+namespace columnar {
+bool RunColumns::init(const codegen::MessageView &message, uint32_t field) {
+  codegen::RunView run;
+
+  if (!message.run(field, &run) || !run.next(&columns_)) return false;
+  len_hint_ = run.len_hint();
+  return true;
+}
+
+double Sum(const Column<float> &column) {
+  double sum = 0;
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  // Two accumulators of 4 doubles, one per half of each 8 floats.
+  __m256d low = _mm256_setzero_pd();
+  __m256d high = _mm256_setzero_pd();
+
+  for (; i + 8 <= column.count; i += 8) {
+    __m256 v = _mm256_loadu_ps((const float *)(column.data + 4 * i));
+
+    low = _mm256_add_pd(low, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+    high = _mm256_add_pd(high, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+  }
+
+  double lanes[4];
+
+  _mm256_storeu_pd(lanes, _mm256_add_pd(low, high));
+  sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+
+  for (; i < column.count; i++) sum += column[i];
+  return sum;
+}
+
+int64_t Sum(const Column<int32_t> &column) {
+  int64_t sum = 0;
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  // Sign-extends each half of 8 values to 64 bits.
+  __m256i low = _mm256_setzero_si256();
+  __m256i high = _mm256_setzero_si256();
+
+  for (; i + 8 <= column.count; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(column.data + 4 * i));
+
+    low = _mm256_add_epi64(low,
+                           _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+    high = _mm256_add_epi64(
+        high, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+  }
+
+  int64_t lanes[4];
+
+  _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(low, high));
+  sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+  for (; i < column.count; i++) sum += column[i];
+  return sum;
+}
+
+uint64_t Sum(const Column<uint64_t> &column) {
+  uint64_t sum = 0;
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+
+  for (; i + 8 <= column.count; i += 8) {
+    const __m256i *src = (const __m256i *)(column.data + 8 * i);
+
+    acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256(src));
+    acc1 = _mm256_add_epi64(acc1, _mm256_loadu_si256(src + 1));
+  }
+
+  uint64_t lanes[4];
+
+  _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+  sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+  for (; i < column.count; i++) sum += column[i];
+  return sum;
+}
+
+namespace {
+/// Appends `base` plus the index of each set bit of `mask` to
+/// `indices`.
+inline size_t AppendIndices(uint32_t mask, uint32_t base, uint32_t *indices) {
+  size_t count = 0;
+
+  for (; mask != 0; mask &= mask - 1)
+    indices[count++] = base + __builtin_ctz(mask);
+  return count;
+}
+}  // namespace
+
+size_t SelectGreater(const Column<int32_t> &column, int32_t threshold,
+                     uint32_t *indices) {
+  size_t count = 0;
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  __m256i bound = _mm256_set1_epi32(threshold);
+
+  for (; i + 8 <= column.count; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(column.data + 4 * i));
+    uint32_t mask = (uint32_t)_mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpgt_epi32(v, bound)));
+
+    count += AppendIndices(mask, (uint32_t)i, indices + count);
+  }
+#endif
+
+  for (; i < column.count; i++) {
+    if (column[i] > threshold) indices[count++] = (uint32_t)i;
+  }
+
+  return count;
+}
+
+size_t SelectGreater(const Column<float> &column, float threshold,
+                     uint32_t *indices) {
+  size_t count = 0;
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  __m256 bound = _mm256_set1_ps(threshold);
+
+  for (; i + 8 <= column.count; i += 8) {
+    __m256 v = _mm256_loadu_ps((const float *)(column.data + 4 * i));
+    // Ordered compares, so NaNs are never selected, like `>`.
+    uint32_t mask =
+        (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(v, bound, _CMP_GT_OQ));
+
+    count += AppendIndices(mask, (uint32_t)i, indices + count);
+  }
+#endif
+
+  for (; i < column.count; i++) {
+    if (column[i] > threshold) indices[count++] = (uint32_t)i;
+  }
+
+  return count;
+}
+}  // namespace columnar
+
+namespace {
+struct Sample {
+  bool valid;
+  int32_t delta;
+  float reading;
+  uint64_t timestamp;
+};
+
+struct Series {
+  uint32_t id;
+  std::vector<Sample> samples;
+  std::string name;
+};
+
+// Field 3 is skipped between the columns for `delta` and `reading`.
+using SampleLayout = layout::Layout<layout::Fixed<1, &Sample::valid>,
+                                    layout::Fixed<2, &Sample::delta>,
+                                    layout::Fixed<4, &Sample::reading>,
+                                    layout::Fixed<5, &Sample::timestamp>>;
+
+using SeriesLayout =
+    layout::Layout<layout::Fixed<1, &Series::id>,
+                   layout::Columnar<2, &Series::samples, SampleLayout>,
+                   layout::String<3, &Series::name>>;
+
+/// Counts `Decode` callbacks, to check that columnar runs are
+/// well-formed runs.
+struct CountVisitor {
+  void field(uint32_t, size_t, const uint8_t *) { fields++; }
+  void open(uint32_t, uint64_t) { opens++; }
+  void separate(uint64_t) { separates++; }
+  void close(uint64_t) {}
+
+  size_t fields{0};
+  size_t opens{0};
+  size_t separates{0};
+};
+}  // namespace
+
+void ColumnarSelfTest() {
+  using columnar::Column;
+
+  for (size_t count = 0; count < 40; count++) {
+    Series series{7, {}, "series"};
+
+    for (size_t i = 0; i < count; i++) {
+      series.samples.push_back(Sample{i % 3 == 0, (int32_t)(i * 37 % 23) - 11,
+                                      0.5f * i - 3, (1ULL << 40) + i});
+    }
+
+    BaseMetaWriter meta(16);
+    DataWriter data(16);
+    CountVisitor visitor;
+
+    SeriesLayout::encode(series, &meta, &data);
+
+    bool decoded = Decode(meta.buf.data(), meta.buf.written(), data.buf.data(),
+                          data.buf.written(), &visitor);
+
+    (void)decoded;
+    assert(decoded && visitor.separates == 0);
+    assert(visitor.opens == (count > 0));
+    // The id, the name, and 4 columns in the run, if any.
+    assert(visitor.fields == 2 + (count > 0 ? 4 : 0));
+
+    codegen::MessageView view(meta.buf.data(), meta.buf.written(),
+                              data.buf.data(), data.buf.written());
+    columnar::RunColumns columns;
+
+    assert(view.value<uint32_t>(1, 0) == 7 && view.bytes(3) == "series");
+    if (count == 0) {
+      assert(!columns.init(view, 2));
+      continue;
+    }
+
+    Column<bool> valid;
+    Column<int32_t> delta;
+    Column<float> reading;
+    Column<uint64_t> timestamp;
+    Column<int32_t> absent;
+    Column<uint64_t> misfit;
+    bool found = columns.init(view, 2) && columns.get(1, &valid) &&
+                 columns.get(2, &delta) && columns.get(4, &reading) &&
+                 columns.get(5, &timestamp);
+
+    (void)found;
+    assert(found && columns.len_hint() == count);
+    assert(!columns.get(3, &absent));
+    // 4-byte values don't make as many 8-byte ones.
+    assert(!columns.get(4, &misfit));
+
+    double reading_sum = 0;
+    int64_t delta_sum = 0;
+    uint64_t timestamp_sum = 0;
+    std::vector<uint32_t> expected_deltas;
+    std::vector<uint32_t> expected_readings;
+
+    for (size_t i = 0; i < count; i++) {
+      const Sample &sample = series.samples[i];
+
+      assert(valid[i] == sample.valid && delta[i] == sample.delta &&
+             reading[i] == sample.reading &&
+             timestamp[i] == sample.timestamp);
+      reading_sum += sample.reading;
+      delta_sum += sample.delta;
+      timestamp_sum += sample.timestamp;
+      if (sample.delta > 0) expected_deltas.push_back(i);
+      if (sample.reading > 4) expected_readings.push_back(i);
+    }
+
+    // The float values are exact in doubles, so the order of the
+    // additions doesn't matter.
+    assert(columnar::Sum(reading) == reading_sum);
+    assert(columnar::Sum(delta) == delta_sum);
+    assert(columnar::Sum(timestamp) == timestamp_sum);
+
+    std::vector<uint32_t> indices(count);
+
+    indices.resize(columnar::SelectGreater(delta, 0, indices.data()));
+    assert(indices == expected_deltas);
+    indices.resize(count);
+    indices.resize(columnar::SelectGreater(reading, 4.0f, indices.data()));
+    assert(indices == expected_readings);
+  }
+}
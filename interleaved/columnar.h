@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "message_view.h"
+
+/// Readers for repeated submessage fields written in columnar form by
+/// `layout::Columnar`, and SIMD reductions and filters over their
+/// columns.
+///
+/// A columnar run is a run of one submessage whose field `n` holds
+/// field `n` of every element, at a fixed width, so a column is a plain
+/// little-endian array in the data stream.  The arrays aren't aligned:
+/// kernels use unaligned loads.
+namespace columnar {
+/// One column: `count` values of type `T`, back to back at `data`.
+template <typename T>
+struct Column {
+  static_assert(std::is_arithmetic_v<T>);
+
+  T operator[](size_t i) const {
+    T ret;
+
+    memcpy(&ret, data + sizeof(T) * i, sizeof(T));
+    return ret;
+  }
+
+  const uint8_t *data{nullptr};
+  size_t count{0};
+};
+
+/// The columns of one columnar run.
+class RunColumns {
+ public:
+  /// Views the columnar run for `field` in `message`.
+  ///
+  /// Returns false if `field` isn't a run.
+  bool init(const codegen::MessageView &message, uint32_t field);
+
+  /// Number of elements: the run's size hint.  0 for runs of 2^28
+  /// elements or more, which only `get` can count.
+  uint64_t len_hint() const { return len_hint_; }
+
+  /// Returns column `field` in `out`.
+  ///
+  /// Returns false if the column is absent, its size isn't a multiple
+  /// of `sizeof(T)`, or its count doesn't match the size hint.
+  template <typename T>
+  bool get(uint32_t field, Column<T> *out) const {
+    std::string_view bytes;
+
+    if (!columns_.has(field)) return false;
+    bytes = columns_.bytes(field);
+    if (bytes.size() % sizeof(T) != 0 ||
+        (len_hint_ != 0 && bytes.size() / sizeof(T) != len_hint_))
+      return false;
+
+    out->data = (const uint8_t *)bytes.data();
+    out->count = bytes.size() / sizeof(T);
+    return true;
+  }
+
+ private:
+  codegen::MessageView columns_;
+  uint64_t len_hint_{0};
+};
+
+/// Sums of a column.  Floats are summed as doubles, and 32-bit
+/// integers as 64-bit ones; the order of the additions is unspecified.
+double Sum(const Column<float> &column);
+int64_t Sum(const Column<int32_t> &column);
+uint64_t Sum(const Column<uint64_t> &column);
+
+/// Writes the indices of the values greater than `threshold` to
+/// `indices` (which must have room for `column.count`), in increasing
+/// order.
+///
+/// Returns the number of indices written.
+size_t SelectGreater(const Column<int32_t> &column, int32_t threshold,
+                     uint32_t *indices);
+size_t SelectGreater(const Column<float> &column, float threshold,
+                     uint32_t *indices);
+}  // namespace columnar
+
+/// Writes columnar runs with `layout::Columnar`, and checks the
+/// readers and kernels against scalar loops.
+void ColumnarSelfTest();
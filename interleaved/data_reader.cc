@@ -0,0 +1,39 @@
+#include "data_reader.h"
+
+#include <assert.h>
+
+#include "data_writer.h"
+
+void DataReader::SelfTest() {
+  for (size_t i = 0; i < 64; i++) {
+    DataWriter writer(10);
+    const uint64_t value = 1ULL << i;
+    size_t size = writer.varint(value);
+
+    DataReader self(writer.buf.data(), writer.buf.written());
+    uint64_t actual = self.varint(size);
+
+    (void)actual;
+    assert(actual == value);
+    assert(self.remaining() == 0);
+    assert(!self.failed());
+  }
+
+  {
+    DataWriter writer(10);
+    size_t len = writer.string("asdf");
+
+    writer.fixed<uint32_t>(42);
+    (void)len;
+
+    DataReader self(writer.buf.data(), writer.buf.written());
+    assert(self.string(len) == "asdf");
+    assert(self.fixed<uint32_t>() == 42);
+    assert(self.offset() == len + sizeof(uint32_t));
+
+    // Reading past the end fails, without moving the cursor.
+    assert(self.read(1) == nullptr);
+    assert(self.failed());
+    assert(self.remaining() == 0);
+  }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/// `DataReader`s are the read-side counterpart of `DataWriter`s: they
+/// walk a linear data stream, one field at a time.  The data stream
+/// doesn't know anything about its own layout; field widths come from
+/// the metadata stream.
+///
+/// Every read method returns a null / empty value when the stream
+/// doesn't have enough bytes left; `failed()` tells these apart from
+/// legitimate zero values.
+struct DataReader {
+  DataReader() = delete;
+
+  /// Reads from `size` bytes at `data`.  The bytes must outlive the
+  /// reader.
+  DataReader(const void *data, size_t size)
+      : begin_((const uint8_t *)data),
+        cursor_((const uint8_t *)data),
+        end_((const uint8_t *)data + size) {}
+
+  static void SelfTest();
+
+  /// Consumes `count` bytes.
+  ///
+  /// Returns a pointer to the first byte consumed, or nullptr if
+  /// there are fewer than `count` bytes left.
+  inline const uint8_t *read(size_t count) {
+    const uint8_t *ret = cursor_;
+
+    if (__builtin_expect(count > remaining(), 0)) {
+      failed_ = true;
+      return nullptr;
+    }
+
+    cursor_ += count;
+    return ret;
+  }
+
+  /// Reads a variable-size unsigned integer value written with
+  /// `DataWriter::varint`, given its byte `width` (1, 2, 4, or 8).
+  inline uint64_t varint(size_t width) {
+    const uint8_t *src = read(width);
+
+    if (src == nullptr) return 0;
+    return load(src, width);
+  }
+
+  /// Reads a fixed-size value.
+  template <typename T>
+  T fixed() {
+    T ret{};
+    const uint8_t *src = read(sizeof(T));
+
+    if (src != nullptr) memcpy(&ret, src, sizeof(T));
+    return ret;
+  }
+
+  /// Reads a `size`-byte string.  The return value points into the
+  /// data stream.
+  std::string_view string(size_t size) {
+    const uint8_t *src = read(size);
+
+    if (src == nullptr) return std::string_view();
+    return std::string_view((const char *)src, size);
+  }
+
+  /// Loads a little-endian unsigned integer of `width` (1, 2, 4, or
+  /// 8) bytes at `src`.
+  static inline uint64_t load(const uint8_t *src, size_t width) {
+    switch (width) {
+      case 1:
+        return src[0];
+      case 2: {
+        uint16_t ret;
+
+        memcpy(&ret, src, sizeof(ret));
+        return ret;
+      }
+      case 4: {
+        uint32_t ret;
+
+        memcpy(&ret, src, sizeof(ret));
+        return ret;
+      }
+      default: {
+        uint64_t ret;
+
+        memcpy(&ret, src, sizeof(ret));
+        return ret;
+      }
+    }
+  }
+
+  /// Returns the number of bytes consumed so far.
+  inline size_t offset() const { return (size_t)(cursor_ - begin_); }
+
+  /// Returns the number of bytes left in the data stream.
+  inline size_t remaining() const { return (size_t)(end_ - cursor_); }
+
+  /// Returns true if any read ran past the end of the data stream.
+  inline bool failed() const { return failed_; }
+
+  /// Returns the first byte of the data stream.
+  inline const uint8_t *begin() const { return begin_; }
+
+ private:
+  const uint8_t *begin_;
+  const uint8_t *cursor_;
+  const uint8_t *end_;
+  bool failed_{false};
+};
@@ -1,7 +1,182 @@
 #include "data_writer.h"
 
 #include <assert.h>
+#include <vector>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+/// Byte count of `value` as `DataWriter::varint` writes it.
+inline uint8_t VarintWidth(uint64_t value) {
+  size_t count = (63 - __builtin_clzll(value | 1)) / 8;
+
+  count |= count >> 1;
+  count |= count >> 2;
+  return (uint8_t)(count + 1);
+}
+
+#if defined(__AVX2__)
+/// How to pack a block of 4 values, for each combination of their
+/// widths (`1 << code` bytes, with the 4 2-bit codes in an 8-bit
+/// index): `pshufb` masks that move the low bytes of each pair of
+/// values (one per 128-bit lane) to the start of the lane, the 4
+/// widths, and the byte counts of the low pair and of all 4.
+struct PackBlocks {
+  constexpr PackBlocks() : shuffles(), widths(), low_sizes(), sizes() {
+    for (size_t index = 0; index < 256; index++) {
+      uint8_t width[4];
+
+      for (size_t j = 0; j < 4; j++) width[j] = 1 << ((index >> (2 * j)) & 3);
+      for (size_t lane = 0; lane < 2; lane++) {
+        uint8_t *mask = shuffles[index] + 16 * lane;
+        size_t first = width[2 * lane];
+        size_t second = width[2 * lane + 1];
+
+        for (size_t i = 0; i < 16; i++) mask[i] = 0x80;
+        for (size_t i = 0; i < first; i++) mask[i] = (uint8_t)i;
+        for (size_t i = 0; i < second; i++)
+          mask[first + i] = (uint8_t)(8 + i);
+      }
+
+      widths[index] = width[0] | width[1] << 8 | width[2] << 16 |
+                      (uint32_t)width[3] << 24;
+      low_sizes[index] = width[0] + width[1];
+      sizes[index] = width[0] + width[1] + width[2] + width[3];
+    }
+  }
+
+  alignas(32) uint8_t shuffles[256][32];
+  uint32_t widths[256];
+  uint8_t low_sizes[256];
+  uint8_t sizes[256];
+};
+
+constexpr PackBlocks kPackBlocks;
+
+inline __m256i Load4(const int32_t *values) {
+  return _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)values));
+}
+
+inline __m256i Load4(const uint32_t *values) {
+  return _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *)values));
+}
+
+inline __m256i Load4(const int64_t *values) {
+  return _mm256_loadu_si256((const __m256i *)values);
+}
+
+inline __m256i Load4(const uint64_t *values) {
+  return _mm256_loadu_si256((const __m256i *)values);
+}
+
+/// All-ones in the 64-bit lanes of `v` below `1 << bits`.
+template <int bits>
+inline __m256i Fits(__m256i v) {
+  return _mm256_cmpeq_epi64(_mm256_srli_epi64(v, bits),
+                            _mm256_setzero_si256());
+}
+#endif
+
+template <typename T>
+size_t Pack(const T *values, size_t count, uint8_t *dst, uint8_t *widths) {
+  size_t size = 0;
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  // Each block of 4 values packs into at most 32 bytes, and its second
+  // 16-byte store starts at most 16 bytes in, so the stores stay within
+  // the 8 bytes per value of this block and the ones before.
+  const __m256i three = _mm256_set1_epi64x(3);
+  // Gathers the low byte of each 64-bit lane into the low 4 bytes.
+  const __m256i gather = _mm256_setr_epi8(
+      0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  //
+      0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+  for (; i + 4 <= count; i += 4) {
+    __m256i v = Load4(values + i);
+    // log2 of each width: 3, less 1 for each of 32, 16, and 8 bits
+    // that the value fits in.
+    __m256i codes = _mm256_add_epi64(
+        _mm256_add_epi64(three, Fits<8>(v)),
+        _mm256_add_epi64(Fits<16>(v), Fits<32>(v)));
+    __m256i bytes = _mm256_shuffle_epi8(codes, gather);
+    uint32_t low = (uint32_t)_mm256_cvtsi256_si32(bytes);
+    uint32_t high =
+        (uint32_t)_mm_cvtsi128_si32(_mm256_extracti128_si256(bytes, 1));
+    size_t index = (low & 3) | (low >> 6 & 0xC) | (high & 3) << 4 |
+                   (high >> 2 & 0xC0);
+    __m256i packed = _mm256_shuffle_epi8(
+        v, _mm256_load_si256((const __m256i *)kPackBlocks.shuffles[index]));
+
+    memcpy(widths + i, &kPackBlocks.widths[index], 4);
+    _mm_storeu_si128((__m128i *)(dst + size), _mm256_castsi256_si128(packed));
+    _mm_storeu_si128((__m128i *)(dst + size + kPackBlocks.low_sizes[index]),
+                     _mm256_extracti128_si256(packed, 1));
+    size += kPackBlocks.sizes[index];
+  }
+#endif
+
+  for (; i < count; i++) {
+    uint64_t value = (uint64_t)(int64_t)values[i];
+    uint8_t width = VarintWidth(value);
+
+    memcpy(dst + size, &value, sizeof(value));
+    widths[i] = width;
+    size += width;
+  }
+
+  return size;
+}
+}  // namespace
+
+size_t PackVarints(const int32_t *values, size_t count, uint8_t *dst,
+                   uint8_t *widths) {
+  return Pack(values, count, dst, widths);
+}
+
+size_t PackVarints(const uint32_t *values, size_t count, uint8_t *dst,
+                   uint8_t *widths) {
+  return Pack(values, count, dst, widths);
+}
+
+size_t PackVarints(const int64_t *values, size_t count, uint8_t *dst,
+                   uint8_t *widths) {
+  return Pack(values, count, dst, widths);
+}
+
+size_t PackVarints(const uint64_t *values, size_t count, uint8_t *dst,
+                   uint8_t *widths) {
+  return Pack(values, count, dst, widths);
+}
+
+namespace {
+/// Checks `varints` against `varint` on each of the first `count`
+/// values, for every `count`.
+template <typename T>
+void CheckVarints(const std::vector<T> &values) {
+  for (size_t count = 0; count <= values.size(); count++) {
+    DataWriter bulk(10);
+    DataWriter single(10);
+    std::vector<uint8_t> widths(count);
+    size_t size = bulk.varints(values.data(), count, widths.data());
+
+    (void)size;
+    for (size_t i = 0; i < count; i++) {
+      size_t width = single.varint((uint64_t)(int64_t)values[i]);
+
+      (void)width;
+      assert(widths[i] == width);
+    }
+
+    assert(size == single.buf.written() && size == bulk.buf.written());
+    assert(memcmp(bulk.buf.data(), single.buf.data(), size) == 0);
+  }
+}
+}  // namespace
+
+template <>
 void DataWriter::SelfTest() {
   {
     DataWriter self(10);
@@ -24,4 +199,15 @@ void DataWriter::SelfTest() {
     memcpy(&dst, self.buf.data(), self.buf.written());
     assert(dst == value);
   }
+
+  // Every width, and negative values, in every position of a block.
+  std::vector<uint64_t> values;
+
+  for (size_t i = 0; i < 70; i++)
+    values.push_back((i * 0x9E3779B97F4A7C15ULL) >> (i % 4 * 16 + i % 8));
+  CheckVarints(values);
+  CheckVarints(std::vector<int64_t>(values.begin(), values.end()));
+  CheckVarints(std::vector<uint32_t>(values.begin(), values.end()));
+  CheckVarints(std::vector<int32_t>{0, -1, 1, 255, 256, -256, 65535, 65536,
+                                    INT32_MIN, INT32_MAX, 7, -7, 1 << 20});
 }
@@ -1,12 +1,29 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <string_view>
 #include <vector>
 
 #include "write_buffer.h"
 
+/// Writes the `count` integers at `values` like `DataWriter::varint`,
+/// after sign-extending signed ones to 64 bits, back to back at `dst`,
+/// and the byte count of each to `widths`.  `dst` must have room for 8
+/// bytes per value: with AVX2, the values are compacted 4 at a time
+/// with byte shuffles, with stores past the packed bytes.
+///
+/// Returns the number of bytes written.
+size_t PackVarints(const int32_t *values, size_t count, uint8_t *dst,
+                   uint8_t *widths);
+size_t PackVarints(const uint32_t *values, size_t count, uint8_t *dst,
+                   uint8_t *widths);
+size_t PackVarints(const int64_t *values, size_t count, uint8_t *dst,
+                   uint8_t *widths);
+size_t PackVarints(const uint64_t *values, size_t count, uint8_t *dst,
+                   uint8_t *widths);
+
 /// `DataWriter`s wrap a `WriteBuffer` with utility methods to easily
 /// populate a data stream.  Directly go through the `buf` member to
 /// access the underlying `WriteBuffer`.
@@ -17,22 +34,27 @@
 ///
 /// The one exception is variable-length integers, which can be
 /// written as 1, 2, 4, or 8 byte values.
-struct DataWriter {
-  DataWriter() = delete;
+///
+/// `kChecked` writers grow their buffer on demand; unchecked ones
+/// (`UncheckedDataWriter`) skip the capacity check, and rely on the
+/// caller to `reserve` enough room in `buf` beforehand.
+template <bool kChecked>
+struct BasicDataWriter {
+  BasicDataWriter() = delete;
 
   /// Wraps this `buf`.
-  explicit DataWriter(WriteBuffer buf_) : buf(std::move(buf_)) {}
+  explicit BasicDataWriter(WriteBuffer buf_) : buf(std::move(buf_)) {}
 
   /// Wraps a `WriteBuffer` with initial `capacity`.
-  explicit DataWriter(size_t capacity) : buf(capacity) {}
+  explicit BasicDataWriter(size_t capacity) : buf(capacity) {}
 
   /// `DataWriter`s are move-only, like `WriteBuffer`s.
-  DataWriter(const DataWriter &) = delete;
-  DataWriter(DataWriter &&) = default;
-  DataWriter &operator=(const DataWriter &) = delete;
-  DataWriter &operator=(DataWriter &&) = default;
+  BasicDataWriter(const BasicDataWriter &) = delete;
+  BasicDataWriter(BasicDataWriter &&) = default;
+  BasicDataWriter &operator=(const BasicDataWriter &) = delete;
+  BasicDataWriter &operator=(BasicDataWriter &&) = default;
 
-  ~DataWriter() = default;
+  ~BasicDataWriter() = default;
 
   static void SelfTest();
 
@@ -50,7 +72,7 @@ struct DataWriter {
   template <typename T>
   size_t bytes(const T *ptr, size_t count) {
     size_t size = sizeof(T) * count;
-    void *dst = buf.reserve(size);
+    void *dst = reserve(size);
 
     memcpy(dst, ptr, size);
     return buf.commit(size);
@@ -61,7 +83,7 @@ struct DataWriter {
   /// Returns the number of bytes written.
   size_t string(std::string_view value) {
     size_t size = value.size();
-    void *dst = buf.reserve(size);
+    void *dst = reserve(size);
 
     memcpy(dst, value.data(), size);
     return buf.commit(size);
@@ -73,7 +95,7 @@ struct DataWriter {
   /// Returns the number of bytes written; the byte count
   /// is always 1, 2, 4, or 8.
   size_t varint(uint64_t value) {
-    void *dst = buf.reserve(sizeof(value));
+    void *dst = reserve(sizeof(value));
     size_t count = (63 - __builtin_clzll(value | 1)) / 8;
 
     memcpy(dst, &value, sizeof(value));
@@ -88,16 +110,44 @@ struct DataWriter {
     return buf.commit(count);
   }
 
+  /// Writes `count` variable-size integers, like `varint` on each
+  /// (signed ones are sign-extended to 64 bits), and stores the byte
+  /// count of each in `widths`.  Takes room for 8 bytes per value in
+  /// `buf`, like as many `varint` calls.
+  ///
+  /// Returns the number of bytes written.
+  template <typename T>
+  size_t varints(const T *values, size_t count, uint8_t *widths) {
+    void *dst = reserve(sizeof(uint64_t) * count);
+
+    return buf.commit(PackVarints(values, count, (uint8_t *)dst, widths));
+  }
+
   /// Writes a fixed-size value.
   ///
   /// Returns the number of bytes written.
   template <typename T>
   size_t fixed(T value) {
-    void *dst = buf.reserve(sizeof(T));
+    void *dst = reserve(sizeof(T));
 
     memcpy(dst, &value, sizeof(T));
     return buf.commit(sizeof(T));
   }
 
   WriteBuffer buf;
+
+ private:
+  inline void *reserve(size_t count) {
+    if constexpr (kChecked) {
+      return buf.reserve(count);
+    } else {
+      return buf.reserve_unchecked(count);
+    }
+  }
 };
+
+using DataWriter = BasicDataWriter<true>;
+using UncheckedDataWriter = BasicDataWriter<false>;
+
+template <>
+void DataWriter::SelfTest();
@@ -0,0 +1,122 @@
+#include "decoder.h"
+
+#include <assert.h>
+#include <string>
+#include <vector>
+
+#include "base_meta_writer.h"
+#include "data_writer.h"
+
+namespace {
+/// Logs every callback as a string, with field data as decoded
+/// integers.
+struct LogVisitor {
+  void field(uint32_t field, size_t width, const uint8_t *data) {
+    log.push_back(std::to_string(field) + "=" +
+                  std::to_string(DataReader::load(data, width)) + "/" +
+                  std::to_string(width));
+  }
+
+  void open(uint32_t field, uint64_t len_hint) {
+    log.push_back("open " + std::to_string(field) + " " +
+                  std::to_string(len_hint));
+  }
+
+  void separate(uint64_t size) {
+    log.push_back("separate " + std::to_string(size));
+  }
+
+  void close(uint64_t size) { log.push_back("close " + std::to_string(size)); }
+
+  std::vector<std::string> log;
+};
+}  // namespace
+
+void DecoderSelfTest() {
+  BaseMetaWriter meta(16);
+  DataWriter data(16);
+
+  // 1, 3
+  meta.one_field(0, data.varint(1));
+  meta.one_field(1, data.varint(3));
+
+  // 4: [{1, 2}, {3}], with a size hint of 2.
+  {
+    size_t run_begin = data.buf.written();
+
+    meta.open_field(2, data.varint(41));
+    {
+      uint8_t w = data.fixed<uint16_t>(42);
+
+      meta.field_separate(w, data.buf.written() - run_begin);
+    }
+
+    meta.skip(2);
+    {
+      uint8_t w = data.varint(43);
+
+      meta.field_close(w, data.buf.written() - run_begin);
+    }
+  }
+
+  // 5, 6
+  {
+    uint8_t w1 = data.fixed<uint64_t>(5);
+    uint8_t w2 = data.fixed<uint8_t>(6);
+
+    meta.two_fields(w1, w2);
+  }
+
+  // 7, 8: a string of 4 bytes.
+  {
+    uint8_t width = data.varint(7);
+    size_t len = data.fixed<uint32_t>(8);
+
+    meta.field_n(width, len);
+  }
+
+  // 9, 10, 11: a run of 2-byte fields.
+  for (uint16_t value = 9; value <= 11; value++) data.fixed<uint16_t>(value);
+  meta.run_fields(2, 3);
+
+  // 100
+  meta.skip(88);
+  {
+    uint8_t w = data.fixed<uint32_t>(100);
+
+    meta.field_close(w, data.buf.written());
+  }
+
+  {
+    LogVisitor visitor;
+    bool success = Decode(meta.buf.data(), meta.buf.written(), data.buf.data(),
+                          data.buf.written(), &visitor);
+    const std::vector<std::string> expected = {
+        "1=1/1",         "3=3/1",   "open 4 2", "1=41/1", "2=42/2",
+        "separate 3",    "3=43/1",  "close 4",  "5=5/8",  "6=6/1",
+        "7=7/1",         "8=8/4",   "9=9/2",    "10=10/2", "11=11/2",
+        "100=100/4",
+        "close " + std::to_string(data.buf.written()),
+    };
+
+    (void)success;
+    assert(success);
+    assert(visitor.log == expected);
+  }
+
+  // Truncated data stream.
+  {
+    LogVisitor visitor;
+
+    assert(!Decode(meta.buf.data(), meta.buf.written(), data.buf.data(),
+                   data.buf.written() - 1, &visitor));
+  }
+
+  // Truncated metadata stream: no top-level close.
+  {
+    LogVisitor visitor;
+
+    assert(!Decode(meta.buf.data(), meta.buf.written() - 2, data.buf.data(),
+                   data.buf.written(), &visitor));
+  }
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "data_reader.h"
+#include "meta_reader.h"
+
+/// Walks a metadata stream and its data stream in lockstep, and
+/// reports each field to a `Visitor` with the following methods:
+///
+///   // A field with `width` bytes of data at `data`.
+///   void field(uint32_t field, size_t width, const uint8_t *data);
+///
+///   // Opens a run of submessages for `field`, with an optional
+///   // (0 if none) size hint for the number of submessages.
+///   void open(uint32_t field, uint64_t len_hint);
+///
+///   // Alternatively, `open` may return a bool: false skips the
+///   // whole run, without any other callback for it.  `Meta` must
+///   // then have a `skip_run` method like `MetaReader`'s.
+///   bool open(uint32_t field, uint64_t len_hint);
+///
+///   // Separates two submessages, after one of `message_size` bytes.
+///   void separate(uint64_t message_size);
+///
+///   // Closes the current run of submessages (of `run_size` bytes),
+///   // or the top-level message.
+///   void close(uint64_t run_size);
+///
+/// Field numbers start at 1 in each (sub)message.  Widths tell the
+/// visitor how many bytes a field takes in the data stream; it's up
+/// to the visitor to know whether that's a varint, a fixed-size value,
+/// or a string.
+///
+/// Returns true if the streams were well-formed and the metadata
+/// stream ended with the close of the top-level message, and false
+/// otherwise.  The visitor may have seen some fields before an error
+/// is detected.
+template <typename Visitor>
+bool Decode(const void *meta, size_t meta_size, const void *data,
+            size_t data_size, Visitor *visitor);
+
+/// Same as above, for the reader objects: on success, `meta` has been
+/// consumed entirely and `data` is positioned after the top-level
+/// message's data.
+///
+/// `Meta` is any type with `MetaReader`'s `next` and `done` methods
+/// (e.g., `ScannedMetaReader`).
+template <typename Meta, typename Visitor>
+bool Decode(Meta *meta, DataReader *data, Visitor *visitor);
+
+/// Round trips a hand-written message through the writers and the
+/// decoder.
+void DecoderSelfTest();
+
+namespace decoder_internal {
+/// Maximum submessage nesting depth.
+inline constexpr size_t kMaxDepth = 64;
+
+/// Decoder state saved when entering a run of submessages.
+struct Frame {
+  uint32_t field;
+  size_t run_begin;
+  size_t message_begin;
+};
+}  // namespace decoder_internal
+
+template <typename Visitor>
+bool Decode(const void *meta, size_t meta_size, const void *data,
+            size_t data_size, Visitor *visitor) {
+  MetaReader meta_reader(meta, meta_size);
+  DataReader data_reader(data, data_size);
+
+  return Decode(&meta_reader, &data_reader, visitor);
+}
+
+template <typename Meta, typename Visitor>
+bool Decode(Meta *meta, DataReader *data, Visitor *visitor) {
+  using decoder_internal::Frame;
+  using decoder_internal::kMaxDepth;
+
+  Frame stack[kMaxDepth];
+  size_t depth = 0;
+  uint32_t field = 1;
+  // Data offset for the beginning of the current run of submessages,
+  // and for the current submessage in that run.
+  size_t run_begin = data->offset();
+  size_t message_begin = run_begin;
+  MetaInstruction insn;
+
+  auto emit = [&](size_t width) {
+    const uint8_t *src = data->read(width);
+
+    if (__builtin_expect(src == nullptr, 0)) return false;
+    visitor->field(field++, width, src);
+    return true;
+  };
+
+  while (meta->next(&insn)) {
+    switch (insn.op) {
+      case Opcode::SkipN:
+        field += insn.imm1 + insn.literal;
+        break;
+
+      case Opcode::OneField:
+        field += insn.imm1;
+        if (!emit(MetaReader::width_for_nonzero_immediate(insn.imm2)))
+          return false;
+        break;
+
+      case Opcode::TwoFields:
+        if (!emit(MetaReader::width_for_nonzero_immediate(insn.imm1)) ||
+            !emit(MetaReader::width_for_nonzero_immediate(insn.imm2)))
+          return false;
+        break;
+
+      case Opcode::OpenField: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (__builtin_expect(depth == kMaxDepth, 0)) return false;
+
+        if constexpr (std::is_same_v<decltype(visitor->open(field,
+                                                             insn.literal)),
+                                     bool>) {
+          if (!visitor->open(field, insn.literal)) {
+            uint64_t run_size;
+
+            if (!meta->skip_run(&run_size) || data->read(run_size) == nullptr)
+              return false;
+
+            field++;
+            break;
+          }
+        } else {
+          visitor->open(field, insn.literal);
+        }
+
+        stack[depth++] = Frame{field, run_begin, message_begin};
+
+        field = 1;
+        run_begin = message_begin = data->offset();
+        if (width != 0 && !emit(width)) return false;
+        break;
+      }
+
+      case Opcode::FieldClose: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !emit(width)) return false;
+        if (__builtin_expect(insn.literal != data->offset() - run_begin, 0))
+          return false;
+
+        visitor->close(insn.literal);
+        if (depth == 0) return meta->done();
+
+        const Frame &frame = stack[--depth];
+        field = frame.field + 1;
+        run_begin = frame.run_begin;
+        message_begin = frame.message_begin;
+        break;
+      }
+
+      case Opcode::FieldSeparate: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !emit(width)) return false;
+        if (__builtin_expect(insn.literal != data->offset() - message_begin,
+                             0))
+          return false;
+
+        visitor->separate(insn.literal);
+        field = 1;
+        message_begin = data->offset();
+        break;
+      }
+
+      case Opcode::RunFields: {
+        size_t width = MetaReader::width_for_nonzero_immediate(insn.imm1);
+        uint64_t count = MetaReader::run_fields_count(insn.literal);
+        // The run's data is contiguous: one bounds check covers it.
+        const uint8_t *src = data->read(width * count);
+
+        if (__builtin_expect(src == nullptr, 0)) return false;
+        for (uint64_t i = 0; i < count; i++, src += width)
+          visitor->field(field++, width, src);
+        break;
+      }
+
+      case Opcode::FieldN: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !emit(width)) return false;
+        if (!emit(insn.literal)) return false;
+        break;
+      }
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,329 @@
+#include "field_table.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "data_writer.h"
+#include "meta_reader.h"
+#include "meta_writer.h"
+
+void PrefixSum32(const uint32_t *in, uint32_t *out, size_t count) {
+  uint32_t total = 0;
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  // Inclusive sums within each 128-bit lane by shifting and adding,
+  // then the low lane's total is carried to the high lane, and the
+  // running total to both.  Subtracting the inputs makes the sums
+  // exclusive.
+  __m256i carry = _mm256_setzero_si256();
+  const __m256i last = _mm256_set1_epi32(7);
+  const __m256i low_last = _mm256_set1_epi32(3);
+
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256i x = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    x = _mm256_add_epi32(
+        x, _mm256_blend_epi32(_mm256_setzero_si256(),
+                              _mm256_permutevar8x32_epi32(x, low_last), 0xF0));
+    x = _mm256_add_epi32(x, carry);
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_sub_epi32(x, v));
+    carry = _mm256_permutevar8x32_epi32(x, last);
+  }
+
+  total = (uint32_t)_mm256_cvtsi256_si32(carry);
+#elif defined(__SSE2__)
+  __m128i carry = _mm_setzero_si128();
+
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i x = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi32(x, carry);
+    _mm_storeu_si128((__m128i *)(out + i), _mm_sub_epi32(x, v));
+    carry = _mm_shuffle_epi32(x, 0xFF);
+  }
+
+  total = (uint32_t)_mm_cvtsi128_si32(carry);
+#endif
+
+  for (; i < count; i++) {
+    uint32_t value = in[i];
+
+    out[i] = total;
+    total += value;
+  }
+
+  return;
+}
+
+bool FieldTable::build(const void *meta, size_t meta_size, const void *data,
+                       size_t data_size) {
+  meta_ = (const uint8_t *)meta;
+  meta_size_ = meta_size;
+  data_base_ = (const uint8_t *)data;
+  data_size_ = data_size;
+  return build_at(0, 0, 0, 0, data_size, true);
+}
+
+bool FieldTable::build_first(const FieldTable &parent, uint32_t field) {
+  if (!parent.has(field) || parent.kinds[field] != kRun) return false;
+
+  const Run *run = nullptr;
+
+  for (const Run &candidate : parent.runs_) {
+    if (candidate.field == field) run = &candidate;
+  }
+
+  size_t run_begin =
+      (size_t)(parent.data_ - parent.data_base_) + parent.offsets[field];
+
+  meta_ = parent.meta_;
+  meta_size_ = parent.meta_size_;
+  data_base_ = parent.data_base_;
+  data_size_ = parent.data_size_;
+  return build_at(run->meta_offset, run_begin, run->first_width, run_begin,
+                  run_begin + parent.widths[field], false);
+}
+
+bool FieldTable::build_next() {
+  if (done_) return false;
+  return build_at(end_meta_offset_, end_data_offset_, 0, run_begin_, run_end_,
+                  false);
+}
+
+bool FieldTable::build_at(size_t meta_offset, size_t data_offset,
+                          size_t first_width, size_t run_begin,
+                          size_t run_end, bool top_level) {
+  MetaReader meta_reader(meta_, meta_size_);
+  MetaInstruction insn;
+  size_t field = 1;
+  size_t filled = 0;
+  // Data bytes available to the message, and used so far.
+  uint64_t available = run_end - data_offset;
+  uint64_t total = 0;
+
+  run_begin_ = run_begin;
+  run_end_ = run_end;
+  done_ = top_level;
+  size_ = 0;
+  runs_.clear();
+
+  // Entries for absent fields up to `field`, then one for `field`.
+  // The arrays are written through local pointers: stores to `kinds`
+  // may alias anything, and would reload the vectors' members.
+  uint8_t *kind_data = kinds.data();
+  uint32_t *width_data = widths.data();
+  size_t capacity = kinds.size();
+  auto add = [&](uint64_t width, uint8_t kind) {
+    if (__builtin_expect(field > kMaxField || width > available - total, 0))
+      return false;
+
+    if (__builtin_expect(field >= capacity, 0)) {
+      capacity = std::max<size_t>(std::max<size_t>(2 * capacity, field + 1),
+                                  64);
+      kinds.resize(capacity);
+      widths.resize(capacity);
+      offsets.resize(capacity);
+      kind_data = kinds.data();
+      width_data = widths.data();
+    }
+
+    if (filled < field) {
+      memset(kind_data + filled, kAbsent, field - filled);
+      memset(width_data + filled, 0, (field - filled) * sizeof(uint32_t));
+    }
+
+    kind_data[field] = kind;
+    width_data[field] = (uint32_t)width;
+    filled = ++field;
+    total += width;
+    return true;
+  };
+
+  if (data_offset > run_end || run_end > data_size_) return false;
+  if (first_width != 0 && !add(first_width, kField)) return false;
+
+  meta_reader.seek(meta_offset);
+  for (;;) {
+    if (!meta_reader.next(&insn)) return false;
+
+    switch (insn.op) {
+      case Opcode::SkipN:
+        field += insn.imm1 + insn.literal;
+        continue;
+
+      case Opcode::OneField:
+        field += insn.imm1;
+        if (!add(MetaReader::width_for_nonzero_immediate(insn.imm2), kField))
+          return false;
+        continue;
+
+      case Opcode::TwoFields:
+        if (!add(MetaReader::width_for_nonzero_immediate(insn.imm1), kField) ||
+            !add(MetaReader::width_for_nonzero_immediate(insn.imm2), kField))
+          return false;
+        continue;
+
+      case Opcode::OpenField: {
+        Run run{(uint32_t)field,
+                MetaReader::width_for_zeroable_immediate(insn.imm1),
+                meta_reader.offset()};
+        uint64_t run_size;
+
+        if (!meta_reader.skip_run(&run_size) || !add(run_size, kRun))
+          return false;
+
+        runs_.push_back(run);
+        continue;
+      }
+
+      case Opcode::FieldClose:
+      case Opcode::FieldSeparate: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !add(width, kField)) return false;
+        break;
+      }
+
+      case Opcode::RunFields: {
+        size_t width = MetaReader::width_for_nonzero_immediate(insn.imm1);
+        uint64_t count = MetaReader::run_fields_count(insn.literal);
+
+        for (uint64_t i = 0; i < count; i++) {
+          if (!add(width, kField)) return false;
+        }
+
+        continue;
+      }
+
+      case Opcode::FieldN: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !add(width, kField)) return false;
+        if (!add(insn.literal, kField)) return false;
+        continue;
+      }
+    }
+
+    break;
+  }
+
+  // Check the message's size against its `FieldSeparate`, or its
+  // run's (or, for the top-level message, its own) `FieldClose`.
+  if (insn.op == Opcode::FieldSeparate) {
+    if (top_level || insn.literal != total) return false;
+  } else if (top_level) {
+    if (insn.literal != total || !meta_reader.done()) return false;
+  } else {
+    if (insn.literal != run_end - run_begin ||
+        data_offset + total != run_end)
+      return false;
+    done_ = true;
+  }
+
+  data_ = data_base_ + data_offset;
+  size_ = filled;
+  end_meta_offset_ = meta_reader.offset();
+  end_data_offset_ = data_offset + total;
+  PrefixSum32(widths.data(), offsets.data(), size_);
+  return true;
+}
+
+void FieldTable::SelfTest() {
+  // The prefix sum, at every length around the vector widths.
+  for (size_t count = 0; count < 40; count++) {
+    std::vector<uint32_t> in(count);
+    std::vector<uint32_t> out(count);
+    uint32_t total = 0;
+
+    for (size_t i = 0; i < count; i++) in[i] = (uint32_t)(i * i + 3 * i) % 11;
+    PrefixSum32(in.data(), out.data(), count);
+    for (size_t i = 0; i < count; i++) {
+      assert(out[i] == total);
+      total += in[i];
+    }
+
+    PrefixSum32(in.data(), in.data(), count);
+    assert(in == out);
+  }
+
+  MetaWriter meta(16);
+  DataWriter data(16);
+
+  // 1: 300, 2: "hello", 3: "", 4: [{1: 7, 3: "x"}, {}, {2: 1000}],
+  // 200: 5
+  meta.field(1, data.varint(300));
+  meta.string(2, data.string("hello"));
+  meta.string(3, data.string(""));
+  codegen::EncodeRun(&meta, &data, 4, true, 3, [&](size_t i) {
+    if (i == 0) {
+      meta.field(1, data.varint(7));
+      meta.string(3, data.string("x"));
+    } else if (i == 2) {
+      meta.field(2, data.varint(1000));
+    }
+  });
+  meta.field(200, data.fixed<uint64_t>(5));
+  meta.close(data.buf.written());
+
+  const void *meta_bytes = meta.base.buf.data();
+  size_t meta_size = meta.base.buf.written();
+  const void *data_bytes = data.buf.data();
+  size_t data_size = data.buf.written();
+  FieldTable table;
+  FieldTable element;
+  bool built = table.build(meta_bytes, meta_size, data_bytes, data_size);
+
+  (void)built;
+  assert(built);
+  assert(table.size() == 201);
+  assert(table.value<int32_t>(1, 0) == 300);
+  assert(std::string((const char *)table.get(2), table.widths[2]) == "hello");
+  assert(table.has(3) && table.widths[3] == 0);
+  assert(!table.has(5) && table.value<int32_t>(5, -1) == -1);
+  assert(!table.has(1000));
+  assert(table.value<uint64_t>(200, 0) == 5);
+  assert(table.kinds[4] == kRun && table.value<int32_t>(4, -1) == -1);
+
+  assert(!element.build_first(table, 1));
+  assert(element.build_first(table, 4));
+  assert(element.value<int32_t>(1, 0) == 7);
+  assert(std::string((const char *)element.get(3), element.widths[3]) == "x");
+  assert(element.build_next() && element.size() == 0);
+  assert(element.build_next() && element.value<int32_t>(2, 0) == 1000);
+  assert(element.done() && !element.build_next());
+
+  // A table reused for a smaller message.
+  MetaWriter meta2(16);
+  DataWriter data2(16);
+
+  meta2.field(2, data2.varint(9));
+  meta2.close(data2.buf.written());
+  assert(table.build(meta2.base.buf.data(), meta2.base.buf.written(),
+                     data2.buf.data(), data2.buf.written()));
+  assert(table.size() == 3 && !table.has(1) && !table.has(200));
+  assert(table.value<int32_t>(2, 0) == 9);
+
+  // Truncated streams, and field numbers past `kMaxField`.
+  assert(!table.build(meta_bytes, meta_size, data_bytes, data_size - 1));
+  assert(!table.build(meta_bytes, meta_size - 1, data_bytes, data_size));
+
+  MetaWriter far_meta(16);
+  DataWriter far_data(16);
+
+  far_meta.field(kMaxField + 1, far_data.varint(1));
+  far_meta.close(far_data.buf.written());
+  assert(!table.build(far_meta.base.buf.data(), far_meta.base.buf.written(),
+                      far_data.buf.data(), far_data.buf.written()));
+  return;
+}
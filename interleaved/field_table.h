@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "codegen_runtime.h"
+
+/// A `FieldTable` maps every field number of one message to its data,
+/// so that reading any field is an array lookup.
+///
+/// A message's fields are consecutive in the data stream, so the data
+/// offset of each field is the sum of the widths of the fields before
+/// it.  `build` decodes the message's instructions into dense arrays
+/// indexed by field number (the kind of each field, and its width),
+/// with width 0 for absent fields, then turns the widths into offsets
+/// with a SIMD exclusive prefix sum (8 lanes with AVX2, 4 with SSE2).
+/// Runs of submessages are one entry, with the run's data size as
+/// width; `build_first` and `build_next` table their submessages.
+///
+/// Field numbers must be at most `kMaxField`, to bound the size of the
+/// arrays.
+struct FieldTable {
+  FieldTable() = default;
+
+  /// `FieldTable`s are move-only, to avoid accidentally copying the
+  /// arrays.
+  FieldTable(const FieldTable &) = delete;
+  FieldTable(FieldTable &&) = default;
+  FieldTable &operator=(const FieldTable &) = delete;
+  FieldTable &operator=(FieldTable &&) = default;
+
+  static void SelfTest();
+
+  static constexpr uint32_t kMaxField = 1 << 16;
+
+  /// Values of `kinds`.
+  static constexpr uint8_t kAbsent = 0;
+  static constexpr uint8_t kField = 1;
+  static constexpr uint8_t kRun = 2;
+
+  /// Tables the top-level message in `meta` and `data`, which must
+  /// outlive the table.  The storage is reused across calls.
+  ///
+  /// Returns false if the streams are malformed, or have a field
+  /// number past `kMaxField`.  Runs of submessages are only checked
+  /// by `build_first` and `build_next`.
+  bool build(const void *meta, size_t meta_size, const void *data,
+             size_t data_size);
+
+  /// Tables the first submessage of run `field` in `parent`.
+  ///
+  /// Returns false if `field` isn't a run, or the submessage is
+  /// malformed.
+  bool build_first(const FieldTable &parent, uint32_t field);
+
+  /// Tables the submessage after the current one, in the same run.
+  ///
+  /// Returns false after the last submessage of the run, or if the
+  /// next one is malformed (`done()` distinguishes the two).
+  bool build_next();
+
+  /// Returns true once the last submessage of a run has been tabled.
+  bool done() const { return done_; }
+
+  /// Number of entries: field numbers up to the last present field.
+  size_t size() const { return size_; }
+
+  /// Returns true if `field` is present, as a field or as a run.
+  bool has(uint32_t field) const {
+    return field < size_ && kinds[field] != kAbsent;
+  }
+
+  /// Returns the data of `field`, which must be less than `size()`.
+  const uint8_t *get(uint32_t field) const { return data_ + offsets[field]; }
+
+  /// Returns scalar `field`, or `default_value` if absent or of the
+  /// wrong width, like `codegen::MessageView::value`.
+  template <typename T>
+  T value(uint32_t field, T default_value) const {
+    T ret;
+
+    if (!has(field) || kinds[field] != kField ||
+        !codegen::DecodeValue(get(field), widths[field], &ret))
+      return default_value;
+    return ret;
+  }
+
+  /// One entry per field number, below `size()`.
+  std::vector<uint8_t> kinds;
+  std::vector<uint32_t> widths;
+  std::vector<uint32_t> offsets;
+
+ private:
+  /// Where a run's instructions start.
+  struct Run {
+    uint32_t field;
+    uint32_t first_width;
+    size_t meta_offset;
+  };
+
+  /// Tables the message at `meta_offset` and `data_offset` (the data
+  /// offset of its run is `run_begin`, which ends at `run_end`), with
+  /// a first field of `first_width` bytes folded in an `OpenField`.
+  bool build_at(size_t meta_offset, size_t data_offset, size_t first_width,
+                size_t run_begin, size_t run_end, bool top_level);
+
+  const uint8_t *meta_{nullptr};
+  size_t meta_size_{0};
+  const uint8_t *data_base_{nullptr};
+  size_t data_size_{0};
+
+  /// Data of the tabled message.
+  const uint8_t *data_{nullptr};
+  size_t size_{0};
+  std::vector<Run> runs_;
+
+  // Where the message ends, and its run.
+  size_t end_meta_offset_{0};
+  size_t end_data_offset_{0};
+  size_t run_begin_{0};
+  size_t run_end_{0};
+  bool done_{true};
+};
+
+/// Writes the exclusive prefix sums of the `count` values at `in` to
+/// `out` (`out[0] = 0`, `out[i] = in[0] + ... + in[i - 1]`, modulo
+/// 2^32).  `in` and `out` may be the same array.
+void PrefixSum32(const uint32_t *in, uint32_t *out, size_t count);
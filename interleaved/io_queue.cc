@@ -0,0 +1,292 @@
+#include "io_queue.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#include <cstring>
+
+namespace {
+int SetupRing(unsigned entries, io_uring_params *params) {
+  return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+int EnterRing(int fd, unsigned to_submit, unsigned min_complete,
+              unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                      flags, nullptr, 0);
+}
+
+int RegisterRing(int fd, unsigned opcode, const void *arg, unsigned count) {
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+void *MapRing(int fd, size_t size, off_t offset) {
+  void *ret = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, offset);
+
+  return (ret == MAP_FAILED) ? nullptr : ret;
+}
+
+/// `pread`s or `pwrite`s all `size` bytes, for the synchronous
+/// fallback.  Returns the number of bytes transferred (short at the
+/// end of the file), or a negative errno.
+int64_t Transfer(bool write, int fd, void *buf, size_t size,
+                 uint64_t offset) {
+  size_t done = 0;
+
+  while (done < size) {
+    ssize_t got = write ? pwrite(fd, (uint8_t *)buf + done, size - done,
+                                 offset + done)
+                        : pread(fd, (uint8_t *)buf + done, size - done,
+                                offset + done);
+
+    if (got < 0 && errno == EINTR) continue;
+    if (got < 0) return -errno;
+    if (got == 0) break;
+    done += got;
+  }
+
+  return done;
+}
+}  // namespace
+
+IoQueue::~IoQueue() {
+  close_ring();
+  return;
+}
+
+void IoQueue::close_ring() {
+  if (sqes_ != nullptr) munmap(sqes_, sqes_size_);
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_ != nullptr) munmap(sq_ring_, sq_ring_size_);
+  if (ring_fd_ >= 0) close(ring_fd_);
+
+  ring_fd_ = -1;
+  sq_ring_ = cq_ring_ = sqes_ = nullptr;
+  return;
+}
+
+bool IoQueue::init(unsigned depth, const iovec *buffers, unsigned count,
+                   bool use_uring) {
+  assert(ring_fd_ < 0 && depth_ == 0);
+  if (depth == 0) return false;
+
+  depth_ = depth;
+  if (!use_uring) return true;
+
+  io_uring_params params;
+
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = SetupRing(depth, &params);
+  if (ring_fd_ < 0) return true;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+    sq_ring_size_ = cq_ring_size_ =
+        (sq_ring_size_ > cq_ring_size_) ? sq_ring_size_ : cq_ring_size_;
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sq_ring_ = MapRing(ring_fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+  if (sq_ring_ != nullptr) {
+    cq_ring_ = ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+                   ? sq_ring_
+                   : MapRing(ring_fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+  }
+
+  if (cq_ring_ != nullptr)
+    sqes_ = MapRing(ring_fd_, sqes_size_, IORING_OFF_SQES);
+
+  if (sqes_ == nullptr) {
+    // Fall back to synchronous operations.
+    close_ring();
+    return true;
+  }
+
+  uint8_t *sq = (uint8_t *)sq_ring_;
+  uint8_t *cq = (uint8_t *)cq_ring_;
+
+  sq_tail_ = (unsigned *)(sq + params.sq_off.tail);
+  sq_mask_ = *(unsigned *)(sq + params.sq_off.ring_mask);
+  sq_array_ = (unsigned *)(sq + params.sq_off.array);
+  cq_head_ = (unsigned *)(cq + params.cq_off.head);
+  cq_tail_ = (unsigned *)(cq + params.cq_off.tail);
+  cq_mask_ = *(unsigned *)(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+
+  registered_ = count > 0 && RegisterRing(ring_fd_, IORING_REGISTER_BUFFERS,
+                                          buffers, count) == 0;
+  return true;
+}
+
+bool IoQueue::queue(uint8_t opcode, int fd, int buffer, const void *buf,
+                    size_t size, uint64_t offset, uint64_t tag) {
+  if (in_flight_ == depth_) return false;
+
+  if (ring_fd_ < 0) {
+    bool write = opcode == IORING_OP_WRITE;
+
+    if (done_head_ == done_.size()) {
+      done_.clear();
+      done_head_ = 0;
+    }
+
+    done_.push_back({tag, Transfer(write, fd, (void *)buf, size, offset)});
+    in_flight_++;
+    return true;
+  }
+
+  if (size > UINT32_MAX) return false;
+
+  // `in_flight_ < depth_` operations, so the submission ring has room.
+  unsigned tail = *sq_tail_;
+  unsigned index = tail & sq_mask_;
+  io_uring_sqe *sqe = (io_uring_sqe *)sqes_ + index;
+
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  if (registered_ && buffer >= 0) {
+    sqe->opcode = (opcode == IORING_OP_WRITE) ? IORING_OP_WRITE_FIXED
+                                              : IORING_OP_READ_FIXED;
+    sqe->buf_index = buffer;
+  }
+
+  sqe->fd = fd;
+  sqe->off = offset;
+  sqe->addr = (uint64_t)(uintptr_t)buf;
+  sqe->len = (uint32_t)size;
+  sqe->user_data = tag;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+  int submitted;
+  do {
+    submitted = EnterRing(ring_fd_, 1, 0, 0);
+  } while (submitted < 0 && errno == EINTR);
+
+  if (submitted != 1) {
+    // Take the entry back: the kernel didn't consume it.
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+    return false;
+  }
+
+  in_flight_++;
+  return true;
+}
+
+bool IoQueue::write(int fd, int buffer, const void *buf, size_t size,
+                    uint64_t offset, uint64_t tag) {
+  return queue(IORING_OP_WRITE, fd, buffer, buf, size, offset, tag);
+}
+
+bool IoQueue::read(int fd, int buffer, void *buf, size_t size,
+                   uint64_t offset, uint64_t tag) {
+  return queue(IORING_OP_READ, fd, buffer, buf, size, offset, tag);
+}
+
+bool IoQueue::wait(uint64_t *tag, int64_t *result) {
+  if (in_flight_ == 0) return false;
+
+  if (ring_fd_ < 0) {
+    const Completion &completion = done_[done_head_++];
+
+    *tag = completion.tag;
+    *result = completion.result;
+    in_flight_--;
+    return true;
+  }
+
+  unsigned head = *cq_head_;
+
+  while (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+    if (EnterRing(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR)
+      return false;
+  }
+
+  const io_uring_cqe *cqe = (const io_uring_cqe *)cqes_ + (head & cq_mask_);
+
+  *tag = cqe->user_data;
+  *result = cqe->res;
+  __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+  in_flight_--;
+  return true;
+}
+
+void IoQueue::SelfTest() {
+  char path[] = "/tmp/io_queue_XXXXXX";
+  int fd = mkstemp(path);
+
+  assert(fd >= 0);
+  unlink(path);
+
+  // Both backends write 4 blocks out of order, through registered
+  // and plain buffers, then read them back.
+  for (bool use_uring : {true, false}) {
+    constexpr size_t kBlock = 4096;
+    static uint8_t blocks[4][kBlock] __attribute__((aligned(4096)));
+    uint8_t back[4][kBlock];
+    iovec registered[2] = {{blocks[0], kBlock}, {blocks[1], kBlock}};
+    IoQueue queue;
+    uint64_t tag;
+    int64_t result;
+    unsigned seen = 0;
+
+    for (size_t i = 0; i < 4; i++)
+      memset(blocks[i], 'a' + i + use_uring, kBlock);
+
+    bool ok = queue.init(3, registered, 2, use_uring);
+
+    assert(ok && (use_uring || !queue.uring()));
+    for (size_t i : {3, 0, 2}) {
+      ok = queue.write(fd, (i < 2) ? (int)i : -1, blocks[i], kBlock,
+                       i * kBlock, i);
+      assert(ok);
+    }
+
+    // Three in flight: the queue is full.
+    assert(queue.in_flight() == 3 &&
+           !queue.write(fd, 1, blocks[1], kBlock, kBlock, 1));
+    ok = queue.wait(&tag, &result);
+    assert(ok && result == (int64_t)kBlock);
+    seen |= 1 << tag;
+    ok = queue.write(fd, 1, blocks[1], kBlock, kBlock, 1);
+    assert(ok);
+
+    while (queue.wait(&tag, &result)) {
+      assert(result == (int64_t)kBlock && (seen & (1 << tag)) == 0);
+      seen |= 1 << tag;
+    }
+
+    assert(seen == 15 && queue.in_flight() == 0);
+    for (size_t i = 0; i < 4; i++) {
+      ok = queue.read(fd, -1, back[i], kBlock, i * kBlock, i);
+      assert(ok || i == 3);
+      if (!ok) {
+        ok = queue.wait(&tag, &result) &&
+             queue.read(fd, -1, back[i], kBlock, i * kBlock, i);
+        assert(ok && result == (int64_t)kBlock);
+      }
+    }
+
+    while (queue.wait(&tag, &result)) assert(result == (int64_t)kBlock);
+    assert(memcmp(back, blocks, sizeof(back)) == 0);
+
+    // Reads past the end of the file are short.
+    ok = queue.read(fd, 0, blocks[0], kBlock, 4 * kBlock - 10, 7) &&
+         queue.wait(&tag, &result);
+    assert(ok && tag == 7 && result == 10);
+    (void)ok;
+  }
+
+  close(fd);
+  return;
+}
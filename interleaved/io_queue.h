@@ -0,0 +1,107 @@
+#pragma once
+
+#include <sys/uio.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// An `IoQueue` runs reads and writes at file offsets asynchronously
+/// with io_uring, straight on the kernel's interface (without
+/// liburing): operations are queued in the submission ring, and their
+/// results come back, tagged, in the completion ring.
+///
+/// Buffers passed to `init` are registered with the ring, so reads
+/// and writes inside them skip the kernel's per-operation page
+/// pinning (`IORING_OP_READ_FIXED` and `WRITE_FIXED`).
+///
+/// When io_uring is unavailable (old kernels, or seccomp filters), or
+/// `init` is told not to use it, operations run synchronously with
+/// `pread` and `pwrite` instead, and `wait` returns their results in
+/// order: the same code works either way, only without the overlap.
+struct IoQueue {
+  IoQueue() = default;
+
+  /// `IoQueue`s own a ring: they can't be copied or moved.
+  IoQueue(const IoQueue &) = delete;
+  IoQueue(IoQueue &&) = delete;
+  IoQueue &operator=(const IoQueue &) = delete;
+  IoQueue &operator=(IoQueue &&) = delete;
+
+  ~IoQueue();
+
+  /// Sets up the queue for up to `depth` operations in flight, and
+  /// registers the `count` `buffers`, which must outlive the queue.
+  /// Uses io_uring if `use_uring` and the kernel allows it (if only
+  /// buffer registration fails, operations use plain reads and
+  /// writes).
+  ///
+  /// Returns false if `depth` is 0.
+  bool init(unsigned depth, const iovec *buffers, unsigned count,
+            bool use_uring = true);
+
+  /// Returns true if operations go through io_uring.
+  bool uring() const { return ring_fd_ >= 0; }
+
+  /// Queues a write of the `size` bytes at `buf` to `fd` at `offset`,
+  /// and submits it.  `buffer` is the index of the registered buffer
+  /// that holds `buf`, or -1.  `tag` identifies the operation in
+  /// `wait`.
+  ///
+  /// Returns false if `depth` operations are already in flight, or on
+  /// submission errors.
+  bool write(int fd, int buffer, const void *buf, size_t size,
+             uint64_t offset, uint64_t tag);
+
+  /// Same, for a read of `size` bytes from `fd` at `offset` to `buf`.
+  bool read(int fd, int buffer, void *buf, size_t size, uint64_t offset,
+            uint64_t tag);
+
+  /// Waits for an operation to complete, and sets its `tag` and its
+  /// `result`: the number of bytes transferred, or a negative errno.
+  /// Operations may complete in any order.
+  ///
+  /// Returns false if nothing is in flight, or on errors.
+  bool wait(uint64_t *tag, int64_t *result);
+
+  /// Number of operations submitted and not yet returned by `wait`.
+  unsigned in_flight() const { return in_flight_; }
+
+  static void SelfTest();
+
+ private:
+  struct Completion {
+    uint64_t tag;
+    int64_t result;
+  };
+
+  bool queue(uint8_t opcode, int fd, int buffer, const void *buf,
+             size_t size, uint64_t offset, uint64_t tag);
+
+  /// Unmaps and closes the ring, if any.
+  void close_ring();
+
+  unsigned depth_{0};
+  unsigned in_flight_{0};
+
+  /// Synchronous fallback: results of the operations not yet waited
+  /// for, in order.
+  std::vector<Completion> done_;
+  size_t done_head_{0};
+
+  int ring_fd_{-1};
+  bool registered_{false};
+  void *sq_ring_{nullptr};
+  size_t sq_ring_size_{0};
+  void *cq_ring_{nullptr};
+  size_t cq_ring_size_{0};
+  void *sqes_{nullptr};
+  size_t sqes_size_{0};
+
+  unsigned *sq_tail_{nullptr};
+  unsigned sq_mask_{0};
+  unsigned *sq_array_{nullptr};
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  unsigned cq_mask_{0};
+  void *cqes_{nullptr};
+};
@@ -0,0 +1,998 @@
+#include "json.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__AVX512BW__) || defined(__AVX2__) || defined(__SSE2__) || \
+    defined(__PCLMUL__)
+#include <immintrin.h>
+#endif
+
+namespace {
+/// Bitmasks with one bit per byte of a 64-byte block.
+struct BlockMasks {
+  uint64_t quote;
+  uint64_t backslash;
+  /// `{}[]:,`
+  uint64_t op;
+  uint64_t space;
+};
+
+inline BlockMasks Classify(const uint8_t *bytes) {
+#if defined(__AVX512BW__)
+  __m512i v = _mm512_loadu_si512((const void *)bytes);
+
+  auto eq = [&](char c) -> uint64_t {
+    return _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(c));
+  };
+#elif defined(__AVX2__)
+  __m256i lo = _mm256_loadu_si256((const __m256i *)bytes);
+  __m256i hi = _mm256_loadu_si256((const __m256i *)(bytes + 32));
+
+  auto eq = [&](char c) -> uint64_t {
+    __m256i k = _mm256_set1_epi8(c);
+
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, k)) |
+           ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, k))
+            << 32);
+  };
+#elif defined(__SSE2__)
+  __m128i v[4];
+
+  for (size_t i = 0; i < 4; i++)
+    v[i] = _mm_loadu_si128((const __m128i *)(bytes + 16 * i));
+
+  auto eq = [&](char c) -> uint64_t {
+    __m128i k = _mm_set1_epi8(c);
+    uint64_t ret = 0;
+
+    for (size_t i = 0; i < 4; i++)
+      ret |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[i], k))
+             << (16 * i);
+    return ret;
+  };
+#else
+  auto eq = [&](char c) -> uint64_t {
+    uint64_t ret = 0;
+
+    for (size_t i = 0; i < 64; i++)
+      ret |= (uint64_t)(bytes[i] == (uint8_t)c) << i;
+    return ret;
+  };
+#endif
+
+  return BlockMasks{
+      eq('"'),
+      eq('\\'),
+      eq('{') | eq('}') | eq('[') | eq(']') | eq(':') | eq(','),
+      eq(' ') | eq('\t') | eq('\n') | eq('\r'),
+  };
+}
+
+/// Returns a mask where each bit is the XOR of all the bits at or
+/// below it in `x`: with unescaped quotes as input, the result is set
+/// from each opening quote up to (excluding) its closing quote.
+inline uint64_t PrefixXor(uint64_t x) {
+#if defined(__PCLMUL__)
+  // Carry-less multiplication by all ones.
+  __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, (int64_t)x),
+                                         _mm_set1_epi8((char)0xFF), 0);
+
+  return (uint64_t)_mm_cvtsi128_si64(product);
+#else
+  for (size_t shift = 1; shift < 64; shift *= 2) x ^= x << shift;
+
+  return x;
+#endif
+}
+
+/// Returns the mask of bytes escaped by a backslash in a block with
+/// `backslash` bytes.  `*carry` is true iff the previous block ended
+/// with an escaping backslash, and is updated for the next block.
+///
+/// Backslashes are rare, so this simply walks them one at a time.
+inline uint64_t Escaped(uint64_t backslash, bool *carry) {
+  uint64_t escaped = *carry;
+
+  backslash &= ~escaped;
+  *carry = false;
+  while (backslash != 0) {
+    uint64_t bit = backslash & -backslash;
+    uint64_t next = bit << 1;
+
+    escaped |= next;
+    backslash &= ~(bit | next);
+    if (next == 0) *carry = true;
+  }
+
+  return escaped;
+}
+
+inline bool IsSpace(uint8_t c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool IsOp(uint8_t c) {
+  return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
+}
+
+/// Parses a JSON integer (an optional minus sign and digits) to its
+/// 64-bit two's complement representation.  Values must fit in a
+/// `uint64_t` or an `int64_t`.
+bool ParseInteger(const char *src, size_t size, uint64_t *out) {
+  bool negative = size > 0 && src[0] == '-';
+  size_t i = negative;
+  uint64_t ret = 0;
+
+  if (i == size) return false;
+
+  // 19 digits can't overflow.
+  size_t safe = (size - i > 19) ? i + 19 : size;
+  for (; i < safe; i++) {
+    uint8_t digit = src[i] - '0';
+
+    if (digit > 9) return false;
+    ret = 10 * ret + digit;
+  }
+
+  for (; i < size; i++) {
+    uint8_t digit = src[i] - '0';
+
+    if (digit > 9 || __builtin_mul_overflow(ret, 10, &ret) ||
+        __builtin_add_overflow(ret, digit, &ret))
+      return false;
+  }
+
+  if (negative) {
+    if (ret > (1ULL << 63)) return false;
+    ret = -ret;
+  }
+
+  *out = ret;
+  return true;
+}
+
+/// Parses a JSON number as a `double`, when that only takes one
+/// correctly rounded IEEE operation (Clinger's fast path): the decimal
+/// mantissa is at most 2^53, and the power of ten at most 10^22, so
+/// both are exact doubles.
+///
+/// Returns false if the number isn't in that range (or is malformed).
+bool ParseFastDouble(const char *src, size_t size, double *out) {
+  static constexpr double kPowersOf10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+
+  const char *end = src + size;
+  bool negative = src != end && *src == '-';
+  uint64_t mantissa = 0;
+  int64_t exponent = 0;
+  size_t digits = 0;
+
+  src += negative;
+  if (src == end || (uint8_t)(*src - '0') > 9) return false;
+
+  for (; src != end && (uint8_t)(*src - '0') <= 9; src++, digits++)
+    mantissa = 10 * mantissa + (*src - '0');
+
+  if (src != end && *src == '.') {
+    src++;
+    for (; src != end && (uint8_t)(*src - '0') <= 9; src++, digits++) {
+      mantissa = 10 * mantissa + (*src - '0');
+      exponent--;
+    }
+  }
+
+  // 19 digits can't overflow.
+  if (digits == 0 || digits > 19) return false;
+
+  if (src != end && (*src | 0x20) == 'e') {
+    bool negative_exponent = false;
+    int64_t explicit_exponent = 0;
+
+    src++;
+    if (src != end && (*src == '-' || *src == '+'))
+      negative_exponent = *src++ == '-';
+    if (src == end) return false;
+
+    for (; src != end && (uint8_t)(*src - '0') <= 9; src++) {
+      if (explicit_exponent > 1000) return false;
+      explicit_exponent = 10 * explicit_exponent + (*src - '0');
+    }
+
+    exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+  }
+
+  if (src != end || mantissa > (1ULL << 53) || exponent < -22 ||
+      exponent > 22)
+    return false;
+
+  double ret = (double)mantissa;
+  ret = (exponent < 0) ? ret / kPowersOf10[-exponent]
+                       : ret * kPowersOf10[exponent];
+  *out = negative ? -ret : ret;
+  return true;
+}
+
+/// Parses a JSON number as a `float` or a `double`.
+template <typename T>
+bool ParseFloating(const char *src, size_t size, T *out) {
+  char buf[64];
+  char *end;
+  double fast;
+
+  if (ParseFastDouble(src, size, &fast)) {
+    if constexpr (sizeof(T) == sizeof(double)) {
+      *out = fast;
+      return true;
+    } else {
+      // `fast` is the exact value rounded to double.  Rounding it to
+      // float gives the same result as rounding the exact value,
+      // unless `fast` is exactly halfway between two (normal) floats.
+      uint64_t bits;
+
+      memcpy(&bits, &fast, sizeof(bits));
+      if ((bits & ((1ULL << 29) - 1)) != (1ULL << 28) &&
+          (fast == 0 || (fabs(fast) >= FLT_MIN && fabs(fast) <= FLT_MAX))) {
+        *out = (float)fast;
+        return true;
+      }
+    }
+  }
+
+  if (size == 0 || size >= sizeof(buf) ||
+      (src[0] != '-' && (uint8_t)(src[0] - '0') > 9))
+    return false;
+
+  for (size_t i = 0; i < size; i++) {
+    char c = src[i];
+
+    if ((uint8_t)(c - '0') > 9 && c != '-' && c != '+' && c != '.' &&
+        c != 'e' && c != 'E')
+      return false;
+  }
+
+  memcpy(buf, src, size);
+  buf[size] = '\0';
+  if constexpr (sizeof(T) == sizeof(float)) {
+    *out = strtof(buf, &end);
+  } else {
+    *out = strtod(buf, &end);
+  }
+
+  return end == buf + size;
+}
+
+bool ParseHex4(const uint8_t *src, uint32_t *out) {
+  uint32_t ret = 0;
+
+  for (size_t i = 0; i < 4; i++) {
+    uint8_t c = src[i];
+    uint32_t digit;
+
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+      digit = (c | 0x20) - 'a' + 10;
+    } else {
+      return false;
+    }
+
+    ret = 16 * ret + digit;
+  }
+
+  *out = ret;
+  return true;
+}
+
+/// Decodes a `\u` escape (and the low surrogate after a high one) at
+/// `*src`, just after the `\u`, and writes its UTF-8 encoding to
+/// `*dst`.  Advances both.
+bool DecodeUnicode(const uint8_t **src, const uint8_t *end, uint8_t **dst) {
+  uint32_t code;
+
+  if (end - *src < 4 || !ParseHex4(*src, &code)) return false;
+  *src += 4;
+
+  if (code >= 0xD800 && code < 0xDC00) {
+    uint32_t low;
+
+    if (end - *src < 6 || (*src)[0] != '\\' || (*src)[1] != 'u' ||
+        !ParseHex4(*src + 2, &low) || low < 0xDC00 || low >= 0xE000)
+      return false;
+
+    *src += 6;
+    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+  } else if (code >= 0xDC00 && code < 0xE000) {
+    return false;
+  }
+
+  uint8_t *out = *dst;
+  if (code < 0x80) {
+    *out++ = code;
+  } else if (code < 0x800) {
+    *out++ = 0xC0 | (code >> 6);
+    *out++ = 0x80 | (code & 0x3F);
+  } else if (code < 0x10000) {
+    *out++ = 0xE0 | (code >> 12);
+    *out++ = 0x80 | ((code >> 6) & 0x3F);
+    *out++ = 0x80 | (code & 0x3F);
+  } else {
+    *out++ = 0xF0 | (code >> 18);
+    *out++ = 0x80 | ((code >> 12) & 0x3F);
+    *out++ = 0x80 | ((code >> 6) & 0x3F);
+    *out++ = 0x80 | (code & 0x3F);
+  }
+
+  *dst = out;
+  return true;
+}
+
+/// Writes the `size` bytes of string contents at `src` to `data`,
+/// and decodes escapes (which never expand).
+///
+/// Returns the number of bytes written, or SIZE_MAX for a malformed
+/// escape.
+size_t WriteString(const uint8_t *src, size_t size, DataWriter *data) {
+  uint8_t *dst = (uint8_t *)data->buf.reserve(size);
+  const uint8_t *end = src + size;
+  const uint8_t *backslash = (const uint8_t *)memchr(src, '\\', size);
+
+  if (__builtin_expect(backslash == nullptr, 1)) {
+    memcpy(dst, src, size);
+    return data->buf.commit(size);
+  }
+
+  uint8_t *out = dst;
+  while (backslash != nullptr) {
+    size_t plain = backslash - src;
+
+    memcpy(out, src, plain);
+    out += plain;
+    src = backslash + 2;
+    // The scan guarantees that a backslash never escapes the closing
+    // quote.
+    switch (backslash[1]) {
+      case '"':
+      case '\\':
+      case '/':
+        *out++ = backslash[1];
+        break;
+      case 'b':
+        *out++ = '\b';
+        break;
+      case 'f':
+        *out++ = '\f';
+        break;
+      case 'n':
+        *out++ = '\n';
+        break;
+      case 'r':
+        *out++ = '\r';
+        break;
+      case 't':
+        *out++ = '\t';
+        break;
+      case 'u':
+        if (!DecodeUnicode(&src, end, &out)) return SIZE_MAX;
+        break;
+      default:
+        return SIZE_MAX;
+    }
+
+    backslash = (const uint8_t *)memchr(src, '\\', end - src);
+  }
+
+  memcpy(out, src, end - src);
+  out += end - src;
+  return data->buf.commit(out - dst);
+}
+
+/// Walks the tokens found by a `JsonScan`, and writes the split
+/// streams.
+class JsonReader {
+ public:
+  JsonReader(const uint8_t *bytes, size_t size, const JsonScan &scan,
+             MetaWriter *meta, DataWriter *data)
+      : bytes_(bytes),
+        size_(size),
+        offsets_(scan.offsets.data()),
+        count_(scan.count),
+        meta_(meta),
+        data_(data) {}
+
+  /// Transcodes an object with `schema`.
+  bool object(const MessageSchema &schema);
+
+  /// Returns true once every token has been consumed.
+  bool done() const { return index_ == count_; }
+
+ private:
+  /// Returns the first byte of the current token, or NUL at the end.
+  char peek() const { return (index_ < count_) ? bytes_[offsets_[index_]] : 0; }
+
+  /// Consumes the current token if it's `c`.
+  bool consume(char c) {
+    if (peek() != c) return false;
+
+    index_++;
+    return true;
+  }
+
+  /// Consumes a string (both quote tokens), and returns the range of
+  /// its contents.
+  bool string(size_t *begin, size_t *end) {
+    if (peek() != '"') return false;
+
+    // The scan always pairs quotes.
+    *begin = offsets_[index_] + 1;
+    *end = offsets_[index_ + 1];
+    index_ += 2;
+    return true;
+  }
+
+  /// Consumes a scalar token (number or literal), and returns its
+  /// bytes.
+  bool token(const char **src, size_t *size);
+
+  /// Consumes a key and the colon after it.
+  bool key(uint32_t *number);
+
+  /// Consumes the value for `field`, and writes it.
+  bool value(const FieldSchema &field);
+
+  /// Consumes a scalar value of `kind`, and writes it as field
+  /// `number`.
+  bool scalar(FieldKind kind, uint32_t number);
+
+  /// Consumes a value without writing anything.
+  bool skip_value();
+
+  const uint8_t *bytes_;
+  size_t size_;
+  const uint32_t *offsets_;
+  size_t count_;
+  size_t index_{0};
+  MetaWriter *meta_;
+  DataWriter *data_;
+  /// Number of open runs in `meta_`.
+  size_t depth_{0};
+};
+
+bool JsonReader::object(const MessageSchema &schema) {
+  uint32_t last = 0;
+
+  if (!consume('{')) return false;
+  if (consume('}')) return true;
+
+  for (;;) {
+    uint32_t number;
+
+    if (!key(&number)) return false;
+
+    const FieldSchema *field = schema.find(number);
+    if (field == nullptr) {
+      if (!skip_value()) return false;
+    } else {
+      if (number <= last || !value(*field)) return false;
+      last = number;
+    }
+
+    if (consume('}')) return true;
+    if (!consume(',')) return false;
+  }
+}
+
+bool JsonReader::token(const char **src, size_t *size) {
+  if (index_ == count_) return false;
+
+  size_t begin = offsets_[index_];
+  if (bytes_[begin] == '"' || IsOp(bytes_[begin])) return false;
+
+  // Only whitespace separates the token from the next one (otherwise
+  // the scan would have found another token), and values are usually
+  // followed directly by a comma, so trim from the end.
+  size_t end = (index_ + 1 < count_) ? offsets_[index_ + 1] : size_;
+  while (IsSpace(bytes_[end - 1])) end--;
+
+  index_++;
+  *src = (const char *)bytes_ + begin;
+  *size = end - begin;
+  return true;
+}
+
+bool JsonReader::key(uint32_t *number) {
+  size_t begin;
+  size_t end;
+  uint32_t ret = 0;
+
+  if (!string(&begin, &end) || begin == end || end - begin > 9) return false;
+
+  for (size_t i = begin; i < end; i++) {
+    uint8_t digit = bytes_[i] - '0';
+
+    if (digit > 9) return false;
+    ret = 10 * ret + digit;
+  }
+
+  if (ret == 0 || ret >= (1UL << 29)) return false;
+
+  *number = ret;
+  return consume(':');
+}
+
+bool JsonReader::value(const FieldSchema &field) {
+  if (peek() == 'n') {
+    const char *src;
+    size_t size;
+
+    return token(&src, &size) && size == 4 && memcmp(src, "null", 4) == 0;
+  }
+
+  if (!field.repeated && field.message == nullptr)
+    return scalar(field.kind, field.number);
+
+  if (field.repeated) {
+    if (!consume('[')) return false;
+    if (consume(']')) return true;
+  } else if (peek() != '{') {
+    return false;
+  }
+
+  if (depth_ == MetaWriter::kMaxDepth) return false;
+
+  // A run with the elements of the array, or the one submessage.
+  size_t run_begin = data_->buf.written();
+  size_t element_begin = run_begin;
+
+  meta_->open(field.number, 0);
+  depth_++;
+  for (;;) {
+    bool success = (field.message != nullptr)
+                       ? object(*field.message)
+                       : scalar(field.kind, 1);
+
+    if (!success) return false;
+    if (!field.repeated || consume(']')) break;
+    if (!consume(',')) return false;
+
+    size_t written = data_->buf.written();
+    meta_->separate(written - element_begin);
+    element_begin = written;
+  }
+
+  meta_->close(data_->buf.written() - run_begin);
+  depth_--;
+  return true;
+}
+
+bool JsonReader::scalar(FieldKind kind, uint32_t number) {
+  if (kind == FieldKind::Bytes) {
+    size_t begin;
+    size_t end;
+
+    if (!string(&begin, &end)) return false;
+
+    size_t size = WriteString(bytes_ + begin, end - begin, data_);
+    if (size == SIZE_MAX) return false;
+
+    meta_->string(number, size);
+    return true;
+  }
+
+  const char *src;
+  size_t size;
+  uint64_t integer;
+
+  if (!token(&src, &size)) return false;
+
+  switch (kind) {
+    case FieldKind::Bool:
+      if (size == 4 && memcmp(src, "true", 4) == 0) {
+        meta_->field(number, data_->fixed<uint8_t>(1));
+        return true;
+      }
+
+      if (size == 5 && memcmp(src, "false", 5) == 0) {
+        meta_->field(number, data_->fixed<uint8_t>(0));
+        return true;
+      }
+
+      return false;
+
+    case FieldKind::Varint:
+      if (!ParseInteger(src, size, &integer)) return false;
+
+      meta_->field(number, data_->varint(integer));
+      return true;
+
+    case FieldKind::Fixed32:
+      // `fixed32` or `sfixed32`.
+      if (!ParseInteger(src, size, &integer) ||
+          (integer > UINT32_MAX &&
+           ((int64_t)integer < INT32_MIN || (int64_t)integer >= 0)))
+        return false;
+
+      meta_->field(number, data_->fixed<uint32_t>(integer));
+      return true;
+
+    case FieldKind::Fixed64:
+      if (!ParseInteger(src, size, &integer)) return false;
+
+      meta_->field(number, data_->fixed<uint64_t>(integer));
+      return true;
+
+    case FieldKind::Float: {
+      float value;
+
+      if (!ParseFloating(src, size, &value)) return false;
+
+      meta_->field(number, data_->fixed(value));
+      return true;
+    }
+
+    case FieldKind::Double: {
+      double value;
+
+      if (!ParseFloating(src, size, &value)) return false;
+
+      meta_->field(number, data_->fixed(value));
+      return true;
+    }
+
+    case FieldKind::Bytes:
+    case FieldKind::Message:
+    case FieldKind::Group:
+      break;
+  }
+
+  return false;
+}
+
+bool JsonReader::skip_value() {
+  size_t begin;
+  size_t end;
+  const char *src;
+  size_t size;
+
+  switch (peek()) {
+    case '"':
+      return string(&begin, &end);
+
+    case '{':
+    case '[': {
+      size_t depth = 0;
+
+      do {
+        if (index_ == count_) return false;
+
+        char c = bytes_[offsets_[index_++]];
+        if (c == '{' || c == '[') {
+          depth++;
+        } else if (c == '}' || c == ']') {
+          depth--;
+        }
+      } while (depth != 0);
+
+      return true;
+    }
+
+    default:
+      return token(&src, &size);
+  }
+}
+}  // namespace
+
+bool JsonScan::scan(const void *json, size_t size) {
+  const uint8_t *bytes = (const uint8_t *)json;
+  size_t n = 0;
+  bool escape_carry = false;
+  // All ones if the previous block ended inside a string.
+  uint64_t string_carry = 0;
+  // 1 if the previous block ended with a scalar byte.
+  uint64_t scalar_carry = 0;
+  uint8_t tail[64];
+
+  count = 0;
+  if (size > UINT32_MAX) return false;
+  // Every token starts at a different byte, and the last block may
+  // write 7 extra offsets.
+  if (offsets.size() < size + 8) offsets.resize(size + 8);
+
+  for (size_t i = 0; i < size; i += 64) {
+    const uint8_t *block = bytes + i;
+
+    // Pad the last block with whitespace.
+    if (size - i < 64) {
+      memset(tail, ' ', sizeof(tail));
+      memcpy(tail, block, size - i);
+      block = tail;
+    }
+
+    BlockMasks masks = Classify(block);
+    uint64_t quote = masks.quote & ~Escaped(masks.backslash, &escape_carry);
+    uint64_t in_string = PrefixXor(quote) ^ string_carry;
+    uint64_t scalar = ~(masks.op | masks.space | quote | in_string);
+    uint64_t tokens = (masks.op & ~in_string) | quote |
+                      (scalar & ~((scalar << 1) | scalar_carry));
+
+    string_carry = (uint64_t)((int64_t)in_string >> 63);
+    scalar_carry = scalar >> 63;
+
+    // Extract 8 offsets at a time, without branching on each bit: the
+    // extra offsets past the token count land in the slack at the end
+    // of `offsets`, and are overwritten by the next block.
+    size_t token_count = __builtin_popcountll(tokens);
+    uint32_t *out = &offsets[n];
+
+    for (size_t j = 0; j < token_count; j += 8) {
+      for (size_t k = 0; k < 8; k++) {
+        out[j + k] = i + (tokens == 0 ? 0 : __builtin_ctzll(tokens));
+        tokens &= tokens - 1;
+      }
+    }
+
+    n += token_count;
+  }
+
+  count = n;
+  return string_carry == 0;
+}
+
+bool JsonToSplit(const void *json, size_t size, const MessageSchema &schema,
+                 JsonScan *scan, MetaWriter *meta, DataWriter *data) {
+  size_t data_begin = data->buf.written();
+
+  if (!scan->scan(json, size)) return false;
+
+  JsonReader reader((const uint8_t *)json, size, *scan, meta, data);
+  if (!reader.object(schema) || !reader.done()) return false;
+
+  meta->close(data->buf.written() - data_begin);
+  return true;
+}
+
+namespace {
+/// Tokenizes `json` one byte at a time, like `JsonScan::scan`.
+std::vector<uint32_t> ScalarTokens(const std::string &json) {
+  std::vector<uint32_t> ret;
+  bool in_string = false;
+  bool in_scalar = false;
+
+  for (size_t i = 0; i < json.size(); i++) {
+    uint8_t c = json[i];
+
+    if (in_string) {
+      if (c == '\\') {
+        i++;
+      } else if (c == '"') {
+        ret.push_back(i);
+        in_string = false;
+      }
+
+      continue;
+    }
+
+    if (c == '"') {
+      ret.push_back(i);
+      in_string = true;
+      in_scalar = false;
+    } else if (IsOp(c)) {
+      ret.push_back(i);
+      in_scalar = false;
+    } else if (IsSpace(c)) {
+      in_scalar = false;
+    } else if (!in_scalar) {
+      ret.push_back(i);
+      in_scalar = true;
+    }
+  }
+
+  return ret;
+}
+
+// message Point {
+//   optional int32 x = 1;
+//   optional bool valid = 2;
+//   optional string label = 3;
+// }
+const FieldSchema kPointFields[] = {
+    {1, FieldKind::Varint, false, nullptr},
+    {2, FieldKind::Bool, false, nullptr},
+    {3, FieldKind::Bytes, false, nullptr},
+};
+
+const uint16_t kPointIndex[] = {0, 1, 2, 3};
+
+const MessageSchema kPointSchema = {"Point", kPointFields, 3, kPointIndex, 4};
+
+// message Shape {
+//   optional fixed64 id = 1;
+//   repeated Point points = 2;
+//   repeated int32 tags = 3;
+//   optional Point center = 4;
+//   optional float scale = 6;
+//   optional double ratio = 7;
+//   optional sfixed32 offset = 8;
+// }
+const FieldSchema kShapeFields[] = {
+    {1, FieldKind::Fixed64, false, nullptr},
+    {2, FieldKind::Message, true, &kPointSchema},
+    {3, FieldKind::Varint, true, nullptr},
+    {4, FieldKind::Message, false, &kPointSchema},
+    {6, FieldKind::Float, false, nullptr},
+    {7, FieldKind::Double, false, nullptr},
+    {8, FieldKind::Fixed32, false, nullptr},
+};
+
+const uint16_t kShapeIndex[] = {0, 1, 2, 3, 4, 0, 5, 6, 7};
+
+const MessageSchema kShapeSchema = {"Shape", kShapeFields, 7, kShapeIndex, 9};
+
+/// Ingests `json` as a `Shape`, and compares the result with `meta`
+/// and `data`.
+bool Ingests(const std::string &json, const MetaWriter &meta,
+             const DataWriter &data) {
+  JsonScan scan;
+  MetaWriter actual_meta(16);
+  DataWriter actual_data(16);
+
+  return JsonToSplit(json.data(), json.size(), kShapeSchema, &scan,
+                     &actual_meta, &actual_data) &&
+         actual_meta.base.buf.written() == meta.base.buf.written() &&
+         memcmp(actual_meta.base.buf.data(), meta.base.buf.data(),
+                meta.base.buf.written()) == 0 &&
+         actual_data.buf.written() == data.buf.written() &&
+         memcmp(actual_data.buf.data(), data.buf.data(),
+                data.buf.written()) == 0;
+}
+
+bool Rejects(const std::string &json) {
+  JsonScan scan;
+  MetaWriter meta(16);
+  DataWriter data(16);
+
+  return !JsonToSplit(json.data(), json.size(), kShapeSchema, &scan, &meta,
+                      &data);
+}
+}  // namespace
+
+void JsonSelfTest() {
+  {
+    // The fast paths must round like `strtof` and `strtod`.
+    uint64_t state = 42;
+
+    for (size_t i = 0; i < 100000; i++) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+      uint64_t mantissa = (state >> 11) >> ((state >> 3) % 53);
+      int exponent = (int)((state >> 58) % 46) - 23;
+      std::string number = std::to_string(mantissa);
+
+      if (i % 2 == 0) {
+        number += "e" + std::to_string(exponent);
+      } else if (exponent < 0 && (size_t)-exponent < number.size()) {
+        number.insert(number.size() + exponent, ".");
+      }
+
+      float f;
+      double d;
+
+      (void)f;
+      (void)d;
+      assert(ParseFloating(number.data(), number.size(), &f) &&
+             f == strtof(number.c_str(), nullptr));
+      assert(ParseFloating(number.data(), number.size(), &d) &&
+             d == strtod(number.c_str(), nullptr));
+    }
+  }
+
+  {
+    // Escapes, strings that span blocks, and scalars at every
+    // alignment.
+    const std::string body =
+        "{\"1\": \"a\\\"b\\\\\", \"22\":[1,-2.5e3 , true,null],"
+        "\"3\" :\"\\\\\\\\\\\"\\\\\",\"4\":{\"5\":\"{[,:]}\"}, "
+        "\"6\": \"" +
+        std::string(100, 'x') + "\\\"\"}";
+    JsonScan scan;
+
+    for (size_t pad = 0; pad < 130; pad++) {
+      std::string json = std::string(pad, ' ') + body;
+      std::vector<uint32_t> expected = ScalarTokens(json);
+
+      (void)expected;
+      assert(scan.scan(json.data(), json.size()));
+      assert(scan.count == expected.size());
+      assert(std::equal(expected.begin(), expected.end(),
+                        scan.offsets.begin()));
+    }
+
+    assert(!scan.scan("{\"1\": \"abc}", 11));
+    assert(!scan.scan("{\"1\": \"abc\\\"}", 13));
+  }
+
+  {
+    MetaWriter meta(16);
+    DataWriter data(16);
+
+    meta.field(1, data.fixed<uint64_t>(18364368954575990000ULL));
+    meta.open(2, 0);
+    meta.field(1, data.varint((uint64_t)-1));
+    meta.field(2, data.fixed<uint8_t>(1));
+    meta.string(3, data.string("a\"b\xc3\xa9\xf0\x9f\x98\x80"));
+    meta.separate(data.buf.written() - 8);
+    meta.string(3, data.string(std::string(100, 'y')));
+    meta.close(data.buf.written() - 8);
+    meta.open(3, 0);
+    meta.field(1, data.varint(1));
+    meta.separate(1);
+    meta.field(1, data.varint(300));
+    meta.close(3);
+    meta.open(4, 0);
+    meta.close(0);
+    meta.field(6, data.fixed(0.5f));
+    meta.field(7, data.fixed(-1e300));
+    meta.field(8, data.fixed<uint32_t>(-2));
+    meta.close(data.buf.written());
+
+    const std::string json =
+        "{\n"
+        "  \"1\": 18364368954575990000,\n"
+        "  \"2\": [{\"1\": -1, \"2\": true,\n"
+        "          \"3\": \"a\\\"b\\u00e9\\ud83d\\ude00\"},\n"
+        "         {\"3\": \"" +
+        std::string(100, 'y') +
+        "\"}],\n"
+        "  \"3\": [1, 300],\n"
+        "  \"4\": {},\n"
+        "  \"5\": {\"1\": [[], {}, \"}\"]},\n"
+        "  \"6\": 0.5,\n"
+        "  \"7\": -1e300,\n"
+        "  \"8\": -2,\n"
+        "  \"9\": null\n"
+        "}\n";
+
+    (void)Ingests;
+    assert(Ingests(json, meta, data));
+  }
+
+  {
+    // Nulls and empty arrays are absent fields.
+    MetaWriter meta(16);
+    DataWriter data(16);
+
+    meta.close(0);
+    assert(Ingests("{}", meta, data));
+    assert(Ingests(" { \"1\" : null , \"2\" : [ ] } ", meta, data));
+  }
+
+  (void)Rejects;
+  assert(Rejects(""));
+  assert(Rejects("[]"));
+  assert(Rejects("{} {}"));
+  assert(Rejects("{\"6\": 1, \"1\": 2}"));
+  assert(Rejects("{\"1\": 1 2}"));
+  assert(Rejects("{\"1\": 1,}"));
+  assert(Rejects("{\"1\" 1}"));
+  assert(Rejects("{\"x\": 1}"));
+  assert(Rejects("{\"0\": 1}"));
+  assert(Rejects("{\"1\": 1.5}"));
+  assert(Rejects("{\"1\": 18446744073709551616}"));
+  assert(Rejects("{\"3\": 1}"));
+  assert(Rejects("{\"4\": [{}]}"));
+  assert(Rejects("{\"6\": \"0.5\"}"));
+  assert(Rejects("{\"6\": 0x10}"));
+  assert(Rejects("{\"8\": 4294967296}"));
+  assert(Rejects("{\"2\": [{\"2\": tru}]}"));
+  assert(Rejects("{\"2\": [{\"3\": \"\\x\"}]}"));
+  assert(Rejects("{\"2\": [{\"3\": \"\\udc00\"}]}"));
+  assert(Rejects("{\"5\": [}"));
+}
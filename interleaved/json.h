@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "data_writer.h"
+#include "meta_writer.h"
+#include "schema.h"
+
+/// JSON ingestion, in two passes like simdjson, but without building
+/// a DOM: `JsonScan` finds the position of every token with SIMD
+/// bitmasks, and `JsonToSplit` walks the tokens and writes each value
+/// straight to the split streams.
+///
+/// The JSON documents are objects keyed by decimal field numbers
+/// (like `message1.json` and `message2.json`), with strings for
+/// `Bytes`, numbers for numeric fields, `true` and `false` for
+/// `Bool`s, objects for submessages, and arrays for repeated fields.
+
+/// A `JsonScan` classifies a JSON document 64 bytes at a time: it
+/// finds quotes, backslashes, structural characters (`{}[]:,`), and
+/// whitespace with SIMD compares (AVX-512BW, AVX2, SSE2, or a scalar
+/// fallback), masks out everything inside strings with a prefix XOR of
+/// the unescaped quotes, and extracts the offset of each token:
+/// structural characters, both quotes of each string, and the first
+/// byte of each scalar (number, `true`, `false`, or `null`).
+struct JsonScan {
+  JsonScan() = default;
+
+  /// `JsonScan`s are move-only, to avoid accidentally copying the
+  /// offsets.
+  JsonScan(const JsonScan &) = delete;
+  JsonScan(JsonScan &&) = default;
+  JsonScan &operator=(const JsonScan &) = delete;
+  JsonScan &operator=(JsonScan &&) = default;
+
+  /// Finds the tokens in the `size` bytes at `json`, and overwrites
+  /// `offsets`.  The storage is reused across calls.
+  ///
+  /// Returns false if the document has an unterminated string or is
+  /// 4 GB or larger.
+  bool scan(const void *json, size_t size);
+
+  /// Number of tokens found by the last `scan`.
+  size_t count{0};
+
+  std::vector<uint32_t> offsets;
+};
+
+/// Writes the JSON object in the `size` bytes at `json`, a message
+/// with `schema`, to `meta` and `data` as a top-level message, with the
+/// same mapping as `ProtobufToSplit`.  `scan` holds scratch space.
+///
+/// Keys must appear in increasing field number order.  Keys that
+/// aren't in the schema are skipped (their values are only checked
+/// for balanced brackets), `null` values are absent fields, and empty
+/// arrays are absent repeated fields.  Strings must be valid UTF-8;
+/// that's not checked.
+///
+/// Returns false if the document is malformed or out of order, or if
+/// a value doesn't match its field's kind.  `meta` and `data` are then
+/// in an unspecified state.
+bool JsonToSplit(const void *json, size_t size, const MessageSchema &schema,
+                 JsonScan *scan, MetaWriter *meta, DataWriter *data);
+
+/// Checks the scan against a scalar tokenizer, and ingests
+/// hand-written documents.
+void JsonSelfTest();
@@ -0,0 +1,137 @@
+#include "layout.h"
+
+#include <assert.h>
+#include <string>
+#include <vector>
+
+#include "decoder.h"
+
+namespace {
+struct Point {
+  uint16_t x;
+  int32_t y;
+  std::string label;
+};
+
+struct Shape {
+  bool closed;
+  std::vector<Point> points;
+  uint64_t id;
+  std::string name;
+  uint32_t color;
+};
+
+// x folds into the `OpenField`, and y and label fuse into a `FieldN`.
+using PointLayout =
+    layout::Layout<layout::Fixed<1, &Point::x>, layout::Varint<2, &Point::y>,
+                   layout::String<3, &Point::label>>;
+
+// id and name can't fuse (id may take 8 bytes), and color folds into
+// the `FieldClose` after a skip.
+using ShapeLayout = layout::Layout<
+    layout::Fixed<2, &Shape::closed>,
+    layout::Repeated<3, &Shape::points, PointLayout>,
+    layout::Varint<4, &Shape::id>, layout::String<5, &Shape::name>,
+    layout::Varint<40, &Shape::color>>;
+
+using layout::internal::Op;
+
+static_assert(PointLayout::kPlan.fold_open);
+static_assert(PointLayout::kPlan.ops[1] == Op::FieldN);
+static_assert(!ShapeLayout::kPlan.fold_open);
+static_assert(ShapeLayout::kPlan.ops[0] == Op::OneField);
+static_assert(ShapeLayout::kPlan.ops[2] == Op::OneField);
+static_assert(ShapeLayout::kPlan.ops[4] == Op::Close);
+
+/// Logs every callback as a string, with field data as decoded
+/// integers, or as strings for `string_fields` at depth 0 and 1.
+struct LogVisitor {
+  void field(uint32_t field, size_t width, const uint8_t *data) {
+    if (field == string_fields[depth]) {
+      log.push_back(std::to_string(field) + "=" +
+                    std::string((const char *)data, width));
+      return;
+    }
+
+    log.push_back(std::to_string(field) + "=" +
+                  std::to_string(DataReader::load(data, width)));
+  }
+
+  void open(uint32_t field, uint64_t len_hint) {
+    log.push_back("open " + std::to_string(field) + " " +
+                  std::to_string(len_hint));
+    depth++;
+  }
+
+  void separate(uint64_t) { log.push_back("separate"); }
+
+  void close(uint64_t) {
+    log.push_back("close");
+    depth--;
+  }
+
+  uint32_t string_fields[2] = {5, 3};
+  size_t depth{0};
+  std::vector<std::string> log;
+};
+
+std::vector<std::string> RoundTrip(const Shape &shape, size_t *meta_size) {
+  BaseMetaWriter meta(16);
+  DataWriter data(16);
+  LogVisitor visitor;
+
+  ShapeLayout::encode(shape, &meta, &data);
+  *meta_size = meta.buf.written();
+
+  bool success = Decode(meta.buf.data(), meta.buf.written(), data.buf.data(),
+                        data.buf.written(), &visitor);
+
+  (void)success;
+  assert(success);
+  return visitor.log;
+}
+}  // namespace
+
+void LayoutSelfTest() {
+  {
+    Shape shape{true, {{1, 2, "a"}, {3, -1, "bc"}}, 1ULL << 40, "name", 7};
+    size_t meta_size;
+    std::vector<std::string> log = RoundTrip(shape, &meta_size);
+    const std::vector<std::string> expected = {
+        "2=1",
+        "open 3 2",
+        "1=1",
+        "2=2",
+        "3=a",
+        "separate",
+        "1=3",
+        "2=4294967295",
+        "3=bc",
+        "close",
+        "4=1099511627776",
+        "5=name",
+        "40=7",
+        "close",
+    };
+
+    (void)meta_size;
+    assert(log == expected);
+    // OneField, OpenField, FieldN, FieldSeparate, OneField, FieldN,
+    // FieldClose, OneField, FieldN, SkipN, FieldClose: 11 opcodes and
+    // 8 single-byte literals.
+    assert(meta_size == 19);
+  }
+
+  {
+    // An empty repeated field is skipped.
+    Shape shape{false, {}, 5, "", 0};
+    size_t meta_size;
+    std::vector<std::string> log = RoundTrip(shape, &meta_size);
+    const std::vector<std::string> expected = {
+        "2=0", "4=5", "5=", "40=0", "close",
+    };
+
+    (void)meta_size;
+    assert(log == expected);
+  }
+}
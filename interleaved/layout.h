@@ -0,0 +1,432 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "base_meta_writer.h"
+#include "data_writer.h"
+
+/// Compile-time message layouts: a `layout::Layout` lists the fields
+/// of a C++ struct that are always present, in field number order,
+/// with their kind and the struct member that holds them:
+///
+///   using SubLayout = layout::Layout<
+///       layout::Varint<1, &Sub::field_1>,
+///       layout::String<15, &Sub::field_15>>;
+///   using MessageLayout = layout::Layout<
+///       layout::Fixed<12, &Message::field_12>,
+///       layout::Message<15, &Message::field_15, SubLayout>>;
+///
+///   MessageLayout::encode(message, &meta, &data);
+///
+/// Fields that aren't listed are skipped.  The skip counts, and the
+/// choice of opcode for each field (`OneField`, `TwoFields`, `FieldN`
+/// for a small word and a string, or folding the first and last
+/// fields into `OpenField` and `FieldClose`), are computed at compile
+/// time to minimise the size of the metadata stream, so `encode` is
+/// straight-line code like a hand-written encoder.
+namespace layout {
+/// What a field is, as far as opcode selection is concerned.
+enum class Kind : uint8_t {
+  /// A machine word: up to 8 bytes in the data stream.
+  Word,
+  /// A string of arbitrary size.
+  String,
+  /// A run of submessages.
+  Run,
+};
+
+namespace internal {
+template <typename>
+struct Member;
+
+template <typename S, typename T>
+struct Member<T S::*> {
+  using Type = T;
+};
+
+template <auto member>
+using MemberType = typename Member<decltype(member)>::Type;
+
+/// What opcode selection needs to know about a field.
+struct Desc {
+  uint32_t number;
+  Kind kind;
+  /// Maximum data width for `Word`s, 0 otherwise.
+  uint8_t max_width;
+};
+
+/// How each field is emitted.
+enum class Op : uint8_t {
+  /// `OneField`, after an optional `SkipN`.
+  OneField,
+  /// `TwoFields` with the next field, after an optional `SkipN`.
+  TwoFields,
+  /// `FieldN` with the next field (a string), after an optional
+  /// `SkipN`.
+  FieldN,
+  /// The last field, in the `FieldClose` or `FieldSeparate`.
+  Close,
+  /// A string, as `FieldN` without a machine word.
+  String,
+  /// A run of submessages.
+  Run,
+};
+
+template <size_t N>
+struct Plan {
+  std::array<Op, N> ops{};
+  /// Whether the first field goes in the run's `OpenField`.
+  bool fold_open{false};
+};
+
+/// Picks an `Op` for each field, by dynamic programming from the
+/// last field: `cost[i]` is the smallest number of metadata bytes for
+/// fields `i...`, excluding the bytes that are the same whatever the
+/// choice (string sizes, run opens and closes).  Ties go to `Close`,
+/// then `TwoFields`, `OneField`, and `FieldN`.
+template <size_t N>
+constexpr Plan<N> MakePlan(const std::array<Desc, N> &descs) {
+  Plan<N> plan;
+  std::array<size_t, N + 2> cost{};
+
+  for (size_t i = N; i-- > 0;) {
+    const Desc &field = descs[i];
+    uint32_t gap = field.number - (i == 0 ? 1 : descs[i - 1].number + 1);
+    size_t skip = BaseMetaWriter::skip_size(gap);
+    bool last = i + 1 == N;
+    Kind next = last ? Kind::Run : descs[i + 1].kind;
+    bool adjacent = !last && descs[i + 1].number == field.number + 1;
+    Op op;
+    size_t best;
+
+    switch (field.kind) {
+      case Kind::String:
+        op = Op::String;
+        best = skip + 1 + cost[i + 1];
+        break;
+
+      case Kind::Run:
+        op = Op::Run;
+        best = skip + cost[i + 1];
+        break;
+
+      case Kind::Word:
+        op = Op::OneField;
+        best = BaseMetaWriter::one_field_size(gap) + cost[i + 1];
+        if (adjacent && next == Kind::String && field.max_width <= 4 &&
+            skip + 1 + cost[i + 2] < best) {
+          op = Op::FieldN;
+          best = skip + 1 + cost[i + 2];
+        }
+
+        if (adjacent && next == Kind::Word && skip + 1 + cost[i + 2] <= best) {
+          op = Op::TwoFields;
+          best = skip + 1 + cost[i + 2];
+        }
+
+        if (last && field.max_width <= 4 && skip <= best) {
+          op = Op::Close;
+          best = skip;
+        }
+
+        break;
+    }
+
+    plan.ops[i] = op;
+    cost[i] = best;
+  }
+
+  plan.fold_open = N > 0 && descs[0].number == 1 &&
+                   descs[0].kind == Kind::Word && descs[0].max_width <= 4 &&
+                   cost[1] <= cost[0];
+  return plan;
+}
+
+enum class End { Close, Separate };
+}  // namespace internal
+
+/// A varint field.  `member` must be an integer, and is zero-extended
+/// from its own size (not to 64 bits), so a 32-bit member takes at
+/// most 4 bytes.  Use `Fixed` for `bool`s.
+template <uint32_t number, auto member>
+struct Varint {
+  using Type = internal::MemberType<member>;
+  static_assert(std::is_integral_v<Type> && !std::is_same_v<Type, bool>);
+
+  static constexpr internal::Desc kDesc{number, Kind::Word, sizeof(Type)};
+
+  template <typename S>
+  static uint8_t write(const S &message, DataWriter *data) {
+    return data->varint((std::make_unsigned_t<Type>)(message.*member));
+  }
+};
+
+/// A fixed-size field of 1, 2, 4, or 8 bytes.
+template <uint32_t number, auto member>
+struct Fixed {
+  using Type = internal::MemberType<member>;
+  static_assert(sizeof(Type) == 1 || sizeof(Type) == 2 || sizeof(Type) == 4 ||
+                sizeof(Type) == 8);
+
+  static constexpr internal::Desc kDesc{number, Kind::Word, sizeof(Type)};
+
+  template <typename S>
+  static uint8_t write(const S &message, DataWriter *data) {
+    return data->fixed(message.*member);
+  }
+
+  /// Writes this field of the `count` messages at `messages`, back to
+  /// back, for `Columnar`.
+  ///
+  /// Returns the number of bytes written.
+  template <typename S>
+  static size_t write_column(const S *messages, size_t count,
+                             DataWriter *data) {
+    size_t size = sizeof(Type) * count;
+    uint8_t *dst = (uint8_t *)data->buf.reserve(size);
+
+    for (size_t i = 0; i < count; i++)
+      memcpy(dst + sizeof(Type) * i, &(messages[i].*member), sizeof(Type));
+    return data->buf.commit(size);
+  }
+};
+
+/// A string field: `member` is anything `DataWriter::string` takes.
+template <uint32_t number, auto member>
+struct String {
+  static constexpr internal::Desc kDesc{number, Kind::String, 0};
+
+  template <typename S>
+  static size_t write(const S &message, DataWriter *data) {
+    return data->string(message.*member);
+  }
+};
+
+/// A submessage field, encoded as a run of one submessage with
+/// `SubLayout`.
+template <uint32_t number, auto member, typename SubLayout>
+struct Message {
+  static constexpr internal::Desc kDesc{number, Kind::Run, 0};
+
+  template <typename S>
+  static void write_run(const S &message, uint32_t gap, BaseMetaWriter *meta,
+                        DataWriter *data) {
+    if (gap != 0) meta->skip(gap);
+    SubLayout::encode_run(&(message.*member), 1, 0, meta, data);
+  }
+};
+
+/// A repeated submessage field: `member` is a `std::vector` of
+/// submessages, encoded as a run with `SubLayout`.  An empty vector
+/// is skipped.
+template <uint32_t number, auto member, typename SubLayout>
+struct Repeated {
+  static constexpr internal::Desc kDesc{number, Kind::Run, 0};
+
+  template <typename S>
+  static void write_run(const S &message, uint32_t gap, BaseMetaWriter *meta,
+                        DataWriter *data) {
+    const auto &elements = message.*member;
+    uint32_t skipped = gap + elements.empty();
+
+    if (skipped != 0) meta->skip(skipped);
+    if (elements.empty()) return;
+
+    size_t count = elements.size();
+    SubLayout::encode_run(elements.data(), count,
+                          count < (1UL << 28) ? count : 0, meta, data);
+  }
+};
+
+/// A repeated submessage field in columnar form: `member` is a
+/// `std::vector` of submessages, and `ColumnLayout` a `Layout` of
+/// `Fixed` fields only.  The run has a single submessage, in which
+/// field `n` is a string with field `n` of every element, back to back
+/// (`sizeof` the member bytes each), so readers can scan a column with
+/// SIMD loads (see `columnar.h`).  The `OpenField`'s size hint is the
+/// number of elements.  An empty vector is skipped.
+///
+/// The streams are well-formed either way, but readers must know which
+/// fields are columnar, like protobuf's packed fields.
+template <uint32_t number, auto member, typename ColumnLayout>
+struct Columnar {
+  static constexpr internal::Desc kDesc{number, Kind::Run, 0};
+
+  template <typename S>
+  static void write_run(const S &message, uint32_t gap, BaseMetaWriter *meta,
+                        DataWriter *data) {
+    const auto &elements = message.*member;
+    uint32_t skipped = gap + elements.empty();
+
+    if (skipped != 0) meta->skip(skipped);
+    if (elements.empty()) return;
+
+    size_t count = elements.size();
+    ColumnLayout::encode_columns(elements.data(), count,
+                                 count < (1UL << 28) ? count : 0, meta, data);
+  }
+};
+
+template <typename... Fields>
+struct Layout {
+  static constexpr size_t kCount = sizeof...(Fields);
+  static constexpr std::array<internal::Desc, kCount> kDescs{Fields::kDesc...};
+  static constexpr internal::Plan<kCount> kPlan = internal::MakePlan(kDescs);
+
+  static_assert(
+      [] {
+        for (size_t i = 0; i < kCount; i++) {
+          if (kDescs[i].number <= (i == 0 ? 0 : kDescs[i - 1].number))
+            return false;
+        }
+
+        return true;
+      }(),
+      "Field numbers must be positive and strictly increasing");
+
+  /// Writes `message` as a top-level message.
+  template <typename S>
+  static void encode(const S &message, BaseMetaWriter *meta,
+                     DataWriter *data) {
+    emit<0, internal::End::Close>(message, meta, data, data->buf.written());
+  }
+
+  /// Writes the `count > 0` submessages at `messages` as a run, with
+  /// `len_hint` in its `OpenField`.
+  template <typename S>
+  static void encode_run(const S *messages, size_t count, uint32_t len_hint,
+                         BaseMetaWriter *meta, DataWriter *data) {
+    using internal::End;
+    constexpr size_t kFirst = kPlan.fold_open ? 1 : 0;
+    size_t run_begin = data->buf.written();
+    size_t message_begin = run_begin;
+
+    for (size_t i = 0; i < count; i++) {
+      const S &message = messages[i];
+      bool last = i + 1 == count;
+
+      if (i == 0) {
+        if constexpr (kPlan.fold_open) {
+          meta->open_field(len_hint, Field<0>::write(message, data));
+        } else {
+          meta->open_field(len_hint, 0);
+        }
+
+        if (last) {
+          emit<kFirst, End::Close>(message, meta, data, run_begin);
+        } else {
+          emit<kFirst, End::Separate>(message, meta, data, message_begin);
+        }
+      } else if (last) {
+        emit<0, End::Close>(message, meta, data, run_begin);
+      } else {
+        emit<0, End::Separate>(message, meta, data, message_begin);
+      }
+
+      message_begin = data->buf.written();
+    }
+  }
+
+  /// Writes the `count > 0` submessages at `messages` as a run of one
+  /// submessage, with a string per field holding that field of every
+  /// submessage, and `len_hint` in its `OpenField`.  All fields must
+  /// be `Fixed`.
+  template <typename S>
+  static void encode_columns(const S *messages, size_t count,
+                             uint32_t len_hint, BaseMetaWriter *meta,
+                             DataWriter *data) {
+    size_t run_begin = data->buf.written();
+    uint32_t next_number = 1;
+
+    meta->open_field(len_hint, 0);
+    (
+        [&] {
+          uint32_t gap = Fields::kDesc.number - next_number;
+          size_t size = Fields::write_column(messages, count, data);
+
+          if (gap != 0) meta->skip(gap);
+          meta->field_n(0, size);
+          next_number = Fields::kDesc.number + 1;
+        }(),
+        ...);
+    meta->field_close(0, data->buf.written() - run_begin);
+  }
+
+ private:
+  template <size_t i>
+  using Field = std::tuple_element_t<i, std::tuple<Fields...>>;
+
+  /// Number of the field after field `i - 1`.
+  static constexpr uint32_t next(size_t i) {
+    return i == 0 ? 1 : kDescs[i - 1].number + 1;
+  }
+
+  template <internal::End end>
+  static void finish(BaseMetaWriter *meta, uint8_t width, uint64_t size) {
+    if constexpr (end == internal::End::Close) {
+      meta->field_close(width, size);
+    } else {
+      meta->field_separate(width, size);
+    }
+  }
+
+  /// Writes fields `i...` of `message`, and the `end` of the
+  /// submessage (`begin` is the data offset its size starts from).
+  template <size_t i, internal::End end, typename S>
+  static void emit(const S &message, BaseMetaWriter *meta, DataWriter *data,
+                   size_t begin) {
+    using internal::Op;
+
+    if constexpr (i == kCount) {
+      finish<end>(meta, 0, data->buf.written() - begin);
+    } else {
+      using F = Field<i>;
+      constexpr uint32_t kGap = kDescs[i].number - next(i);
+      constexpr Op kOp = kPlan.ops[i];
+
+      if constexpr (kOp == Op::OneField) {
+        meta->skip_one_field(kGap, F::write(message, data));
+        emit<i + 1, end>(message, meta, data, begin);
+      } else if constexpr (kOp == Op::TwoFields) {
+        uint8_t w1 = F::write(message, data);
+        uint8_t w2 = Field<i + 1>::write(message, data);
+
+        if constexpr (kGap != 0) meta->skip(kGap);
+        meta->two_fields(w1, w2);
+        emit<i + 2, end>(message, meta, data, begin);
+      } else if constexpr (kOp == Op::FieldN) {
+        uint8_t width = F::write(message, data);
+        size_t size = Field<i + 1>::write(message, data);
+
+        if constexpr (kGap != 0) meta->skip(kGap);
+        meta->field_n(width, size);
+        emit<i + 2, end>(message, meta, data, begin);
+      } else if constexpr (kOp == Op::Close) {
+        uint8_t width = F::write(message, data);
+
+        if constexpr (kGap != 0) meta->skip(kGap);
+        finish<end>(meta, width, data->buf.written() - begin);
+      } else if constexpr (kOp == Op::String) {
+        size_t size = F::write(message, data);
+
+        if constexpr (kGap != 0) meta->skip(kGap);
+        meta->field_n(0, size);
+        emit<i + 1, end>(message, meta, data, begin);
+      } else {
+        F::write_run(message, kGap, meta, data);
+        emit<i + 1, end>(message, meta, data, begin);
+      }
+    }
+  }
+};
+}  // namespace layout
+
+/// Encodes messages with repeated runs and every fusion through
+/// layouts, and decodes them back.
+void LayoutSelfTest();
@@ -0,0 +1,132 @@
+#include "mapped_file.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <utility>
+
+MappedFile::MappedFile(MappedFile &&other)
+    : data_(other.data_), size_(other.size_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+  return;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) {
+  using std::swap;
+
+  swap(data_, other.data_);
+  swap(size_, other.size_);
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) munmap((void *)data_, size_);
+  return;
+}
+
+bool MappedFile::open(const char *path) {
+  struct stat st;
+  int fd = ::open(path, O_RDONLY);
+
+  assert(data_ == nullptr);
+  if (fd < 0) return false;
+
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+
+  size_ = st.st_size;
+  if (size_ > 0) {
+    void *mapped = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+
+    data_ = (mapped == MAP_FAILED) ? nullptr : (const uint8_t *)mapped;
+  }
+
+  // The mapping keeps the file alive.
+  close(fd);
+  if (size_ > 0 && data_ == nullptr) size_ = 0;
+  return size_ == (size_t)st.st_size;
+}
+
+bool MappedFile::advise(size_t offset, size_t size, int advice) const {
+  static const size_t kPageSize = sysconf(_SC_PAGESIZE);
+
+  if (offset >= size_ || size == 0) return true;
+  if (size > size_ - offset) size = size_ - offset;
+
+  // `madvise` takes page-aligned ranges: the mapping is.
+  size_t begin = offset & ~(kPageSize - 1);
+  size_t end = offset + size;
+
+  return madvise((void *)(data_ + begin), end - begin, advice) == 0;
+}
+
+bool MappedFile::will_need(size_t offset, size_t size) const {
+  return advise(offset, size, MADV_WILLNEED);
+}
+
+void MappedFile::SelfTest() {
+  char path[] = "/tmp/mapped_file_XXXXXX";
+  int fd = mkstemp(path);
+  static const char kBytes[] = "0123456789abcdef";
+  bool ok;
+
+  assert(fd >= 0);
+
+  // An empty file maps to nothing, and takes any advice.
+  {
+    MappedFile file;
+
+    ok = file.open(path);
+    assert(ok && file.size() == 0 && file.data() == nullptr);
+    ok = file.will_need(0, 100) && file.advise(0, 0, MADV_SEQUENTIAL);
+    assert(ok);
+  }
+
+  // A file of 3 pages and a bit.
+  std::string bytes;
+
+  while (bytes.size() < 3 * 4096 + 10) bytes += kBytes;
+  ok = write(fd, bytes.data(), bytes.size()) == (ssize_t)bytes.size();
+  close(fd);
+  assert(ok);
+
+  {
+    MappedFile file;
+
+    ok = file.open(path);
+    assert(ok && file.size() == bytes.size() &&
+           memcmp(file.data(), bytes.data(), bytes.size()) == 0);
+
+    // Unaligned and overlong ranges are rounded and clipped.
+    ok = file.advise(0, file.size(), MADV_SEQUENTIAL) &&
+         file.will_need(4097, 3) && file.will_need(5000, 1 << 30) &&
+         file.advise(file.size(), 10, MADV_RANDOM);
+    assert(ok);
+
+    MappedFile moved(std::move(file));
+
+    assert(file.data() == nullptr && file.size() == 0);
+    assert(moved.size() == bytes.size() &&
+           memcmp(moved.data(), bytes.data(), bytes.size()) == 0);
+
+    file = std::move(moved);
+    assert(file.size() == bytes.size() && moved.data() == nullptr);
+  }
+
+  unlink(path);
+
+  MappedFile missing;
+
+  ok = missing.open(path);
+  assert(!ok && missing.data() == nullptr);
+  (void)ok;
+  return;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// A `MappedFile` maps a whole file read-only, so its bytes can be
+/// decoded in place: no copies into heap buffers, and strings viewed
+/// in the file point straight into the page cache.
+///
+/// The kernel only reads pages as they're touched, so callers tell it
+/// what they'll touch next with `advise` and `will_need`: readers
+/// walking a file in order ask for the sequential readahead policy up
+/// front, and for a window of pages ahead of their position.
+struct MappedFile {
+  MappedFile() = default;
+
+  /// `MappedFile`s are move-only, like `WriteBuffer`s.
+  MappedFile(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other);
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile &operator=(MappedFile &&other);
+
+  /// Unmaps the file, if any.
+  ~MappedFile();
+
+  /// Maps the file at `path`.  Empty files map to no bytes.
+  ///
+  /// Returns false if the file can't be opened or mapped.
+  bool open(const char *path);
+
+  const uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+
+  /// Passes `advice` (`MADV_SEQUENTIAL`, `MADV_RANDOM`, ...) for the
+  /// pages that hold `[offset, offset + size)`, clipped to the file.
+  ///
+  /// Returns false if the kernel rejects it; the hint is only ever an
+  /// optimization.
+  bool advise(size_t offset, size_t size, int advice) const;
+
+  /// Starts reading the pages that hold `[offset, offset + size)` in
+  /// the background (`MADV_WILLNEED`).
+  bool will_need(size_t offset, size_t size) const;
+
+  static void SelfTest();
+
+ private:
+  const uint8_t *data_{nullptr};
+  size_t size_{0};
+};
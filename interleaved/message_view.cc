@@ -0,0 +1,280 @@
+#include "message_view.h"
+
+#include <assert.h>
+#include <string>
+
+#include "data_writer.h"
+#include "meta_writer.h"
+
+namespace codegen {
+void MessageView::reset(const void *meta, size_t meta_size, const void *data,
+                        size_t data_size) {
+  reset_submessage((const uint8_t *)meta, meta_size, (const uint8_t *)data,
+                   data_size, 0, 0, 0, 0);
+  top_level_ = true;
+  return;
+}
+
+void MessageView::reset_submessage(const uint8_t *meta, size_t meta_size,
+                                   const uint8_t *data, size_t data_size,
+                                   size_t meta_offset, size_t data_offset,
+                                   size_t first_width, size_t run_begin) {
+  meta_ = meta;
+  meta_size_ = meta_size;
+  data_ = data;
+  data_size_ = data_size;
+  run_begin_ = run_begin;
+  message_begin_ = data_offset;
+  top_level_ = false;
+
+  entries_.clear();
+  meta_cursor_ = meta_offset;
+  data_cursor_ = data_offset;
+  next_field_ = 1;
+  done_ = false;
+  ok_ = true;
+  if (first_width != 0 && !add_field(first_width)) done_ = true;
+  return;
+}
+
+bool MessageView::add_field(uint64_t width) const {
+  if (__builtin_expect(width > data_size_ - data_cursor_, 0)) {
+    ok_ = false;
+    return false;
+  }
+
+  entries_.push_back(
+      Entry{next_field_++, 0, data_cursor_, width, kNotRun, 0});
+  data_cursor_ += width;
+  return true;
+}
+
+void MessageView::index_to(uint32_t field) const {
+  MetaReader meta_reader(meta_, meta_size_);
+  MetaInstruction insn;
+
+  meta_reader.seek(meta_cursor_);
+  while (!done_ && next_field_ <= field) {
+    if (!meta_reader.next(&insn)) {
+      ok_ = false;
+      break;
+    }
+
+    switch (insn.op) {
+      case Opcode::SkipN:
+        next_field_ += insn.imm1 + insn.literal;
+        continue;
+
+      case Opcode::OneField:
+        next_field_ += insn.imm1;
+        if (!add_field(MetaReader::width_for_nonzero_immediate(insn.imm2)))
+          break;
+        continue;
+
+      case Opcode::TwoFields:
+        if (!add_field(MetaReader::width_for_nonzero_immediate(insn.imm1)) ||
+            !add_field(MetaReader::width_for_nonzero_immediate(insn.imm2)))
+          break;
+        continue;
+
+      case Opcode::OpenField: {
+        Entry entry{next_field_++,
+                    MetaReader::width_for_zeroable_immediate(insn.imm1),
+                    data_cursor_,
+                    0,
+                    meta_reader.offset(),
+                    insn.literal};
+
+        if (!meta_reader.skip_run(&entry.size) ||
+            entry.size > data_size_ - data_cursor_) {
+          ok_ = false;
+          break;
+        }
+
+        entries_.push_back(entry);
+        data_cursor_ += entry.size;
+        continue;
+      }
+
+      case Opcode::FieldClose:
+      case Opcode::FieldSeparate: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+        bool close = insn.op == Opcode::FieldClose;
+
+        if (width != 0 && !add_field(width)) break;
+        if (insn.literal !=
+                data_cursor_ - (close ? run_begin_ : message_begin_) ||
+            (top_level_ && (!close || !meta_reader.done())))
+          ok_ = false;
+        break;
+      }
+
+      case Opcode::RunFields: {
+        size_t width = MetaReader::width_for_nonzero_immediate(insn.imm1);
+        uint64_t count = MetaReader::run_fields_count(insn.literal);
+        uint64_t i = 0;
+
+        while (i < count && add_field(width)) i++;
+        if (i < count) break;
+        continue;
+      }
+
+      case Opcode::FieldN: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !add_field(width)) break;
+        if (!add_field(insn.literal)) break;
+        continue;
+      }
+    }
+
+    // The end of the message, or an error.
+    done_ = true;
+  }
+
+  meta_cursor_ = meta_reader.offset();
+  if (!ok_) done_ = true;
+  return;
+}
+
+bool MessageView::run(uint32_t field, RunView *out) const {
+  const Entry *entry = find(field);
+
+  if (entry == nullptr || entry->meta_offset == kNotRun) return false;
+
+  *out = RunView();
+  out->meta_ = meta_;
+  out->meta_size_ = meta_size_;
+  out->data_ = data_;
+  out->data_size_ = data_size_;
+  out->meta_cursor_ = entry->meta_offset;
+  out->data_cursor_ = entry->data_offset;
+  out->first_width_ = entry->first_width;
+  out->run_begin_ = entry->data_offset;
+  out->run_size_ = entry->size;
+  out->len_hint_ = entry->len_hint;
+  out->done_ = false;
+  return true;
+}
+
+bool RunView::next(MessageView *out) {
+  if (done_) return false;
+
+  // Skip the submessage viewed last, up to its `FieldSeparate` (or the
+  // run's `FieldClose`), only now that the next one is needed.
+  if (started_) {
+    MetaReader meta_reader(meta_, meta_size_);
+    MetaInstruction insn;
+    size_t depth = 0;
+
+    meta_reader.seek(meta_cursor_);
+    for (;;) {
+      if (!meta_reader.next(&insn)) {
+        done_ = true;
+        return false;
+      }
+
+      if (insn.op == Opcode::OpenField) {
+        depth++;
+      } else if (insn.op == Opcode::FieldClose && depth > 0) {
+        depth--;
+      } else if (depth == 0 && (insn.op == Opcode::FieldSeparate ||
+                                insn.op == Opcode::FieldClose)) {
+        break;
+      }
+    }
+
+    if (insn.op == Opcode::FieldClose ||
+        insn.literal > run_begin_ + run_size_ - data_cursor_) {
+      done_ = true;
+      return false;
+    }
+
+    meta_cursor_ = meta_reader.offset();
+    data_cursor_ += insn.literal;
+    first_width_ = 0;
+  }
+
+  out->reset_submessage(meta_, meta_size_, data_, data_size_, meta_cursor_,
+                        data_cursor_, first_width_, run_begin_);
+  started_ = true;
+  return true;
+}
+
+void MessageView::SelfTest() {
+  MetaWriter meta(16);
+  DataWriter data(16);
+
+  // 1: 300, 2: "hello", 4: [{1: 7, 3: "x"}, {2: {1: 9}}, {}], 9: 5
+  meta.field(1, data.varint(300));
+  meta.string(2, data.string("hello"));
+  EncodeRun(&meta, &data, 4, true, 3, [&](size_t i) {
+    if (i == 0) {
+      meta.field(1, data.varint(7));
+      meta.string(3, data.string("x"));
+    } else if (i == 1) {
+      EncodeRun(&meta, &data, 2, false, 1,
+                [&](size_t) { meta.field(1, data.varint(9)); });
+    }
+  });
+  meta.field(9, data.fixed<uint64_t>(5));
+  meta.close(data.buf.written());
+
+  const void *meta_bytes = meta.base.buf.data();
+  size_t meta_size = meta.base.buf.written();
+  const void *data_bytes = data.buf.data();
+  size_t data_size = data.buf.written();
+  MessageView view(meta_bytes, meta_size, data_bytes, data_size);
+
+  // Out of order accesses, absent fields, and defaults.
+  assert(view.value<uint64_t>(9, 0) == 5);
+  assert(view.value<int32_t>(1, 0) == 300);
+  assert(view.bytes(2) == "hello");
+  assert(!view.has(3) && view.value<int32_t>(3, -1) == -1);
+  assert(view.bytes(5, "default") == "default");
+  assert(view.value<uint32_t>(2, 1) == 1);  // A 5-byte string.
+  assert(view.ok());
+
+  RunView run;
+  MessageView element;
+  MessageView nested;
+
+  assert(!view.run(1, &run));
+  assert(view.run(4, &run) && run.len_hint() == 3);
+  assert(run.next(&element));
+  assert(element.value<int32_t>(1, 0) == 7 && element.bytes(3) == "x");
+  assert(element.ok());
+  assert(run.next(&element));
+  assert(!element.has(1));
+  assert(element.submessage(2, &nested));
+  assert(nested.value<int32_t>(1, 0) == 9 && nested.ok());
+  assert(element.ok());
+  assert(run.next(&element));
+  assert(!element.has(1) && element.ok());
+  assert(!run.next(&element));
+
+  // Views reused for another message.
+  MetaWriter meta2(16);
+  DataWriter data2(16);
+
+  meta2.field(3, data2.varint(1));
+  meta2.close(data2.buf.written());
+  view.reset(meta2.base.buf.data(), meta2.base.buf.written(),
+             data2.buf.data(), data2.buf.written());
+  assert(!view.has(1) && view.value<int32_t>(3, 0) == 1 && view.ok());
+
+  // Truncated streams: fields before the error are still available.
+  MessageView truncated(meta_bytes, meta_size, data_bytes, data_size - 1);
+
+  assert(truncated.value<int32_t>(1, 0) == 300);
+  assert(!truncated.has(9) && !truncated.ok());
+  truncated.reset(meta_bytes, meta_size - 1, data_bytes, data_size);
+  assert(truncated.bytes(2) == "hello" && !truncated.ok());
+
+  // A default view is empty.
+  MessageView empty;
+
+  assert(!empty.has(1) && !empty.ok());
+  return;
+}
+}  // namespace codegen
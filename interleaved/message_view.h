@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "codegen_runtime.h"
+#include "meta_reader.h"
+
+/// Read-only views of messages in place, in their metadata and data
+/// streams, without decoding them to structs.
+///
+/// A `MessageView` doesn't look at its streams until a field is first
+/// accessed.  It then walks the message's instructions only as far as
+/// that field, and remembers the data offset and width of every field
+/// on the way: fields are in increasing order in the metadata stream,
+/// so accesses in field order walk the message once in total, and
+/// fields before the furthest one accessed are a binary search away.
+/// Runs of submessages are skipped by their opcode bytes (like
+/// `MetaReader::skip_run`) and their data size, and only walked when
+/// viewed.  Strings come back as `std::string_view`s into the data
+/// stream, and integers are loaded from it with the width from the
+/// metadata, like `codegen::DecodeValue`.
+///
+/// The streams must outlive the views.  Accessors return the default
+/// value for absent fields, and for fields that the view found
+/// malformed; `ok` tells the two apart.
+///
+/// splitc generates a `...View` type per message, with an accessor
+/// per field on top of these.
+namespace codegen {
+class RunView;
+
+class MessageView {
+ public:
+  MessageView() = default;
+
+  /// Views the top-level message in `meta` and `data`.
+  MessageView(const void *meta, size_t meta_size, const void *data,
+              size_t data_size) {
+    reset(meta, meta_size, data, data_size);
+  }
+
+  /// Views the top-level message in `meta` and `data` instead, keeping
+  /// the storage for the field offsets.
+  void reset(const void *meta, size_t meta_size, const void *data,
+             size_t data_size);
+
+  /// Walks the rest of the message, and returns true if its
+  /// instructions, field widths, and size are well-formed, and (for a
+  /// top-level message) it ends the metadata stream.  Runs of
+  /// submessages are only checked when viewed.
+  bool ok() const {
+    index_to(UINT32_MAX);
+    return ok_;
+  }
+
+  /// Returns true if `field` is present, as a field or as a run.
+  bool has(uint32_t field) const { return find(field) != nullptr; }
+
+  /// Returns the data of `field`, or `default_value` if absent.
+  std::string_view bytes(uint32_t field,
+                         std::string_view default_value = {}) const {
+    const Entry *entry = find(field);
+
+    if (entry == nullptr || entry->meta_offset != kNotRun)
+      return default_value;
+    return std::string_view((const char *)data_ + entry->data_offset,
+                            entry->size);
+  }
+
+  /// Returns scalar `field`, or `default_value` if absent or of the
+  /// wrong width.
+  template <typename T>
+  T value(uint32_t field, T default_value) const {
+    const Entry *entry = find(field);
+    T ret;
+
+    if (entry == nullptr || entry->meta_offset != kNotRun ||
+        !DecodeValue(data_ + entry->data_offset, entry->size, &ret))
+      return default_value;
+    return ret;
+  }
+
+  /// Views the run of submessages for `field` in `out`.
+  ///
+  /// Returns false if `field` isn't a run.
+  bool run(uint32_t field, RunView *out) const;
+
+  /// Views the first submessage in the run for `field` in `out` (the
+  /// only one, for singular submessage fields).
+  ///
+  /// Returns false if `field` isn't a run, or the run is malformed.
+  inline bool submessage(uint32_t field, MessageView *out) const;
+
+  /// Views and checks hand-written messages.
+  static void SelfTest();
+
+ private:
+  friend class RunView;
+
+  static constexpr size_t kNotRun = SIZE_MAX;
+
+  /// A field found so far.
+  struct Entry {
+    uint32_t field;
+    /// For runs: the width of the first field, folded in the
+    /// `OpenField`.
+    uint32_t first_width;
+    /// Data offset of the field, or of the run.
+    size_t data_offset;
+    /// Width of the field, or data size of the run.
+    uint64_t size;
+    /// For runs: metadata offset right after the `OpenField`.
+    size_t meta_offset;
+    /// For runs: the size hint of the `OpenField`.
+    uint64_t len_hint;
+  };
+
+  /// Views one submessage of a run, from `meta_offset` and
+  /// `data_offset`, whose first field (of `first_width` bytes) is
+  /// folded in the run's `OpenField`.  `run_begin` is the data offset
+  /// of the run.
+  void reset_submessage(const uint8_t *meta, size_t meta_size,
+                        const uint8_t *data, size_t data_size,
+                        size_t meta_offset, size_t data_offset,
+                        size_t first_width, size_t run_begin);
+
+  const Entry *find(uint32_t field) const {
+    if (field >= next_field_ && !done_) index_to(field);
+
+    auto it = std::lower_bound(
+        entries_.begin(), entries_.end(), field,
+        [](const Entry &entry, uint32_t field) { return entry.field < field; });
+    return (it != entries_.end() && it->field == field) ? &*it : nullptr;
+  }
+
+  /// Walks the message until all fields up to `field` are known.
+  void index_to(uint32_t field) const;
+
+  /// Adds field `next_field_` with `width` bytes of data at the
+  /// current data offset.  Returns false if it's past the data.
+  bool add_field(uint64_t width) const;
+
+  const uint8_t *meta_{nullptr};
+  size_t meta_size_{0};
+  const uint8_t *data_{nullptr};
+  size_t data_size_{0};
+  size_t run_begin_{0};
+  size_t message_begin_{0};
+  bool top_level_{true};
+
+  // Walk state, updated by (const) accessors.
+  mutable std::vector<Entry> entries_;
+  mutable size_t meta_cursor_{0};
+  mutable size_t data_cursor_{0};
+  mutable uint32_t next_field_{1};
+  mutable bool done_{true};
+  mutable bool ok_{false};
+};
+
+/// A view of a run of submessages, one submessage at a time.
+class RunView {
+ public:
+  RunView() = default;
+
+  /// The `OpenField`'s size hint for the number of submessages (0 if
+  /// none).
+  uint64_t len_hint() const { return len_hint_; }
+
+  /// Views the next submessage in `out` (a `MessageView`, or a
+  /// generated view).  Finding it walks the instructions of the
+  /// previous one (but not its nested runs' data), so views of the
+  /// first submessage are free.
+  ///
+  /// Returns false after the last submessage, or if the run is
+  /// malformed.
+  bool next(MessageView *out);
+
+ private:
+  friend class MessageView;
+
+  const uint8_t *meta_{nullptr};
+  size_t meta_size_{0};
+  const uint8_t *data_{nullptr};
+  size_t data_size_{0};
+  size_t meta_cursor_{0};
+  size_t data_cursor_{0};
+  size_t first_width_{0};
+  size_t run_begin_{0};
+  uint64_t run_size_{0};
+  uint64_t len_hint_{0};
+  bool started_{false};
+  bool done_{true};
+};
+
+bool MessageView::submessage(uint32_t field, MessageView *out) const {
+  RunView run_view;
+
+  return run(field, &run_view) && run_view.next(out);
+}
+}  // namespace codegen
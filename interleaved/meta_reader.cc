@@ -0,0 +1,164 @@
+#include "meta_reader.h"
+
+#include <assert.h>
+
+#include "base_meta_writer.h"
+
+bool MetaReader::skip_run(uint64_t *run_size) {
+  size_t depth = 0;
+
+  for (; cursor_ != end_; cursor_++) {
+    uint8_t byte = *cursor_;
+
+    if (byte > 127) continue;
+
+    Opcode op = (Opcode)(byte % 8);
+    if (op == Opcode::OpenField) {
+      depth++;
+    } else if (op == Opcode::FieldClose) {
+      if (depth == 0) {
+        MetaInstruction insn;
+
+        if (!next(&insn)) return false;
+
+        *run_size = insn.literal;
+        return true;
+      }
+
+      depth--;
+    }
+  }
+
+  return false;
+}
+
+void MetaReader::SelfTest() {
+  // Round-trip literals of every bit length through the zeroable
+  // (28 bits) and the nonzero (56 bits) literal encodings.
+  for (size_t i = 0; i <= 56; i++) {
+    const uint64_t values[] = {
+        (1ULL << i) - 1,
+        (1ULL << i) >> 1,
+    };
+
+    for (uint64_t value : values) {
+      BaseMetaWriter writer(16);
+
+      if (value < (1ULL << 28)) writer.open_field(value, 2);
+      writer.field_n(4, value);
+
+      MetaReader self(writer.buf.data(), writer.buf.written());
+      MetaInstruction insn;
+
+      (void)insn;
+
+      if (value < (1ULL << 28)) {
+        assert(self.next(&insn));
+        assert(insn.op == Opcode::OpenField);
+        assert(width_for_zeroable_immediate(insn.imm1) == 2);
+        assert(insn.literal == value);
+      }
+
+      assert(self.next(&insn));
+      assert(insn.op == Opcode::FieldN);
+      assert(width_for_zeroable_immediate(insn.imm1) == 4);
+      assert(insn.literal == value);
+      assert(self.done());
+      assert(!self.next(&insn));
+    }
+  }
+
+  {
+    BaseMetaWriter writer(16);
+
+    writer.skip(2);
+    writer.skip(200);
+    writer.one_field(3, 8);
+    writer.two_fields(1, 4);
+    writer.field_close(0, 10);
+    writer.field_separate(1, 1000);
+
+    MetaReader self(writer.buf.data(), writer.buf.written());
+    MetaInstruction insn;
+
+    (void)insn;
+
+    assert(self.next(&insn));
+    assert(insn.op == Opcode::SkipN);
+    assert(insn.imm1 + insn.literal == 2);
+
+    assert(self.next(&insn));
+    assert(insn.op == Opcode::SkipN);
+    assert(insn.imm1 + insn.literal == 200);
+
+    assert(self.next(&insn));
+    assert(insn.op == Opcode::OneField);
+    assert(insn.imm1 == 3);
+    assert(width_for_nonzero_immediate(insn.imm2) == 8);
+
+    assert(self.next(&insn));
+    assert(insn.op == Opcode::TwoFields);
+    assert(width_for_nonzero_immediate(insn.imm1) == 1);
+    assert(width_for_nonzero_immediate(insn.imm2) == 4);
+
+    assert(self.next(&insn));
+    assert(insn.op == Opcode::FieldClose);
+    assert(width_for_zeroable_immediate(insn.imm1) == 0);
+    assert(insn.literal == 10);
+
+    assert(self.next(&insn));
+    assert(insn.op == Opcode::FieldSeparate);
+    assert(width_for_zeroable_immediate(insn.imm1) == 1);
+    assert(insn.literal == 1000);
+
+    assert(self.done());
+  }
+
+  {
+    // A literal byte can't start an instruction.
+    const uint8_t literal[] = {128};
+    MetaInstruction insn;
+
+    (void)literal;
+    (void)insn;
+    assert(!MetaReader(literal, sizeof(literal)).next(&insn));
+  }
+
+  {
+    // Runs of 3 fields (no literal) up to the largest count.
+    const uint32_t counts[] = {3, 4, 130, 131, 16386, (1UL << 28) + 2};
+    BaseMetaWriter writer(16);
+    size_t size = 0;
+
+    for (uint32_t count : counts) {
+      writer.run_fields(count % 2 ? 1 : 8, count);
+      size += BaseMetaWriter::run_fields_size(count);
+    }
+
+    MetaReader self(writer.buf.data(), writer.buf.written());
+    MetaInstruction insn;
+
+    (void)size;
+    (void)insn;
+    assert(writer.buf.written() == size);
+    for (uint32_t count : counts) {
+      (void)count;
+      assert(self.next(&insn));
+      assert(insn.op == Opcode::RunFields);
+      assert(width_for_nonzero_immediate(insn.imm1) == (count % 2 ? 1 : 8));
+      assert(run_fields_count(insn.literal) == count);
+    }
+
+    assert(self.done());
+  }
+
+  {
+    // Truncated literal.
+    BaseMetaWriter writer(16);
+    MetaInstruction insn;
+
+    (void)insn;
+    writer.field_n(0, 1000);
+    assert(!MetaReader(writer.buf.data(), writer.buf.written() - 1).next(&insn));
+  }
+}
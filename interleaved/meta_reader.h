@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "opcode.h"
+#include "radix128.h"
+
+/// A decoded metadata instruction: the opcode, its two immediates,
+/// and the value of its radix-128 literal (0 if the opcode has no
+/// literal).
+struct MetaInstruction {
+  Opcode op;
+  uint8_t imm1;
+  uint8_t imm2;
+  uint64_t literal;
+};
+
+/// `MetaReader`s decode a metadata stream written by a
+/// `BaseMetaWriter`, one instruction at a time.
+///
+/// The reader only decodes instructions; it doesn't track field
+/// numbers or the data stream.  See `decoder.h` for that.
+struct MetaReader {
+  MetaReader() = delete;
+
+  /// Reads from `size` bytes at `meta`.  The bytes must outlive the
+  /// reader.
+  MetaReader(const void *meta, size_t size)
+      : begin_((const uint8_t *)meta),
+        cursor_((const uint8_t *)meta),
+        end_((const uint8_t *)meta + size) {}
+
+  static void SelfTest();
+
+  /// Decodes the next instruction into `out`.
+  ///
+  /// Returns false at the end of the stream, or if the next
+  /// instruction is malformed (`done()` distinguishes the two).
+  inline bool next(MetaInstruction *out);
+
+  /// Returns true once the whole stream has been consumed.
+  inline bool done() const { return cursor_ == end_; }
+
+  /// Returns the number of bytes consumed so far.
+  inline size_t offset() const { return (size_t)(cursor_ - begin_); }
+
+  /// Moves the read cursor to `offset` bytes from the beginning of
+  /// the stream.  `offset` must be at most the size of the stream.
+  inline void seek(size_t offset) { cursor_ = begin_ + offset; }
+
+  /// Skips the rest of the run of submessages opened by the last
+  /// instruction (an `OpenField`), up to and including the matching
+  /// `FieldClose`, and stores the run's data size in `run_size`.
+  ///
+  /// This only looks at opcode bytes to match nested opens and closes
+  /// (literal bytes are skipped by their tag bit), so it takes time
+  /// linear in the size of the run's metadata.  See
+  /// `IndexedMetaReader` for constant-time skips.
+  ///
+  /// Returns false if there is no matching `FieldClose`.
+  bool skip_run(uint64_t *run_size);
+
+  /// Returns the number of literal bytes after an opcode byte.  The
+  /// count only depends on the low 5 bits (opcode and second
+  /// immediate) of the opcode byte.
+  static constexpr size_t literal_bytes(uint8_t opcode_byte) {
+    return kLiteralBytes[opcode_byte % 32];
+  }
+
+  /// Returns the width for a nonzero width immediate: 0, 1, 2, 3 map
+  /// to 1, 2, 4, 8.
+  static inline uint8_t width_for_nonzero_immediate(uint8_t imm) {
+    return 1 << imm;
+  }
+
+  /// Returns the number of fields in a `RunFields` with `literal`.
+  static inline uint64_t run_fields_count(uint64_t literal) {
+    return literal + 3;
+  }
+
+  /// Returns the width for a zeroable (or nullable) width immediate:
+  /// 0, 1, 2, 3 map to 0, 1, 2, 4.
+  static inline uint8_t width_for_zeroable_immediate(uint8_t imm) {
+    return (1 << imm) >> 1;
+  }
+
+  /// Decodes up to 8 radix-128 bytes (high bits already cleared) to
+  /// a 56-bit value, with `Radix128Compress64`.
+  static inline uint64_t radix_compress_64(uint64_t x);
+
+ private:
+  /// Literal byte counts, indexed by the low 5 bits of the opcode
+  /// byte: `Opcode` in the low 3 bits, and the second immediate in
+  /// the next 2.
+  static constexpr uint8_t kLiteralBytes[32] = {
+      // imm2 = 0
+      0, 0, 0, 0, 1, 1, 1, 0,
+      // imm2 = 1
+      1, 0, 0, 1, 2, 2, 2, 1,
+      // imm2 = 2
+      2, 0, 0, 2, 4, 4, 4, 2,
+      // imm2 = 3
+      4, 0, 0, 4, 8, 8, 8, 4,
+  };
+
+  const uint8_t *begin_;
+  const uint8_t *cursor_;
+  const uint8_t *end_;
+};
+
+inline uint64_t MetaReader::radix_compress_64(uint64_t x) {
+  return Radix128Compress64(x);
+}
+
+inline bool MetaReader::next(MetaInstruction *out) {
+  static constexpr uint64_t kTopBits = 128 * (UINT64_MAX / 255);
+
+  if (__builtin_expect(cursor_ == end_, 0)) return false;
+
+  uint8_t byte = *cursor_;
+  size_t available = (size_t)(end_ - cursor_) - 1;
+  size_t count = literal_bytes(byte);
+
+  // Literal bytes (top bit set) can't start an instruction.
+  if (__builtin_expect(byte > 127 || count > available, 0))
+    return false;
+
+  uint64_t literal = 0;
+  if (count > 0) {
+    uint64_t mask = UINT64_MAX >> (64 - 8 * count);
+    uint64_t word = 0;
+
+    if (available >= sizeof(word)) {
+      memcpy(&word, cursor_ + 1, sizeof(word));
+    } else {
+      memcpy(&word, cursor_ + 1, count);
+    }
+
+    word &= mask;
+    if (__builtin_expect((word & kTopBits) != (mask & kTopBits), 0))
+      return false;
+
+    literal = radix_compress_64(word & ~kTopBits);
+  }
+
+  out->op = (Opcode)(byte % 8);
+  out->imm1 = byte >> 5;
+  out->imm2 = (byte >> 3) % 4;
+  out->literal = literal;
+  cursor_ += 1 + count;
+  return true;
+}
@@ -0,0 +1,172 @@
+#include "meta_scan.h"
+
+#include <assert.h>
+
+#if defined(__AVX512BW__) || defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "base_meta_writer.h"
+
+namespace {
+/// Returns a bitmask with one bit per byte in `bytes[0 ... 63]`: the
+/// bit is set iff the byte is an opcode (top bit clear).
+inline uint64_t opcode_mask_64(const uint8_t *bytes) {
+#if defined(__AVX512BW__)
+  __m512i v = _mm512_loadu_si512((const void *)bytes);
+
+  return ~(uint64_t)_mm512_movepi8_mask(v);
+#elif defined(__AVX2__)
+  __m256i lo = _mm256_loadu_si256((const __m256i *)bytes);
+  __m256i hi = _mm256_loadu_si256((const __m256i *)(bytes + 32));
+  uint64_t literals = (uint32_t)_mm256_movemask_epi8(lo) |
+                      ((uint64_t)(uint32_t)_mm256_movemask_epi8(hi) << 32);
+
+  return ~literals;
+#elif defined(__SSE2__)
+  uint64_t literals = 0;
+
+  for (size_t i = 0; i < 4; i++) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(bytes + 16 * i));
+
+    literals |= (uint64_t)(uint16_t)_mm_movemask_epi8(v) << (16 * i);
+  }
+
+  return ~literals;
+#else
+  uint64_t ret = 0;
+
+  for (size_t i = 0; i < 64; i++) ret |= (uint64_t)(bytes[i] < 128) << i;
+
+  return ret;
+#endif
+}
+}  // namespace
+
+void MetaScan::scan(const void *meta, size_t size) {
+  const uint8_t *bytes = (const uint8_t *)meta;
+  size_t n = 0;
+
+  assert(size <= UINT32_MAX);
+  // There are at most `size` instructions.
+  if (offsets.size() < size) {
+    offsets.resize(size);
+    opcodes.resize(size);
+    literal_lengths.resize(size);
+  }
+
+  // Find all the opcode bytes, one 64-byte block at a time, with a
+  // scalar loop for the tail.
+  size_t i = 0;
+  for (; i + 64 <= size; i += 64) {
+    uint64_t mask = opcode_mask_64(bytes + i);
+
+    while (mask != 0) {
+      size_t offset = i + __builtin_ctzll(mask);
+
+      offsets[n] = offset;
+      opcodes[n] = bytes[offset];
+      n++;
+      mask &= mask - 1;
+    }
+  }
+
+  for (; i < size; i++) {
+    if (bytes[i] > 127) continue;
+
+    offsets[n] = i;
+    opcodes[n] = bytes[i];
+    n++;
+  }
+
+  // Each instruction's literal bytes span the gap to the next opcode
+  // (or to the end of the stream).  Gaps longer than 255 bytes
+  // saturate, which is never a valid literal length anyway.
+  for (size_t j = 0; j < n; j++) {
+    size_t next = (j + 1 < n) ? offsets[j + 1] : size;
+    size_t gap = next - offsets[j] - 1;
+
+    literal_lengths[j] = (gap < 255) ? gap : 255;
+  }
+
+  count = n;
+  leading_literals = (n > 0) ? offsets[0] : size;
+  return;
+}
+
+void MetaScan::SelfTest() {
+  // Compare against `MetaReader` on a stream long enough to span
+  // several blocks.
+  BaseMetaWriter writer(16);
+
+  for (size_t i = 0; i < 100; i++) {
+    writer.skip(i * i * i);
+    writer.one_field(i % 4, 1 << (i % 4));
+    writer.open_field(i, 2);
+    writer.field_separate(1, i << 20);
+    writer.field_close(4, i * 1000);
+    writer.field_n(0, i);
+  }
+
+  writer.field_close(0, 0);
+
+  MetaScan self;
+
+  // Scan a short prefix first, to make sure the arrays are reused.
+  self.scan(writer.buf.data(), 10);
+  self.scan(writer.buf.data(), writer.buf.written());
+  assert(self.leading_literals == 0);
+
+  {
+    MetaReader expected(writer.buf.data(), writer.buf.written());
+    ScannedMetaReader actual(writer.buf.data(), writer.buf.written(), self);
+    MetaInstruction x, y;
+    size_t n = 0;
+
+    while (expected.next(&x)) {
+      assert(actual.next(&y));
+      assert(x.op == y.op);
+      assert(x.imm1 == y.imm1);
+      assert(x.imm2 == y.imm2);
+      assert(x.literal == y.literal);
+      n++;
+    }
+
+    (void)y;
+    (void)n;
+    assert(n == self.count);
+    assert(expected.done());
+    assert(actual.done());
+    assert(!actual.next(&y));
+  }
+
+  {
+    // A truncated literal is caught by the length check.
+    MetaScan scan;
+    MetaInstruction insn;
+    BaseMetaWriter truncated(16);
+
+    (void)insn;
+    truncated.field_n(0, 1000);
+    scan.scan(truncated.buf.data(), truncated.buf.written() - 1);
+
+    ScannedMetaReader reader(truncated.buf.data(),
+                             truncated.buf.written() - 1, scan);
+    assert(!reader.next(&insn));
+    assert(!reader.done());
+  }
+
+  {
+    // So are leading literal bytes.
+    const uint8_t bytes[] = {128, 0};
+    MetaScan scan;
+    MetaInstruction insn;
+
+    (void)insn;
+    scan.scan(bytes, sizeof(bytes));
+    assert(scan.leading_literals == 1);
+
+    ScannedMetaReader reader(bytes, sizeof(bytes), scan);
+    assert(!reader.next(&insn));
+  }
+}
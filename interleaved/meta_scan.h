@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "meta_reader.h"
+
+/// A `MetaScan` classifies every byte of a metadata stream in bulk:
+/// literal bytes always have their top bit set and opcode bytes never
+/// do, so a SIMD movemask finds all the opcodes in a block (32 bytes
+/// with AVX2, 64 with AVX-512BW, 16 otherwise) without decoding any
+/// literal.
+///
+/// The result is three parallel arrays, one entry per instruction:
+/// the offset of the opcode byte, the opcode byte itself (opcode and
+/// immediates), and the number of literal bytes after it.
+struct MetaScan {
+  MetaScan() = default;
+
+  /// `MetaScan`s are move-only, to avoid accidentally copying the
+  /// arrays.
+  MetaScan(const MetaScan &) = delete;
+  MetaScan(MetaScan &&) = default;
+  MetaScan &operator=(const MetaScan &) = delete;
+  MetaScan &operator=(MetaScan &&) = default;
+
+  static void SelfTest();
+
+  /// Classifies the `size` bytes at `meta`, and overwrites the
+  /// arrays.  The storage is reused across calls.
+  ///
+  /// Leading literal bytes (which don't belong to any instruction) are
+  /// counted in `leading_literals`.
+  void scan(const void *meta, size_t size);
+
+  /// Number of instructions found by the last `scan`.
+  size_t count{0};
+
+  /// Number of literal bytes before the first opcode byte: always 0
+  /// for well-formed streams.
+  size_t leading_literals{0};
+
+  std::vector<uint32_t> offsets;
+  std::vector<uint8_t> opcodes;
+  std::vector<uint8_t> literal_lengths;
+};
+
+/// A `ScannedMetaReader` decodes instructions like a `MetaReader`, but
+/// takes opcode positions and literal lengths from a `MetaScan`
+/// instead of walking the stream.  It also checks that each literal's
+/// length matches its opcode, so malformed streams fail the same way.
+struct ScannedMetaReader {
+  ScannedMetaReader() = delete;
+
+  /// Reads the `size` bytes at `meta`, which must have been classified
+  /// by `scan`.  Both must outlive the reader.
+  ScannedMetaReader(const void *meta, size_t size, const MetaScan &scan)
+      : meta_((const uint8_t *)meta),
+        size_(size),
+        scan_(&scan),
+        index_(0),
+        failed_(scan.leading_literals != 0) {}
+
+  /// Decodes the next instruction into `out`.
+  ///
+  /// Returns false at the end of the stream, or if the next
+  /// instruction is malformed (`done()` distinguishes the two).
+  inline bool next(MetaInstruction *out);
+
+  /// Returns true once the whole stream has been consumed.
+  inline bool done() const { return !failed_ && index_ == scan_->count; }
+
+ private:
+  const uint8_t *meta_;
+  size_t size_;
+  const MetaScan *scan_;
+  size_t index_;
+  bool failed_;
+};
+
+inline bool ScannedMetaReader::next(MetaInstruction *out) {
+  static constexpr uint64_t kLowBits = 127 * (UINT64_MAX / 255);
+
+  if (__builtin_expect(failed_ || index_ == scan_->count, 0)) return false;
+
+  size_t offset = scan_->offsets[index_];
+  uint8_t byte = scan_->opcodes[index_];
+  size_t count = scan_->literal_lengths[index_];
+
+  if (__builtin_expect(count > 8 || count != MetaReader::literal_bytes(byte),
+                       0)) {
+    failed_ = true;
+    return false;
+  }
+
+  uint64_t literal = 0;
+  if (count > 0) {
+    uint64_t word = 0;
+
+    // The scan already checked the top bits.
+    if (size_ - offset - 1 >= sizeof(word)) {
+      memcpy(&word, meta_ + offset + 1, sizeof(word));
+    } else {
+      memcpy(&word, meta_ + offset + 1, count);
+    }
+
+    word &= UINT64_MAX >> (64 - 8 * count);
+    literal = MetaReader::radix_compress_64(word & kLowBits);
+  }
+
+  out->op = (Opcode)(byte % 8);
+  out->imm1 = byte >> 5;
+  out->imm2 = (byte >> 3) % 4;
+  out->literal = literal;
+  index_++;
+  return true;
+}
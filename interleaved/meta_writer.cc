@@ -0,0 +1,277 @@
+#include "meta_writer.h"
+
+#include <assert.h>
+#include <cstring>
+#include <vector>
+
+#include "meta_reader.h"
+#include "split_literal_meta.h"
+
+template <bool kChecked, template <bool> class Emitter>
+void BasicMetaWriter<kChecked, Emitter>::open(uint32_t field,
+                                              uint32_t len_hint) {
+  assert(field >= next_);
+  assert(depth_ < kMaxDepth);
+  uint32_t skip = field - next_;
+
+  flush_open();
+  flush_field();
+  if (skip != 0) base.skip(skip);
+
+  stack_[depth_++] = field + 1;
+  next_ = 1;
+  open_pending_ = true;
+  len_hint_ = len_hint;
+  return;
+}
+
+template <bool kChecked, template <bool> class Emitter>
+void BasicMetaWriter<kChecked, Emitter>::flush_run(bool keep_last) {
+  uint32_t count = pending_count_;
+
+  if (count == 1) {
+    if (!keep_last) {
+      base.skip_one_field(pending_skip_, pending_width_);
+      has_pending_ = false;
+    }
+
+    return;
+  }
+
+  // The first field goes in a `OneField` with the skip, or the skip
+  // goes alone, like for a pending field fused with the next one.
+  if (fuse_pending()) {
+    if (pending_skip_ != 0) base.skip(pending_skip_);
+  } else {
+    base.skip_one_field(pending_skip_, pending_width_);
+    count--;
+  }
+
+  // The rest is a `RunFields` or `TwoFields` pairs, whichever is
+  // shorter, but the last field is kept if the caller can fuse it.
+  uint32_t run = keep_last ? count - 1 : count;
+  size_t pairs = keep_last ? count / 2 : (count + 1) / 2;
+
+  if (run >= Emitter<kChecked>::kMinRunFields &&
+      Emitter<kChecked>::run_fields_size(run) < pairs) {
+    base.run_fields(pending_width_, run);
+    count -= run;
+  } else {
+    for (; count >= 2; count -= 2)
+      base.two_fields(pending_width_, pending_width_);
+  }
+
+  if (count == 1 && !keep_last) {
+    base.one_field(0, pending_width_);
+    count = 0;
+  }
+
+  has_pending_ = count != 0;
+  pending_skip_ = 0;
+  pending_count_ = count;
+  return;
+}
+
+template <bool kChecked, template <bool> class Emitter>
+uint8_t BasicMetaWriter<kChecked, Emitter>::flush_end() {
+  flush_open();
+  if (has_pending_) flush_run(pending_width_ <= 4);
+  if (!has_pending_) return 0;
+
+  has_pending_ = false;
+  // Folding the skip in a `SkipN` is never longer than folding it in
+  // a `OneField`.
+  if (pending_width_ <= 4) {
+    if (pending_skip_ != 0) base.skip(pending_skip_);
+    return pending_width_;
+  }
+
+  base.skip_one_field(pending_skip_, pending_width_);
+  return 0;
+}
+
+template <bool kChecked, template <bool> class Emitter>
+void BasicMetaWriter<kChecked, Emitter>::separate(uint64_t message_size) {
+  assert(depth_ > 0);
+
+  base.field_separate(flush_end(), message_size);
+  next_ = 1;
+  return;
+}
+
+template <bool kChecked, template <bool> class Emitter>
+void BasicMetaWriter<kChecked, Emitter>::close(uint64_t sequence_size) {
+  base.field_close(flush_end(), sequence_size);
+  next_ = (depth_ > 0) ? stack_[--depth_] : 1;
+  return;
+}
+
+template <bool kChecked, template <bool> class Emitter>
+void BasicMetaWriter<kChecked, Emitter>::splice(const void *instructions,
+                                                size_t size,
+                                                uint8_t trailing_width)
+  requires std::is_same_v<Emitter<kChecked>, BasicBaseMetaWriter<kChecked>>
+{
+  assert(depth_ > 0);
+  assert(trailing_width <= 4);
+
+  flush_open();
+  flush_field();
+  memcpy(base.buf.reserve(size), instructions, size);
+  base.buf.commit(size);
+
+  has_pending_ = trailing_width != 0;
+  pending_skip_ = 0;
+  pending_width_ = trailing_width;
+  pending_count_ = 1;
+  next_ = 1;
+  return;
+}
+
+namespace {
+/// Decodes a metadata stream to (opcode, imm1, imm2, literal) tuples.
+std::vector<MetaInstruction> Instructions(const MetaWriter &writer) {
+  MetaReader reader(writer.base.buf.data(), writer.base.buf.written());
+  std::vector<MetaInstruction> ret;
+  MetaInstruction insn;
+
+  while (reader.next(&insn)) ret.push_back(insn);
+  assert(reader.done());
+  return ret;
+}
+
+bool Same(const std::vector<MetaInstruction> &x,
+          const std::vector<MetaInstruction> &y) {
+  if (x.size() != y.size()) return false;
+
+  for (size_t i = 0; i < x.size(); i++) {
+    if (x[i].op != y[i].op || x[i].imm1 != y[i].imm1 ||
+        x[i].imm2 != y[i].imm2 || x[i].literal != y[i].literal)
+      return false;
+  }
+
+  return true;
+}
+}  // namespace
+
+template <>
+void MetaWriter::SelfTest() {
+  {
+    MetaWriter self(16);
+
+    // 1, 2: TwoFields
+    self.field(1, 1);
+    self.field(2, 8);
+    // 4, 5: OneField(1) (folding the skip beats TwoFields), then a
+    // FieldN with the string.
+    self.field(4, 2);
+    self.field(5, 4);
+    self.string(6, 100);
+    // 20: a string after 13 skips.
+    self.string(20, 3);
+    // 30, 31: TwoFields after a SkipN, shorter than skip(6) + OneField.
+    self.field(30, 1);
+    self.field(31, 1);
+    // 32: folded in the OpenField, then 2 folded in the FieldSeparate.
+    self.open(32, 2);
+    self.field(1, 4);
+    self.field(2, 1);
+    self.separate(5);
+    // 8 bytes don't fit in the FieldClose.
+    self.field(1, 8);
+    self.close(13);
+    // 33: OneField, and the top-level close.
+    self.field(33, 2);
+    self.field(100, 8);
+    self.close(1000);
+
+    const std::vector<MetaInstruction> expected = {
+        {Opcode::TwoFields, 0, 3, 0},
+        {Opcode::OneField, 1, 1, 0},
+        {Opcode::FieldN, 3, 0, 100},
+        {Opcode::SkipN, 3, 1, 10},
+        {Opcode::FieldN, 0, 0, 3},
+        {Opcode::SkipN, 3, 1, 6},
+        {Opcode::TwoFields, 0, 0, 0},
+        {Opcode::OpenField, 3, 1, 2},
+        {Opcode::FieldSeparate, 1, 0, 5},
+        {Opcode::OneField, 0, 3, 0},
+        {Opcode::FieldClose, 0, 0, 13},
+        {Opcode::OneField, 0, 1, 0},
+        {Opcode::SkipN, 3, 1, 63},
+        {Opcode::OneField, 0, 3, 0},
+        {Opcode::FieldClose, 0, 1, 1000},
+    };
+
+    (void)Instructions;
+    (void)Same;
+    assert(Same(Instructions(self), expected));
+  }
+
+  {
+    // Submessages without fields, and a close right after an open.
+    MetaWriter self(16);
+
+    self.open(1, 0);
+    self.separate(0);
+    self.close(0);
+    self.field(2, 1);
+    self.close(1);
+
+    const std::vector<MetaInstruction> expected = {
+        {Opcode::OpenField, 0, 0, 0},
+        {Opcode::FieldSeparate, 0, 0, 0},
+        {Opcode::FieldClose, 0, 0, 0},
+        {Opcode::FieldClose, 1, 0, 1},
+    };
+
+    assert(Same(Instructions(self), expected));
+  }
+
+  {
+    // Runs of same-width fields.
+    MetaWriter self(16);
+
+    // 1-10: a RunFields, before a skip.
+    for (uint32_t field = 1; field <= 10; field++) self.field(field, 4);
+    // 20: 3 fields in a RunFields, after the OpenField.
+    self.open(20, 0);
+    for (uint32_t field = 1; field <= 3; field++) self.field(field, 8);
+    self.close(24);
+    // 21-24: 3 in a RunFields, the last fused with the string.
+    for (uint32_t field = 21; field <= 24; field++) self.field(field, 2);
+    self.string(25, 7);
+    // 30-33: the skip folds in a OneField, then a RunFields.
+    for (uint32_t field = 30; field <= 33; field++) self.field(field, 8);
+    self.field(35, 1);
+    self.close(1000);
+
+    const std::vector<MetaInstruction> expected = {
+        {Opcode::RunFields, 2, 1, 7},
+        {Opcode::SkipN, 3, 1, 6},
+        {Opcode::OpenField, 0, 0, 0},
+        {Opcode::RunFields, 3, 0, 0},
+        {Opcode::FieldClose, 0, 0, 24},
+        {Opcode::RunFields, 1, 0, 0},
+        {Opcode::FieldN, 2, 0, 7},
+        {Opcode::SkipN, 1, 0, 0},
+        {Opcode::OneField, 3, 3, 0},
+        {Opcode::RunFields, 3, 0, 0},
+        {Opcode::SkipN, 1, 0, 0},
+        {Opcode::FieldClose, 1, 1, 1000},
+    };
+
+    assert(Same(Instructions(self), expected));
+  }
+}
+
+template struct BasicMetaWriter<true>;
+template struct BasicMetaWriter<false>;
+
+// The split-literal writer has neither a single-buffer constructor nor
+// `splice`.
+template void SplitLiteralMetaWriter::open(uint32_t, uint32_t);
+template void SplitLiteralMetaWriter::separate(uint64_t);
+template void SplitLiteralMetaWriter::close(uint64_t);
+template void SplitLiteralMetaWriter::flush_run(bool);
+template uint8_t SplitLiteralMetaWriter::flush_end();
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <assert.h>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "base_meta_writer.h"
+#include "write_buffer.h"
+
+/// `MetaWriter`s emit a metadata stream from one call per present
+/// field, and pick the opcodes themselves: skips fold into `OneField`,
+/// adjacent words pair into `TwoFields`, longer runs of words of the
+/// same width become a `RunFields`, a small word followed by a string
+/// becomes a `FieldN`, and small first and last fields of a submessage
+/// fold into its `OpenField` and `FieldSeparate` or `FieldClose`.
+///
+/// The writer keeps at most one run of same-width fields (and one
+/// `OpenField`) pending, until the next call tells it how to fuse
+/// them.  Everything pending
+/// is written by the `close` of the top-level message.
+///
+/// Directly go through `base.buf` to access the underlying
+/// `WriteBuffer`, but not through `base` to emit instructions.
+///
+/// Unchecked writers (`UncheckedMetaWriter`) don't check the buffer's
+/// capacity, like `UncheckedBaseMetaWriter`.
+///
+/// `Emitter` is the instruction encoding: `BasicBaseMetaWriter` for
+/// the interleaved one, or `BasicSplitLiteralBaseMetaWriter` (see
+/// `split_literal_meta.h`) for literals in a separate stream.
+template <bool kChecked,
+          template <bool> class Emitter = BasicBaseMetaWriter>
+struct BasicMetaWriter {
+  BasicMetaWriter() = delete;
+
+  explicit BasicMetaWriter(WriteBuffer buf_) : base(std::move(buf_)) {}
+  explicit BasicMetaWriter(size_t capacity) : base(capacity) {}
+
+  BasicMetaWriter(const BasicMetaWriter &) = delete;
+  BasicMetaWriter(BasicMetaWriter &&) = default;
+  BasicMetaWriter &operator=(const BasicMetaWriter &) = delete;
+  BasicMetaWriter &operator=(BasicMetaWriter &&) = delete;
+
+  ~BasicMetaWriter() = default;
+
+  static void SelfTest();
+
+  /// Maximum submessage nesting depth, like `Decode`'s.
+  static constexpr size_t kMaxDepth = 64;
+
+  /// Adds a machine word `field` with a non-zero data width (1, 2, 4,
+  /// or 8).  Field numbers must increase within each (sub)message.
+  inline void field(uint32_t field, uint8_t data_width);
+
+  /// Adds an arbitrary size `field`, with `data_size` bytes of data.
+  inline void string(uint32_t field, uint64_t data_size);
+
+  /// Opens a run of submessages for `field`, with `len_hint` for the
+  /// number of submessages (0 for no hint).
+  ///
+  /// At most `kMaxDepth` runs may be open at once.  That's only
+  /// asserted here: callers bound their nesting up front (`splitc`
+  /// rejects schemas that nest deeper, and the JSON and protobuf
+  /// readers fail on deeper input).
+  void open(uint32_t field, uint32_t len_hint);
+
+  /// Ends the current submessage, of `message_size` bytes, and starts
+  /// the next one in the same run.
+  void separate(uint64_t message_size);
+
+  /// Closes the current run of submessages, or the top-level message,
+  /// with the total size of its data.
+  void close(uint64_t sequence_size);
+
+  /// Appends `size` bytes of instructions, written by another
+  /// `MetaWriter`, to the current run of submessages: e.g., whole
+  /// submessages with their `FieldSeparate`s, encoded on another
+  /// thread.  The data must be appended to the data stream separately.
+  ///
+  /// A non-zero `trailing_width` (1, 2, or 4) is the width of a last
+  /// field left out of `instructions`, for the next `separate` or
+  /// `close` to fold, like `field` would.
+  ///
+  /// Only for the interleaved encoding, whose instructions are
+  /// contiguous.
+  void splice(const void *instructions, size_t size, uint8_t trailing_width)
+    requires std::is_same_v<Emitter<kChecked>, BasicBaseMetaWriter<kChecked>>;
+
+  Emitter<kChecked> base;
+
+ private:
+  /// Returns true if writing the pending field with the next one in a
+  /// `TwoFields` or a `FieldN`, after a plain `SkipN`, is shorter than
+  /// folding the skip in a `OneField` for the pending field alone.
+  inline bool fuse_pending() const {
+    return Emitter<kChecked>::skip_size(pending_skip_) <
+           Emitter<kChecked>::one_field_size(pending_skip_);
+  }
+
+  /// Writes the pending `OpenField`, without any field.
+  inline void flush_open() {
+    if (__builtin_expect(open_pending_, 0)) {
+      base.open_field(len_hint_, 0);
+      open_pending_ = false;
+    }
+  }
+
+  /// Writes the pending fields, if any.
+  inline void flush_field() {
+    if (has_pending_) flush_run(false);
+  }
+
+  /// Writes the pending fields.  If `keep_last`, the last one may stay
+  /// pending, for the caller to fuse with what comes next.
+  void flush_run(bool keep_last);
+
+  /// Writes everything pending for the end of a submessage, and
+  /// returns the width to fold into the `FieldSeparate` or
+  /// `FieldClose`.
+  uint8_t flush_end();
+
+  /// Number of the field after the last one added in the current
+  /// (sub)message.
+  uint32_t next_{1};
+
+  bool has_pending_{false};
+  bool open_pending_{false};
+  /// Pending fields: number of fields skipped before the first, their
+  /// (common) width, and how many there are, back to back.
+  uint32_t pending_skip_{0};
+  uint8_t pending_width_{0};
+  uint32_t pending_count_{0};
+  uint32_t len_hint_{0};
+
+  /// `next_` for the enclosing messages.
+  uint32_t stack_[kMaxDepth];
+  size_t depth_{0};
+};
+
+using MetaWriter = BasicMetaWriter<true>;
+using UncheckedMetaWriter = BasicMetaWriter<false>;
+
+template <>
+void MetaWriter::SelfTest();
+
+template <bool kChecked, template <bool> class Emitter>
+inline void BasicMetaWriter<kChecked, Emitter>::field(uint32_t field,
+                                                      uint8_t data_width) {
+  assert(field >= next_);
+  uint32_t skip = field - next_;
+
+  next_ = field + 1;
+  if (__builtin_expect(open_pending_, 0)) {
+    open_pending_ = false;
+    if (skip == 0 && data_width <= 4) {
+      base.open_field(len_hint_, data_width);
+      return;
+    }
+
+    base.open_field(len_hint_, 0);
+  }
+
+  if (has_pending_) {
+    if (skip == 0 && data_width == pending_width_ &&
+        pending_count_ < Emitter<kChecked>::kMaxRunFields) {
+      pending_count_++;
+      return;
+    }
+
+    flush_run(skip == 0);
+  }
+
+  if (has_pending_) {
+    if (fuse_pending()) {
+      if (pending_skip_ != 0) base.skip(pending_skip_);
+      base.two_fields(pending_width_, data_width);
+      has_pending_ = false;
+      return;
+    }
+
+    base.skip_one_field(pending_skip_, pending_width_);
+  }
+
+  has_pending_ = true;
+  pending_skip_ = skip;
+  pending_width_ = data_width;
+  pending_count_ = 1;
+  return;
+}
+
+template <bool kChecked, template <bool> class Emitter>
+inline void BasicMetaWriter<kChecked, Emitter>::string(uint32_t field,
+                                                       uint64_t data_size) {
+  assert(field >= next_);
+  uint32_t skip = field - next_;
+
+  next_ = field + 1;
+  flush_open();
+  if (has_pending_) flush_run(skip == 0 && pending_width_ <= 4);
+  if (has_pending_) {
+    has_pending_ = false;
+    if (skip == 0 && pending_width_ <= 4 && fuse_pending()) {
+      if (pending_skip_ != 0) base.skip(pending_skip_);
+      base.field_n(pending_width_, data_size);
+      return;
+    }
+
+    base.skip_one_field(pending_skip_, pending_width_);
+  }
+
+  if (skip != 0) base.skip(skip);
+  base.field_n(0, data_size);
+  return;
+}
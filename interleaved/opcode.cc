@@ -16,6 +16,8 @@ std::string OpcodeName(Opcode op) {
       return "FieldSeparate";
     case Opcode::FieldN:
       return "FieldN";
+    case Opcode::RunFields:
+      return "RunFields";
   }
 
   return "Unknown";
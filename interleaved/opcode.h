@@ -4,7 +4,9 @@
 #include <string>
 
 /// Opcodes for the metadata stream.  These integer values aren't
-/// optimised for SIMD processing.
+/// optimised for SIMD processing; the split-literal encoding (see
+/// `split_literal_meta.h`) moves literals out of the opcode stream
+/// instead.
 enum class Opcode : uint8_t {
   /// Skip multiple fields (or no-op if the count is 0).
   ///
@@ -75,6 +77,17 @@ enum class Opcode : uint8_t {
   /// many radix-128 literal bytes in the metadata stream, and the
   /// field takes up exactly that many bytes in the data stream.
   FieldN = 6,
+
+  /// A run of at least 3 machine word fields of the same width, with
+  /// no skip between (or before) them.
+  ///
+  /// The first immediate is the non-zero width of each field's data
+  /// (1, 2, 4, or 8 bytes mapped to [0, 3]), and the second immediate
+  /// the zeroable width (0, 1, 2, 4 literal bytes mapped to [0, 3]) of
+  /// the number of fields minus 3.  That count is encoded as that many
+  /// radix-128 literal bytes in the metadata stream, like `SkipN`'s,
+  /// and the fields' data is contiguous in the data stream.
+  RunFields = 7,
 };
 
 std::string OpcodeName(Opcode);
@@ -0,0 +1,286 @@
+#include "parallel_decode.h"
+
+#include <assert.h>
+#include <string>
+
+#include "codegen_runtime.h"
+#include "data_writer.h"
+#include "meta_writer.h"
+
+namespace parallel_decode_internal {
+bool ScanChunk(const uint8_t *meta, size_t meta_size, ChunkEffect *effect) {
+  MetaReader meta_reader(meta, meta_size);
+  SymbolicFrame current{{Symbol::kStart, 0},
+                        {Symbol::kStart, 0},
+                        {Symbol::kStart, 0}};
+  uint64_t data_size = 0;
+  MetaInstruction insn;
+
+  effect->pops = 0;
+  effect->pushes.clear();
+  meta_reader.seek(effect->meta_begin);
+  while (meta_reader.offset() < effect->meta_end) {
+    if (!meta_reader.next(&insn)) return false;
+
+    switch (insn.op) {
+      case Opcode::SkipN:
+        current.field.value += insn.imm1 + insn.literal;
+        break;
+
+      case Opcode::OneField:
+        current.field.value += insn.imm1 + 1;
+        data_size += MetaReader::width_for_nonzero_immediate(insn.imm2);
+        break;
+
+      case Opcode::TwoFields:
+        current.field.value += 2;
+        data_size += MetaReader::width_for_nonzero_immediate(insn.imm1);
+        data_size += MetaReader::width_for_nonzero_immediate(insn.imm2);
+        break;
+
+      case Opcode::OpenField: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (effect->pushes.size() == decoder_internal::kMaxDepth)
+          return false;
+
+        effect->pushes.push_back(current);
+        current = SymbolicFrame{{Symbol::kLocal, 1},
+                                {Symbol::kLocal, data_size},
+                                {Symbol::kLocal, data_size}};
+        data_size += width;
+        current.field.value += (width != 0);
+        break;
+      }
+
+      case Opcode::FieldClose:
+        data_size += MetaReader::width_for_zeroable_immediate(insn.imm1);
+        if (effect->pushes.empty()) {
+          // Closes a run opened before the chunk: the state comes from
+          // the next frame of the start stack.
+          int32_t k = (int32_t)effect->pops++;
+
+          current = SymbolicFrame{{k, 0}, {k, 0}, {k, 0}};
+        } else {
+          current = effect->pushes.back();
+          current.field.value++;
+          effect->pushes.pop_back();
+        }
+        break;
+
+      case Opcode::FieldSeparate:
+        data_size += MetaReader::width_for_zeroable_immediate(insn.imm1);
+        current.field = {Symbol::kLocal, 1};
+        current.message_begin = {Symbol::kLocal, data_size};
+        break;
+
+      case Opcode::RunFields: {
+        uint64_t count = MetaReader::run_fields_count(insn.literal);
+
+        current.field.value += count;
+        data_size += MetaReader::width_for_nonzero_immediate(insn.imm1) * count;
+        break;
+      }
+
+      case Opcode::FieldN: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        data_size += width + insn.literal;
+        current.field.value += (width != 0) + 1;
+        break;
+      }
+    }
+  }
+
+  effect->data_size = data_size;
+  effect->end = current;
+  return true;
+}
+
+bool Advance(const ChunkEffect &effect, const DecodeState &in,
+             DecodeState *out) {
+  using decoder_internal::Frame;
+
+  if (effect.pops > in.depth + 1) return false;
+  if (effect.pops == in.depth + 1) {
+    // Closed the top-level message.
+    out->depth = SIZE_MAX;
+    return true;
+  }
+
+  size_t kept = in.depth - effect.pops;
+
+  if (kept + effect.pushes.size() > decoder_internal::kMaxDepth) return false;
+
+  auto field = [&](const Symbol &symbol) -> uint32_t {
+    if (symbol.source == Symbol::kLocal) return (uint32_t)symbol.value;
+    if (symbol.source == Symbol::kStart) return in.field + symbol.value;
+    return in.stack[in.depth - 1 - symbol.source].field + 1 + symbol.value;
+  };
+  auto run_begin = [&](const Symbol &symbol) -> size_t {
+    if (symbol.source == Symbol::kLocal) return in.data_offset + symbol.value;
+    if (symbol.source == Symbol::kStart) return in.run_begin;
+    return in.stack[in.depth - 1 - symbol.source].run_begin;
+  };
+  auto message_begin = [&](const Symbol &symbol) -> size_t {
+    if (symbol.source == Symbol::kLocal) return in.data_offset + symbol.value;
+    if (symbol.source == Symbol::kStart) return in.message_begin;
+    return in.stack[in.depth - 1 - symbol.source].message_begin;
+  };
+
+  std::copy(in.stack, in.stack + kept, out->stack);
+  for (const SymbolicFrame &frame : effect.pushes) {
+    out->stack[kept++] =
+        Frame{field(frame.field), run_begin(frame.run_begin),
+              message_begin(frame.message_begin)};
+  }
+
+  out->depth = kept;
+  out->field = field(effect.end.field);
+  out->run_begin = run_begin(effect.end.run_begin);
+  out->message_begin = message_begin(effect.end.message_begin);
+  out->data_offset = in.data_offset + effect.data_size;
+  return true;
+}
+}  // namespace parallel_decode_internal
+
+namespace {
+/// Logs every callback as a string, like the `Decode` self-test.
+struct LogVisitor {
+  void field(uint32_t field, size_t width, const uint8_t *data) {
+    log.push_back(std::to_string(field) + "=" +
+                  std::string((const char *)data, width));
+  }
+
+  void open(uint32_t field, uint64_t len_hint) {
+    log.push_back("open " + std::to_string(field) + " " +
+                  std::to_string(len_hint));
+  }
+
+  void separate(uint64_t size) {
+    log.push_back("separate " + std::to_string(size));
+  }
+
+  void close(uint64_t size) { log.push_back("close " + std::to_string(size)); }
+
+  std::vector<std::string> log;
+};
+
+struct Random {
+  uint32_t next(uint32_t bound) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(state >> 33) % bound;
+  }
+
+  uint64_t state{42};
+};
+
+/// Writes the fields of a random message, with runs nested up to
+/// `depth` levels down.
+void WriteRandomFields(Random *random, size_t depth, MetaWriter *meta,
+                       DataWriter *data) {
+  uint32_t field = 1;
+
+  for (uint32_t i = random->next(8); i > 0; i--) {
+    field += random->next(3) == 0 ? random->next(40) : 0;
+
+    switch (random->next(depth > 0 ? 4 : 3)) {
+      case 0:
+        meta->field(field, data->varint(random->next(1 << 20)));
+        break;
+      case 1:
+        meta->field(field, data->fixed<uint64_t>(random->next(1000)));
+        break;
+      case 2: {
+        std::string bytes(random->next(20), 'a' + random->next(26));
+
+        meta->string(field, data->bytes(bytes.data(), bytes.size()));
+        break;
+      }
+      case 3:
+        codegen::EncodeRun(meta, data, field, true, 1 + random->next(6),
+                           [&](size_t) {
+                             WriteRandomFields(random, depth - 1, meta, data);
+                           });
+        break;
+    }
+
+    field++;
+  }
+}
+
+/// Decodes with `ParallelDecode` in `num_chunks` chunks, with
+/// `options`, and compares with `Decode`.
+void CheckChunks(const std::string &meta, const std::string &data,
+                 size_t num_chunks, const ParallelDecodeOptions &options) {
+  LogVisitor sequential;
+  std::vector<LogVisitor> chunks(num_chunks);
+  bool success = Decode(meta.data(), meta.size(), data.data(), data.size(),
+                        &sequential);
+  bool parallel_success = ParallelDecode(meta.data(), meta.size(), data.data(),
+                                         data.size(), chunks.data(),
+                                         num_chunks, options);
+
+  (void)success;
+  (void)parallel_success;
+  assert(parallel_success == success);
+  if (!success) return;
+
+  std::vector<std::string> log;
+
+  for (const LogVisitor &chunk : chunks)
+    log.insert(log.end(), chunk.log.begin(), chunk.log.end());
+  assert(log == sequential.log);
+}
+}  // namespace
+
+void ParallelDecodeSelfTest() {
+  Random random;
+  WorkerPool pool(4);
+  // Every chunk count, on the calling thread alone and on the pool
+  // (with more chunks than workers, too).
+  ParallelDecodeOptions serial;
+  ParallelDecodeOptions pooled;
+  // The default `min_chunk` leaves these streams to `Decode`.
+  ParallelDecodeOptions short_streams;
+
+  serial.min_chunk = 1;
+  pooled.pool = short_streams.pool = &pool;
+  pooled.min_chunk = 1;
+
+  for (size_t round = 0; round < 50; round++) {
+    MetaWriter meta_writer(16);
+    DataWriter data_writer(16);
+
+    WriteRandomFields(&random, 1 + round % 4, &meta_writer, &data_writer);
+    meta_writer.close(data_writer.buf.written());
+
+    std::string meta((const char *)meta_writer.base.buf.data(),
+                     meta_writer.base.buf.written());
+    std::string data((const char *)data_writer.buf.data(),
+                     data_writer.buf.written());
+
+    for (size_t num_chunks = 1; num_chunks <= 16; num_chunks++) {
+      CheckChunks(meta, data, num_chunks, serial);
+      CheckChunks(meta, data, num_chunks, pooled);
+    }
+
+    CheckChunks(meta, data, 4, short_streams);
+
+    // Truncated streams, and corrupt metadata bytes, fail (or not)
+    // exactly like the sequential decode.
+    CheckChunks(meta, data.substr(0, data.size() / 2), 3, pooled);
+    CheckChunks(meta.substr(0, meta.size() - 1), data, 3, pooled);
+    for (size_t i = 0; i < meta.size(); i += 1 + meta.size() / 16) {
+      std::string corrupt = meta;
+
+      corrupt[i] ^= 1 << random.next(8);
+      CheckChunks(corrupt, data, 1 + random.next(8), pooled);
+    }
+  }
+
+  // Empty streams.
+  CheckChunks("", "", 1, pooled);
+  CheckChunks("", "", 4, pooled);
+  return;
+}
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <barrier>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "data_reader.h"
+#include "decoder.h"
+#include "meta_reader.h"
+#include "worker_pool.h"
+
+/// Parallel `Decode` for large messages.
+///
+/// Opcode bytes never have their top bit set, and literal bytes always
+/// do, so a metadata stream can be cut anywhere and resynchronised at
+/// the next byte below 128.  `ParallelDecode` cuts the stream into
+/// chunks that way, and decodes them in three phases:
+///
+///   1. Each thread scans a chunk without knowing where it starts in
+///      the message, and summarises its effect on the decoder state
+///      (`ChunkEffect`): the data bytes it consumes, the runs it
+///      closes that it didn't open, the runs it leaves open, and its
+///      final field number and data offsets, in terms of the state at
+///      the start of the chunk.
+///   2. A prefix pass over the summaries (not the stream) gives every
+///      chunk its exact starting state: nesting depth, enclosing
+///      runs, field number, and data offset.
+///   3. Each thread decodes its chunk from that state, with its own
+///      visitor.
+///
+/// The visitors see the same callbacks as one visitor would with
+/// `Decode`, split at the chunk boundaries: a chunk's visitor may see
+/// fields of a submessage opened before its chunk, and closes for
+/// runs it didn't see open.  Visitors can't skip runs (`open` must
+/// return void).
+namespace parallel_decode_internal {
+/// A value in a chunk's final decoder state, in terms of the state at
+/// the start of the chunk.
+struct Symbol {
+  /// `kLocal`: `value` itself is the field number, or the data offset
+  /// from the beginning of the chunk's data.
+  static constexpr int32_t kLocal = -2;
+  /// `kStart`: the value at the start of the chunk (plus `value`, for
+  /// field numbers).
+  static constexpr int32_t kStart = -1;
+
+  /// `kLocal`, `kStart`, or k >= 0 for the value saved in the k-th
+  /// frame (from the top) of the stack at the start of the chunk (plus
+  /// 1 + `value`, for field numbers: the field after the run).
+  int32_t source;
+  uint64_t value;
+};
+
+/// The decoder state for one (sub)message, as saved on the stack.
+struct SymbolicFrame {
+  Symbol field;
+  Symbol run_begin;
+  Symbol message_begin;
+};
+
+/// The effect of a chunk of metadata on the decoder state.
+struct ChunkEffect {
+  size_t meta_begin;
+  size_t meta_end;
+
+  /// Data bytes consumed by the chunk.
+  uint64_t data_size;
+
+  /// Number of frames popped off the stack the chunk started with.
+  size_t pops;
+
+  /// Frames pushed by the chunk and still on the stack at its end,
+  /// bottom first.
+  std::vector<SymbolicFrame> pushes;
+
+  /// State at the end of the chunk.
+  SymbolicFrame end;
+};
+
+/// Exact decoder state.
+struct DecodeState {
+  uint32_t field;
+  size_t run_begin;
+  size_t message_begin;
+  size_t data_offset;
+  size_t depth;
+  decoder_internal::Frame stack[decoder_internal::kMaxDepth];
+};
+
+/// Phase 1: scans the instructions in `[effect->meta_begin,
+/// effect->meta_end)` of `meta`, and fills in the rest of `effect`.
+///
+/// Returns false on malformed instructions.
+bool ScanChunk(const uint8_t *meta, size_t meta_size, ChunkEffect *effect);
+
+/// Phase 2: computes the state after a chunk with `effect`, from the
+/// state `in` at its start.
+///
+/// Returns false if the chunk closes more runs than are open, or opens
+/// too many.  A close of the top-level message leaves `out->depth` at
+/// `SIZE_MAX`.
+bool Advance(const ChunkEffect &effect, const DecodeState &in,
+             DecodeState *out);
+
+/// Phase 3: decodes the chunk `[meta_begin, meta_end)`, from `state`.
+///
+/// Returns false if the streams are malformed.
+template <typename Visitor>
+bool DecodeChunk(const uint8_t *meta, size_t meta_size, size_t meta_begin,
+                 size_t meta_end, const void *data, size_t data_size,
+                 const DecodeState &state, Visitor *visitor) {
+  using decoder_internal::Frame;
+  using decoder_internal::kMaxDepth;
+
+  MetaReader meta_reader(meta, meta_size);
+  DataReader data_reader(data, data_size);
+  Frame stack[kMaxDepth];
+  size_t depth = state.depth;
+  uint32_t field = state.field;
+  size_t run_begin = state.run_begin;
+  size_t message_begin = state.message_begin;
+  MetaInstruction insn;
+
+  if (data_reader.read(state.data_offset) == nullptr) return false;
+
+  meta_reader.seek(meta_begin);
+  std::copy(state.stack, state.stack + depth, stack);
+
+  auto emit = [&](size_t width) {
+    const uint8_t *src = data_reader.read(width);
+
+    if (__builtin_expect(src == nullptr, 0)) return false;
+    visitor->field(field++, width, src);
+    return true;
+  };
+
+  while (meta_reader.offset() < meta_end) {
+    if (!meta_reader.next(&insn)) return false;
+
+    switch (insn.op) {
+      case Opcode::SkipN:
+        field += insn.imm1 + insn.literal;
+        break;
+
+      case Opcode::OneField:
+        field += insn.imm1;
+        if (!emit(MetaReader::width_for_nonzero_immediate(insn.imm2)))
+          return false;
+        break;
+
+      case Opcode::TwoFields:
+        if (!emit(MetaReader::width_for_nonzero_immediate(insn.imm1)) ||
+            !emit(MetaReader::width_for_nonzero_immediate(insn.imm2)))
+          return false;
+        break;
+
+      case Opcode::OpenField: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (__builtin_expect(depth == kMaxDepth, 0)) return false;
+
+        visitor->open(field, insn.literal);
+        stack[depth++] = Frame{field, run_begin, message_begin};
+        field = 1;
+        run_begin = message_begin = data_reader.offset();
+        if (width != 0 && !emit(width)) return false;
+        break;
+      }
+
+      case Opcode::FieldClose: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !emit(width)) return false;
+        if (__builtin_expect(
+                insn.literal != data_reader.offset() - run_begin, 0))
+          return false;
+
+        visitor->close(insn.literal);
+        if (depth == 0) return meta_reader.done();
+
+        const Frame &frame = stack[--depth];
+        field = frame.field + 1;
+        run_begin = frame.run_begin;
+        message_begin = frame.message_begin;
+        break;
+      }
+
+      case Opcode::FieldSeparate: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !emit(width)) return false;
+        if (__builtin_expect(
+                insn.literal != data_reader.offset() - message_begin, 0))
+          return false;
+
+        visitor->separate(insn.literal);
+        field = 1;
+        message_begin = data_reader.offset();
+        break;
+      }
+
+      case Opcode::RunFields: {
+        size_t width = MetaReader::width_for_nonzero_immediate(insn.imm1);
+        uint64_t count = MetaReader::run_fields_count(insn.literal);
+        const uint8_t *src = data_reader.read(width * count);
+
+        if (__builtin_expect(src == nullptr, 0)) return false;
+        for (uint64_t i = 0; i < count; i++, src += width)
+          visitor->field(field++, width, src);
+        break;
+      }
+
+      case Opcode::FieldN: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (width != 0 && !emit(width)) return false;
+        if (!emit(insn.literal)) return false;
+        break;
+      }
+    }
+  }
+
+  // Only the last nonempty chunk ends with the top-level close (and
+  // returns above).
+  return meta_end != meta_size || (meta_begin == meta_size && meta_size > 0);
+}
+}  // namespace parallel_decode_internal
+
+/// How `ParallelDecode` cuts a stream, and where the chunks run.
+struct ParallelDecodeOptions {
+  /// Workers for the chunks, including the calling thread.  nullptr
+  /// decodes every chunk on the calling thread.
+  WorkerPool *pool{nullptr};
+
+  /// Fewest metadata bytes per chunk: shorter streams use fewer
+  /// chunks, or `Decode` alone.  Each chunk is scanned and decoded,
+  /// and each worker costs a wakeup, so chunks must be much longer
+  /// than message2's whole stream (14 KB) to pay off.
+  size_t min_chunk{256 << 10};
+};
+
+/// Decodes the top-level message in `meta` and `data` like `Decode`,
+/// in up to `num_chunks` chunks, with `visitors[i]` for the `i`th
+/// chunk.  `num_chunks` must be at least 1; visitors past the last
+/// chunk, and chunks of short streams, may see nothing.
+///
+/// Chunks are spread over the workers of `options.pool`, which run
+/// both the scan and the decode, with a barrier between them for the
+/// prefix pass.  Streams too short for two chunks of
+/// `options.min_chunk` bytes are decoded by `Decode`, with
+/// `visitors[0]`.
+///
+/// Returns true if the streams were well-formed and the metadata
+/// stream ended with the close of the top-level message.  The
+/// visitors may have seen some fields even if decoding fails.
+template <typename Visitor>
+bool ParallelDecode(const void *meta, size_t meta_size, const void *data,
+                    size_t data_size, Visitor *visitors, size_t num_chunks,
+                    const ParallelDecodeOptions &options = {}) {
+  using namespace parallel_decode_internal;
+
+  static_assert(std::is_void_v<decltype(visitors->open(0, 0))>,
+                "Chunks can't skip runs that may span other chunks.");
+
+  assert(num_chunks >= 1);
+  num_chunks = std::min(num_chunks,
+                        meta_size / std::max<size_t>(options.min_chunk, 1));
+  if (num_chunks <= 1)
+    return Decode(meta, meta_size, data, data_size, visitors);
+
+  const uint8_t *bytes = (const uint8_t *)meta;
+  std::vector<ChunkEffect> effects(num_chunks);
+  std::vector<DecodeState> states(num_chunks);
+  std::vector<uint8_t> success(num_chunks, 0);
+
+  // Cut at the first opcode byte after each even split.  The first
+  // chunk starts at 0 regardless, so a stray literal byte there is an
+  // error, as with `Decode`.
+  for (size_t i = 0; i < num_chunks; i++) {
+    size_t begin = meta_size * i / num_chunks;
+
+    while (i > 0 && begin < meta_size && bytes[begin] > 127) begin++;
+    if (i > 0) effects[i - 1].meta_end = begin;
+    effects[i].meta_begin = begin;
+  }
+
+  effects[num_chunks - 1].meta_end = meta_size;
+
+  size_t num_workers = 1;
+  bool advanced = false;
+
+  if (options.pool != nullptr)
+    num_workers = std::min(num_chunks, options.pool->size());
+
+  // Once every chunk is scanned, the last worker to arrive gives each
+  // chunk its start state.
+  auto advance = [&]() noexcept {
+    for (uint8_t chunk_success : success) {
+      if (!chunk_success) return;
+    }
+
+    states[0] = DecodeState{1, 0, 0, 0, 0, {}};
+    for (size_t i = 0; i + 1 < num_chunks && effects[i].meta_end < meta_size;
+         i++) {
+      if (!Advance(effects[i], states[i], &states[i + 1]) ||
+          states[i + 1].depth == SIZE_MAX)
+        return;
+    }
+
+    advanced = true;
+  };
+  std::barrier scanned(num_workers, advance);
+
+  // Worker `w` takes chunks `w`, `w + num_workers`, ..., in both
+  // phases.
+  auto work = [&](size_t w) {
+    for (size_t i = w; i < num_chunks; i += num_workers)
+      success[i] = ScanChunk(bytes, meta_size, &effects[i]);
+
+    scanned.arrive_and_wait();
+    if (!advanced) return;
+
+    for (size_t i = w; i < num_chunks; i += num_workers) {
+      success[i] = DecodeChunk(bytes, meta_size, effects[i].meta_begin,
+                               effects[i].meta_end, data, data_size,
+                               states[i], &visitors[i]);
+    }
+  };
+
+  if (num_workers == 1) {
+    work(0);
+  } else {
+    options.pool->run(num_workers, work);
+  }
+
+  if (!advanced) return false;
+  for (uint8_t chunk_success : success) {
+    if (!chunk_success) return false;
+  }
+
+  return true;
+}
+
+/// Checks that chunked decodes see the same fields as `Decode`, for
+/// every number of chunks, on random messages.
+void ParallelDecodeSelfTest();
@@ -0,0 +1,107 @@
+#include "parallel_encode.h"
+
+#include <assert.h>
+#include <cstring>
+#include <string>
+
+#include "opcode.h"
+
+namespace codegen {
+size_t StitchChunk(EncodedChunk *chunk, bool last, uint8_t *trailing_width) {
+  static const uint8_t kZeroableWidth[4] = {0, 1, 2, 4};
+  uint8_t *meta = (uint8_t *)chunk->meta.base.buf.data();
+
+  *trailing_width = 0;
+  for (size_t i = 0; i < chunk->ends.size(); i++) {
+    // Literal bytes have their top bit set, so the `FieldClose` starts
+    // at the last byte without.
+    size_t begin = chunk->ends[i] - 1;
+
+    while (meta[begin] > 127) begin--;
+
+    assert((Opcode)(meta[begin] % 8) == Opcode::FieldClose);
+    if (last && i + 1 == chunk->ends.size()) {
+      *trailing_width = kZeroableWidth[meta[begin] >> 5];
+      return begin;
+    }
+
+    meta[begin] = (meta[begin] & ~7) | (uint8_t)Opcode::FieldSeparate;
+  }
+
+  return chunk->meta.base.buf.written();
+}
+}  // namespace codegen
+
+namespace {
+struct Element {
+  std::string name;
+  uint64_t value;
+  std::vector<uint32_t> values;
+};
+
+void EncodeFields(const Element &element, MetaWriter *meta,
+                  DataWriter *data) {
+  meta->string(1, data->bytes(element.name.data(), element.name.size()));
+  if (element.value != 0) meta->field(2, data->varint(element.value));
+  if (!element.values.empty()) {
+    codegen::EncodeRun(meta, data, 3, true, element.values.size(),
+                       [&](size_t i) {
+                         meta->field(1, data->varint(element.values[i]));
+                       });
+  }
+}
+}  // namespace
+
+void ParallelEncodeSelfTest() {
+  std::vector<Element> elements(100);
+
+  // Small values fold into the separators, 8-byte ones don't, and
+  // some elements have a nested run.
+  for (size_t i = 0; i < elements.size(); i++) {
+    elements[i].name = std::string(i % 7, 'a' + i % 26);
+    elements[i].value = (i % 3 == 0) ? 0 : (i % 5 == 0) ? 1ULL << 40 : i;
+    elements[i].values.assign(i % 4, i);
+  }
+
+  // The elements start with a string, so the `OpenField` doesn't fold
+  // anything, and the stitched run is identical to a sequential one.
+  for (size_t num_threads : {1, 2, 3, 7}) {
+    WorkerPool pool(num_threads);
+
+    for (size_t count : {1, 2, 10, 99, 100}) {
+      std::vector<Element> subset(elements.begin(), elements.begin() + count);
+      MetaWriter sequential_meta(16);
+      DataWriter sequential_data(16);
+      MetaWriter parallel_meta(16);
+      DataWriter parallel_data(16);
+      codegen::ParallelOptions options;
+
+      options.pool = &pool;
+      options.min_chunk = 1;
+
+      sequential_meta.field(1, sequential_data.varint(42));
+      codegen::EncodeRun(&sequential_meta, &sequential_data, 2, true, count,
+                         [&](size_t i) {
+                           EncodeFields(subset[i], &sequential_meta,
+                                        &sequential_data);
+                         });
+      sequential_meta.close(sequential_data.buf.written());
+
+      parallel_meta.field(1, parallel_data.varint(42));
+      codegen::EncodeRunParallel(&parallel_meta, &parallel_data, 2, subset,
+                                 options);
+      parallel_meta.close(parallel_data.buf.written());
+
+      assert(parallel_meta.base.buf.written() ==
+             sequential_meta.base.buf.written());
+      assert(memcmp(parallel_meta.base.buf.data(),
+                    sequential_meta.base.buf.data(),
+                    sequential_meta.base.buf.written()) == 0);
+      assert(parallel_data.buf.written() == sequential_data.buf.written());
+      assert(memcmp(parallel_data.buf.data(), sequential_data.buf.data(),
+                    sequential_data.buf.written()) == 0);
+    }
+  }
+
+  return;
+}
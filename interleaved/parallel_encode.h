@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "codegen_runtime.h"
+#include "data_writer.h"
+#include "meta_writer.h"
+#include "worker_pool.h"
+
+/// Parallel encoding for long runs of submessages (large repeated
+/// message or group fields).
+///
+/// Each thread encodes a contiguous share of the run's submessages as
+/// top-level messages, into its own buffers.  A top-level `FieldClose`
+/// has the same layout as a `FieldSeparate` (a folded width, then the
+/// message's data size), so once every thread is done, the chunks are
+/// stitched into the run by rewriting the opcode of each submessage's
+/// `FieldClose` but the last, and replacing the last one with the
+/// run's `FieldClose`.  The data streams are concatenated.
+///
+/// The stitched run decodes to the same submessages as `EncodeRun`'s,
+/// but its first field is never folded in the `OpenField`.
+namespace codegen {
+/// How the generated `EncodeFields` splits repeated submessage fields
+/// across threads.
+struct ParallelOptions {
+  /// Workers for each run, including the calling thread: up to one
+  /// chunk each.  nullptr encodes on the calling thread alone.
+  WorkerPool *pool{nullptr};
+
+  /// Fewest submessages per thread: shorter runs use fewer threads,
+  /// or are encoded by the calling thread alone.
+  size_t min_chunk{32};
+};
+
+/// Options for one thread, as the sequential `EncodeFields` uses.
+inline constexpr ParallelOptions kSequential{};
+
+/// One thread's share of a run: consecutive submessages, each encoded
+/// as a top-level message.
+struct EncodedChunk {
+  EncodedChunk() : meta(256), data(1024) {}
+
+  MetaWriter meta;
+  DataWriter data;
+
+  /// Offset right after each submessage's `FieldClose` in `meta`.
+  std::vector<size_t> ends;
+};
+
+/// Turns the `FieldClose` of each submessage in `chunk` into a
+/// `FieldSeparate`, except for the last submessage of the run
+/// (`last`), whose `FieldClose` is cut off.
+///
+/// Returns the number of metadata bytes to splice, and sets
+/// `trailing_width` to the width folded in the cut `FieldClose`.
+size_t StitchChunk(EncodedChunk *chunk, bool last, uint8_t *trailing_width);
+
+/// Writes the run of submessages for `field` (with a size hint of
+/// `count`) from `chunks`, in order.
+template <typename Meta, typename Data>
+void SpliceRun(Meta *meta, Data *data, uint32_t field, size_t count,
+               std::vector<EncodedChunk> *chunks) {
+  size_t run_begin = data->buf.written();
+
+  meta->open(field, (count < (1UL << 28)) ? count : 0);
+  for (size_t i = 0; i < chunks->size(); i++) {
+    EncodedChunk &chunk = (*chunks)[i];
+    uint8_t trailing_width;
+    size_t size = StitchChunk(&chunk, i + 1 == chunks->size(),
+                              &trailing_width);
+    size_t data_size = chunk.data.buf.written();
+
+    meta->splice(chunk.meta.base.buf.data(), size, trailing_width);
+    memcpy(data->buf.reserve(data_size), chunk.data.buf.data(), data_size);
+    data->buf.commit(data_size);
+  }
+
+  meta->close(data->buf.written() - run_begin);
+  return;
+}
+
+/// Writes the run of submessages for repeated `field`, like
+/// `EncodeRun` with `EncodeFields` for each element, but on up to
+/// `options.pool->size()` workers.
+template <typename T, typename Meta, typename Data>
+void EncodeRunParallel(Meta *meta, Data *data, uint32_t field,
+                       const std::vector<T> &elements,
+                       const ParallelOptions &options) {
+  size_t count = elements.size();
+  size_t num_chunks = 1;
+
+  if (options.pool != nullptr) {
+    num_chunks = count / std::max<size_t>(options.min_chunk, 1);
+    num_chunks = std::min(num_chunks, options.pool->size());
+  }
+
+  // Writers without `splice` (the split-literal encoding) always
+  // encode sequentially.
+  constexpr bool kSplice =
+      requires(Meta *writer) { writer->splice(nullptr, 0, 0); };
+
+  if (!kSplice || num_chunks <= 1) {
+    EncodeRun(meta, data, field, true, count,
+              [&](size_t i) { EncodeFields(elements[i], meta, data); });
+    return;
+  }
+
+  std::vector<EncodedChunk> chunks(num_chunks);
+  auto encode_chunk = [&](size_t c) {
+    EncodedChunk &chunk = chunks[c];
+
+    for (size_t i = count * c / num_chunks; i < count * (c + 1) / num_chunks;
+         i++) {
+      size_t begin = chunk.data.buf.written();
+
+      EncodeFields(elements[i], &chunk.meta, &chunk.data);
+      chunk.meta.close(chunk.data.buf.written() - begin);
+      chunk.ends.push_back(chunk.meta.base.buf.written());
+    }
+  };
+
+  options.pool->run(num_chunks, encode_chunk);
+
+  if constexpr (kSplice) SpliceRun(meta, data, field, count, &chunks);
+  return;
+}
+
+/// Writes `message` as a top-level message, like `EncodeMessage`, with
+/// its repeated submessage fields encoded by `EncodeRunParallel`.
+/// Nested runs are encoded sequentially, by their thread.
+template <typename T>
+void EncodeMessageParallel(const T &message, MetaWriter *meta,
+                           DataWriter *data, const ParallelOptions &options) {
+  size_t begin = data->buf.written();
+
+  EncodeFields(message, meta, data, options);
+  meta->close(data->buf.written() - begin);
+  return;
+}
+}  // namespace codegen
+
+/// Stitches hand-written chunks, and checks them against a sequential
+/// run.
+void ParallelEncodeSelfTest();
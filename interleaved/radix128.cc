@@ -0,0 +1,231 @@
+#include "radix128.h"
+
+#include <assert.h>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef RADIX128_X86
+#include <cpuid.h>
+#endif
+
+namespace {
+using radix128_internal::kLow64;
+
+/// The original shift and mask sequence: split the value in 14-bit
+/// halves, then each half in 7-bit quarters, with a branch to skip
+/// the high 28 bits when they're zero.
+uint32_t shift_expand_32(uint32_t x) {
+  assert(x < (1UL << 28));
+  uint32_t high_half = (x & (-1UL << 14));
+  uint32_t low_half = x & ((1UL << 14) - 1);
+
+  x = (high_half << 2) | low_half;
+
+  uint32_t low_mask = (127UL << 16) | 127;
+  uint32_t high_quarters = x & ~low_mask;
+  /* Shift the high quarters left by one bit. */
+  x += high_quarters;
+  return x;
+}
+
+uint64_t shift_expand_64(uint64_t x) {
+  assert(x < (1UL << 56));
+  uint64_t high_half = x & (-1ULL << 28);
+
+  if (__builtin_expect(high_half == 0, 1)) {
+    return shift_expand_32(x);
+  }
+
+  uint64_t low_half = x & ((1ULL << 28) - 1);
+  high_half = shift_expand_32(high_half >> 28);
+  low_half = shift_expand_32(low_half);
+  return (high_half << 32) | low_half;
+}
+
+uint32_t shift_compress_32(uint32_t x) {
+  uint32_t low_mask = (127UL << 16) | 127;
+
+  /* Shift the high quarters right by one bit. */
+  x = (x & low_mask) | ((x & ~low_mask) >> 1);
+  return (x & ((1UL << 14) - 1)) | ((x >> 2) & (-1UL << 14));
+}
+
+uint64_t shift_compress_64(uint64_t x) {
+  uint64_t high_half = x >> 32;
+
+  if (__builtin_expect(high_half == 0, 1)) {
+    return shift_compress_32(x);
+  }
+
+  return ((uint64_t)shift_compress_32(high_half) << 28) |
+         shift_compress_32((uint32_t)x);
+}
+
+uint64_t swar_expand_64(uint64_t x) {
+  assert(x < (1UL << 56));
+  return radix128_internal::swar_expand_64(x);
+}
+
+uint32_t swar_expand_32(uint32_t x) { return swar_expand_64(x); }
+
+uint64_t swar_compress_64(uint64_t x) {
+  return radix128_internal::swar_compress_64(x);
+}
+
+#ifdef RADIX128_X86
+__attribute__((target("bmi2"))) uint32_t pdep_expand_32(uint32_t x) {
+  assert(x < (1UL << 28));
+  return radix128_internal::pdep_expand_32(x);
+}
+
+__attribute__((target("bmi2"))) uint64_t pdep_expand_64(uint64_t x) {
+  assert(x < (1UL << 56));
+  return radix128_internal::pdep_expand_64(x);
+}
+
+__attribute__((target("bmi2"))) uint64_t pext_compress_64(uint64_t x) {
+  return radix128_internal::pext_compress_64(x);
+}
+#endif
+
+enum ImplIndex : size_t {
+  kSwar = 0,
+  kShift,
+#ifdef RADIX128_X86
+  kPdep,
+#endif
+  kNumImpls,
+};
+
+constexpr Radix128Impl kImpls[kNumImpls] = {
+    [kSwar] = {"swar", swar_expand_32, swar_expand_64, swar_compress_64},
+    [kShift] = {"shift", shift_expand_32, shift_expand_64, shift_compress_64},
+#ifdef RADIX128_X86
+    [kPdep] = {"pdep", pdep_expand_32, pdep_expand_64, pext_compress_64},
+#endif
+};
+
+/// Returns true if the CPU has BMI2.
+bool has_bmi2() {
+#ifdef RADIX128_X86
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2");
+#else
+  return false;
+#endif
+}
+
+/// Returns true if PDEP/PEXT are fast: AMD only made them fast with
+/// Zen 3 (family 19h).
+bool has_fast_bmi2() {
+#ifdef RADIX128_X86
+  unsigned int eax, ebx, ecx, edx;
+
+  if (!has_bmi2()) return false;
+  if (!__builtin_cpu_is("amd")) return true;
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) return false;
+
+  unsigned int family = (eax >> 8) & 0xF;
+  if (family == 0xF) family += (eax >> 20) & 0xFF;
+
+  return family >= 0x19;
+#else
+  return false;
+#endif
+}
+
+/// Number of entries in `kImpls` the CPU supports: the PDEP
+/// implementation is last.
+size_t num_supported() {
+#ifdef RADIX128_X86
+  return has_bmi2() ? kNumImpls : kPdep;
+#else
+  return kNumImpls;
+#endif
+}
+
+/// Picks the default implementation before `main`.  `radix128` is
+/// constant-initialised to the portable implementation, so it's
+/// always safe to use, even in static initialisers.
+__attribute__((constructor)) void select_default() {
+  const char *name = getenv("RADIX128");
+
+  if (name != nullptr && Radix128Select(name)) return;
+
+#ifdef RADIX128_X86
+  if (has_fast_bmi2()) Radix128Select("pdep");
+#endif
+  return;
+}
+}  // namespace
+
+const Radix128Impl *radix128 = &kImpls[kSwar];
+bool radix128_internal::use_pdep = false;
+
+const Radix128Impl *Radix128Impls(size_t *count) {
+  *count = num_supported();
+  return kImpls;
+}
+
+bool Radix128Select(const char *name) {
+  size_t count = num_supported();
+
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(kImpls[i].name, name) == 0) {
+      radix128 = &kImpls[i];
+#ifdef RADIX128_X86
+      radix128_internal::use_pdep = i == kPdep;
+#endif
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void Radix128SelfTest() {
+  size_t count;
+  const Radix128Impl *impls = Radix128Impls(&count);
+  const char *selected = radix128->name;
+
+  assert(count >= 2);
+  for (size_t i = 0; i < count; i++) {
+    const Radix128Impl &impl = impls[i];
+    bool ok = Radix128Select(impl.name);
+
+    (void)ok;
+    assert(ok && radix128 == &impl);
+
+    for (size_t bit = 0; bit < 56; bit++) {
+      const uint64_t values[] = {
+          1ULL << bit,
+          (1ULL << bit) - 1,
+          ((1ULL << bit) - 1) ^ 0x5555555555555ULL,
+      };
+
+      for (uint64_t value : values) {
+        value &= (1ULL << 56) - 1;
+
+        uint64_t expanded = impl.expand_64(value);
+        (void)expanded;
+        assert((expanded & ~kLow64) == 0);
+        assert(expanded == swar_expand_64(value));
+        assert(impl.compress_64(expanded) == value);
+
+        // The inline conversions follow the selection.
+        assert(Radix128Expand64(value) == expanded);
+        assert(Radix128Compress64(expanded) == value);
+
+        if (value < (1ULL << 28)) {
+          assert(impl.expand_32(value) == expanded);
+          assert(Radix128Expand32(value) == expanded);
+        }
+      }
+    }
+  }
+
+  Radix128Select(selected);
+  assert(!Radix128Select("no such implementation"));
+  assert(strcmp(radix128->name, selected) == 0);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RADIX128_X86 1
+#endif
+
+/// Conversions between binary integers and radix-128 literal bytes
+/// (7 bits per byte, little-endian, top bit of each byte left clear).
+///
+/// PDEP/PEXT do this in one instruction, but they're microcoded (and
+/// slow) on AMD before Zen 3, and absent on other ISAs.  Each
+/// `Radix128Impl` is one way to implement the conversions, and one of
+/// them is selected at startup for the current CPU.
+///
+/// The metadata writers and readers don't call through the table:
+/// `Radix128Expand32`, `Radix128Expand64` and `Radix128Compress64`
+/// below inline both PDEP/PEXT and the SWAR ladder, and branch on the
+/// selection, so the hot paths pay a predictable branch rather than an
+/// indirect call, and constant arguments still fold.
+struct Radix128Impl {
+  /// Short name, for benchmark reports and the `RADIX128` override.
+  const char *name;
+
+  /// Encodes a value in [0, 2^28 - 1] to 4 radix-128 bytes.
+  uint32_t (*expand_32)(uint32_t);
+
+  /// Encodes a value in [0, 2^56 - 1] to 8 radix-128 bytes.
+  uint64_t (*expand_64)(uint64_t);
+
+  /// Decodes up to 8 radix-128 bytes (top bits already cleared) to a
+  /// value in [0, 2^56 - 1].
+  uint64_t (*compress_64)(uint64_t);
+};
+
+/// The implementation selected for this process.
+///
+/// The selection defaults to PDEP/PEXT ("pdep") on CPUs with fast
+/// BMI2 (Intel since Haswell, AMD since Zen 3), and to the branch-free
+/// mask-and-shift ladder ("swar") otherwise.  Setting the `RADIX128`
+/// environment variable to an implementation name forces that
+/// implementation, if the CPU supports it.  The inline conversions
+/// below follow it between PDEP/PEXT and SWAR; "shift" is only there
+/// for comparison, and they use SWAR for it.
+extern const Radix128Impl *radix128;
+
+/// Returns the array of implementations that the current CPU
+/// supports, and stores its size in `count`.
+const Radix128Impl *Radix128Impls(size_t *count);
+
+/// Makes the implementation called `name` the current `radix128`.
+///
+/// Returns false (and leaves `radix128` unchanged) if there is no
+/// such implementation for this CPU.
+bool Radix128Select(const char *name);
+
+namespace radix128_internal {
+constexpr uint32_t kLow32 = 127 * (UINT32_MAX / 255);
+constexpr uint64_t kLow64 = 127 * (UINT64_MAX / 255);
+
+/// True if `radix128` is the PDEP/PEXT implementation.
+extern bool use_pdep;
+
+/// Branch-free ladder: move 28-bit halves to 32-bit lanes, then
+/// 14-bit quarters to 16-bit lanes, and 7-bit eighths to bytes (or the
+/// reverse).
+inline uint64_t swar_expand_64(uint64_t x) {
+  x = ((x & 0x00FFFFFFF0000000ULL) << 4) | (x & 0x000000000FFFFFFFULL);
+  x = ((x & 0x0FFFC0000FFFC000ULL) << 2) | (x & 0x00003FFF00003FFFULL);
+  x = ((x & 0x3F803F803F803F80ULL) << 1) | (x & 0x007F007F007F007FULL);
+  return x;
+}
+
+inline uint32_t swar_expand_32(uint32_t x) { return swar_expand_64(x); }
+
+inline uint64_t swar_compress_64(uint64_t x) {
+  x = ((x & 0x7F007F007F007F00ULL) >> 1) | (x & 0x007F007F007F007FULL);
+  x = ((x & 0x3FFF00003FFF0000ULL) >> 2) | (x & 0x00003FFF00003FFFULL);
+  x = ((x & 0x0FFFFFFF00000000ULL) >> 4) | (x & 0x000000000FFFFFFFULL);
+  return x;
+}
+
+#ifdef RADIX128_X86
+// Built for BMI2 whatever the target: these only inline into callers
+// built for BMI2 (e.g., with `-march=native`), and are direct calls
+// otherwise.
+__attribute__((target("bmi2"))) inline uint32_t pdep_expand_32(uint32_t x) {
+  return _pdep_u32(x, kLow32);
+}
+
+__attribute__((target("bmi2"))) inline uint64_t pdep_expand_64(uint64_t x) {
+  return _pdep_u64(x, kLow64);
+}
+
+__attribute__((target("bmi2"))) inline uint64_t pext_compress_64(uint64_t x) {
+  return _pext_u64(x, kLow64);
+}
+#endif
+}  // namespace radix128_internal
+
+/// Encodes a value in [0, 2^28 - 1] to 4 radix-128 bytes, with
+/// PDEP if it's selected, and the SWAR ladder otherwise.
+inline uint32_t Radix128Expand32(uint32_t x) {
+#ifdef RADIX128_X86
+  if (__builtin_expect(radix128_internal::use_pdep, 1))
+    return radix128_internal::pdep_expand_32(x);
+#endif
+  return radix128_internal::swar_expand_32(x);
+}
+
+/// Encodes a value in [0, 2^56 - 1] to 8 radix-128 bytes.
+inline uint64_t Radix128Expand64(uint64_t x) {
+#ifdef RADIX128_X86
+  if (__builtin_expect(radix128_internal::use_pdep, 1))
+    return radix128_internal::pdep_expand_64(x);
+#endif
+  return radix128_internal::swar_expand_64(x);
+}
+
+/// Decodes up to 8 radix-128 bytes (top bits already cleared).
+inline uint64_t Radix128Compress64(uint64_t x) {
+#ifdef RADIX128_X86
+  if (__builtin_expect(radix128_internal::use_pdep, 1))
+    return radix128_internal::pext_compress_64(x);
+#endif
+  return radix128_internal::swar_compress_64(x);
+}
+
+void Radix128SelfTest();
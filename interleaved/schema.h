@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Runtime descriptions of protobuf messages, for code that works on
+/// any message type (e.g., the protobuf transcoder in `transcode.h`).
+/// `splitc` generates one `MessageSchema` per message.
+
+/// How a field is represented, in protobuf and in the split format.
+enum class FieldKind : uint8_t {
+  /// Integers and enums: protobuf varints, and `DataWriter::varint`s.
+  /// Negative values are sign extended to 64 bits.
+  Varint,
+  /// A varint in protobuf, and one byte in the data stream.
+  Bool,
+  /// `fixed32` and `sfixed32`: 4 bytes.
+  Fixed32,
+  /// `fixed64` and `sfixed64`: 8 bytes.
+  Fixed64,
+  /// `float`: 4 bytes, like `Fixed32` except in text formats.
+  Float,
+  /// `double`: 8 bytes, like `Fixed64` except in text formats.
+  Double,
+  /// `string` and `bytes`.
+  Bytes,
+  /// A length-delimited submessage in protobuf.
+  Message,
+  /// A group (delimited by start and end tags) in protobuf.
+  Group,
+};
+
+struct MessageSchema;
+
+struct FieldSchema {
+  uint32_t number;
+  FieldKind kind;
+  bool repeated;
+  /// The submessage's schema for `Message` and `Group` fields, and
+  /// nullptr otherwise.
+  const MessageSchema *message;
+};
+
+struct MessageSchema {
+  /// Returns the schema for field `number`, or nullptr if the message
+  /// has no such field.
+  inline const FieldSchema *find(uint32_t number) const {
+    if (__builtin_expect(number < index_size, 1))
+      return (index[number] == 0) ? nullptr : &fields[index[number] - 1];
+
+    size_t begin = 0;
+    size_t end = count;
+    while (begin < end) {
+      size_t mid = begin + (end - begin) / 2;
+
+      if (fields[mid].number == number) return &fields[mid];
+      if (fields[mid].number < number) {
+        begin = mid + 1;
+      } else {
+        end = mid;
+      }
+    }
+
+    return nullptr;
+  }
+
+  const char *name;
+
+  /// The fields, sorted by number.
+  const FieldSchema *fields;
+  size_t count;
+
+  /// `index[number]` is 1 + the position of field `number` in
+  /// `fields`, or 0 if there's no such field.  `find` binary searches
+  /// `fields` for numbers at or above `index_size`.
+  const uint16_t *index;
+  size_t index_size;
+};
@@ -0,0 +1,261 @@
+#include "split_literal_meta.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+namespace {
+/// `MetaReader::literal_bytes` for each opcode byte with bit 4 (the
+/// high bit of the second immediate) clear, then set: `pshufb` only
+/// looks at the low 4 bits of each index.
+template <size_t kHigh>
+constexpr uint8_t kLiteralTable[16] = {
+#define L(i) (uint8_t)MetaReader::literal_bytes(16 * kHigh + i)
+    L(0), L(1), L(2),  L(3),  L(4),  L(5),  L(6),  L(7),
+    L(8), L(9), L(10), L(11), L(12), L(13), L(14), L(15),
+#undef L
+};
+}  // namespace
+
+bool SplitLiteralMetaReader::refill() {
+  if (op_ == ops_size_) return false;
+
+  size_t count = std::min(kBlock, ops_size_ - op_);
+  const uint8_t *ops = ops_ + op_;
+  size_t total = 0;
+
+#if defined(__SSSE3__)
+  if (count == kBlock) {
+    __m128i v = _mm_loadu_si128((const __m128i *)ops);
+
+    // Literal tag bits can't be in the opcode stream.
+    if (_mm_movemask_epi8(v) != 0) return false;
+
+    __m128i high = _mm_cmpeq_epi8(_mm_and_si128(v, _mm_set1_epi8(16)),
+                                  _mm_set1_epi8(16));
+    __m128i low_lengths = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i *)kLiteralTable<0>), v);
+    __m128i high_lengths = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i *)kLiteralTable<1>), v);
+    __m128i lengths = _mm_or_si128(_mm_andnot_si128(high, low_lengths),
+                                   _mm_and_si128(high, high_lengths));
+
+    // Inclusive prefix sum of the lengths (at most 16 * 8 = 128, so
+    // bytes don't overflow), then exclusive offsets.
+    __m128i sums = _mm_add_epi8(lengths, _mm_slli_si128(lengths, 1));
+
+    sums = _mm_add_epi8(sums, _mm_slli_si128(sums, 2));
+    sums = _mm_add_epi8(sums, _mm_slli_si128(sums, 4));
+    sums = _mm_add_epi8(sums, _mm_slli_si128(sums, 8));
+    _mm_storeu_si128((__m128i *)offsets_, _mm_sub_epi8(sums, lengths));
+    total = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(sums, 12)) >> 24;
+  } else
+#endif
+  {
+    for (size_t i = 0; i < count; i++) {
+      if (ops[i] > 127) return false;
+
+      offsets_[i] = (uint8_t)total;
+      total += MetaReader::literal_bytes(ops[i]);
+    }
+  }
+
+  if (total > literals_size_ - block_literal_end_) return false;
+
+  block_begin_ = op_;
+  block_end_ = op_ + count;
+  block_literal_ = block_literal_end_;
+  block_literal_end_ += total;
+  return true;
+}
+
+bool SplitLiteralMetaReader::skip_run(uint64_t *run_size) {
+  size_t depth = 0;
+  size_t literal = (op_ < block_end_)
+                       ? block_literal_ + offsets_[op_ - block_begin_]
+                       : block_literal_end_;
+
+  for (size_t op = op_; op < ops_size_; op++) {
+    uint8_t byte = ops_[op];
+
+    if (byte > 127) return false;
+
+    Opcode code = (Opcode)(byte % 8);
+    if (code == Opcode::OpenField) {
+      depth++;
+    } else if (code == Opcode::FieldClose) {
+      if (depth == 0) {
+        MetaInstruction insn;
+
+        // Restart the blocks at the close.
+        op_ = block_end_ = op;
+        block_literal_end_ = literal;
+        if (!next(&insn)) return false;
+
+        *run_size = insn.literal;
+        return true;
+      }
+
+      depth--;
+    }
+
+    literal += MetaReader::literal_bytes(byte);
+  }
+
+  return false;
+}
+
+namespace {
+/// Emits the same instructions with either encoding.
+template <typename Writer>
+void WriteInstructions(Writer *writer) {
+  const uint32_t zeroable[] = {0, 1, 127, 128, 255, 256, 16383, 65535, 65536,
+                               (1UL << 28) - 1};
+  const uint64_t nonzero[] = {0, 1, 255, 256, 65535, 65536,
+                              (1ULL << 32) - 1, 1ULL << 32,
+                              (1ULL << 56) - 1};
+
+  for (uint32_t value : zeroable) {
+    writer->skip(value);
+    writer->open_field(value, 2);
+  }
+
+  for (uint64_t value : nonzero) {
+    writer->field_n(4, value);
+    writer->field_separate(1, value);
+  }
+
+  writer->one_field(3, 8);
+  writer->two_fields(1, 4);
+  writer->run_fields(2, 3);
+  writer->run_fields(8, 1000);
+  for (uint32_t i = 0; i < 40; i++) writer->skip_one_field(i, 1);
+  writer->field_close(0, 10);
+}
+
+std::vector<MetaInstruction> ReadAll(MetaReader *reader) {
+  std::vector<MetaInstruction> ret;
+  MetaInstruction insn;
+
+  while (reader->next(&insn)) ret.push_back(insn);
+  assert(reader->done());
+  return ret;
+}
+
+std::vector<MetaInstruction> ReadAll(SplitLiteralMetaReader *reader) {
+  std::vector<MetaInstruction> ret;
+  MetaInstruction insn;
+
+  while (reader->next(&insn)) ret.push_back(insn);
+  assert(reader->done());
+  return ret;
+}
+}  // namespace
+
+void SplitLiteralMetaReader::SelfTest() {
+  BaseMetaWriter interleaved(16);
+  SplitLiteralBaseMetaWriter split(16);
+
+  WriteInstructions(&interleaved);
+  WriteInstructions(&split);
+
+  MetaReader interleaved_reader(interleaved.buf.data(),
+                                interleaved.buf.written());
+  SplitLiteralMetaReader split_reader(split.buf.data(), split.buf.written(),
+                                      split.literals.data(),
+                                      split.literals.written());
+  std::vector<MetaInstruction> expected = ReadAll(&interleaved_reader);
+  std::vector<MetaInstruction> actual = ReadAll(&split_reader);
+
+  // The second immediate is a literal width, except in `OneField`
+  // and `TwoFields`, and literal widths differ between encodings.
+  assert(actual.size() == expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    bool literal_width = expected[i].op != Opcode::OneField &&
+                         expected[i].op != Opcode::TwoFields;
+
+    (void)literal_width;
+    assert(actual[i].op == expected[i].op &&
+           actual[i].imm1 == expected[i].imm1 &&
+           (literal_width || actual[i].imm2 == expected[i].imm2) &&
+           actual[i].literal == expected[i].literal);
+  }
+
+  // Every prefix of the opcode stream, so blocks end everywhere.
+  for (size_t size = 0; size <= split.buf.written(); size++) {
+    SplitLiteralMetaReader prefix(split.buf.data(), size,
+                                  split.literals.data(),
+                                  split.literals.written());
+    MetaInstruction insn;
+    size_t count = 0;
+
+    while (prefix.next(&insn)) count++;
+    (void)count;
+    assert(count == size && prefix.done() == (size == split.buf.written()));
+  }
+
+  // Truncated literals, and a literal tag bit in the opcode stream.
+  {
+    SplitLiteralMetaReader truncated(split.buf.data(), split.buf.written(),
+                                     split.literals.data(),
+                                     split.literals.written() - 1);
+    MetaInstruction insn;
+
+    while (truncated.next(&insn)) {
+    }
+
+    assert(!truncated.done());
+
+    std::vector<uint8_t> ops(40, (uint8_t)Opcode::TwoFields);
+
+    ops[20] = 128;
+    for (size_t size : {ops.size(), (size_t)21}) {
+      SplitLiteralMetaReader tagged(ops.data(), size, nullptr, 0);
+      size_t count = 0;
+
+      while (tagged.next(&insn)) count++;
+      (void)count;
+      assert(count == 16 && !tagged.done());
+    }
+  }
+
+  // `skip_run` from within a block and across blocks, through the
+  // peephole writer.
+  {
+    SplitLiteralMetaWriter writer(16);
+
+    writer.field(1, 4);
+    writer.open(2, 3);
+    for (size_t i = 0; i < 3; i++) {
+      if (i > 0) writer.separate(100 * i);
+      writer.open(1, 0);
+      for (uint32_t field = 1; field <= 20; field += 2) writer.field(field, 1);
+      writer.close(10);
+    }
+
+    writer.close(1000);
+    writer.field(3, 2);
+    writer.close(1006);
+
+    SplitLiteralMetaReader reader(writer.base.buf.data(),
+                                  writer.base.buf.written(),
+                                  writer.base.literals.data(),
+                                  writer.base.literals.written());
+    MetaInstruction insn;
+    uint64_t run_size = 0;
+
+    (void)insn;
+    (void)run_size;
+    assert(reader.next(&insn) && insn.op == Opcode::OneField);
+    assert(reader.next(&insn) && insn.op == Opcode::OpenField &&
+           insn.literal == 3);
+    assert(reader.skip_run(&run_size) && run_size == 1000);
+    assert(reader.next(&insn) && insn.op == Opcode::FieldClose &&
+           insn.literal == 1006);
+    assert(!reader.next(&insn) && reader.done());
+  }
+}
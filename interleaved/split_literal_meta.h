@@ -0,0 +1,354 @@
+#pragma once
+
+#include <assert.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "base_meta_writer.h"
+#include "meta_reader.h"
+#include "meta_writer.h"
+#include "opcode.h"
+#include "write_buffer.h"
+
+/// The split-literal metadata encoding: the same instructions as the
+/// interleaved encoding (see `opcode.h`), with the same opcode bytes,
+/// but the literals go to a second stream, as plain little-endian
+/// bytes instead of radix-128 ones.
+///
+/// The number of literal bytes still only depends on the opcode byte
+/// (`MetaReader::literal_bytes`), so a reader finds every opcode
+/// without looking at the literals, and finds every literal with a
+/// prefix sum of the opcodes' literal lengths.  Literal bytes hold 8
+/// bits instead of 7, so values also fit in fewer bytes.
+
+/// `SplitLiteralBaseMetaWriter`s emit instructions like
+/// `BaseMetaWriter`s, with the same methods, to two buffers: `buf` for
+/// opcode bytes, and `literals` for their literals.
+template <bool kChecked>
+struct BasicSplitLiteralBaseMetaWriter {
+  BasicSplitLiteralBaseMetaWriter() = delete;
+
+  BasicSplitLiteralBaseMetaWriter(WriteBuffer buf_, WriteBuffer literals_)
+      : buf(std::move(buf_)), literals(std::move(literals_)) {}
+  explicit BasicSplitLiteralBaseMetaWriter(size_t capacity)
+      : buf(capacity), literals(capacity) {}
+
+  BasicSplitLiteralBaseMetaWriter(const BasicSplitLiteralBaseMetaWriter &) =
+      delete;
+  BasicSplitLiteralBaseMetaWriter(BasicSplitLiteralBaseMetaWriter &&) =
+      default;
+  BasicSplitLiteralBaseMetaWriter &operator=(
+      const BasicSplitLiteralBaseMetaWriter &) = delete;
+  BasicSplitLiteralBaseMetaWriter &operator=(
+      BasicSplitLiteralBaseMetaWriter &&) = delete;
+
+  ~BasicSplitLiteralBaseMetaWriter() = default;
+
+  /// The instruction emitters, like `BaseMetaWriter`'s.
+  inline void skip(uint32_t num_skipped);
+  inline void one_field(uint8_t num_skipped, uint8_t data_width);
+  inline void skip_one_field(uint32_t num_skipped, uint8_t data_width);
+  inline void two_fields(uint8_t data_width1, uint8_t data_width2);
+  inline void open_field(uint32_t len_hint, uint8_t optional_data_width);
+  inline void field_close(uint8_t data_width, uint64_t sequence_size);
+  inline void field_separate(uint8_t data_width, uint64_t message_size);
+  inline void field_n(uint8_t optional_data_width, uint64_t data_size);
+  inline void run_fields(uint8_t data_width, uint32_t count);
+
+  static constexpr uint32_t kMinRunFields = BaseMetaWriter::kMinRunFields;
+  static constexpr uint32_t kMaxRunFields = BaseMetaWriter::kMaxRunFields;
+
+  /// Bytes emitted in both streams, like `BaseMetaWriter`'s.
+  static constexpr size_t skip_size(uint32_t num_skipped);
+  static constexpr size_t one_field_size(uint32_t num_skipped);
+  static constexpr size_t run_fields_size(uint32_t count);
+
+  /// Emits an opcode with two immediates in [0, 3].
+  inline void imm_imm(Opcode op, uint8_t imm1, uint8_t imm2);
+
+  /// Emits an opcode with one immediate in [0, 3], and a literal in
+  /// [0, 2^28 - 1] (like `BaseMetaWriter`, so both encodings take the
+  /// same values) in 0, 1, 2, or 4 bytes.
+  inline void imm_width(Opcode op, uint8_t imm1, uint32_t literal);
+
+  /// Emits an opcode with one immediate in [0, 3], and a literal in
+  /// [0, 2^56 - 1] in 1, 2, 4, or 8 bytes.
+  inline void imm_nonzero_width(Opcode op, uint8_t imm1, uint64_t literal);
+
+  /// Returns the number of bytes (0, 1, 2, or 4) for a literal of
+  /// `imm_width`.
+  static constexpr size_t zeroable_literal_size(uint32_t literal) {
+    return literal == 0 ? 0 : literal < (1UL << 8) ? 1
+                          : literal < (1UL << 16) ? 2
+                                                  : 4;
+  }
+
+  /// Largest `reserve` the emitters make, in either buffer.
+  static constexpr size_t kMaxReserve = 8;
+
+  WriteBuffer buf;
+  WriteBuffer literals;
+
+ private:
+  static inline void *reserve(WriteBuffer *buffer, size_t count) {
+    if constexpr (kChecked) {
+      return buffer->reserve(count);
+    } else {
+      return buffer->reserve_unchecked(count);
+    }
+  }
+};
+
+using SplitLiteralBaseMetaWriter = BasicSplitLiteralBaseMetaWriter<true>;
+
+/// The peephole `MetaWriter`, on top of the split-literal encoding.
+/// It has no `splice`: its instructions span two streams.
+using SplitLiteralMetaWriter =
+    BasicMetaWriter<true, BasicSplitLiteralBaseMetaWriter>;
+
+/// `SplitLiteralMetaReader`s decode a split-literal metadata stream,
+/// like `MetaReader`s (and for `Decode`), but 16 opcodes at a time: a
+/// block's literal lengths come from two `pshufb` table lookups, and
+/// its literal offsets from a SIMD prefix sum, with one bounds check
+/// for the whole block.
+struct SplitLiteralMetaReader {
+  SplitLiteralMetaReader() = delete;
+
+  /// Reads `ops_size` opcode bytes at `ops`, and `literals_size`
+  /// literal bytes at `literals`.  The bytes must outlive the reader.
+  SplitLiteralMetaReader(const void *ops, size_t ops_size,
+                         const void *literals, size_t literals_size)
+      : ops_((const uint8_t *)ops),
+        ops_size_(ops_size),
+        literals_((const uint8_t *)literals),
+        literals_size_(literals_size) {}
+
+  static void SelfTest();
+
+  /// Opcodes decoded per block.
+  static constexpr size_t kBlock = 16;
+
+  /// Decodes the next instruction into `out`.
+  ///
+  /// Returns false at the end of the streams, or if the next
+  /// instruction is malformed (`done()` distinguishes the two).
+  inline bool next(MetaInstruction *out);
+
+  /// Returns true once both streams have been consumed.
+  inline bool done() const {
+    return op_ == ops_size_ && block_literal_end_ == literals_size_;
+  }
+
+  /// Skips the rest of the run of submessages opened by the last
+  /// instruction, like `MetaReader::skip_run`.
+  bool skip_run(uint64_t *run_size);
+
+ private:
+  /// Decodes the literal offsets of the next block of opcodes, from
+  /// `op_`, whose literal is at `block_literal_end_`.
+  ///
+  /// Returns false at the end of the opcode stream, or if the block
+  /// has a literal tag bit set or needs more literal bytes than are
+  /// left.
+  bool refill();
+
+  const uint8_t *ops_;
+  size_t ops_size_;
+  const uint8_t *literals_;
+  size_t literals_size_;
+
+  /// The next opcode, and the current block: opcodes in
+  /// [block_begin_, block_end_), with literals from `block_literal_`
+  /// to `block_literal_end_`.
+  size_t op_{0};
+  size_t block_begin_{0};
+  size_t block_end_{0};
+  size_t block_literal_{0};
+  size_t block_literal_end_{0};
+  /// Offsets of each opcode's literal from `block_literal_`.
+  uint8_t offsets_[kBlock];
+};
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::skip(
+    uint32_t num_skipped) {
+  assert(num_skipped < (1UL << 28));
+
+  uint8_t low = (num_skipped < 4) ? num_skipped : 3;
+  num_skipped -= low;
+  imm_width(Opcode::SkipN, low, num_skipped);
+  return;
+}
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::one_field(
+    uint8_t num_skipped, uint8_t data_width) {
+  assert(num_skipped < 4);
+
+  imm_imm(Opcode::OneField, num_skipped,
+          BaseMetaWriter::immediate_for_nonzero_width(data_width));
+  return;
+}
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::skip_one_field(
+    uint32_t num_skipped, uint8_t data_width) {
+  if (num_skipped <= 3) {
+    one_field(num_skipped, data_width);
+  } else if (skip_size(num_skipped) == skip_size(num_skipped - 3)) {
+    skip(num_skipped);
+    one_field(0, data_width);
+  } else {
+    skip(num_skipped - 3);
+    one_field(3, data_width);
+  }
+
+  return;
+}
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::two_fields(
+    uint8_t data_width1, uint8_t data_width2) {
+  imm_imm(Opcode::TwoFields,
+          BaseMetaWriter::immediate_for_nonzero_width(data_width1),
+          BaseMetaWriter::immediate_for_nonzero_width(data_width2));
+  return;
+}
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::open_field(
+    uint32_t len_hint, uint8_t optional_data_width) {
+  imm_width(Opcode::OpenField,
+            BaseMetaWriter::immediate_for_zeroable_width(optional_data_width),
+            len_hint);
+  return;
+}
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::field_close(
+    uint8_t data_width, uint64_t sequence_size) {
+  imm_nonzero_width(Opcode::FieldClose,
+                    BaseMetaWriter::immediate_for_zeroable_width(data_width),
+                    sequence_size);
+  return;
+}
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::field_separate(
+    uint8_t data_width, uint64_t message_size) {
+  imm_nonzero_width(Opcode::FieldSeparate,
+                    BaseMetaWriter::immediate_for_zeroable_width(data_width),
+                    message_size);
+  return;
+}
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::field_n(
+    uint8_t optional_data_width, uint64_t data_size) {
+  imm_nonzero_width(
+      Opcode::FieldN,
+      BaseMetaWriter::immediate_for_zeroable_width(optional_data_width),
+      data_size);
+  return;
+}
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::run_fields(
+    uint8_t data_width, uint32_t count) {
+  assert(count >= kMinRunFields && count <= kMaxRunFields);
+
+  imm_width(Opcode::RunFields,
+            BaseMetaWriter::immediate_for_nonzero_width(data_width),
+            count - kMinRunFields);
+  return;
+}
+
+template <bool kChecked>
+constexpr size_t BasicSplitLiteralBaseMetaWriter<kChecked>::skip_size(
+    uint32_t num_skipped) {
+  if (num_skipped == 0) return 0;
+  return 1 + zeroable_literal_size(num_skipped -
+                                   (num_skipped < 3 ? num_skipped : 3));
+}
+
+template <bool kChecked>
+constexpr size_t BasicSplitLiteralBaseMetaWriter<kChecked>::one_field_size(
+    uint32_t num_skipped) {
+  return 1 + (num_skipped <= 3 ? 0 : skip_size(num_skipped - 3));
+}
+
+template <bool kChecked>
+constexpr size_t BasicSplitLiteralBaseMetaWriter<kChecked>::run_fields_size(
+    uint32_t count) {
+  return 1 + zeroable_literal_size(count - kMinRunFields);
+}
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::imm_imm(Opcode op,
+                                                               uint8_t imm1,
+                                                               uint8_t imm2) {
+  assert(imm1 < 4);
+  assert(imm2 < 4);
+
+  uint8_t encoded = (uint8_t)op | (imm2 << 3) | (imm1 << 5);
+  memcpy(reserve(&buf, 1), &encoded, 1);
+  buf.commit(1);
+  return;
+}
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::imm_width(
+    Opcode op, uint8_t imm1, uint32_t literal) {
+  assert(literal < (1UL << 28));
+
+  size_t width = zeroable_literal_size(literal);
+  uint64_t wide = literal;
+
+  // 0, 1, 2, 4 bytes map to immediates 0, 1, 2, 3.
+  imm_imm(op, imm1, width - width / 4);
+  memcpy(reserve(&literals, sizeof(wide)), &wide, sizeof(wide));
+  literals.commit(width);
+  return;
+}
+
+template <bool kChecked>
+inline void BasicSplitLiteralBaseMetaWriter<kChecked>::imm_nonzero_width(
+    Opcode op, uint8_t imm1, uint64_t literal) {
+  assert(literal < (1ULL << 56));
+
+  // Bytes needed, rounded up to 1, 2, 4, or 8: immediates 0 to 3.
+  size_t bits = 64 - __builtin_clzll(literal | 1);
+  uint8_t imm2 = (bits <= 8) ? 0 : (bits <= 16) ? 1 : (bits <= 32) ? 2 : 3;
+
+  imm_imm(op, imm1, imm2);
+  memcpy(reserve(&literals, sizeof(literal)), &literal, sizeof(literal));
+  literals.commit((size_t)1 << imm2);
+  return;
+}
+
+inline bool SplitLiteralMetaReader::next(MetaInstruction *out) {
+  if (__builtin_expect(op_ == block_end_, 0) && !refill()) return false;
+
+  uint8_t byte = ops_[op_];
+  size_t count = MetaReader::literal_bytes(byte);
+  size_t offset = block_literal_ + offsets_[op_ - block_begin_];
+  uint64_t literal = 0;
+
+  // `refill` checked that the block's literals are in bounds.
+  if (count > 0) {
+    if (literals_size_ - offset >= sizeof(literal)) {
+      memcpy(&literal, literals_ + offset, sizeof(literal));
+      literal &= UINT64_MAX >> (64 - 8 * count);
+    } else {
+      memcpy(&literal, literals_ + offset, count);
+    }
+  }
+
+  out->op = (Opcode)(byte % 8);
+  out->imm1 = byte >> 5;
+  out->imm2 = (byte >> 3) % 4;
+  out->literal = literal;
+  op_++;
+  return true;
+}
@@ -0,0 +1,930 @@
+/// `splitc` reads a proto2 `.proto` schema and writes C++ structs,
+/// encoders, and decoders for the split metadata/data format.
+///
+///   $ ./splitc ../benchmark_message1_proto2.proto benchmark_message1_proto2
+///
+/// writes `benchmark_message1_proto2.split.h` and
+/// `benchmark_message1_proto2.split.cc`.  The generated code uses
+/// `codegen_runtime.h`, and `message_view.h` for the views.
+///
+/// The parser only understands the subset of proto2 needed for
+/// message definitions: messages (nested or not), groups, enums,
+/// scalar, string and message fields, and `[default = ...]`.  Other
+/// statements (`option`, `import`, ...) and field options are
+/// ignored.
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+[[noreturn]] void Fail(const std::string &message) {
+  std::cerr << "splitc: " << message << "\n";
+  exit(1);
+}
+
+/// Splits a `.proto` file into identifiers (including dotted names),
+/// numbers, string literals (with their quotes), and single character
+/// punctuation.  Comments are dropped.
+std::vector<std::string> Tokenize(const std::string &text) {
+  std::vector<std::string> tokens;
+  size_t i = 0;
+
+  while (i < text.size()) {
+    char c = text[i];
+
+    if (isspace((unsigned char)c)) {
+      i++;
+    } else if (text.compare(i, 2, "//") == 0) {
+      while (i < text.size() && text[i] != '\n') i++;
+    } else if (text.compare(i, 2, "/*") == 0) {
+      size_t end = text.find("*/", i + 2);
+
+      if (end == std::string::npos) Fail("unterminated comment");
+      i = end + 2;
+    } else if (c == '"' || c == '\'') {
+      size_t begin = i++;
+
+      while (i < text.size() && text[i] != c) i += (text[i] == '\\') ? 2 : 1;
+      if (i >= text.size()) Fail("unterminated string");
+      i++;
+      // Normalise to double quotes for C++.
+      tokens.push_back("\"" + text.substr(begin + 1, i - begin - 2) + "\"");
+    } else if (isalnum((unsigned char)c) || c == '_' || c == '.' ||
+               c == '-' || c == '+') {
+      size_t begin = i;
+
+      while (i < text.size() &&
+             (isalnum((unsigned char)text[i]) || text[i] == '_' ||
+              text[i] == '.' || text[i] == '-' || text[i] == '+'))
+        i++;
+      tokens.push_back(text.substr(begin, i - begin));
+    } else {
+      tokens.push_back(std::string(1, c));
+      i++;
+    }
+  }
+
+  return tokens;
+}
+
+enum class Label { Optional, Required, Repeated };
+
+struct Field {
+  Label label;
+  /// The type as written in the schema: a scalar type name, or a
+  /// message, group, or enum name.
+  std::string type;
+  std::string name;
+  uint32_t number;
+  /// The `[default = ...]` value, if any.
+  std::string default_value;
+  /// The C++ name of the message (or group) type, empty for scalars
+  /// and enums.
+  std::string message;
+};
+
+struct Message {
+  /// C++ name: nested types are `Outer_Inner`, like protoc's.
+  std::string name;
+  std::vector<Field> fields;
+};
+
+struct Schema {
+  std::string package;
+  std::vector<Message> messages;
+  /// Enum name (C++ name) -> value name -> number.
+  std::map<std::string, std::map<std::string, std::string>> enums;
+};
+
+struct Parser {
+  explicit Parser(std::vector<std::string> tokens_)
+      : tokens(std::move(tokens_)) {}
+
+  bool at_end() const { return pos == tokens.size(); }
+
+  const std::string &peek() const {
+    if (at_end()) Fail("unexpected end of file");
+    return tokens[pos];
+  }
+
+  std::string take() {
+    const std::string &ret = peek();
+
+    pos++;
+    return ret;
+  }
+
+  void expect(const std::string &token) {
+    std::string actual = take();
+
+    if (actual != token) Fail("expected '" + token + "', got '" + actual + "'");
+  }
+
+  /// Skips a statement, up to and including its `;` (or its
+  /// `{ ... }` block).
+  void skip_statement() {
+    size_t depth = 0;
+
+    for (;;) {
+      std::string token = take();
+
+      if (token == "{") {
+        depth++;
+      } else if (token == "}") {
+        if (--depth == 0) return;
+      } else if (token == ";" && depth == 0) {
+        return;
+      }
+    }
+  }
+
+  void parse_file() {
+    while (!at_end()) {
+      const std::string &token = peek();
+
+      if (token == "package") {
+        take();
+        schema.package = take();
+        expect(";");
+      } else if (token == "message") {
+        take();
+        parse_message("", take());
+      } else if (token == "enum") {
+        take();
+        parse_enum("", take());
+      } else {
+        skip_statement();
+      }
+    }
+  }
+
+  void parse_enum(const std::string &prefix, const std::string &name) {
+    auto &values = schema.enums[prefix + name];
+
+    expect("{");
+    while (peek() != "}") {
+      if (peek() == "option" || peek() == "reserved") {
+        skip_statement();
+        continue;
+      }
+
+      std::string value = take();
+
+      expect("=");
+      values[value] = take();
+      if (peek() == "[") {
+        while (take() != "]") continue;
+      }
+
+      expect(";");
+    }
+
+    expect("}");
+  }
+
+  /// Parses a message body after its name; `prefix` is the C++
+  /// name of the enclosing message followed by an underscore, or
+  /// empty for top-level messages.
+  void parse_message(const std::string &prefix, const std::string &name) {
+    Message message;
+
+    message.name = prefix + name;
+    scopes.push_back(message.name + "_");
+    expect("{");
+    while (peek() != "}") {
+      const std::string &token = peek();
+
+      if (token == "message") {
+        take();
+        parse_message(message.name + "_", take());
+      } else if (token == "enum") {
+        take();
+        parse_enum(message.name + "_", take());
+      } else if (token == "optional" || token == "required" ||
+                 token == "repeated") {
+        message.fields.push_back(parse_field(message.name));
+      } else if (token == ";") {
+        take();
+      } else {
+        // option, extensions, reserved, oneof, ...
+        skip_statement();
+      }
+    }
+
+    expect("}");
+    scopes.pop_back();
+    schema.messages.push_back(std::move(message));
+  }
+
+  Field parse_field(const std::string &message_name) {
+    Field field;
+    std::string label = take();
+
+    field.label = (label == "optional")   ? Label::Optional
+                  : (label == "required") ? Label::Required
+                                          : Label::Repeated;
+    field.type = take();
+    if (field.type == "group") {
+      std::string group = take();
+
+      field.name = group;
+      for (char &c : field.name) c = tolower((unsigned char)c);
+      expect("=");
+      field.number = parse_number(take());
+      field.message = message_name + "_" + group;
+      parse_message(message_name + "_", group);
+      return field;
+    }
+
+    field.name = take();
+    expect("=");
+    field.number = parse_number(take());
+    if (peek() == "[") {
+      take();
+      for (;;) {
+        std::string option = take();
+
+        expect("=");
+        std::string value = take();
+
+        if (option == "default") field.default_value = value;
+        if (peek() == "]") break;
+        expect(",");
+      }
+
+      expect("]");
+    }
+
+    expect(";");
+    // Remember the scopes for type resolution once everything has
+    // been parsed.
+    field.message = scopes.back();
+    return field;
+  }
+
+  static uint32_t parse_number(const std::string &token) {
+    char *end;
+    unsigned long ret = strtoul(token.c_str(), &end, 0);
+
+    if (*end != '\0' || ret == 0 || ret >= (1UL << 29))
+      Fail("bad field number '" + token + "'");
+    return ret;
+  }
+
+  std::vector<std::string> tokens;
+  size_t pos{0};
+  std::vector<std::string> scopes{""};
+  Schema schema;
+};
+
+/// Scalar types: C++ type, and the `DataWriter` method that encodes
+/// them.
+struct Scalar {
+  const char *cxx;
+  const char *writer;
+};
+
+const std::map<std::string, Scalar> kScalars = {
+    {"double", {"double", "fixed"}},    {"float", {"float", "fixed"}},
+    {"int32", {"int32_t", "varint"}},   {"int64", {"int64_t", "varint"}},
+    {"uint32", {"uint32_t", "varint"}}, {"uint64", {"uint64_t", "varint"}},
+    {"fixed32", {"uint32_t", "fixed"}}, {"fixed64", {"uint64_t", "fixed"}},
+    {"sfixed32", {"int32_t", "fixed"}}, {"sfixed64", {"int64_t", "fixed"}},
+    {"bool", {"bool", "fixed"}},        {"string", {"std::string", "string"}},
+    {"bytes", {"std::string", "string"}},
+};
+
+/// Resolves each field's type to a scalar, an enum (stored as
+/// `int32`), or a message.  Until now, `Field::message` for non-group
+/// fields holds the innermost scope prefix of the field.
+void Resolve(Schema *schema) {
+  std::set<std::string> messages;
+
+  for (const Message &message : schema->messages) messages.insert(message.name);
+
+  for (Message &message : schema->messages) {
+    for (Field &field : message.fields) {
+      if (field.type == "group") continue;
+
+      std::string scope = field.message;
+
+      field.message.clear();
+      if (kScalars.count(field.type) != 0) continue;
+
+      std::string type = field.type;
+      if (!schema->package.empty() &&
+          type.compare(0, schema->package.size() + 2,
+                       "." + schema->package + ".") == 0)
+        type = type.substr(schema->package.size() + 2);
+      for (char &c : type) {
+        if (c == '.') c = '_';
+      }
+
+      // Search from the innermost scope out.
+      std::string resolved;
+      for (;;) {
+        std::string candidate = scope + type;
+
+        if (messages.count(candidate) != 0 ||
+            schema->enums.count(candidate) != 0) {
+          resolved = candidate;
+          break;
+        }
+
+        if (scope.empty()) break;
+
+        size_t cut = scope.rfind('_', scope.size() - 2);
+        scope = (cut == std::string::npos) ? "" : scope.substr(0, cut + 1);
+      }
+
+      if (resolved.empty()) Fail("unknown type '" + field.type + "'");
+
+      if (messages.count(resolved) != 0) {
+        field.message = resolved;
+      } else {
+        field.type = "enum";
+        if (!field.default_value.empty())
+          field.default_value = schema->enums[resolved][field.default_value];
+      }
+    }
+  }
+
+  return;
+}
+
+/// Orders messages so that every message comes after the types of
+/// its singular submessage fields (which are stored by value).
+std::vector<const Message *> Sort(const Schema &schema) {
+  std::map<std::string, const Message *> by_name;
+  std::map<std::string, int> state;  // 1: visiting, 2: done
+  std::vector<const Message *> ret;
+
+  for (const Message &message : schema.messages)
+    by_name[message.name] = &message;
+
+  auto visit = [&](auto &self, const Message *message) -> void {
+    int &s = state[message->name];
+
+    if (s == 2) return;
+    if (s == 1) Fail("recursive message '" + message->name + "'");
+    s = 1;
+    for (const Field &field : message->fields) {
+      if (!field.message.empty()) self(self, by_name[field.message]);
+    }
+
+    state[message->name] = 2;
+    ret.push_back(message);
+  };
+
+  for (const Message &message : schema.messages) visit(visit, &message);
+  return ret;
+}
+
+/// `MetaWriter::kMaxDepth`: the generated encoders can't nest runs
+/// deeper than this.
+constexpr size_t kMaxDepth = 64;
+
+/// Fails if encoding one of `messages` (ordered by `Sort`) would nest
+/// more than `kMaxDepth` runs: submessage fields and repeated fields
+/// each open one.  Messages aren't recursive, so the depth is bounded
+/// by the schema.
+void CheckDepth(const std::vector<const Message *> &messages) {
+  std::map<std::string, size_t> depths;
+
+  for (const Message *message : messages) {
+    size_t depth = 0;
+
+    for (const Field &field : message->fields) {
+      size_t nested = field.message.empty() ? 0 : depths[field.message];
+
+      if (!field.message.empty() || field.label == Label::Repeated)
+        depth = std::max(depth, nested + 1);
+    }
+
+    if (depth > kMaxDepth) {
+      Fail("message '" + message->name + "' nests more than " +
+           std::to_string(kMaxDepth) + " submessages deep");
+    }
+
+    depths[message->name] = depth;
+  }
+
+  return;
+}
+
+std::string CxxType(const Field &field) {
+  if (!field.message.empty()) return field.message;
+  if (field.type == "enum") return "int32_t";
+  return kScalars.at(field.type).cxx;
+}
+
+std::string Writer(const Field &field) {
+  if (field.type == "enum") return "varint";
+  return kScalars.at(field.type).writer;
+}
+
+/// Returns the expression that writes `value` to the data stream, and
+/// evaluates to its size.
+std::string WriteData(const Field &field, const std::string &value) {
+  std::string writer = Writer(field);
+
+  // Negative int32s are sign extended, like in protobuf.
+  if (writer == "varint") {
+    return "data->varint((uint64_t)(int64_t)" + value + ")";
+  }
+
+  return "data->" + writer + "(" + value + ")";
+}
+
+void EmitStruct(const Message &message, std::ostream &out) {
+  out << "struct " << message.name << " {\n";
+  for (const Field &field : message.fields) {
+    std::string type = CxxType(field);
+
+    if (field.label == Label::Repeated) {
+      // Avoid `std::vector<bool>`, which can't hand out pointers to
+      // its elements.
+      if (type == "bool") type = "uint8_t";
+      out << "  std::vector<" << type << "> " << field.name << ";\n";
+      continue;
+    }
+
+    out << "  " << type << " " << field.name;
+    if (!field.default_value.empty()) {
+      out << "{" << field.default_value << "}";
+    } else if (field.message.empty() && type != "std::string") {
+      out << "{}";
+    }
+
+    out << ";\n";
+  }
+
+  for (const Field &field : message.fields) {
+    if (field.label != Label::Repeated)
+      out << "  bool has_" << field.name << "{false};\n";
+  }
+
+  out << "};\n\n";
+}
+
+/// Writes `...View`, with an accessor per field over
+/// `codegen::MessageView`: `std::string_view`s for strings, values
+/// for scalars (with the field's default), views for submessages (by
+/// value, or into a view that keeps its storage), and
+/// `codegen::RunView`s for repeated fields.
+void EmitView(const Message &message, std::ostream &out) {
+  out << "struct " << message.name << "View : codegen::MessageView {\n"
+      << "  using MessageView::MessageView;\n";
+  for (const Field &field : message.fields) {
+    std::string number = std::to_string(field.number);
+
+    out << "\n";
+    if (field.label == Label::Repeated) {
+      out << "  codegen::RunView " << field.name << "() const {\n"
+          << "    codegen::RunView view;\n\n"
+          << "    run(" << number << ", &view);\n"
+          << "    return view;\n"
+          << "  }\n";
+      continue;
+    }
+
+    if (!field.message.empty()) {
+      out << "  " << field.message << "View " << field.name << "() const {\n"
+          << "    " << field.message << "View view;\n\n"
+          << "    submessage(" << number << ", &view);\n"
+          << "    return view;\n"
+          << "  }\n"
+          << "  bool " << field.name << "(" << field.message
+          << "View *view) const {\n"
+          << "    return submessage(" << number << ", view);\n"
+          << "  }\n";
+    } else if (CxxType(field) == "std::string") {
+      out << "  std::string_view " << field.name
+          << "() const { return bytes(" << number;
+      if (!field.default_value.empty()) out << ", " << field.default_value;
+      out << "); }\n";
+    } else {
+      std::string type = CxxType(field);
+
+      out << "  " << type << " " << field.name << "() const { return value<"
+          << type << ">(" << number << ", "
+          << (field.default_value.empty() ? "{}" : field.default_value)
+          << "); }\n";
+    }
+
+    out << "  bool has_" << field.name << "() const { return has(" << number
+        << "); }\n";
+  }
+
+  out << "};\n\n";
+}
+
+void EmitEncoder(const Message &message, std::ostream &out) {
+  std::vector<const Field *> fields;
+
+  for (const Field &field : message.fields) fields.push_back(&field);
+  std::sort(fields.begin(), fields.end(),
+            [](const Field *x, const Field *y) { return x->number < y->number; });
+
+  // One body for both the checked and the unchecked writers, and for
+  // sequential and parallel runs.
+  out << "namespace {\n"
+      << "template <typename Meta, typename Data>\n"
+      << "void EncodeFieldsImpl(const " << message.name
+      << " &message, Meta *meta, Data *data,\n"
+      << "                      const codegen::ParallelOptions &parallel) {\n";
+  if (fields.empty()) out << "  (void)message;\n  (void)meta;\n  (void)data;\n";
+  if (std::none_of(fields.begin(), fields.end(), [](const Field *field) {
+        return field->label == Label::Repeated && !field->message.empty();
+      }))
+    out << "  (void)parallel;\n";
+
+  for (const Field *field : fields) {
+    std::string value = "message." + field->name;
+    std::string number = std::to_string(field->number);
+
+    if (field != fields.front()) out << "\n";
+    if (field->label == Label::Repeated && !field->message.empty()) {
+      out << "  if (!" << value << ".empty()) {\n"
+          << "    codegen::EncodeRunParallel(meta, data, " << number << ", "
+          << value << ", parallel);\n"
+          << "  }\n";
+      continue;
+    }
+
+    if (field->label == Label::Repeated && Writer(*field) == "varint") {
+      out << "  if (!" << value << ".empty()) {\n"
+          << "    codegen::EncodeVarintRun(meta, data, " << number << ", "
+          << value << ");\n"
+          << "  }\n";
+      continue;
+    }
+
+    if (field->label == Label::Repeated) {
+      out << "  if (!" << value << ".empty()) {\n"
+          << "    codegen::EncodeRun(meta, data, " << number << ", true, "
+          << value << ".size(), [&](size_t i) {\n";
+      if (Writer(*field) == "string") {
+        out << "      meta->string(1, " << WriteData(*field, value + "[i]")
+            << ");\n";
+      } else {
+        out << "      meta->field(1, " << WriteData(*field, value + "[i]")
+            << ");\n";
+      }
+
+      out << "    });\n"
+          << "  }\n";
+      continue;
+    }
+
+    out << "  if (message.has_" << field->name << ") {\n";
+    if (!field->message.empty()) {
+      out << "    codegen::EncodeRun(meta, data, " << number
+          << ", false, 1, [&](size_t) {\n"
+          << "      EncodeFields(" << value << ", meta, data);\n"
+          << "    });\n";
+    } else if (Writer(*field) == "string") {
+      out << "    meta->string(" << number << ", " << WriteData(*field, value)
+          << ");\n";
+    } else {
+      out << "    meta->field(" << number << ", " << WriteData(*field, value)
+          << ");\n";
+    }
+
+    out << "  }\n";
+  }
+
+  out << "}\n"
+      << "}  // namespace\n\n"
+      << "void EncodeFields(const " << message.name
+      << " &message, MetaWriter *meta,\n"
+      << "                  DataWriter *data) {\n"
+      << "  EncodeFieldsImpl(message, meta, data, codegen::kSequential);\n"
+      << "}\n\n"
+      << "void EncodeFields(const " << message.name
+      << " &message, UncheckedMetaWriter *meta,\n"
+      << "                  UncheckedDataWriter *data) {\n"
+      << "  EncodeFieldsImpl(message, meta, data, codegen::kSequential);\n"
+      << "}\n\n"
+      << "void EncodeFields(const " << message.name
+      << " &message, SplitLiteralMetaWriter *meta,\n"
+      << "                  DataWriter *data) {\n"
+      << "  EncodeFieldsImpl(message, meta, data, codegen::kSequential);\n"
+      << "}\n\n"
+      << "void EncodeFields(const " << message.name
+      << " &message, MetaWriter *meta,\n"
+      << "                  DataWriter *data,\n"
+      << "                  const codegen::ParallelOptions &options) {\n"
+      << "  EncodeFieldsImpl(message, meta, data, options);\n"
+      << "}\n\n";
+}
+
+/// Returns the largest number of data bytes a non-string scalar field
+/// writes.
+std::string DataBound(const Field &field) {
+  if (Writer(field) == "varint") return "8";
+  return "sizeof(" + CxxType(field) + ")";
+}
+
+/// Emits `AddEncodeBounds`, which must account for at least every byte
+/// that `EncodeFields` writes.
+///
+/// Only optional submessages branch: other fields scale their bounds
+/// by their `has_` flag or their size, so the pass doesn't pay for
+/// the mispredictions `EncodeFields` already does.
+void EmitBounds(const Message &message, std::ostream &out) {
+  out << "void AddEncodeBounds(const " << message.name << " &message,\n"
+      << "                     codegen::EncodeBounds *bounds) {\n";
+  if (message.fields.empty()) out << "  (void)message;\n  (void)bounds;\n";
+
+  // Emits `codegen::<adder>(<first>, bounds, <scale>);`, wrapped at
+  // 80 columns.
+  auto emit_scaled = [&](const std::string &adder, const std::string &first,
+                         const std::string &scale) {
+    std::string call = "  codegen::" + adder + "(" + first + ", bounds,";
+
+    if (call.size() + 1 + scale.size() + 2 > 80) {
+      out << call << "\n" << std::string(12 + adder.size(), ' ');
+    } else {
+      out << call << " ";
+    }
+
+    out << scale << ");\n";
+  };
+
+  for (const Field &field : message.fields) {
+    std::string value = "message." + field.name;
+    std::string has = "message.has_" + field.name;
+
+    if (field.label == Label::Repeated) {
+      out << "  codegen::AddRunBounds(" << value << ".size(), bounds);\n";
+      if (!field.message.empty()) {
+        out << "  for (const auto &value : " << value << ")\n"
+            << "    AddEncodeBounds(value, bounds);\n";
+      } else if (Writer(field) == "string") {
+        out << "  for (const auto &value : " << value << ")\n"
+            << "    codegen::AddStringBounds(value.size(), bounds);\n";
+      } else {
+        emit_scaled("AddFieldBounds", DataBound(field), value + ".size()");
+      }
+    } else if (!field.message.empty()) {
+      out << "  if (" << has << ") {\n"
+          << "    codegen::AddRunBounds(1, bounds);\n"
+          << "    AddEncodeBounds(" << value << ", bounds);\n"
+          << "  }\n";
+    } else if (Writer(field) == "string") {
+      emit_scaled("AddStringBounds", value + ".size()", has);
+    } else {
+      emit_scaled("AddFieldBounds", DataBound(field), has);
+    }
+  }
+
+  out << "}\n\n";
+}
+
+void EmitDecoder(const Message &message, std::ostream &out) {
+  out << "bool DecodeField(uint32_t field, size_t width, const uint8_t *src,\n"
+      << "                 " << message.name << " *message) {\n"
+      << "  switch (field) {\n";
+  for (const Field &field : message.fields) {
+    if (field.label == Label::Repeated || !field.message.empty()) continue;
+
+    out << "    case " << field.number << ":\n"
+        << "      message->has_" << field.name << " = true;\n"
+        << "      return codegen::DecodeValue(src, width, &message->"
+        << field.name << ");\n";
+  }
+
+  out << "    default:\n"
+      << "      return true;\n"
+      << "  }\n"
+      << "}\n\n";
+
+  bool has_runs = false;
+  for (const Field &field : message.fields)
+    has_runs |= field.label == Label::Repeated || !field.message.empty();
+
+  out << "bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t "
+         "first_width,\n"
+      << "                size_t depth, MetaReader *meta, DataReader *data,\n"
+      << "                " << message.name
+      << (has_runs ? " *message) {\n" : " *) {\n")
+      << "  switch (field) {\n";
+  for (const Field &field : message.fields) {
+    if (field.label == Label::Repeated) {
+      out << "    case " << field.number << ":\n"
+          << "      return codegen::DecodeAppend(meta, data, first_width, "
+          << "depth,\n"
+          << "                                   &message->" << field.name
+          << ");\n";
+    } else if (!field.message.empty()) {
+      out << "    case " << field.number << ":\n"
+          << "      message->has_" << field.name << " = true;\n"
+          << "      return codegen::DecodeOne(meta, data, first_width, "
+          << "depth,\n"
+          << "                                &message->" << field.name
+          << ");\n";
+    }
+  }
+
+  out << "    default:\n"
+      << "      return codegen::DecodeOpen(field, len_hint, first_width, "
+         "depth, meta,\n"
+      << "                                 data, (codegen::Ignored *)nullptr);"
+         "\n"
+      << "  }\n";
+  out << "}\n\n";
+}
+
+/// Returns the `FieldKind` enumerator for `field`.
+std::string Kind(const Field &field) {
+  if (field.type == "group") return "Group";
+  if (!field.message.empty()) return "Message";
+  if (field.type == "enum") return "Varint";
+
+  static const std::map<std::string, std::string> kKinds = {
+      {"bool", "Bool"},        {"float", "Float"},    {"fixed32", "Fixed32"},
+      {"sfixed32", "Fixed32"}, {"double", "Double"},  {"fixed64", "Fixed64"},
+      {"sfixed64", "Fixed64"}, {"string", "Bytes"},   {"bytes", "Bytes"},
+  };
+  auto it = kKinds.find(field.type);
+  return (it == kKinds.end()) ? "Varint" : it->second;
+}
+
+std::string SchemaName(const std::string &message) {
+  return "k" + message + "Schema";
+}
+
+/// Field numbers up to this get a slot in the dense index of
+/// `MessageSchema`s; `find` binary searches for larger ones.
+constexpr uint32_t kMaxIndex = 1024;
+
+/// Writes the `MessageSchema` for `message`, with its field table and
+/// index in an anonymous namespace.
+void EmitSchema(const Message &message, std::ostream &out) {
+  std::vector<const Field *> fields;
+
+  for (const Field &field : message.fields) fields.push_back(&field);
+  std::sort(fields.begin(), fields.end(),
+            [](const Field *x, const Field *y) { return x->number < y->number; });
+  if (fields.size() >= (1UL << 16)) Fail("too many fields in " + message.name);
+
+  uint32_t index_size = fields.empty() ? 0 : fields.back()->number + 1;
+  if (index_size > kMaxIndex) index_size = kMaxIndex;
+
+  std::vector<size_t> index(index_size, 0);
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (fields[i]->number < index_size) index[fields[i]->number] = i + 1;
+  }
+
+  if (fields.empty()) {
+    out << "const MessageSchema " << SchemaName(message.name) << " = {\""
+        << message.name << "\", nullptr, 0, nullptr, 0};\n\n";
+    return;
+  }
+
+  out << "namespace {\n"
+      << "const FieldSchema k" << message.name << "Fields[] = {\n";
+  for (const Field *field : fields) {
+    out << "    {" << field->number << ", FieldKind::" << Kind(*field) << ", "
+        << (field->label == Label::Repeated ? "true" : "false") << ", "
+        << (field->message.empty() ? "nullptr"
+                                   : "&" + SchemaName(field->message))
+        << "},\n";
+  }
+
+  out << "};\n\n"
+      << "const uint16_t k" << message.name << "Index[] = {";
+  for (size_t i = 0; i < index.size(); i++)
+    out << ((i % 16 == 0) ? "\n    " : " ") << index[i] << ",";
+  out << "\n};\n"
+      << "}  // namespace\n\n"
+      << "const MessageSchema " << SchemaName(message.name) << " = {\n"
+      << "    \"" << message.name << "\", k" << message.name << "Fields, "
+      << fields.size() << ",\n    k" << message.name << "Index, " << index_size
+      << "};\n\n";
+}
+
+std::string Namespace(const std::string &package) {
+  std::string ret = package;
+
+  for (size_t i = ret.find('.'); i != std::string::npos; i = ret.find('.', i))
+    ret.replace(i, 1, "::");
+  return ret;
+}
+
+std::string Basename(const std::string &path) {
+  size_t slash = path.rfind('/');
+
+  return (slash == std::string::npos) ? path : path.substr(slash + 1);
+}
+
+void Write(const std::string &path, const std::string &contents) {
+  std::ofstream out(path);
+
+  out << contents;
+  if (!out) Fail("failed to write " + path);
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    std::cerr << "usage: splitc schema.proto output_prefix\n";
+    return 2;
+  }
+
+  std::ifstream in(argv[1]);
+  std::stringstream text;
+
+  text << in.rdbuf();
+  if (!in) Fail(std::string("failed to read ") + argv[1]);
+
+  Parser parser(Tokenize(text.str()));
+  parser.parse_file();
+
+  Schema &schema = parser.schema;
+  Resolve(&schema);
+
+  std::vector<const Message *> messages = Sort(schema);
+  CheckDepth(messages);
+  std::string prefix = argv[2];
+  std::string ns = Namespace(schema.package);
+  std::string banner = "// Generated by splitc from " + Basename(argv[1]) +
+                       ".  Do not edit.\n";
+  std::ostringstream header;
+  std::ostringstream source;
+
+  header << banner << "#pragma once\n\n"
+         << "#include <cstddef>\n"
+         << "#include <cstdint>\n"
+         << "#include <string>\n"
+         << "#include <string_view>\n"
+         << "#include <vector>\n\n"
+         << "#include \"codegen_runtime.h\"\n"
+         << "#include \"message_view.h\"\n"
+         << "#include \"schema.h\"\n\n";
+  if (!ns.empty()) header << "namespace " << ns << " {\n";
+  for (const Message *message : messages) EmitStruct(*message, header);
+  for (const Message *message : messages) EmitView(*message, header);
+
+  for (const Message *message : messages) {
+    header << "void EncodeFields(const " << message->name
+           << " &message, MetaWriter *meta,\n"
+           << "                  DataWriter *data);\n"
+           << "void EncodeFields(const " << message->name
+           << " &message, UncheckedMetaWriter *meta,\n"
+           << "                  UncheckedDataWriter *data);\n"
+           << "void EncodeFields(const " << message->name
+           << " &message, SplitLiteralMetaWriter *meta,\n"
+           << "                  DataWriter *data);\n"
+           << "void EncodeFields(const " << message->name
+           << " &message, MetaWriter *meta,\n"
+           << "                  DataWriter *data,\n"
+           << "                  const codegen::ParallelOptions &options);\n"
+           << "void AddEncodeBounds(const " << message->name << " &message,\n"
+           << "                     codegen::EncodeBounds *bounds);\n"
+           << "bool DecodeField(uint32_t field, size_t width, const uint8_t "
+              "*src,\n"
+           << "                 " << message->name << " *message);\n"
+           << "bool DecodeOpen(uint32_t field, uint64_t len_hint, size_t "
+              "first_width,\n"
+           << "                size_t depth, MetaReader *meta, DataReader "
+              "*data,\n"
+           << "                " << message->name << " *message);\n\n";
+  }
+
+  for (const Message *message : messages)
+    header << "extern const MessageSchema " << SchemaName(message->name) << ";\n";
+  header << "\n";
+
+  if (!ns.empty()) header << "}  // namespace " << ns << "\n";
+
+  // The encoders instantiate the split-literal and parallel writers,
+  // which the header only names.
+  source << banner << "#include \"" << Basename(prefix) << ".split.h\"\n\n"
+         << "#include \"parallel_encode.h\"\n"
+         << "#include \"split_literal_meta.h\"\n\n";
+  if (!ns.empty()) source << "namespace " << ns << " {\n";
+  for (const Message *message : messages) {
+    EmitEncoder(*message, source);
+    EmitBounds(*message, source);
+    EmitDecoder(*message, source);
+  }
+
+  for (const Message *message : messages) EmitSchema(*message, source);
+
+  if (!ns.empty()) source << "}  // namespace " << ns << "\n";
+
+  Write(prefix + ".split.h", header.str());
+  Write(prefix + ".split.cc", source.str());
+  return 0;
+}
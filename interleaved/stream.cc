@@ -0,0 +1,283 @@
+#include "stream.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+
+bool FdSink::write(iovec *iovs, size_t count) {
+  while (count > 0) {
+    int iovcnt = (int)std::min<size_t>(count, IOV_MAX);
+    ssize_t written = writev(fd, iovs, iovcnt);
+
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+
+    // Skip the `iovec`s written in full, and trim a partial one.
+    size_t remaining = written;
+    while (count > 0 && remaining >= iovs->iov_len) {
+      remaining -= iovs->iov_len;
+      iovs++;
+      count--;
+    }
+
+    if (remaining > 0) {
+      iovs->iov_base = (uint8_t *)iovs->iov_base + remaining;
+      iovs->iov_len -= remaining;
+    }
+  }
+
+  return true;
+}
+
+namespace {
+/// Reads `size` bytes from `fd` to `dst`.  Returns the number of
+/// bytes read: less than `size` at the end of the file or on errors.
+size_t ReadFully(int fd, uint8_t *dst, size_t size) {
+  size_t done = 0;
+
+  while (done < size) {
+    ssize_t got = read(fd, dst + done, size - done);
+
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) break;
+    done += got;
+  }
+
+  return done;
+}
+
+/// Appends `size` bytes from `fd` to `out`, at most 1 MB at a time, so
+/// a bogus size fails at the end of the file rather than allocating
+/// it all up front.
+bool AppendFromFd(int fd, WriteBuffer *out, uint64_t size) {
+  constexpr size_t kPiece = 1 << 20;
+
+  while (size > 0) {
+    size_t piece = (size_t)std::min<uint64_t>(size, kPiece);
+    size_t got = ReadFully(fd, (uint8_t *)out->reserve(piece), piece);
+
+    out->commit(got);
+    if (got < piece) return false;
+    size -= piece;
+  }
+
+  return true;
+}
+}  // namespace
+
+bool ReadStreamFrame(int fd, WriteBuffer *meta, WriteBuffer *data,
+                     bool *last) {
+  uint8_t header[kStreamFrameHeaderSize];
+  uint32_t flags;
+  uint64_t meta_size;
+  uint64_t data_size;
+
+  if (ReadFully(fd, header, sizeof(header)) != sizeof(header) ||
+      memcmp(header, kStreamMagic, sizeof(kStreamMagic)) != 0)
+    return false;
+
+  memcpy(&flags, header + 4, sizeof(flags));
+  memcpy(&meta_size, header + 8, sizeof(meta_size));
+  memcpy(&data_size, header + 16, sizeof(data_size));
+  if ((flags & ~kStreamLastFrame) != 0) return false;
+
+  *last = (flags & kStreamLastFrame) != 0;
+  return AppendFromFd(fd, meta, meta_size) &&
+         AppendFromFd(fd, data, data_size);
+}
+
+namespace {
+/// Appends frames to a string.
+struct StringSink {
+  std::string *out;
+
+  bool write(iovec *iovs, size_t count) {
+    for (size_t i = 0; i < count; i++)
+      out->append((const char *)iovs[i].iov_base, iovs[i].iov_len);
+    return true;
+  }
+};
+
+/// Writes a top-level message with a run of `count` submessages of
+/// 1 to 3 fields each, and calls `poll()` after each submessage.
+template <typename Meta, typename Data, typename Poll>
+void WriteMessage(Meta *meta, Data *data, size_t count, Poll poll) {
+  static const char kBytes[] = "0123456789abcdef";
+  size_t run_begin = data->buf.written();
+  size_t message_begin = run_begin;
+
+  meta->field(1, data->varint(count));
+  meta->open(2, count);
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0) {
+      meta->separate(data->buf.written() - message_begin);
+      message_begin = data->buf.written();
+    }
+
+    meta->field(1, data->varint(i));
+    if (i % 3 != 0) meta->string(2, data->string({kBytes, 1 + i % 15}));
+    if (i % 5 != 0) meta->field(7, data->template fixed<uint64_t>(i << 20));
+    poll();
+  }
+
+  meta->close(data->buf.written() - run_begin);
+  meta->close(data->buf.written());
+}
+
+/// Reads every frame in `bytes` through a pipe, into `meta` and
+/// `data`.  Returns true if the stream ends with its last frame, and
+/// nothing follows.
+bool ReadStream(const std::string &bytes, WriteBuffer *meta,
+                WriteBuffer *data) {
+  int fds[2];
+  bool last = false;
+  bool ret;
+
+  // Small streams fit in the pipe's buffer.
+  assert(bytes.size() < 4096);
+  if (pipe(fds) != 0) return false;
+  ret = write(fds[1], bytes.data(), bytes.size()) == (ssize_t)bytes.size();
+  close(fds[1]);
+
+  while (ret && !last) ret = ReadStreamFrame(fds[0], meta, data, &last);
+
+  uint8_t extra;
+  ret = ret && read(fds[0], &extra, 1) == 0;
+  close(fds[0]);
+  return ret;
+}
+}  // namespace
+
+void StreamSelfTest() {
+  constexpr size_t kCount = 5000;
+  constexpr size_t kWatermark = 4096;
+  MetaWriter meta(16);
+  DataWriter data(16);
+
+  WriteMessage(&meta, &data, kCount, [] {});
+
+  // A big message through a pipe, with `FdSink` on one end and
+  // `ReadStreamFrame` on the other.
+  {
+    int fds[2];
+    bool ok = pipe(fds) == 0;
+    size_t frames = 0;
+
+    assert(ok);
+    (void)ok;
+    std::thread writer([&] {
+      StreamWriter<FdSink> stream(FdSink{fds[1]}, kWatermark, 1024);
+      bool success = true;
+
+      WriteMessage(&stream.meta, &stream.data, kCount,
+                   [&] { success &= stream.poll(); });
+      success &= stream.finish();
+      assert(success && stream.frames() > 10);
+      (void)success;
+      frames = stream.frames();
+      close(fds[1]);
+    });
+
+    WriteBuffer streamed_meta;
+    WriteBuffer streamed_data;
+    bool last = false;
+    size_t read_frames = 0;
+
+    while (ok && !last) {
+      size_t before = streamed_meta.written() + streamed_data.written();
+
+      ok = ReadStreamFrame(fds[0], &streamed_meta, &streamed_data, &last);
+      assert(ok);
+      read_frames++;
+
+      // A frame holds the watermark, plus at most one submessage.
+      size_t frame_size =
+          streamed_meta.written() + streamed_data.written() - before;
+      assert(frame_size < kWatermark + 64);
+      (void)frame_size;
+    }
+
+    writer.join();
+    close(fds[0]);
+    assert(read_frames == frames);
+    assert(streamed_meta.written() == meta.base.buf.written() &&
+           memcmp(streamed_meta.data(), meta.base.buf.data(),
+                  meta.base.buf.written()) == 0);
+    assert(streamed_data.written() == data.buf.written() &&
+           memcmp(streamed_data.data(), data.buf.data(),
+                  data.buf.written()) == 0);
+  }
+
+  // Small streams, to a callback sink: every truncation and a few
+  // corruptions fail.
+  std::string bytes;
+  MetaWriter small_meta(16);
+  DataWriter small_data(16);
+  StreamWriter<StringSink> stream(StringSink{&bytes}, 16, 16);
+
+  WriteMessage(&small_meta, &small_data, 20, [] {});
+  WriteMessage(&stream.meta, &stream.data, 20, [&] { stream.poll(); });
+  stream.finish();
+  assert(stream.frames() > 2);
+
+  {
+    WriteBuffer streamed_meta;
+    WriteBuffer streamed_data;
+    bool ok = ReadStream(bytes, &streamed_meta, &streamed_data);
+
+    (void)ok;
+    assert(ok);
+    assert(streamed_meta.written() == small_meta.base.buf.written() &&
+           memcmp(streamed_meta.data(), small_meta.base.buf.data(),
+                  streamed_meta.written()) == 0);
+    assert(streamed_data.written() == small_data.buf.written() &&
+           memcmp(streamed_data.data(), small_data.buf.data(),
+                  streamed_data.written()) == 0);
+  }
+
+  for (size_t size = 0; size < bytes.size(); size++) {
+    WriteBuffer streamed_meta;
+    WriteBuffer streamed_data;
+
+    assert(!ReadStream(bytes.substr(0, size), &streamed_meta,
+                       &streamed_data));
+  }
+
+  for (size_t offset : {(size_t)0, (size_t)4}) {
+    std::string corrupt = bytes;
+    WriteBuffer streamed_meta;
+    WriteBuffer streamed_data;
+
+    corrupt[offset] ^= 2;
+    assert(!ReadStream(corrupt, &streamed_meta, &streamed_data));
+  }
+
+  // Trailing bytes after the last frame.
+  {
+    WriteBuffer streamed_meta;
+    WriteBuffer streamed_data;
+
+    assert(!ReadStream(bytes + "x", &streamed_meta, &streamed_data));
+  }
+
+  // A failed sink sticks.
+  {
+    struct FailingSink {
+      bool write(iovec *, size_t) { return false; }
+    };
+
+    StreamWriter<FailingSink> failing(FailingSink{}, 16, 16);
+    bool ok = true;
+
+    WriteMessage(&failing.meta, &failing.data, 20,
+                 [&] { ok &= failing.poll(); });
+    assert(!ok && !failing.finish() && failing.frames() == 1);
+    (void)ok;
+  }
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <sys/uio.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "data_writer.h"
+#include "meta_writer.h"
+#include "write_buffer.h"
+
+/// Streams send one (possibly huge) top-level message in frames, so
+/// neither end has to hold all of it.  Each frame carries the next
+/// chunk of the metadata stream and the next chunk of the data stream:
+///
+///   "SPS1"                   4-byte magic
+///   flags                    uint32_t, `kStreamLastFrame` or 0
+///   meta_size                uint64_t
+///   data_size                uint64_t
+///   meta chunk               meta_size bytes
+///   data chunk               data_size bytes
+///
+/// Integers are little-endian.  Concatenating the chunks of every
+/// frame, in order, gives back the two streams; the last frame is
+/// flagged, so truncated streams are detected.
+///
+/// Instructions are written after their data, so a frame's
+/// instructions only refer to data in that frame or earlier ones.
+/// Data may precede its instructions by several frames, e.g. for a
+/// long `RunFields`.
+constexpr size_t kStreamFrameHeaderSize = 24;
+constexpr uint32_t kStreamLastFrame = 1;
+inline constexpr char kStreamMagic[4] = {'S', 'P', 'S', '1'};
+
+/// Writes frames to a file descriptor (a file, a pipe, or a socket)
+/// with `writev`.  Sinks for `StreamWriter` may be any type with the
+/// same `write` method, e.g. to hand frames to a callback.
+struct FdSink {
+  int fd;
+
+  /// Writes all the bytes in the `count` `iovec`s at `iovs`, which it
+  /// may update, retrying after short writes and `EINTR`.
+  ///
+  /// Returns false on error.
+  bool write(iovec *iovs, size_t count);
+};
+
+/// A `StreamWriter` encodes a top-level message to `meta` and `data`,
+/// like a `MetaWriter` and a `DataWriter` (it owns one of each), and
+/// flushes what's written to `sink` as frames, so the message's size
+/// isn't bounded by memory.
+///
+/// The writers can't flush in the middle of a call, so the encoder
+/// must call `poll` regularly, e.g. after each element of a run (see
+/// `codegen::EncodeRun`): once the bytes buffered since the last
+/// frame reach the high watermark, `poll` writes them as a frame and
+/// drops them.  Buffered bytes are thus bounded by the watermark plus
+/// whatever is written between two `poll`s.  Both buffers are
+/// segmented, so a frame goes out with `writev`, without copies.
+template <typename Sink>
+struct StreamWriter {
+  StreamWriter() = delete;
+
+  /// Flushes once `meta` and `data` buffer `high_watermark` bytes
+  /// together.  The buffers grow by chunks of `chunk_size` bytes.
+  StreamWriter(Sink sink_, size_t high_watermark,
+               size_t chunk_size = 64 * 1024)
+      : meta(WriteBuffer::Segmented(chunk_size)),
+        data(WriteBuffer::Segmented(chunk_size)),
+        sink(std::move(sink_)),
+        high_watermark_(high_watermark) {}
+
+  /// `StreamWriter`s are move-only, like `WriteBuffer`s.
+  StreamWriter(const StreamWriter &) = delete;
+  StreamWriter(StreamWriter &&) = default;
+  StreamWriter &operator=(const StreamWriter &) = delete;
+  StreamWriter &operator=(StreamWriter &&) = delete;
+
+  ~StreamWriter() = default;
+
+  /// Writes a frame if the buffered bytes reach the high watermark.
+  ///
+  /// Returns false if the sink has failed, now or before: the
+  /// stream is then incomplete, and the writer drops what it buffers.
+  inline bool poll() {
+    if (__builtin_expect(buffered() < high_watermark_, 1)) return ok_;
+
+    return flush(0);
+  }
+
+  /// Writes everything left as the last frame.  Call after the
+  /// top-level `close`.
+  ///
+  /// Returns false if the sink has failed.
+  bool finish() { return flush(kStreamLastFrame); }
+
+  /// Number of bytes written to `meta` and `data` since the last
+  /// frame.
+  size_t buffered() const {
+    return (meta.base.buf.written() - meta_flushed_) +
+           (data.buf.written() - data_flushed_);
+  }
+
+  /// Number of frames written so far.
+  size_t frames() const { return frames_; }
+
+  MetaWriter meta;
+  DataWriter data;
+  Sink sink;
+
+ private:
+  __attribute__((noinline)) bool flush(uint32_t flags);
+
+  size_t high_watermark_;
+  size_t meta_flushed_{0};
+  size_t data_flushed_{0};
+  size_t frames_{0};
+  bool ok_{true};
+  std::vector<iovec> iovs_;
+  uint8_t header_[kStreamFrameHeaderSize];
+};
+
+template <typename Sink>
+bool StreamWriter<Sink>::flush(uint32_t flags) {
+  uint64_t meta_size = meta.base.buf.written() - meta_flushed_;
+  uint64_t data_size = data.buf.written() - data_flushed_;
+
+  if (ok_ && (meta_size + data_size > 0 || flags != 0)) {
+    memcpy(header_, kStreamMagic, sizeof(kStreamMagic));
+    memcpy(header_ + 4, &flags, sizeof(flags));
+    memcpy(header_ + 8, &meta_size, sizeof(meta_size));
+    memcpy(header_ + 16, &data_size, sizeof(data_size));
+
+    iovs_.clear();
+    iovs_.push_back(iovec{header_, sizeof(header_)});
+    meta.base.buf.append_iovecs(&iovs_);
+    data.buf.append_iovecs(&iovs_);
+    ok_ = sink.write(iovs_.data(), iovs_.size());
+    frames_++;
+  }
+
+  // Sizes are still computed from `written()`, so discard the bytes
+  // rather than reset the buffers.
+  meta.base.buf.discard();
+  data.buf.discard();
+  meta_flushed_ = meta.base.buf.written();
+  data_flushed_ = data.buf.written();
+  return ok_;
+}
+
+/// Reads the next frame of a stream from `fd`, and appends its chunks
+/// to `meta` and `data`, e.g. to decode them once the last frame is
+/// in, or to hand them to a consumer frame by frame.  Sets `last` if
+/// it was the stream's last frame.
+///
+/// Returns false at the end of the file, on read errors, and on
+/// malformed or truncated frames.  Chunk sizes aren't trusted: the
+/// buffers only grow as bytes actually come in.
+bool ReadStreamFrame(int fd, WriteBuffer *meta, WriteBuffer *data,
+                     bool *last);
+
+/// Streams hand-written messages through a pipe and back, and rejects
+/// truncated and malformed streams.
+void StreamSelfTest();
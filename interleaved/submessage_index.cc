@@ -0,0 +1,243 @@
+#include "submessage_index.h"
+
+#include <assert.h>
+#include <climits>
+
+#include "base_meta_writer.h"
+#include "data_reader.h"
+#include "data_writer.h"
+#include "decoder.h"
+
+bool SubmessageIndex::build(const void *meta, size_t size) {
+  MetaReader reader(meta, size);
+  MetaInstruction insn;
+  uint64_t data = 0;
+  uint32_t field = 1;
+
+  runs.clear();
+  open_.clear();
+  for (;;) {
+    size_t offset = reader.offset();
+
+    if (!reader.next(&insn)) return false;
+
+    switch (insn.op) {
+      case Opcode::SkipN:
+        field += insn.imm1 + insn.literal;
+        break;
+
+      case Opcode::OneField:
+        field += insn.imm1 + 1;
+        data += MetaReader::width_for_nonzero_immediate(insn.imm2);
+        break;
+
+      case Opcode::TwoFields:
+        field += 2;
+        data += MetaReader::width_for_nonzero_immediate(insn.imm1);
+        data += MetaReader::width_for_nonzero_immediate(insn.imm2);
+        break;
+
+      case Opcode::OpenField: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        if (runs.size() >= UINT32_MAX) return false;
+
+        open_.push_back(runs.size());
+        runs.push_back(SubmessageRun{
+            .field = field,
+            .depth = (uint32_t)(open_.size() - 1),
+            .next = 0,
+            .meta_begin = offset,
+            .meta_end = 0,
+            .data_begin = data,
+            .data_size = 0,
+        });
+
+        field = (width != 0) ? 2 : 1;
+        data += width;
+        break;
+      }
+
+      case Opcode::FieldClose: {
+        data += MetaReader::width_for_zeroable_immediate(insn.imm1);
+        if (open_.empty()) return insn.literal == data && reader.done();
+
+        SubmessageRun &run = runs[open_.back()];
+
+        open_.pop_back();
+        if (insn.literal != data - run.data_begin) return false;
+
+        run.next = runs.size();
+        run.meta_end = reader.offset();
+        run.data_size = insn.literal;
+        field = run.field + 1;
+        break;
+      }
+
+      case Opcode::FieldSeparate:
+        data += MetaReader::width_for_zeroable_immediate(insn.imm1);
+        field = 1;
+        break;
+
+      case Opcode::RunFields: {
+        uint64_t count = MetaReader::run_fields_count(insn.literal);
+
+        field += count;
+        data += MetaReader::width_for_nonzero_immediate(insn.imm1) * count;
+        break;
+      }
+
+      case Opcode::FieldN: {
+        size_t width = MetaReader::width_for_zeroable_immediate(insn.imm1);
+
+        field += (width != 0) ? 2 : 1;
+        data += width + insn.literal;
+        break;
+      }
+    }
+  }
+}
+
+namespace {
+/// Sums the top-level fields, and skips every run except those for
+/// `descend_field`.
+struct SkipVisitor {
+  void field(uint32_t field, size_t width, const uint8_t *data) {
+    if (depth == 0) sum += field * DataReader::load(data, width);
+  }
+
+  bool open(uint32_t field, uint64_t) {
+    if (field != descend_field) return false;
+
+    depth++;
+    return true;
+  }
+
+  void separate(uint64_t) {}
+  void close(uint64_t) { depth--; }
+
+  uint32_t descend_field;
+  int depth{0};
+  uint64_t sum{0};
+};
+
+/// Writes a run of `count` submessages, with a nested run in each, and
+/// returns the run's data size.
+uint64_t write_run(BaseMetaWriter *meta, DataWriter *data, size_t count) {
+  size_t run_begin = data->buf.written();
+
+  meta->open_field(count, 0);
+  for (size_t i = 0; i < count; i++) {
+    size_t message_begin = data->buf.written();
+
+    meta->one_field(0, data->varint(i));
+    {
+      size_t nested_begin = data->buf.written();
+      uint8_t w = data->varint(100 + i);
+
+      meta->open_field(0, w);
+      meta->field_close(0, data->buf.written() - nested_begin);
+    }
+
+    uint8_t w = data->varint(1000);
+    if (i + 1 < count) {
+      meta->field_separate(w, data->buf.written() - message_begin);
+    } else {
+      meta->field_close(w, data->buf.written() - run_begin);
+    }
+  }
+
+  return data->buf.written() - run_begin;
+}
+}  // namespace
+
+void SubmessageIndex::SelfTest() {
+  BaseMetaWriter meta(16);
+  DataWriter data(16);
+
+  // 1
+  meta.one_field(0, data.varint(1));
+  // 2: a run of 3 submessages, each with a nested run.
+  size_t meta_2 = meta.buf.written();
+  uint64_t size_2 = write_run(&meta, &data, 3);
+  // 3
+  meta.one_field(0, data.varint(3));
+  // 5: another run of 2 submessages.
+  meta.skip(1);
+  size_t meta_5 = meta.buf.written();
+  uint64_t size_5 = write_run(&meta, &data, 2);
+  // 6
+  {
+    uint8_t w = data.varint(6);
+
+    meta.field_close(w, data.buf.written());
+  }
+
+  SubmessageIndex self;
+  bool success = self.build(meta.buf.data(), meta.buf.written());
+
+  (void)success;
+  (void)meta_2;
+  (void)size_2;
+  (void)meta_5;
+  (void)size_5;
+  assert(success);
+  // 1 + 3 runs for field 2, and 1 + 2 for field 5.
+  assert(self.runs.size() == 7);
+
+  assert(self.runs[0].field == 2);
+  assert(self.runs[0].depth == 0);
+  assert(self.runs[0].next == 4);
+  assert(self.runs[0].meta_begin == meta_2);
+  assert(self.runs[0].data_begin == 1);
+  assert(self.runs[0].data_size == size_2);
+
+  for (size_t i = 1; i < 4; i++) {
+    assert(self.runs[i].field == 2);
+    assert(self.runs[i].depth == 1);
+    assert(self.runs[i].next == i + 1);
+    assert(self.runs[i].data_size == 1);
+  }
+
+  assert(self.runs[4].field == 5);
+  assert(self.runs[4].depth == 0);
+  assert(self.runs[4].next == 7);
+  assert(self.runs[4].meta_begin == meta_5);
+  assert(self.runs[4].data_begin == 1 + size_2 + 1);
+  assert(self.runs[4].data_size == size_5);
+
+  // Skipping all runs with the index, or without, or decoding
+  // everything must yield the same top-level fields.
+  for (uint32_t descend : {0, 2, 5}) {
+    SkipVisitor indexed{descend};
+    SkipVisitor scanned{descend};
+
+    {
+      IndexedMetaReader meta_reader(meta.buf.data(), meta.buf.written(),
+                                    self);
+      DataReader data_reader(data.buf.data(), data.buf.written());
+      bool success = Decode(&meta_reader, &data_reader, &indexed);
+
+      (void)success;
+      assert(success);
+      assert(data_reader.remaining() == 0);
+    }
+
+    {
+      MetaReader meta_reader(meta.buf.data(), meta.buf.written());
+      DataReader data_reader(data.buf.data(), data.buf.written());
+      bool success = Decode(&meta_reader, &data_reader, &scanned);
+
+      (void)success;
+      assert(success);
+      assert(data_reader.remaining() == 0);
+    }
+
+    assert(indexed.sum == 1 + 3 * 3 + 6 * 6);
+    assert(scanned.sum == indexed.sum);
+  }
+
+  // Truncated or inconsistent streams are rejected.
+  assert(!self.build(meta.buf.data(), meta.buf.written() - 2));
+  assert(!self.build(meta.buf.data(), meta_5));
+}
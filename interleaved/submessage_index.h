@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "meta_reader.h"
+
+/// One run of submessages (from an `OpenField` to its matching
+/// `FieldClose`) in a metadata stream.
+struct SubmessageRun {
+  /// Field number for the run in the enclosing message.
+  uint32_t field;
+
+  /// Nesting depth: 0 for runs in the top-level message.
+  uint32_t depth;
+
+  /// Index of the first run after this run's subtree, i.e., the run
+  /// for the next `OpenField` once this run has been skipped.
+  uint32_t next;
+
+  /// Offset of the `OpenField` instruction in the metadata stream.
+  size_t meta_begin;
+
+  /// Offset right after the matching `FieldClose` instruction.
+  size_t meta_end;
+
+  /// Offset of the run's first byte in the data stream.
+  uint64_t data_begin;
+
+  /// Total size of the run's data, as recorded in the `FieldClose`.
+  uint64_t data_size;
+};
+
+/// A `SubmessageIndex` lists every run of submessages in a metadata
+/// stream, in the order of their `OpenField` instructions (i.e., a
+/// pre-order traversal of the message tree).
+///
+/// Entries are per run, not per submessage: the elements of a repeated
+/// field share one `OpenField` and one `FieldClose`, with a
+/// `FieldSeparate` between consecutive elements, so they share one
+/// entry, whose extents cover them all.  That's the granularity of
+/// skipping (a reader drops a whole repeated field at once).  Within a
+/// run, each `FieldSeparate` holds the data size of the element before
+/// it, and the last element's is what's left of the run's.
+///
+/// Building the index takes one pass over the metadata stream, without
+/// looking at the data stream: data offsets are the running sum of
+/// field widths.  Once built, any run can be skipped in constant time
+/// with an `IndexedMetaReader`.
+struct SubmessageIndex {
+  SubmessageIndex() = default;
+
+  /// `SubmessageIndex`es are move-only, like `WriteBuffer`s.
+  SubmessageIndex(const SubmessageIndex &) = delete;
+  SubmessageIndex(SubmessageIndex &&) = default;
+  SubmessageIndex &operator=(const SubmessageIndex &) = delete;
+  SubmessageIndex &operator=(SubmessageIndex &&) = default;
+
+  static void SelfTest();
+
+  /// Rebuilds the index for the `size` bytes of metadata at `meta`.
+  ///
+  /// Returns false if the stream is malformed (including run sizes
+  /// that don't match their contents' widths), or doesn't end with
+  /// the close of the top-level message.
+  bool build(const void *meta, size_t size);
+
+  std::vector<SubmessageRun> runs;
+
+ private:
+  /// Indices of the currently open runs.
+  std::vector<uint32_t> open_;
+};
+
+/// An `IndexedMetaReader` decodes instructions with a `MetaReader`,
+/// and uses a `SubmessageIndex` to `skip_run` in constant time.
+struct IndexedMetaReader {
+  IndexedMetaReader() = delete;
+
+  /// Reads the `size` bytes at `meta`, which must have been indexed
+  /// by `index`.  Both must outlive the reader.
+  IndexedMetaReader(const void *meta, size_t size,
+                    const SubmessageIndex &index)
+      : reader_(meta, size), index_(&index) {}
+
+  /// Decodes the next instruction into `out`.  See `MetaReader::next`.
+  inline bool next(MetaInstruction *out) {
+    if (!reader_.next(out)) return false;
+
+    if (out->op == Opcode::OpenField) current_ = next_run_++;
+    return true;
+  }
+
+  /// Returns true once the whole stream has been consumed.
+  inline bool done() const { return reader_.done(); }
+
+  /// Skips the rest of the run opened by the last instruction.  See
+  /// `MetaReader::skip_run`.
+  inline bool skip_run(uint64_t *run_size) {
+    if (__builtin_expect(current_ >= index_->runs.size(), 0)) return false;
+
+    const SubmessageRun &run = index_->runs[current_];
+
+    reader_.seek(run.meta_end);
+    next_run_ = run.next;
+    *run_size = run.data_size;
+    return true;
+  }
+
+ private:
+  MetaReader reader_;
+  const SubmessageIndex *index_;
+  // Index of the run for the last `OpenField`.
+  size_t current_{SIZE_MAX};
+  // Index of the run for the next `OpenField`.
+  size_t next_run_{0};
+};
@@ -1,9 +1,44 @@
-#include <sys/time.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
 
+#include "archive.h"
 #include "base_meta_writer.h"
+#include "batch.h"
+#include "bench.h"
+#include "buffer_pool.h"
+#include "columnar.h"
+#include "benchmark_message1_proto2.split.h"
+#include "benchmark_message2.split.h"
+#include "data_reader.h"
 #include "data_writer.h"
+#include "decoder.h"
+#include "field_table.h"
+#include "json.h"
+#include "layout.h"
+#include "meta_reader.h"
+#include "meta_scan.h"
+#include "message_view.h"
+#include "meta_writer.h"
+#include "parallel_decode.h"
+#include "parallel_encode.h"
+#include "radix128.h"
+#include "split_literal_meta.h"
+#include "stream.h"
+#include "submessage_index.h"
+#include "transcode.h"
+#include "worker_pool.h"
 
 namespace {
 void data() {
@@ -202,11 +237,1813 @@ __attribute__((noinline)) void test_meta(const Message &message,
   return;
 }
 
-double now() {
-  timeval tv;
+using SubmessageLayout = layout::Layout<
+    layout::Varint<1, &Submessage::field_1>,
+    layout::Varint<2, &Submessage::field_2>,
+    layout::String<15, &Submessage::field_15>,
+    layout::Fixed<21, &Submessage::field_21>,
+    layout::Varint<22, &Submessage::field_22>,
+    layout::Fixed<23, &Submessage::field_23>>;
 
-  gettimeofday(&tv, nullptr);
-  return tv.tv_sec + 1e-6 * tv.tv_usec;
+using MessageLayout = layout::Layout<
+    layout::Varint<2, &Message::field_2>, layout::Varint<3, &Message::field_3>,
+    layout::String<4, &Message::field_4>, layout::String<9, &Message::field_9>,
+    layout::Fixed<12, &Message::field_12>,
+    layout::Fixed<13, &Message::field_13>,
+    layout::Fixed<14, &Message::field_14>,
+    layout::Message<15, &Message::field_15, SubmessageLayout>,
+    layout::Fixed<17, &Message::field_17>,
+    layout::String<18, &Message::field_18>,
+    layout::Varint<67, &Message::field_67>,
+    layout::Varint<100, &Message::field_100>>;
+
+/// Same as `test_meta`, with the opcodes picked by `MessageLayout`.
+__attribute__((noinline)) void test_layout_meta(const Message &message,
+                                                WriteBuffer *meta_buf,
+                                                WriteBuffer *data_buf) {
+  BaseMetaWriter meta(std::move(*meta_buf));
+  DataWriter data(std::move(*data_buf));
+
+  MessageLayout::encode(message, &meta, &data);
+
+  *meta_buf = std::move(meta.buf);
+  *data_buf = std::move(data.buf);
+  return;
+}
+
+/// Same as `test_meta`, with one `MetaWriter` call per field.
+__attribute__((noinline)) void test_meta_writer(const Message &message,
+                                                WriteBuffer *meta_buf,
+                                                WriteBuffer *data_buf) {
+  MetaWriter meta(std::move(*meta_buf));
+  DataWriter data(std::move(*data_buf));
+  const Submessage &sub_15 = message.field_15;
+
+  meta.field(2, data.varint(message.field_2));
+  meta.field(3, data.varint(message.field_3));
+  meta.string(4, data.string(message.field_4));
+  meta.string(9, data.string(message.field_9));
+  meta.field(12, data.fixed(message.field_12));
+  meta.field(13, data.fixed(message.field_13));
+  meta.field(14, data.fixed(message.field_14));
+
+  size_t submessage_begin = data.buf.written();
+  meta.open(15, 0);
+  meta.field(1, data.varint(sub_15.field_1));
+  meta.field(2, data.varint(sub_15.field_2));
+  meta.string(15, data.string(sub_15.field_15));
+  meta.field(21, data.fixed(sub_15.field_21));
+  meta.field(22, data.varint(sub_15.field_22));
+  meta.field(23, data.fixed(sub_15.field_23));
+  meta.close(data.buf.written() - submessage_begin);
+
+  meta.field(17, data.fixed(message.field_17));
+  meta.string(18, data.string(message.field_18));
+  meta.field(67, data.varint(message.field_67));
+  meta.field(100, data.varint(message.field_100));
+  meta.close(data.buf.written());
+
+  *meta_buf = std::move(meta.base.buf);
+  *data_buf = std::move(data.buf);
+  return;
+}
+
+/// Fills a `Message` from `Decode` callbacks.
+struct MessageVisitor {
+  void field(uint32_t field, size_t width, const uint8_t *data) {
+    if (depth > 0) {
+      Submessage &sub = message->field_15;
+
+      switch (field) {
+        case 1:
+          sub.field_1 = DataReader::load(data, width);
+          break;
+        case 2:
+          sub.field_2 = DataReader::load(data, width);
+          break;
+        case 15:
+          sub.field_15.assign((const char *)data, width);
+          break;
+        case 21:
+          sub.field_21 = DataReader::load(data, width);
+          break;
+        case 22:
+          sub.field_22 = DataReader::load(data, width);
+          break;
+        case 23:
+          sub.field_23 = data[0] != 0;
+          break;
+      }
+
+      return;
+    }
+
+    switch (field) {
+      case 2:
+        message->field_2 = DataReader::load(data, width);
+        break;
+      case 3:
+        message->field_3 = DataReader::load(data, width);
+        break;
+      case 4:
+        message->field_4.assign((const char *)data, width);
+        break;
+      case 9:
+        message->field_9.assign((const char *)data, width);
+        break;
+      case 12:
+        message->field_12 = data[0] != 0;
+        break;
+      case 13:
+        message->field_13 = data[0] != 0;
+        break;
+      case 14:
+        message->field_14 = data[0] != 0;
+        break;
+      case 17:
+        message->field_17 = data[0] != 0;
+        break;
+      case 18:
+        message->field_18.assign((const char *)data, width);
+        break;
+      case 67:
+        message->field_67 = DataReader::load(data, width);
+        break;
+      case 100:
+        message->field_100 = DataReader::load(data, width);
+        break;
+    }
+  }
+
+  void open(uint32_t, uint64_t) { depth++; }
+  void separate(uint64_t) {}
+  void close(uint64_t) { depth--; }
+
+  Message *message;
+  int depth{0};
+};
+
+/// Only fills the top-level fields of a `Message`: submessages are
+/// skipped.
+struct TopLevelVisitor : MessageVisitor {
+  bool open(uint32_t, uint64_t) { return false; }
+};
+
+bool same(const Message &x, const Message &y) {
+  const Submessage &sx = x.field_15;
+  const Submessage &sy = y.field_15;
+
+  return x.field_2 == y.field_2 && x.field_3 == y.field_3 &&
+         x.field_4 == y.field_4 && x.field_9 == y.field_9 &&
+         x.field_12 == y.field_12 && x.field_13 == y.field_13 &&
+         x.field_14 == y.field_14 && sx.field_1 == sy.field_1 &&
+         sx.field_2 == sy.field_2 && sx.field_15 == sy.field_15 &&
+         sx.field_21 == sy.field_21 && sx.field_22 == sy.field_22 &&
+         sx.field_23 == sy.field_23 && x.field_17 == y.field_17 &&
+         x.field_18 == y.field_18 && x.field_67 == y.field_67 &&
+         x.field_100 == y.field_100;
+}
+
+__attribute__((noinline)) bool test_decode(const WriteBuffer &meta,
+                                           const WriteBuffer &data,
+                                           Message *message) {
+  MessageVisitor visitor{message};
+
+  return Decode(meta.data(), meta.written(), data.data(), data.written(),
+                &visitor);
+}
+
+__attribute__((noinline)) bool test_scan_decode(const WriteBuffer &meta,
+                                                const WriteBuffer &data,
+                                                MetaScan *scan,
+                                                Message *message) {
+  MessageVisitor visitor{message};
+
+  scan->scan(meta.data(), meta.written());
+
+  ScannedMetaReader meta_reader(meta.data(), meta.written(), *scan);
+  DataReader data_reader(data.data(), data.written());
+  return Decode(&meta_reader, &data_reader, &visitor);
+}
+
+template <typename Meta>
+__attribute__((noinline)) bool test_skip_decode(Meta *meta_reader,
+                                                const WriteBuffer &data,
+                                                Message *message) {
+  TopLevelVisitor visitor{{message}};
+  DataReader data_reader(data.data(), data.written());
+
+  return Decode(meta_reader, &data_reader, &visitor);
+}
+
+/// Sums the field numbers, widths, and first data bytes a decode
+/// sees, as a cheap `Decode` workload that `ParallelDecode` can split.
+struct ChecksumVisitor {
+  void field(uint32_t field, size_t width, const uint8_t *data) {
+    sum += field + width + data[0];
+  }
+
+  void open(uint32_t field, uint64_t len_hint) { sum += field + len_hint; }
+  void separate(uint64_t size) { sum += size; }
+  void close(uint64_t size) { sum += size; }
+
+  uint64_t sum{0};
+};
+
+using benchmarks::proto2::GoogleMessage1;
+using benchmarks::proto2::GoogleMessage1SubMessage;
+using benchmarks::proto2::GoogleMessage1SubMessageView;
+using benchmarks::proto2::GoogleMessage1View;
+using benchmarks::proto2::GoogleMessage2;
+using benchmarks::proto2::GoogleMessage2_Group1;
+using benchmarks::proto2::GoogleMessage2View;
+
+/// Copies a `Message` to the struct generated by `splitc`.
+GoogleMessage1 to_generated(const Message &message) {
+  GoogleMessage1 ret;
+  const Submessage &sub = message.field_15;
+
+  ret.field2 = message.field_2;
+  ret.field3 = message.field_3;
+  ret.field4 = message.field_4;
+  ret.field9 = message.field_9;
+  ret.field12 = message.field_12;
+  ret.field13 = message.field_13;
+  ret.field14 = message.field_14;
+  ret.field15.field1 = sub.field_1;
+  ret.field15.field2 = sub.field_2;
+  ret.field15.field15 = sub.field_15;
+  ret.field15.field21 = sub.field_21;
+  ret.field15.field22 = sub.field_22;
+  ret.field15.field23 = sub.field_23;
+  ret.field17 = message.field_17;
+  ret.field18 = message.field_18;
+  ret.field67 = message.field_67;
+  ret.field100 = message.field_100;
+
+  ret.has_field2 = ret.has_field3 = ret.has_field4 = ret.has_field9 = true;
+  ret.has_field12 = ret.has_field13 = ret.has_field14 = true;
+  ret.has_field15 = ret.has_field17 = ret.has_field18 = true;
+  ret.has_field67 = ret.has_field100 = true;
+  ret.field15.has_field1 = ret.field15.has_field2 = true;
+  ret.field15.has_field15 = ret.field15.has_field21 = true;
+  ret.field15.has_field22 = ret.field15.has_field23 = true;
+  return ret;
+}
+
+bool same(const Message &x, const GoogleMessage1 &y) {
+  const Submessage &sx = x.field_15;
+  const auto &sy = y.field15;
+
+  return x.field_2 == y.field2 && x.field_3 == y.field3 &&
+         x.field_4 == y.field4 && x.field_9 == y.field9 &&
+         x.field_12 == y.field12 && x.field_13 == y.field13 &&
+         x.field_14 == y.field14 && sx.field_1 == sy.field1 &&
+         sx.field_2 == sy.field2 && sx.field_15 == sy.field15 &&
+         sx.field_21 == sy.field21 && sx.field_22 == sy.field22 &&
+         sx.field_23 == sy.field23 && x.field_17 == y.field17 &&
+         x.field_18 == y.field18 && x.field_67 == y.field67 &&
+         x.field_100 == y.field100 && !y.has_field1 && y.field5.empty();
+}
+
+__attribute__((noinline)) void test_generated_meta(
+    const GoogleMessage1 &message, WriteBuffer *meta_buf,
+    WriteBuffer *data_buf) {
+  MetaWriter meta(std::move(*meta_buf));
+  DataWriter data(std::move(*data_buf));
+
+  codegen::EncodeMessage(message, &meta, &data);
+
+  *meta_buf = std::move(meta.base.buf);
+  *data_buf = std::move(data.buf);
+  return;
+}
+
+__attribute__((noinline)) bool test_generated_decode(const WriteBuffer &meta,
+                                                     const WriteBuffer &data,
+                                                     GoogleMessage1 *message) {
+  return codegen::DecodeMessage(meta.data(), meta.written(), data.data(),
+                                data.written(), message);
+}
+
+/// Round trips a message2 with groups, repeated scalars, and nested
+/// submessages through the generated code.
+void generated_self_test() {
+  GoogleMessage2 message;
+
+  message.field1 = "field1";
+  message.has_field1 = true;
+  message.field3 = -3;
+  message.has_field3 = true;
+  message.field222 = 2.5;
+  message.has_field222 = true;
+  message.field128 = {"a", "", "ccc"};
+  message.field130 = {1, -2, 1ULL << 40};
+  message.field206 = true;
+  message.has_field206 = true;
+
+  for (size_t i = 0; i < 3; i++) {
+    auto &group = message.group1.emplace_back();
+
+    group.field11 = i;
+    group.has_field11 = true;
+    group.field15 = 1000 * i;
+    group.has_field15 = true;
+    group.field73 = std::vector<int32_t>(i, -1);
+    if (i == 1) {
+      group.field14 = {"x", "y"};
+      group.field31.field3 = 0.5;
+      group.field31.has_field3 = true;
+      group.field31.field11 = 11;
+      group.field31.has_field11 = true;
+      group.has_field31 = true;
+    }
+  }
+
+  MetaWriter meta(16);
+  DataWriter data(16);
+  GoogleMessage2 decoded;
+
+  codegen::EncodeMessage(message, &meta, &data);
+
+  bool success = codegen::DecodeMessage(
+      meta.base.buf.data(), meta.base.buf.written(), data.buf.data(),
+      data.buf.written(), &decoded);
+
+  (void)success;
+  assert(success);
+  assert(decoded.has_field1 && decoded.field1 == "field1");
+  assert(decoded.has_field3 && decoded.field3 == -3);
+  assert(decoded.has_field222 && decoded.field222 == 2.5);
+  assert(!decoded.has_field4);
+  assert(decoded.field128 == message.field128);
+  assert(decoded.field130 == message.field130);
+  assert(decoded.has_field206 && decoded.field206);
+  assert(decoded.group1.size() == 3);
+  for (size_t i = 0; i < 3; i++) {
+    const auto &expected = message.group1[i];
+    const auto &actual = decoded.group1[i];
+
+    (void)expected;
+    (void)actual;
+    assert(actual.field11 == expected.field11);
+    assert(actual.field15 == expected.field15);
+    assert(actual.field73 == expected.field73);
+    assert(actual.field14 == expected.field14);
+    assert(actual.has_field31 == expected.has_field31);
+    assert(actual.field31.field3 == expected.field31.field3);
+    assert(actual.field31.field11 == expected.field31.field11);
+  }
+
+  // Truncated data stream.
+  assert(!codegen::DecodeMessage(meta.base.buf.data(), meta.base.buf.written(),
+                                 data.buf.data(), data.buf.written() - 1,
+                                 &decoded));
+
+  // The sized, unchecked encoder writes the same bytes, within its
+  // bounds, after a previous message too.
+  codegen::EncodeBounds bounds;
+  MetaWriter unchecked_meta(16);
+  DataWriter unchecked_data(16);
+
+  AddEncodeBounds(message, &bounds);
+  assert(bounds.meta >= meta.base.buf.written());
+  assert(bounds.data >= data.buf.written());
+  for (size_t i = 1; i <= 2; i++) {
+    codegen::EncodeMessageUnchecked(message, &unchecked_meta, &unchecked_data);
+    assert(unchecked_meta.base.buf.written() == i * meta.base.buf.written());
+    assert(unchecked_data.buf.written() == i * data.buf.written());
+  }
+
+  assert(memcmp(unchecked_meta.base.buf.data(), meta.base.buf.data(),
+                meta.base.buf.written()) == 0);
+  assert(memcmp(unchecked_data.buf.data(), data.buf.data(),
+                data.buf.written()) == 0);
+
+  // Batched varint runs write the same bytes as a `varint` per
+  // element, across several batches.
+  std::vector<int32_t> values;
+  MetaWriter run_meta(16);
+  DataWriter run_data(16);
+  MetaWriter batched_meta(16);
+  DataWriter batched_data(16);
+
+  for (int32_t i = 0; i < 600; i++) values.push_back((i % 7 - 3) << (i % 31));
+  codegen::EncodeRun(&run_meta, &run_data, 5, true, values.size(),
+                     [&](size_t i) {
+                       run_meta.field(
+                           1, run_data.varint((uint64_t)(int64_t)values[i]));
+                     });
+  codegen::EncodeVarintRun(&batched_meta, &batched_data, 5, values);
+  assert(batched_meta.base.buf.written() == run_meta.base.buf.written());
+  assert(batched_data.buf.written() == run_data.buf.written());
+  assert(memcmp(batched_meta.base.buf.data(), run_meta.base.buf.data(),
+                run_meta.base.buf.written()) == 0);
+  assert(memcmp(batched_data.buf.data(), run_data.buf.data(),
+                run_data.buf.written()) == 0);
+
+  // The split-literal encoding decodes to the same fields, with the
+  // same data stream.
+  SplitLiteralMetaWriter split_meta(16);
+  DataWriter split_data(16);
+  ChecksumVisitor expected_sum;
+  ChecksumVisitor split_sum;
+
+  codegen::EncodeMessage(message, &split_meta, &split_data);
+  assert(split_data.buf.written() == data.buf.written());
+  assert(memcmp(split_data.buf.data(), data.buf.data(),
+                data.buf.written()) == 0);
+
+  SplitLiteralMetaReader split_reader(
+      split_meta.base.buf.data(), split_meta.base.buf.written(),
+      split_meta.base.literals.data(), split_meta.base.literals.written());
+  DataReader split_data_reader(split_data.buf.data(), split_data.buf.written());
+
+  success = Decode(meta.base.buf.data(), meta.base.buf.written(),
+                   data.buf.data(), data.buf.written(), &expected_sum) &&
+            Decode(&split_reader, &split_data_reader, &split_sum);
+  assert(success && split_sum.sum == expected_sum.sum);
+
+  // Runs nested up to `kMaxDepth` deep decode (as unknown fields), and
+  // deeper ones fail rather than exhausting the stack.
+  for (size_t depth : {decoder_internal::kMaxDepth,
+                       decoder_internal::kMaxDepth + 1}) {
+    BaseMetaWriter nested(16);
+
+    for (size_t i = 0; i < depth; i++) nested.open_field(0, 0);
+    for (size_t i = 0; i <= depth; i++) nested.field_close(0, 0);
+
+    success = codegen::DecodeMessage(nested.buf.data(), nested.buf.written(),
+                                     "", 0, &decoded);
+    assert(success == (depth == decoder_internal::kMaxDepth));
+  }
+
+  {
+    std::string hostile(10 << 20, (char)Opcode::OpenField);
+    GoogleMessage1 decoded1;
+
+    success = codegen::DecodeMessage(hostile.data(), hostile.size(), "", 0,
+                                     &decoded1) ||
+              codegen::DecodeMessage(hostile.data(), hostile.size(), "", 0,
+                                     &decoded);
+    assert(!success);
+  }
+
+  (void)success;
+}
+
+double now() { return 1e-9 * BenchClock::ns_per_tick() * BenchClock::ticks(); }
+
+/// Reports the cost of writing 65536 repeated int32 and uint64 values
+/// (with a mix of widths) with a `varint` call each and with
+/// `DataWriter::varints`, alone and as the run of a top-level message
+/// with its metadata (`EncodeRun` against `EncodeVarintRun`).
+void bench_varints() {
+  constexpr size_t kCount = 1 << 16;
+  std::vector<int32_t> values32(kCount);
+  std::vector<uint64_t> values64(kCount);
+  std::vector<uint8_t> widths(kCount);
+  uint64_t state = 42;
+
+  for (size_t i = 0; i < kCount; i++) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    values32[i] = (int32_t)(state >> 32) >> (state % 32);
+    values64[i] = state >> (state % 64);
+  }
+
+  auto time = [](auto &&body) {
+    double begin = now();
+
+    for (size_t i = 0; i < 64; i++) body();
+    return 1e9 * (now() - begin) / (64 * kCount);
+  };
+
+  DataWriter data(16 * kCount);
+  MetaWriter meta(16 * kCount);
+  auto bench = [&](const char *name, const auto &values) {
+    double single = time([&] {
+      data.buf.reset();
+      for (auto value : values) data.varint((uint64_t)(int64_t)value);
+    });
+    size_t size = data.buf.written();
+    double bulk = time([&] {
+      data.buf.reset();
+      data.varints(values.data(), values.size(), widths.data());
+    });
+    double run = time([&] {
+      data.buf.reset();
+      meta.base.buf.reset();
+      codegen::EncodeRun(&meta, &data, 1, true, values.size(), [&](size_t i) {
+        meta.field(1, data.varint((uint64_t)(int64_t)values[i]));
+      });
+      meta.close(data.buf.written());
+    });
+    double batched_run = time([&] {
+      data.buf.reset();
+      meta.base.buf.reset();
+      codegen::EncodeVarintRun(&meta, &data, 1, values);
+      meta.close(data.buf.written());
+    });
+
+    std::cout << "Varints " << name << " (" << size / (double)kCount
+              << " B/value): varint " << single << " ns/value; varints "
+              << bulk << " ns/value; run " << run
+              << " ns/value; batched run " << batched_run << " ns/value\n";
+  };
+
+  bench("int32", values32);
+  bench("uint64", values64);
+}
+
+/// Reports the metadata size and decode speed of 1024 rows of
+/// consecutive same-width fields, each row a submessage with 16 float,
+/// 8 bool, and 8 fixed64 fields: runs of words that `MetaWriter`
+/// writes as `RunFields`.
+void bench_run_fields() {
+  constexpr size_t kRows = 1024;
+  MetaWriter meta(16);
+  DataWriter data(16);
+  size_t run_begin = data.buf.written();
+  size_t message_begin = run_begin;
+
+  meta.open(1, kRows);
+  for (size_t row = 0; row < kRows; row++) {
+    if (row > 0) {
+      meta.separate(data.buf.written() - message_begin);
+      message_begin = data.buf.written();
+    }
+
+    uint32_t field = 1;
+
+    for (size_t i = 0; i < 16; i++)
+      meta.field(field++, data.fixed<float>(0.25f * (row + i)));
+    for (size_t i = 0; i < 8; i++)
+      meta.field(field++, data.fixed<uint8_t>((row >> i) & 1));
+    for (size_t i = 0; i < 8; i++)
+      meta.field(field++, data.fixed<uint64_t>(row << i));
+  }
+
+  meta.close(data.buf.written() - run_begin);
+  meta.close(data.buf.written());
+
+  // Sums every field's low byte, so all the data is read.
+  struct SumVisitor {
+    void field(uint32_t, size_t, const uint8_t *data) { sum += data[0]; }
+    void open(uint32_t, uint64_t) {}
+    void separate(uint64_t) {}
+    void close(uint64_t) {}
+
+    uint64_t sum{0};
+  };
+
+  constexpr size_t kIter = 2000;
+  SumVisitor visitor;
+  bool success = true;
+  double begin = now();
+
+  for (size_t i = 0; i < kIter; i++) {
+    success &= Decode(meta.base.buf.data(), meta.base.buf.written(),
+                      data.buf.data(), data.buf.written(), &visitor);
+  }
+
+  double ns = 1e9 * (now() - begin) / (kIter * kRows);
+
+  std::cout << "Run fields (" << kRows << " rows; meta "
+            << meta.base.buf.written() << " B, data " << data.buf.written()
+            << " B): decode " << ns << " ns/row"
+            << (success ? "" : " (decode failed)") << " [" << visitor.sum
+            << "]\n";
+}
+
+/// Reports the `radix128` implementation selected for this CPU, and
+/// the speed of every implementation the CPU supports.
+void bench_radix128(size_t niter) {
+  size_t count;
+  const Radix128Impl *impls = Radix128Impls(&count);
+
+  std::cout << "Radix-128: " << radix128->name << "\n";
+  for (size_t i = 0; i < count; i++) {
+    const Radix128Impl &impl = impls[i];
+    uint64_t acc = 0;
+
+    double begin = now();
+    for (size_t j = 0; j < niter; j++) {
+      acc += impl.expand_64((j * 0x9E3779B97F4A7C15ULL) >> 8);
+    }
+
+    double mid = now();
+    for (size_t j = 0; j < niter; j++) {
+      acc += impl.compress_64((j * 0x9E3779B97F4A7C15ULL) & 0x7F7F7F7F7F7F7F7FULL);
+    }
+
+    double end = now();
+
+    asm volatile("" ::"r"(acc));
+    std::cout << "\t" << impl.name
+              << " expand: " << 1e9 * (mid - begin) / niter
+              << " ns/op; compress: " << 1e9 * (end - mid) / niter
+              << " ns/op\n";
+  }
+
+  return;
+}
+
+// `message2.json` follows the README, not `benchmark_message2.proto`:
+// `Group1` is field 5, and its `field73` isn't repeated.  Fields past
+// each index are found by binary search.
+const FieldSchema kMessage2JsonSubFields[] = {
+    {1, FieldKind::Float, false, nullptr}, {3, FieldKind::Float, false, nullptr},
+    {4, FieldKind::Bool, false, nullptr},  {5, FieldKind::Bool, false, nullptr},
+    {6, FieldKind::Bool, false, nullptr},  {7, FieldKind::Bool, false, nullptr},
+    {8, FieldKind::Float, false, nullptr},
+};
+
+const uint16_t kMessage2JsonSubIndex[] = {0, 1, 0, 2, 3, 4, 5, 6, 7};
+
+const MessageSchema kMessage2JsonSubSchema = {
+    "Message2JsonSub", kMessage2JsonSubFields, 7, kMessage2JsonSubIndex, 9};
+
+const FieldSchema kMessage2JsonGroupFields[] = {
+    {5, FieldKind::Varint, false, nullptr},
+    {11, FieldKind::Float, false, nullptr},
+    {12, FieldKind::Bytes, false, nullptr},
+    {15, FieldKind::Varint, false, nullptr},
+    {31, FieldKind::Message, false, &kMessage2JsonSubSchema},
+    {73, FieldKind::Varint, false, nullptr},
+};
+
+const uint16_t kMessage2JsonGroupIndex[] = {0, 0, 0, 0, 0, 1, 0, 0,
+                                            0, 0, 0, 2, 3, 0, 0, 4};
+
+const MessageSchema kMessage2JsonGroupSchema = {
+    "Message2JsonGroup", kMessage2JsonGroupFields, 6, kMessage2JsonGroupIndex,
+    16};
+
+const FieldSchema kMessage2JsonFields[] = {
+    {2, FieldKind::Bytes, false, nullptr},
+    {3, FieldKind::Varint, false, nullptr},
+    {4, FieldKind::Varint, false, nullptr},
+    {5, FieldKind::Message, true, &kMessage2JsonGroupSchema},
+    {21, FieldKind::Varint, false, nullptr},
+    {25, FieldKind::Float, false, nullptr},
+    {71, FieldKind::Varint, false, nullptr},
+    {129, FieldKind::Varint, false, nullptr},
+    {205, FieldKind::Bool, false, nullptr},
+    {206, FieldKind::Bool, false, nullptr},
+};
+
+const uint16_t kMessage2JsonIndex[] = {0, 0, 1, 2, 3, 4, 0, 0, 0, 0, 0, 0, 0,
+                                       0, 0, 0, 0, 0, 0, 0, 0, 5, 0, 0, 0, 6};
+
+const MessageSchema kMessage2JsonSchema = {
+    "Message2Json", kMessage2JsonFields, 10, kMessage2JsonIndex, 26};
+
+bool read_file(const char *path, std::string *out) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream contents;
+
+  contents << in.rdbuf();
+  if (!in) return false;
+
+  *out = contents.str();
+  return true;
+}
+
+/// Ingests the JSON document in `path`, and reports the throughput in
+/// GB/s of JSON bytes.  If `pb_path` isn't null, the split streams
+/// must match `ProtobufToSplit`'s for that protobuf file.
+///
+/// Returns false on mismatch; unreadable files are skipped.
+bool bench_json(const char *path, const MessageSchema &schema,
+                const char *pb_path) {
+  std::string json;
+
+  if (!read_file(path, &json)) {
+    std::cout << "JSON " << path << ": skipped (unreadable)\n";
+    return true;
+  }
+
+  JsonScan scan;
+  MetaWriter meta(json.size());
+  DataWriter data(json.size());
+
+  if (!JsonToSplit(json.data(), json.size(), schema, &scan, &meta, &data)) {
+    std::cout << "JSON " << path << ": ingestion failed\n";
+    return false;
+  }
+
+  std::string pb;
+  if (pb_path != nullptr && read_file(pb_path, &pb)) {
+    MetaWriter pb_meta(pb.size());
+    DataWriter pb_data(pb.size());
+
+    // The hand-converted JSON rounds some 64-bit integers, so only the
+    // metadata streams must be identical.
+    if (!ProtobufToSplit(pb.data(), pb.size(), schema, &pb_meta, &pb_data) ||
+        pb_data.buf.written() != data.buf.written() ||
+        pb_meta.base.buf.written() != meta.base.buf.written() ||
+        memcmp(pb_meta.base.buf.data(), meta.base.buf.data(),
+               meta.base.buf.written()) != 0) {
+      std::cout << "JSON " << path << ": mismatch with " << pb_path << "\n";
+      return false;
+    }
+  }
+
+  // About 1 GB of JSON.
+  size_t niter = (1UL << 30) / json.size() + 1;
+
+  double begin = now();
+  for (size_t i = 0; i < niter; i++) {
+    meta.base.buf.reset();
+    data.buf.reset();
+    asm volatile("" ::"r"(json.data()) : "memory");
+    JsonToSplit(json.data(), json.size(), schema, &scan, &meta, &data);
+  }
+
+  double end = now();
+
+  std::cout << "JSON " << path << " (" << json.size() << " B; " << scan.count
+            << " tokens; meta " << meta.base.buf.written() << " B, data "
+            << data.buf.written() << " B): "
+            << 1e-9 * json.size() * niter / (end - begin) << " GB/s\n";
+  return true;
+}
+
+/// Packs copies of the message1 in `path` (each with a different
+/// `field2`) into a batch, and reports the cost of building it, of
+/// walking its records, of decoding them in order and at random, and
+/// of reading 3 fields of each in place with a `GoogleMessage1View`.
+///
+/// Returns false on mismatch; unreadable files are skipped.
+bool bench_batch(const char *path, const MessageSchema &schema) {
+  std::string pb;
+
+  if (!read_file(path, &pb)) {
+    std::cout << "Batch " << path << ": skipped (unreadable)\n";
+    return true;
+  }
+
+  GoogleMessage1 message;
+  MetaWriter meta(pb.size());
+  DataWriter data(pb.size());
+
+  if (!ProtobufToSplit(pb.data(), pb.size(), schema, &meta, &data) ||
+      !codegen::DecodeMessage(meta.base.buf.data(), meta.base.buf.written(),
+                              data.buf.data(), data.buf.written(),
+                              &message)) {
+    std::cout << "Batch " << path << ": decode failed\n";
+    return false;
+  }
+
+  constexpr size_t kRecords = 1 << 16;
+  BatchWriter writer;
+  WriteBuffer container(16);
+
+  double begin = now();
+  for (size_t i = 0; i < kRecords; i++) {
+    message.field2 = i;
+    codegen::EncodeMessage(message, &writer.meta, &writer.data);
+    writer.end_record();
+  }
+
+  writer.finish(&container);
+  double built = now();
+
+  BatchReader reader;
+  BatchRecord record;
+  size_t total = 0;
+
+  if (!reader.init(container.data(), container.written()) ||
+      reader.count() != kRecords) {
+    std::cout << "Batch " << path << ": bad container\n";
+    return false;
+  }
+
+  double walk_begin = now();
+  while (reader.next(&record)) total += record.meta_size + record.data_size;
+  double walked = now();
+
+  GoogleMessage1 decoded;
+  const GoogleMessage1 empty;
+  bool success = true;
+
+  reader.seek(0);
+  double decode_begin = now();
+  for (size_t i = 0; reader.next(&record); i++) {
+    decoded = empty;
+    success &= codegen::DecodeMessage(record.meta, record.meta_size,
+                                      record.data, record.data_size,
+                                      &decoded) &&
+               decoded.field2 == (int32_t)i;
+  }
+
+  double decoded_in_order = now();
+  // A fixed odd stride visits every record once, out of order.
+  for (size_t i = 0, j = 0; i < kRecords; i++) {
+    j = (j + 40503) % kRecords;
+    decoded = empty;
+    success &= reader.record(j, &record) &&
+               codegen::DecodeMessage(record.meta, record.meta_size,
+                                      record.data, record.data_size,
+                                      &decoded) &&
+               decoded.field2 == (int32_t)j;
+  }
+
+  double end = now();
+
+  // Views read the 3 fields in place, and agree with the decoded
+  // record.
+  GoogleMessage1View view;
+  GoogleMessage1SubMessageView sub_view;
+  size_t view_total = 0;
+
+  reader.seek(0);
+  double view_begin = now();
+  for (size_t i = 0; reader.next(&record); i++) {
+    view.reset(record.meta, record.meta_size, record.data, record.data_size);
+    view.field15(&sub_view);
+    success &= view.field2() == (int32_t)i;
+    view_total += view.field1().size() + sub_view.field15().size();
+  }
+
+  double viewed = now();
+
+  if (reader.record(0, &record)) {
+    const GoogleMessage1SubMessage &sub = message.field15;
+    codegen::RunView run;
+    codegen::MessageView element;
+    size_t count = 0;
+
+    view.reset(record.meta, record.meta_size, record.data, record.data_size);
+    success &= view.ok() && view.field1() == message.field1 &&
+               view.field3() == message.field3 &&
+               view.field129() == message.field129 &&
+               view.has_field15() && view.field15().ok() &&
+               view.field15().field1() == sub.field1 &&
+               view.field15().field21() == sub.field21 &&
+               view.field15().field206() == sub.field206 &&
+               view_total == kRecords * (message.field1.size() +
+                                         message.field15.field15.size());
+    run = view.field5();
+    while (run.next(&element)) {
+      success &= count < message.field5.size() &&
+                 element.value<uint64_t>(1, 0) == message.field5[count];
+      count++;
+    }
+
+    success &= count == message.field5.size();
+  }
+
+  if (!success || total + kBatchHeaderSize + kRecords * kBatchIndexEntrySize !=
+                      container.written()) {
+    std::cout << "Batch " << path << ": record mismatch\n";
+    return false;
+  }
+
+  double ns = 1e9 / kRecords;
+  std::cout << "Batch " << path << " (" << kRecords << " records, "
+            << container.written() / kRecords << " B/record): build "
+            << ns * (built - begin) << " ns/record; walk "
+            << ns * (walked - walk_begin) << " ns/record; decode in order "
+            << ns * (decoded_in_order - decode_begin)
+            << " ns/record; at random " << ns * (end - decoded_in_order)
+            << " ns/record; view 3 fields " << ns * (viewed - view_begin)
+            << " ns/record\n";
+  return true;
+}
+
+/// Reads 5 flat fields of the message2 in `path`, and 4 fields of
+/// every `group1` element, in no particular order, by decoding the
+/// message, through a `GoogleMessage2View`, and through `FieldTable`s,
+/// and reports the cost of each.
+///
+/// Returns false on mismatch; unreadable files are skipped.
+bool bench_field_table(const char *path, const MessageSchema &schema) {
+  std::string pb;
+
+  if (!read_file(path, &pb)) {
+    std::cout << "Field table " << path << ": skipped (unreadable)\n";
+    return true;
+  }
+
+  MetaWriter meta(pb.size());
+  DataWriter data(pb.size());
+
+  if (!ProtobufToSplit(pb.data(), pb.size(), schema, &meta, &data)) {
+    std::cout << "Field table " << path << ": transcode failed\n";
+    return false;
+  }
+
+  const void *meta_bytes = meta.base.buf.data();
+  size_t meta_size = meta.base.buf.written();
+  const void *data_bytes = data.buf.data();
+  size_t data_size = data.buf.written();
+  size_t niter = (1UL << 26) / pb.size() + 1;
+  uint64_t decoded_sum = 0;
+  uint64_t viewed_sum = 0;
+  uint64_t tabled_sum = 0;
+  bool success = true;
+
+  GoogleMessage2 message;
+  const GoogleMessage2 empty;
+
+  double begin = now();
+  for (size_t i = 0; i < niter; i++) {
+    message = empty;
+    success &= codegen::DecodeMessage(meta_bytes, meta_size, data_bytes,
+                                      data_size, &message);
+    decoded_sum += message.field129 + message.field3 + message.field131 +
+                   message.field21 + message.field4;
+    for (const auto &group : message.group1)
+      decoded_sum +=
+          group.field28 + group.field15 + group.field20 + group.field5;
+  }
+
+  double decoded = now();
+
+  GoogleMessage2View view;
+  codegen::MessageView element_view;
+
+  for (size_t i = 0; i < niter; i++) {
+    view.reset(meta_bytes, meta_size, data_bytes, data_size);
+    viewed_sum += view.field129() + view.field3() + view.field131() +
+                  view.field21() + view.field4();
+
+    codegen::RunView run = view.group1();
+
+    while (run.next(&element_view))
+      viewed_sum += element_view.value<int32_t>(28, 0) +
+                    element_view.value<uint64_t>(15, 0) +
+                    element_view.value<int32_t>(20, 0) +
+                    element_view.value<int32_t>(5, 0);
+  }
+
+  double viewed = now();
+
+  FieldTable table;
+  FieldTable element;
+
+  for (size_t i = 0; i < niter; i++) {
+    success &= table.build(meta_bytes, meta_size, data_bytes, data_size);
+    tabled_sum += table.value<int32_t>(129, 0) + table.value<int64_t>(3, 0) +
+                  table.value<int64_t>(131, 0) + table.value<int32_t>(21, 0) +
+                  table.value<int64_t>(4, 0);
+    for (bool more = element.build_first(table, 10); more;
+         more = element.build_next())
+      tabled_sum += element.value<int32_t>(28, 0) +
+                    element.value<uint64_t>(15, 0) +
+                    element.value<int32_t>(20, 0) +
+                    element.value<int32_t>(5, 0);
+    success &= element.done();
+  }
+
+  double end = now();
+
+  if (!success || viewed_sum != decoded_sum || tabled_sum != decoded_sum) {
+    std::cout << "Field table " << path << ": mismatch\n";
+    return false;
+  }
+
+  double us = 1e6 / niter;
+  std::cout << "Field table " << path << " (" << table.size()
+            << " entries; " << message.group1.size()
+            << " group1 elements): decode " << us * (decoded - begin)
+            << " us/message; view " << us * (viewed - decoded)
+            << " us/message; table " << us * (end - viewed)
+            << " us/message\n";
+  return true;
+}
+
+/// The scalar fields of message2's `group1` elements, as a layout for
+/// row-wise and columnar runs.
+using Group1Layout = layout::Layout<
+    layout::Fixed<5, &GoogleMessage2_Group1::field5>,
+    layout::Fixed<11, &GoogleMessage2_Group1::field11>,
+    layout::Fixed<15, &GoogleMessage2_Group1::field15>,
+    layout::Fixed<20, &GoogleMessage2_Group1::field20>,
+    layout::Fixed<26, &GoogleMessage2_Group1::field26>,
+    layout::Fixed<28, &GoogleMessage2_Group1::field28>>;
+
+using Group1RowsLayout = layout::Layout<
+    layout::Repeated<10, &GoogleMessage2::group1, Group1Layout>>;
+using Group1ColumnsLayout = layout::Layout<
+    layout::Columnar<10, &GoogleMessage2::group1, Group1Layout>>;
+
+/// Writes the scalar fields of the `group1` elements of the message2
+/// in `path` row-wise and in columns, and reports the cost of summing
+/// `field15` and `field11` and selecting the elements with a positive
+/// `field5`: with `MessageView`s over the rows, and with the
+/// `columnar` kernels over the columns.
+///
+/// Returns false on mismatch; unreadable files are skipped.
+/// Reports the metadata sizes of message `T` at `path` (protobuf) in
+/// the interleaved and the split-literal encodings, both written by
+/// the generated encoder, and the speed of `Decode` over each: with a
+/// `MetaReader`, a `MetaScan` and its `ScannedMetaReader`, and a
+/// `SplitLiteralMetaReader`.
+template <typename T>
+bool bench_split_literals(const char *path, const MessageSchema &schema) {
+  std::string pb;
+
+  if (!read_file(path, &pb)) {
+    std::cout << "Split literals " << path << ": skipped (unreadable)\n";
+    return true;
+  }
+
+  MetaWriter transcoded(pb.size());
+  DataWriter transcoded_data(pb.size());
+  T message;
+
+  if (!ProtobufToSplit(pb.data(), pb.size(), schema, &transcoded,
+                       &transcoded_data) ||
+      !codegen::DecodeMessage(transcoded.base.buf.data(),
+                              transcoded.base.buf.written(),
+                              transcoded_data.buf.data(),
+                              transcoded_data.buf.written(), &message)) {
+    std::cout << "Split literals " << path << ": transcode failed\n";
+    return false;
+  }
+
+  MetaWriter meta(16);
+  DataWriter data(16);
+  SplitLiteralMetaWriter split_meta(16);
+  DataWriter split_data(16);
+
+  codegen::EncodeMessage(message, &meta, &data);
+  codegen::EncodeMessage(message, &split_meta, &split_data);
+
+  const void *meta_bytes = meta.base.buf.data();
+  size_t meta_size = meta.base.buf.written();
+  const void *ops = split_meta.base.buf.data();
+  size_t ops_size = split_meta.base.buf.written();
+  const void *literals = split_meta.base.literals.data();
+  size_t literals_size = split_meta.base.literals.written();
+  const void *data_bytes = data.buf.data();
+  size_t data_size = data.buf.written();
+  size_t niter = (1UL << 27) / pb.size() + 1;
+  bool success = true;
+  MetaScan scan;
+
+  auto time = [&](auto &&decode) {
+    ChecksumVisitor visitor;
+    double begin = now();
+
+    for (size_t i = 0; i < niter; i++) {
+      DataReader data_reader(data_bytes, data_size);
+
+      success &= decode(&data_reader, &visitor);
+    }
+
+    double ns = 1e9 * (now() - begin) / niter;
+
+    return std::make_pair(ns, visitor.sum);
+  };
+
+  auto interleaved = time([&](DataReader *data_reader, ChecksumVisitor *v) {
+    MetaReader reader(meta_bytes, meta_size);
+
+    return Decode(&reader, data_reader, v);
+  });
+  auto scanned = time([&](DataReader *data_reader, ChecksumVisitor *v) {
+    scan.scan(meta_bytes, meta_size);
+
+    ScannedMetaReader reader(meta_bytes, meta_size, scan);
+
+    return Decode(&reader, data_reader, v);
+  });
+  auto split = time([&](DataReader *data_reader, ChecksumVisitor *v) {
+    SplitLiteralMetaReader reader(ops, ops_size, literals, literals_size);
+
+    return Decode(&reader, data_reader, v);
+  });
+
+  if (!success || interleaved.second != split.second ||
+      interleaved.second != scanned.second ||
+      split_data.buf.written() != data_size ||
+      memcmp(split_data.buf.data(), data_bytes, data_size) != 0) {
+    std::cout << "Split literals " << path << ": decode mismatch\n";
+    return false;
+  }
+
+  std::cout << "Split literals " << path << " (interleaved meta "
+            << meta_size << " B; split " << ops_size << " B opcodes + "
+            << literals_size << " B literals): interleaved "
+            << interleaved.first << " ns/message; scanned " << scanned.first
+            << " ns/message; split " << split.first << " ns/message\n";
+  return true;
+}
+
+/// Exports a run of copies of the message at `path` (protobuf) as one
+/// top-level message, through a pipe with a `StreamWriter`, while a
+/// thread reads the frames back with `ReadStreamFrame` (dropping each
+/// once read).  Reports the throughput in meta and data bytes, and the
+/// writer's peak buffered bytes, against encoding the whole run in
+/// memory.
+bool bench_stream(const char *path, const MessageSchema &schema) {
+  std::string pb;
+
+  if (!read_file(path, &pb)) {
+    std::cout << "Stream " << path << ": skipped (unreadable)\n";
+    return true;
+  }
+
+  GoogleMessage1 message;
+  MetaWriter meta(pb.size());
+  DataWriter data(pb.size());
+
+  if (!ProtobufToSplit(pb.data(), pb.size(), schema, &meta, &data) ||
+      !codegen::DecodeMessage(meta.base.buf.data(), meta.base.buf.written(),
+                              data.buf.data(), data.buf.written(),
+                              &message)) {
+    std::cout << "Stream " << path << ": decode failed\n";
+    return false;
+  }
+
+  constexpr size_t kRecords = 1 << 18;
+  constexpr size_t kWatermark = 1 << 20;
+
+  // The whole run in memory.
+  MetaWriter run_meta(16);
+  DataWriter run_data(16);
+  double begin = now();
+
+  codegen::EncodeRun(&run_meta, &run_data, 1, true, kRecords, [&](size_t) {
+    EncodeFields(message, &run_meta, &run_data);
+  });
+  run_meta.close(run_data.buf.written());
+
+  double memory_ns = 1e9 * (now() - begin);
+  size_t total = run_meta.base.buf.written() + run_data.buf.written();
+
+  // The same run, streamed.
+  int fds[2];
+
+  if (pipe(fds) != 0) {
+    std::cout << "Stream " << path << ": skipped (no pipe)\n";
+    return true;
+  }
+
+  size_t read_bytes = 0;
+  size_t read_frames = 0;
+  bool read_ok = true;
+  std::thread reader([&] {
+    WriteBuffer frame_meta(kWatermark);
+    WriteBuffer frame_data(kWatermark);
+    bool last = false;
+
+    while (read_ok && !last) {
+      frame_meta.reset();
+      frame_data.reset();
+      read_ok = ReadStreamFrame(fds[0], &frame_meta, &frame_data, &last);
+      read_bytes += frame_meta.written() + frame_data.written();
+      read_frames++;
+    }
+  });
+
+  StreamWriter<FdSink> stream(FdSink{fds[1]}, kWatermark);
+  size_t peak = 0;
+  bool ok = true;
+  auto encode = [&](size_t) {
+    EncodeFields(message, &stream.meta, &stream.data);
+    peak = std::max(peak, stream.buffered());
+    ok &= stream.poll();
+  };
+
+  begin = now();
+  codegen::EncodeRun(&stream.meta, &stream.data, 1, true, kRecords, encode);
+  stream.meta.close(stream.data.buf.written());
+  ok &= stream.finish();
+  close(fds[1]);
+  reader.join();
+
+  double stream_ns = 1e9 * (now() - begin);
+
+  close(fds[0]);
+  if (!ok || !read_ok || read_bytes != total ||
+      read_frames != stream.frames()) {
+    std::cout << "Stream " << path << ": mismatch\n";
+    return false;
+  }
+
+  std::cout << "Stream " << path << " (" << kRecords << " records, "
+            << total << " B in " << read_frames << " frames; peak buffered "
+            << peak << " B): in memory " << total / memory_ns
+            << " GB/s; streamed through a pipe " << total / stream_ns
+            << " GB/s\n";
+  return true;
+}
+
+/// Archives 2^18 copies of the message at `path` (protobuf) to a
+/// temporary file, then replays them: walking the records of each
+/// batch, and decoding each record into a `GoogleMessage1`.  Reports
+/// GB/s of archive file for each, with io_uring and with the
+/// synchronous fallback.
+/// Writes the file at `path` back and drops its pages from the page
+/// cache, so the next read of it comes from the disk.  Returns false
+/// if it can't.
+bool drop_cached(const char *path) {
+  int fd = open(path, O_RDONLY);
+  bool ok = fd >= 0 && fdatasync(fd) == 0 &&
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+
+  if (fd >= 0) close(fd);
+  return ok;
+}
+
+bool bench_archive(const char *path, const MessageSchema &schema) {
+  std::string pb;
+
+  if (!read_file(path, &pb)) {
+    std::cout << "Archive " << path << ": skipped (unreadable)\n";
+    return true;
+  }
+
+  GoogleMessage1 message;
+  MetaWriter meta(pb.size());
+  DataWriter data(pb.size());
+
+  if (!ProtobufToSplit(pb.data(), pb.size(), schema, &meta, &data) ||
+      !codegen::DecodeMessage(meta.base.buf.data(), meta.base.buf.written(),
+                              data.buf.data(), data.buf.written(),
+                              &message)) {
+    std::cout << "Archive " << path << ": decode failed\n";
+    return false;
+  }
+
+  constexpr size_t kRecords = 1 << 18;
+  char archive_path[] = "/tmp/bench_archive_XXXXXX";
+  int fd = mkstemp(archive_path);
+
+  if (fd < 0) {
+    std::cout << "Archive " << path << ": skipped (no temporary file)\n";
+    return true;
+  }
+
+  close(fd);
+  for (bool use_uring : {true, false}) {
+    ArchiveOptions options;
+
+    options.use_uring = use_uring;
+
+    ArchiveWriter writer(options);
+    bool ok = writer.open(archive_path);
+    double begin = now();
+
+    for (size_t i = 0; i < kRecords && ok; i++) {
+      codegen::EncodeMessage(message, &writer.batch.meta, &writer.batch.data);
+      ok = writer.end_record();
+    }
+
+    ok = writer.close() && ok;
+
+    double write_ns = 1e9 * (now() - begin);
+    double size = (double)writer.slots() * options.slot_size;
+    size_t walked = 0;
+    size_t decoded = 0;
+    double walk_ns = 0;
+    double decode_ns = 0;
+
+    for (bool decode : {false, true}) {
+      ArchiveReader reader(options);
+      BatchReader batch;
+      BatchRecord record;
+      size_t &count = decode ? decoded : walked;
+
+      ok &= reader.open(archive_path);
+      begin = now();
+      while (ok && reader.next(&batch)) {
+        while (batch.next(&record)) {
+          if (decode) {
+            ok &= codegen::DecodeMessage(record.meta, record.meta_size,
+                                         record.data, record.data_size,
+                                         &message);
+          }
+
+          count++;
+        }
+      }
+
+      ok &= reader.done() && reader.uring() == writer.uring();
+      (decode ? decode_ns : walk_ns) = 1e9 * (now() - begin);
+    }
+
+    if (!ok || walked != kRecords || decoded != kRecords) {
+      std::cout << "Archive " << path << ": mismatch\n";
+      unlink(archive_path);
+      return false;
+    }
+
+    std::cout << "Archive " << path << " (" << kRecords << " records, "
+              << (size_t)size << " B, "
+              << (writer.uring() ? "io_uring" : "pread/pwrite")
+              << "): write " << size / write_ns << " GB/s; walk "
+              << size / walk_ns << " GB/s; replay " << size / decode_ns
+              << " GB/s\n";
+  }
+
+  // The last archive again, cold (its pages dropped from the page
+  // cache first) and warm: read into slot buffers, or mapped, and
+  // decoded, or viewed in place (3 fields, strings pointing into the
+  // buffers or the mapping).
+  GoogleMessage1View view;
+  GoogleMessage1SubMessageView sub_view;
+  size_t view_total = 0;
+  bool ok = true;
+  auto visit = [&](const BatchRecord &record, bool decode) {
+    if (decode) {
+      return codegen::DecodeMessage(record.meta, record.meta_size,
+                                    record.data, record.data_size, &message);
+    }
+
+    view.reset(record.meta, record.meta_size, record.data, record.data_size);
+    view.field15(&sub_view);
+    view_total += view.field1().size() + sub_view.field15().size();
+    return view.field2() == message.field2;
+  };
+  auto replay = [&](bool mapped, bool cold, bool decode) {
+    size_t count = 0;
+    BatchRecord record;
+    double begin;
+
+    if (cold) ok &= drop_cached(archive_path);
+    begin = now();
+    if (mapped) {
+      MappedArchiveReader reader;
+
+      ok &= reader.open(archive_path);
+      while (ok && reader.next(&record)) {
+        ok &= visit(record, decode);
+        count++;
+      }
+
+      ok &= reader.done();
+    } else {
+      ArchiveReader reader;
+      BatchReader batch;
+
+      ok &= reader.open(archive_path);
+      while (ok && reader.next(&batch)) {
+        while (batch.next(&record)) {
+          ok &= visit(record, decode);
+          count++;
+        }
+      }
+
+      ok &= reader.done();
+    }
+
+    double ns = 1e9 * (now() - begin);
+
+    ok &= count == kRecords;
+    return ns;
+  };
+
+  struct stat st;
+  double size = (stat(archive_path, &st) == 0) ? st.st_size : 0;
+  double cold_read_ns = replay(false, true, true);
+  double cold_mapped_ns = replay(true, true, true);
+  double read_ns = replay(false, false, true);
+  double mapped_ns = replay(true, false, true);
+  double view_read_ns = replay(false, false, false);
+  double view_mapped_ns = replay(true, false, false);
+
+  unlink(archive_path);
+  if (!ok || view_total == 0) {
+    std::cout << "Archive " << path << ": mapped mismatch\n";
+    return false;
+  }
+
+  std::cout << "Archive " << path << " (cold replay): read "
+            << size / cold_read_ns << " GB/s; mapped "
+            << size / cold_mapped_ns << " GB/s\n";
+  std::cout << "Archive " << path << " (warm): replay read "
+            << size / read_ns << " GB/s, mapped " << size / mapped_ns
+            << " GB/s; view read " << size / view_read_ns
+            << " GB/s, mapped " << size / view_mapped_ns << " GB/s\n";
+  return true;
+}
+
+bool bench_columnar(const char *path, const MessageSchema &schema) {
+  std::string pb;
+
+  if (!read_file(path, &pb)) {
+    std::cout << "Columnar " << path << ": skipped (unreadable)\n";
+    return true;
+  }
+
+  GoogleMessage2 message;
+  MetaWriter meta(pb.size());
+  DataWriter data(pb.size());
+
+  if (!ProtobufToSplit(pb.data(), pb.size(), schema, &meta, &data) ||
+      !codegen::DecodeMessage(meta.base.buf.data(), meta.base.buf.written(),
+                              data.buf.data(), data.buf.written(),
+                              &message)) {
+    std::cout << "Columnar " << path << ": decode failed\n";
+    return false;
+  }
+
+  uint64_t expected_sum15 = 0;
+  double expected_sum11 = 0;
+  size_t expected_selected = 0;
+
+  for (const GoogleMessage2_Group1 &group : message.group1) {
+    expected_sum15 += group.field15;
+    expected_sum11 += group.field11;
+    expected_selected += group.field5 > 0;
+  }
+
+  BaseMetaWriter row_meta(16);
+  DataWriter row_data(16);
+  BaseMetaWriter column_meta(16);
+  DataWriter column_data(16);
+
+  Group1RowsLayout::encode(message, &row_meta, &row_data);
+  Group1ColumnsLayout::encode(message, &column_meta, &column_data);
+
+  size_t count = message.group1.size();
+  size_t niter = (1UL << 24) / (count + 1) + 1;
+  std::vector<uint32_t> indices(count);
+  uint64_t sum15 = 0;
+  double sum11 = 0;
+  size_t selected = 0;
+  bool success = true;
+
+  double begin = now();
+  for (size_t i = 0; i < niter; i++) {
+    codegen::MessageView view(row_meta.buf.data(), row_meta.buf.written(),
+                              row_data.buf.data(), row_data.buf.written());
+    codegen::RunView run;
+    codegen::MessageView element;
+
+    sum15 = 0;
+    sum11 = 0;
+    selected = 0;
+    success &= view.run(10, &run);
+    for (uint32_t j = 0; run.next(&element); j++) {
+      sum15 += element.value<uint64_t>(15, 0);
+      sum11 += element.value<float>(11, 0);
+      if (element.value<int32_t>(5, 0) > 0) indices[selected++] = j;
+    }
+  }
+
+  double rows = now();
+  success &= sum15 == expected_sum15 && sum11 == expected_sum11 &&
+             selected == expected_selected;
+
+  for (size_t i = 0; i < niter; i++) {
+    codegen::MessageView view(column_meta.buf.data(),
+                              column_meta.buf.written(),
+                              column_data.buf.data(),
+                              column_data.buf.written());
+    columnar::RunColumns columns;
+    columnar::Column<uint64_t> field15;
+    columnar::Column<float> field11;
+    columnar::Column<int32_t> field5;
+
+    success &= columns.init(view, 10) && columns.get(15, &field15) &&
+               columns.get(11, &field11) && columns.get(5, &field5);
+    sum15 = columnar::Sum(field15);
+    sum11 = columnar::Sum(field11);
+    selected = columnar::SelectGreater(field5, 0, indices.data());
+  }
+
+  double end = now();
+
+  // The columnar float sum adds in another order.
+  if (!success || sum15 != expected_sum15 ||
+      std::abs(sum11 - expected_sum11) >
+          1e-9 * std::abs(expected_sum11) + 1e-9 ||
+      selected != expected_selected) {
+    std::cout << "Columnar " << path << ": mismatch\n";
+    return false;
+  }
+
+  double ns = 1e9 / (niter * (count + 1));
+  std::cout << "Columnar " << path << " (" << count << " group1 elements; rows "
+            << row_meta.buf.written() << " B meta, " << row_data.buf.written()
+            << " B data; columns " << column_meta.buf.written()
+            << " B meta, " << column_data.buf.written()
+            << " B data): rows " << ns * (rows - begin)
+            << " ns/element; columns " << ns * (end - rows)
+            << " ns/element\n";
+  return true;
+}
+
+/// Transcodes the protobuf message in `path` to split streams and
+/// back, checks that the round trip is exact, and reports the
+/// throughput of both directions in MB/s of protobuf bytes.
+///
+/// Returns false on mismatch; unreadable files are skipped.
+bool bench_transcode(const char *path, const MessageSchema &schema) {
+  std::string pb;
+
+  if (!read_file(path, &pb)) {
+    std::cout << "Transcode " << path << ": skipped (unreadable)\n";
+    return true;
+  }
+
+  MetaWriter meta(pb.size());
+  DataWriter data(pb.size());
+  WriteBuffer out(pb.size());
+
+  if (!ProtobufToSplit(pb.data(), pb.size(), schema, &meta, &data) ||
+      !SplitToProtobuf(meta.base.buf.data(), meta.base.buf.written(),
+                       data.buf.data(), data.buf.written(), schema, &out) ||
+      out.written() != pb.size() ||
+      memcmp(out.data(), pb.data(), pb.size()) != 0) {
+    std::cout << "Transcode " << path << ": round trip mismatch\n";
+    return false;
+  }
+
+  // About 256 MB of protobuf in each direction.
+  size_t niter = (1UL << 28) / pb.size() + 1;
+  double mb = 1e-6 * pb.size() * niter;
+
+  double begin = now();
+  for (size_t i = 0; i < niter; i++) {
+    meta.base.buf.reset();
+    data.buf.reset();
+    asm volatile("" ::"r"(pb.data()) : "memory");
+    ProtobufToSplit(pb.data(), pb.size(), schema, &meta, &data);
+  }
+
+  double mid = now();
+  for (size_t i = 0; i < niter; i++) {
+    out.reset();
+    asm volatile("" ::"r"(data.buf.data()) : "memory");
+    SplitToProtobuf(meta.base.buf.data(), meta.base.buf.written(),
+                    data.buf.data(), data.buf.written(), schema, &out);
+  }
+
+  double end = now();
+
+  std::cout << "Transcode " << path << " (" << pb.size() << " B; meta "
+            << meta.base.buf.written() << " B, data " << data.buf.written()
+            << " B): pb->split " << mb / (mid - begin)
+            << " MB/s; split->pb " << mb / (end - mid) << " MB/s\n";
+  return true;
+}
+
+/// Benchmarks the generated encoder and decoder on the protobuf
+/// message in `path` (transcoded to split streams), with the same
+/// variants as `cpp-benchmark` in the README: `_parse_new` decodes
+/// into a fresh `T`, `_parse_reuse` into one reset by copy assignment
+/// (which keeps the top-level strings' and vectors' storage),
+/// `_visit` walks the streams with `Decode` and a `ChecksumVisitor`,
+/// `_visit_parallel` with `ParallelDecode` (up to a chunk per worker,
+/// with the default `min_chunk`), and `_serialize` encodes into
+/// reused buffers, `_serialize_new` into new ones, `_serialize_pooled`
+/// into `PooledWriters`, and `_serialize_segmented` into new segmented
+/// buffers (4 KB chunks) exported as `iovec`s.  Throughput is in MB/s
+/// of protobuf bytes, like the README.
+///
+/// Returns false on mismatch; unreadable files are skipped.
+template <typename T>
+bool bench_message(const char *name, const char *path,
+                   const MessageSchema &schema, PerfCounters *counters) {
+  std::string pb;
+
+  if (!read_file(path, &pb)) {
+    std::cout << name << ": skipped (" << path << " unreadable)\n";
+    return true;
+  }
+
+  T message;
+  MetaWriter meta(pb.size());
+  DataWriter data(pb.size());
+
+  if (!ProtobufToSplit(pb.data(), pb.size(), schema, &meta, &data) ||
+      !codegen::DecodeMessage(meta.base.buf.data(), meta.base.buf.written(),
+                              data.buf.data(), data.buf.written(),
+                              &message)) {
+    std::cout << name << ": decode failed\n";
+    return false;
+  }
+
+  // The generated encoder must write the same message back.
+  WriteBuffer out(pb.size());
+
+  meta.base.buf.reset();
+  data.buf.reset();
+  codegen::EncodeMessage(message, &meta, &data);
+  if (!SplitToProtobuf(meta.base.buf.data(), meta.base.buf.written(),
+                       data.buf.data(), data.buf.written(), schema, &out) ||
+      out.written() != pb.size() ||
+      memcmp(out.data(), pb.data(), pb.size()) != 0) {
+    std::cout << name << ": round trip mismatch\n";
+    return false;
+  }
+
+  // So must the sized, unchecked encoder.
+  MetaWriter unchecked_meta(16);
+  DataWriter unchecked_data(16);
+
+  codegen::EncodeMessageUnchecked(message, &unchecked_meta, &unchecked_data);
+  if (unchecked_meta.base.buf.written() != meta.base.buf.written() ||
+      unchecked_data.buf.written() != data.buf.written() ||
+      memcmp(unchecked_meta.base.buf.data(), meta.base.buf.data(),
+             meta.base.buf.written()) != 0 ||
+      memcmp(unchecked_data.buf.data(), data.buf.data(),
+             data.buf.written()) != 0) {
+    std::cout << name << ": unchecked encoder mismatch\n";
+    return false;
+  }
+
+  // Runs encoded in parallel decode to the same message (their first
+  // field isn't folded in the `OpenField`, so the bytes can differ).
+  WorkerPool pool(std::max(2U, std::thread::hardware_concurrency()));
+  codegen::ParallelOptions parallel;
+  MetaWriter parallel_meta(16);
+  DataWriter parallel_data(16);
+  MetaWriter reencoded_meta(16);
+  DataWriter reencoded_data(16);
+  T reencoded;
+
+  parallel.pool = &pool;
+  parallel.min_chunk = 1;
+  codegen::EncodeMessageParallel(message, &parallel_meta, &parallel_data,
+                                 parallel);
+  parallel.min_chunk = codegen::ParallelOptions().min_chunk;
+  if (!codegen::DecodeMessage(
+          parallel_meta.base.buf.data(), parallel_meta.base.buf.written(),
+          parallel_data.buf.data(), parallel_data.buf.written(),
+          &reencoded) ||
+      parallel_data.buf.written() != data.buf.written() ||
+      memcmp(parallel_data.buf.data(), data.buf.data(),
+             data.buf.written()) != 0) {
+    std::cout << name << ": parallel encoder mismatch\n";
+    return false;
+  }
+
+  codegen::EncodeMessage(reencoded, &reencoded_meta, &reencoded_data);
+  if (reencoded_meta.base.buf.written() != meta.base.buf.written() ||
+      memcmp(reencoded_meta.base.buf.data(), meta.base.buf.data(),
+             meta.base.buf.written()) != 0) {
+    std::cout << name << ": parallel encoder mismatch\n";
+    return false;
+  }
+
+  // Decoding in parallel chunks sees the same fields, even when they
+  // are much shorter than `min_chunk`.
+  size_t num_chunks = pool.size();
+  std::vector<ChecksumVisitor> chunk_visitors(num_chunks);
+  ParallelDecodeOptions chunked;
+  ParallelDecodeOptions decode_options;
+
+  chunked.pool = decode_options.pool = &pool;
+  chunked.min_chunk = 1;
+  ChecksumVisitor checksum;
+  uint64_t chunk_sum = 0;
+
+  if (!Decode(meta.base.buf.data(), meta.base.buf.written(),
+              data.buf.data(), data.buf.written(), &checksum) ||
+      !ParallelDecode(meta.base.buf.data(), meta.base.buf.written(),
+                      data.buf.data(), data.buf.written(),
+                      chunk_visitors.data(), num_chunks, chunked)) {
+    std::cout << name << ": parallel decode failed\n";
+    return false;
+  }
+
+  for (const ChecksumVisitor &visitor : chunk_visitors)
+    chunk_sum += visitor.sum;
+  if (chunk_sum != checksum.sum) {
+    std::cout << name << ": parallel decode mismatch\n";
+    return false;
+  }
+
+  // Segmented buffers must hold the same bytes, in `iovec`s.
+  MetaWriter chunked_meta(WriteBuffer::Segmented(4096));
+  DataWriter chunked_data(WriteBuffer::Segmented(4096));
+  std::vector<iovec> iovs;
+  std::string gathered;
+
+  codegen::EncodeMessage(message, &chunked_meta, &chunked_data);
+  chunked_meta.base.buf.append_iovecs(&iovs);
+  chunked_data.buf.append_iovecs(&iovs);
+  for (const iovec &iov : iovs)
+    gathered.append((const char *)iov.iov_base, iov.iov_len);
+
+  if (gathered !=
+      std::string((const char *)meta.base.buf.data(),
+                  meta.base.buf.written()) +
+          std::string((const char *)data.buf.data(), data.buf.written())) {
+    std::cout << name << ": segmented buffer mismatch\n";
+    return false;
+  }
+
+  // About 256 MB of protobuf, and enough samples for a p999.
+  size_t niter = std::max<size_t>((1UL << 28) / pb.size(), 4000);
+  std::string label(name);
+  const T empty;
+  T decoded;
+
+  BenchReport((label + "_parse_new").c_str(), pb.size(),
+              RunBench(niter, counters, [&] {
+                T fresh;
+
+                codegen::DecodeMessage(
+                    meta.base.buf.data(), meta.base.buf.written(),
+                    data.buf.data(), data.buf.written(), &fresh);
+                asm volatile("" ::"r"(&fresh) : "memory");
+              }));
+
+  BenchReport((label + "_parse_reuse").c_str(), pb.size(),
+              RunBench(niter, counters, [&] {
+                decoded = empty;
+                codegen::DecodeMessage(
+                    meta.base.buf.data(), meta.base.buf.written(),
+                    data.buf.data(), data.buf.written(), &decoded);
+                asm volatile("" ::"r"(&decoded) : "memory");
+              }));
+
+  BenchReport((label + "_visit").c_str(), pb.size(),
+              RunBench(niter, counters, [&] {
+                ChecksumVisitor visitor;
+
+                Decode(meta.base.buf.data(), meta.base.buf.written(),
+                       data.buf.data(), data.buf.written(), &visitor);
+                asm volatile("" ::"r"(visitor.sum) : "memory");
+              }));
+
+  BenchReport((label + "_visit_parallel").c_str(), pb.size(),
+              RunBench(niter, counters, [&] {
+                std::vector<ChecksumVisitor> visitors(num_chunks);
+
+                ParallelDecode(meta.base.buf.data(), meta.base.buf.written(),
+                               data.buf.data(), data.buf.written(),
+                               visitors.data(), num_chunks, decode_options);
+                asm volatile("" ::"r"(visitors.data()) : "memory");
+              }));
+
+  BenchReport((label + "_serialize").c_str(), pb.size(),
+              RunBench(niter, counters, [&] {
+                meta.base.buf.reset();
+                data.buf.reset();
+                asm volatile("" ::"r"(&message) : "memory");
+                codegen::EncodeMessage(message, &meta, &data);
+              }));
+
+  BenchReport((label + "_serialize_unchecked").c_str(), pb.size(),
+              RunBench(niter, counters, [&] {
+                meta.base.buf.reset();
+                data.buf.reset();
+                asm volatile("" ::"r"(&message) : "memory");
+                codegen::EncodeMessageUnchecked(message, &meta, &data);
+              }));
+
+  BenchReport((label + "_serialize_parallel").c_str(), pb.size(),
+              RunBench(niter, counters, [&] {
+                meta.base.buf.reset();
+                data.buf.reset();
+                asm volatile("" ::"r"(&message) : "memory");
+                codegen::EncodeMessageParallel(message, &meta, &data,
+                                               parallel);
+              }));
+
+  BenchReport((label + "_serialize_new").c_str(), pb.size(),
+              RunBench(niter, counters, [&] {
+                MetaWriter fresh_meta(128);
+                DataWriter fresh_data(128);
+
+                asm volatile("" ::"r"(&message) : "memory");
+                codegen::EncodeMessage(message, &fresh_meta, &fresh_data);
+                asm volatile("" ::"r"(fresh_data.buf.data()) : "memory");
+              }));
+
+  BenchReport((label + "_serialize_new_unchecked").c_str(), pb.size(),
+              RunBench(niter, counters, [&] {
+                MetaWriter fresh_meta(128);
+                DataWriter fresh_data(128);
+
+                asm volatile("" ::"r"(&message) : "memory");
+                codegen::EncodeMessageUnchecked(message, &fresh_meta,
+                                                &fresh_data);
+                asm volatile("" ::"r"(fresh_data.buf.data()) : "memory");
+              }));
+
+  BenchReport((label + "_serialize_pooled").c_str(), pb.size(),
+              RunBench(niter, counters, [&] {
+                PooledWriters writers(PooledWriters::HintFor<T>());
+
+                asm volatile("" ::"r"(&message) : "memory");
+                codegen::EncodeMessage(message, &writers.meta, &writers.data);
+                asm volatile("" ::"r"(writers.data.buf.data()) : "memory");
+              }));
+
+  BenchReport((label + "_serialize_segmented").c_str(), pb.size(),
+              RunBench(niter, counters, [&] {
+                MetaWriter fresh_meta(WriteBuffer::Segmented(4096));
+                DataWriter fresh_data(WriteBuffer::Segmented(4096));
+
+                asm volatile("" ::"r"(&message) : "memory");
+                codegen::EncodeMessage(message, &fresh_meta, &fresh_data);
+                iovs.clear();
+                fresh_meta.base.buf.append_iovecs(&iovs);
+                fresh_data.buf.append_iovecs(&iovs);
+                asm volatile("" ::"r"(iovs.data()) : "memory");
+              }));
+  return true;
 }
 
 void decode_meta(const uint8_t *bytes, size_t count) {
@@ -233,7 +2070,36 @@ void decode_meta(const uint8_t *bytes, size_t count) {
 }  // namespace
 
 int main(int, char **) {
+#ifdef NDEBUG
+  std::cout << "Self tests skipped: built with -DNDEBUG\n";
+#endif
+  Radix128SelfTest();
+  BenchSelfTest();
+  WriteBuffer::SelfTest();
+  WriteBufferPool::SelfTest();
   DataWriter::SelfTest();
+  MetaWriter::SelfTest();
+  DataReader::SelfTest();
+  MetaReader::SelfTest();
+  SplitLiteralMetaReader::SelfTest();
+  DecoderSelfTest();
+  MetaScan::SelfTest();
+  SubmessageIndex::SelfTest();
+  LayoutSelfTest();
+  ColumnarSelfTest();
+  TranscodeSelfTest();
+  JsonSelfTest();
+  BatchSelfTest();
+  StreamSelfTest();
+  IoQueue::SelfTest();
+  MappedFile::SelfTest();
+  ArchiveSelfTest();
+  WorkerPool::SelfTest();
+  ParallelEncodeSelfTest();
+  ParallelDecodeSelfTest();
+  codegen::MessageView::SelfTest();
+  FieldTable::SelfTest();
+  generated_self_test();
 
   data();
 
@@ -242,6 +2108,10 @@ int main(int, char **) {
   WriteBuffer meta(128);
   WriteBuffer data(128);
 
+  bench_radix128(niter);
+  bench_varints();
+  bench_run_fields();
+
   test_meta(message, &meta, &data);
   decode_meta((const uint8_t *)meta.data(), meta.written());
   std::cout << "Data: " << data.written() << "; meta: " << meta.written()
@@ -275,5 +2145,231 @@ int main(int, char **) {
     std::cout << "Write: " << 1e9 * (end - begin) / niter << " ns/iter\n";
   }
 
+  {
+    Message decoded;
+
+    decoded.field_15.field_15.clear();
+    if (!test_decode(meta, data, &decoded) || !same(message, decoded)) {
+      std::cout << "Decode mismatch\n";
+      return 1;
+    }
+
+    double begin = now();
+    for (size_t i = 0; i < niter; i++) {
+      asm volatile("" : "+m"(meta), "+m"(data));
+      test_decode(meta, data, &decoded);
+    }
+
+    double end = now();
+
+    std::cout << "Read: " << 1e9 * (end - begin) / niter << " ns/iter\n";
+  }
+
+  {
+    WriteBuffer layout_meta(128);
+    WriteBuffer layout_data(128);
+
+    test_layout_meta(message, &layout_meta, &layout_data);
+    // The layout should pick the same opcodes as `test_meta`.
+    if (layout_meta.written() != meta.written() ||
+        memcmp(layout_meta.data(), meta.data(), meta.written()) != 0 ||
+        layout_data.written() != data.written() ||
+        memcmp(layout_data.data(), data.data(), data.written()) != 0) {
+      std::cout << "Layout mismatch\n";
+      return 1;
+    }
+
+    double begin = now();
+    for (size_t i = 0; i < niter; i++) {
+      layout_meta.reset();
+      layout_data.reset();
+      asm volatile("" : "+m"(message));
+      test_layout_meta(message, &layout_meta, &layout_data);
+    }
+
+    double end = now();
+
+    std::cout << "Layout write: " << 1e9 * (end - begin) / niter
+              << " ns/iter\n";
+  }
+
+  {
+    WriteBuffer writer_meta(128);
+    WriteBuffer writer_data(128);
+    Message decoded;
+
+    test_meta_writer(message, &writer_meta, &writer_data);
+    decoded.field_15.field_15.clear();
+    if (writer_meta.written() != meta.written() ||
+        !test_decode(writer_meta, writer_data, &decoded) ||
+        !same(message, decoded)) {
+      std::cout << "MetaWriter mismatch\n";
+      return 1;
+    }
+
+    double begin = now();
+    for (size_t i = 0; i < niter; i++) {
+      writer_meta.reset();
+      writer_data.reset();
+      asm volatile("" : "+m"(message));
+      test_meta_writer(message, &writer_meta, &writer_data);
+    }
+
+    double end = now();
+
+    std::cout << "MetaWriter write: " << 1e9 * (end - begin) / niter
+              << " ns/iter\n";
+  }
+
+  {
+    GoogleMessage1 generated = to_generated(message);
+    WriteBuffer generated_meta(128);
+    WriteBuffer generated_data(128);
+
+    test_generated_meta(generated, &generated_meta, &generated_data);
+    // The generated encoder's `MetaWriter` fuses fields as well as
+    // `test_meta`, if not always in the same way.
+    if (generated_meta.written() != meta.written() ||
+        generated_data.written() != data.written() ||
+        memcmp(generated_data.data(), data.data(), data.written()) != 0) {
+      std::cout << "Generated data mismatch\n";
+      return 1;
+    }
+
+    double begin = now();
+    for (size_t i = 0; i < niter; i++) {
+      generated_meta.reset();
+      generated_data.reset();
+      asm volatile("" : "+m"(generated));
+      test_generated_meta(generated, &generated_meta, &generated_data);
+    }
+
+    double end = now();
+
+    std::cout << "Generated write: " << 1e9 * (end - begin) / niter
+              << " ns/iter\n";
+
+    GoogleMessage1 decoded;
+
+    if (!test_generated_decode(generated_meta, generated_data, &decoded) ||
+        !same(message, decoded)) {
+      std::cout << "Generated decode mismatch\n";
+      return 1;
+    }
+
+    begin = now();
+    for (size_t i = 0; i < niter; i++) {
+      asm volatile("" : "+m"(generated_meta), "+m"(generated_data));
+      test_generated_decode(generated_meta, generated_data, &decoded);
+    }
+
+    end = now();
+
+    std::cout << "Generated read: " << 1e9 * (end - begin) / niter
+              << " ns/iter\n";
+  }
+
+  {
+    Message decoded;
+    MetaScan scan;
+
+    decoded.field_15.field_15.clear();
+    if (!test_scan_decode(meta, data, &scan, &decoded) ||
+        !same(message, decoded)) {
+      std::cout << "Scan decode mismatch\n";
+      return 1;
+    }
+
+    double begin = now();
+    for (size_t i = 0; i < niter; i++) {
+      asm volatile("" : "+m"(meta), "+m"(data));
+      test_scan_decode(meta, data, &scan, &decoded);
+    }
+
+    double end = now();
+
+    std::cout << "Scan + read: " << 1e9 * (end - begin) / niter
+              << " ns/iter\n";
+  }
+
+  {
+    Message decoded;
+
+    double begin = now();
+    for (size_t i = 0; i < niter; i++) {
+      asm volatile("" : "+m"(meta), "+m"(data));
+      MetaReader meta_reader(meta.data(), meta.written());
+      test_skip_decode(&meta_reader, data, &decoded);
+    }
+
+    double end = now();
+
+    std::cout << "Read (skip 15): " << 1e9 * (end - begin) / niter
+              << " ns/iter\n";
+  }
+
+  {
+    Message decoded;
+    SubmessageIndex index;
+
+    if (!index.build(meta.data(), meta.written())) {
+      std::cout << "Index build failed\n";
+      return 1;
+    }
+
+    double begin = now();
+    for (size_t i = 0; i < niter; i++) {
+      asm volatile("" : "+m"(meta), "+m"(data));
+      IndexedMetaReader meta_reader(meta.data(), meta.written(), index);
+      test_skip_decode(&meta_reader, data, &decoded);
+    }
+
+    double end = now();
+
+    std::cout << "Indexed read (skip 15): " << 1e9 * (end - begin) / niter
+              << " ns/iter\n";
+  }
+
+  {
+    PerfCounters counters;
+
+    if (!counters.open())
+      std::cout << "Hardware counters unavailable; timing only\n";
+
+    if (!bench_message<GoogleMessage1>(
+            "google_message1_proto2", "../benchmark_message1_proto2.pb",
+            benchmarks::proto2::kGoogleMessage1Schema, &counters) ||
+        !bench_message<GoogleMessage2>(
+            "google_message2", "../benchmark_message2.pb",
+            benchmarks::proto2::kGoogleMessage2Schema, &counters))
+      return 1;
+  }
+
+  if (!bench_transcode("../benchmark_message1_proto2.pb",
+                       benchmarks::proto2::kGoogleMessage1Schema) ||
+      !bench_transcode("../benchmark_message2.pb",
+                       benchmarks::proto2::kGoogleMessage2Schema) ||
+      !bench_json("../message1.json",
+                  benchmarks::proto2::kGoogleMessage1Schema,
+                  "../benchmark_message1_proto2.pb") ||
+      !bench_json("../message2.json", kMessage2JsonSchema, nullptr) ||
+      !bench_batch("../benchmark_message1_proto2.pb",
+                   benchmarks::proto2::kGoogleMessage1Schema) ||
+      !bench_field_table("../benchmark_message2.pb",
+                         benchmarks::proto2::kGoogleMessage2Schema) ||
+      !bench_split_literals<GoogleMessage1>(
+          "../benchmark_message1_proto2.pb",
+          benchmarks::proto2::kGoogleMessage1Schema) ||
+      !bench_split_literals<GoogleMessage2>(
+          "../benchmark_message2.pb",
+          benchmarks::proto2::kGoogleMessage2Schema) ||
+      !bench_columnar("../benchmark_message2.pb",
+                      benchmarks::proto2::kGoogleMessage2Schema) ||
+      !bench_stream("../benchmark_message1_proto2.pb",
+                    benchmarks::proto2::kGoogleMessage1Schema) ||
+      !bench_archive("../benchmark_message1_proto2.pb",
+                     benchmarks::proto2::kGoogleMessage1Schema))
+    return 1;
+
   return 0;
 }
@@ -0,0 +1,762 @@
+#include "transcode.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "data_reader.h"
+#include "decoder.h"
+
+namespace {
+/// Protobuf wire types.
+enum WireType : uint32_t {
+  kVarint = 0,
+  kFixed64 = 1,
+  kLength = 2,
+  kStartGroup = 3,
+  kEndGroup = 4,
+  kFixed32 = 5,
+};
+
+/// Returns the wire type for (non-packed) values of `kind`.
+uint32_t WireTypeFor(FieldKind kind) {
+  switch (kind) {
+    case FieldKind::Varint:
+    case FieldKind::Bool:
+      return kVarint;
+    case FieldKind::Fixed32:
+    case FieldKind::Float:
+      return kFixed32;
+    case FieldKind::Fixed64:
+    case FieldKind::Double:
+      return kFixed64;
+    case FieldKind::Bytes:
+    case FieldKind::Message:
+      return kLength;
+    case FieldKind::Group:
+      return kStartGroup;
+  }
+
+  return kLength;
+}
+
+/// Reads a protobuf varint at `*cursor`, before `end`, and advances
+/// `*cursor` past it.
+inline bool ReadVarint(const uint8_t **cursor, const uint8_t *end,
+                       uint64_t *value) {
+  const uint8_t *src = *cursor;
+
+  if (__builtin_expect(src != end && *src < 0x80, 1)) {
+    *value = *src;
+    *cursor = src + 1;
+    return true;
+  }
+
+  uint64_t ret = 0;
+  for (size_t shift = 0; shift < 64 && src != end; shift += 7) {
+    uint8_t byte = *src++;
+
+    ret |= (uint64_t)(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      *value = ret;
+      *cursor = src;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/// Writes `value` as a protobuf varint at `dst`, which must have room
+/// for 10 bytes.
+///
+/// Returns the number of bytes written.
+inline size_t EncodeVarint(uint8_t *dst, uint64_t value) {
+  size_t i = 0;
+
+  while (value >= 0x80) {
+    dst[i++] = (uint8_t)value | 0x80;
+    value >>= 7;
+  }
+
+  dst[i++] = (uint8_t)value;
+  return i;
+}
+
+inline void PutVarint(WriteBuffer *out, uint64_t value) {
+  out->commit(EncodeVarint((uint8_t *)out->reserve(10), value));
+}
+
+inline void PutTag(WriteBuffer *out, uint32_t field, uint32_t wire_type) {
+  PutVarint(out, ((uint64_t)field << 3) | wire_type);
+}
+
+inline void PutBytes(WriteBuffer *out, const void *src, size_t size) {
+  memcpy(out->reserve(size), src, size);
+  out->commit(size);
+}
+
+/// Parses protobuf bytes and writes the corresponding split streams.
+class ProtobufReader {
+ public:
+  ProtobufReader(const uint8_t *begin, const uint8_t *end, MetaWriter *meta,
+                 DataWriter *data)
+      : cursor_(begin), end_(end), meta_(meta), data_(data) {}
+
+  /// Transcodes the fields of a message with `schema`, up to the end
+  /// of the input for a length-delimited message (`group == 0`), or
+  /// up to the end tag of `group`.
+  bool message(const MessageSchema &schema, uint32_t group);
+
+ private:
+  /// Reads a scalar value of `kind` with `wire_type`, and writes it
+  /// as field `number`.
+  bool scalar(FieldKind kind, uint32_t number, uint32_t wire_type);
+
+  /// Reads a length prefix, and returns the end of the bytes it
+  /// covers in `*end`.
+  bool length(const uint8_t **end) {
+    uint64_t size;
+
+    if (!ReadVarint(&cursor_, end_, &size) ||
+        size > (uint64_t)(end_ - cursor_))
+      return false;
+
+    *end = cursor_ + size;
+    return true;
+  }
+
+  /// Skips the value of an unknown field, with `depth` enclosing
+  /// groups.
+  bool skip(uint32_t number, uint32_t wire_type, size_t depth);
+
+  const uint8_t *cursor_;
+  const uint8_t *end_;
+  MetaWriter *meta_;
+  DataWriter *data_;
+  /// Number of open runs in `meta_`.
+  size_t depth_{0};
+};
+
+bool ProtobufReader::message(const MessageSchema &schema, uint32_t group) {
+  // The run for the last field, if it's repeated or a submessage:
+  // the next field may continue it.
+  const FieldSchema *run = nullptr;
+  size_t run_begin = 0;
+  size_t element_begin = 0;
+  bool first_element = false;
+  uint32_t last = 0;
+
+  auto close_run = [&] {
+    if (run != nullptr) {
+      meta_->close(data_->buf.written() - run_begin);
+      depth_--;
+      run = nullptr;
+    }
+  };
+
+  auto next_element = [&] {
+    size_t written = data_->buf.written();
+
+    if (!first_element) meta_->separate(written - element_begin);
+    element_begin = written;
+    first_element = false;
+  };
+
+  while (cursor_ != end_) {
+    uint64_t tag;
+
+    if (!ReadVarint(&cursor_, end_, &tag) || tag > UINT32_MAX) return false;
+
+    uint32_t number = tag >> 3;
+    uint32_t wire_type = tag & 7;
+
+    if (number == 0) return false;
+    if (wire_type == kEndGroup) {
+      if (number != group) return false;
+      close_run();
+      return true;
+    }
+
+    const FieldSchema *field = schema.find(number);
+    if (field == nullptr) {
+      if (!skip(number, wire_type, 0)) return false;
+      continue;
+    }
+
+    if (field == run) {
+      // Only repeated fields may continue their run.
+      if (!field->repeated) return false;
+    } else {
+      if (number <= last) return false;
+
+      close_run();
+      last = number;
+      if (field->repeated || field->message != nullptr) {
+        if (depth_ == MetaWriter::kMaxDepth) return false;
+
+        meta_->open(number, 0);
+        depth_++;
+        run = field;
+        run_begin = element_begin = data_->buf.written();
+        first_element = true;
+      }
+    }
+
+    if (run == nullptr) {
+      if (!scalar(field->kind, number, wire_type)) return false;
+      continue;
+    }
+
+    if (field->kind == FieldKind::Group) {
+      if (wire_type != kStartGroup) return false;
+
+      next_element();
+      if (!message(*field->message, number)) return false;
+    } else if (field->kind == FieldKind::Message) {
+      const uint8_t *end;
+      const uint8_t *outer_end = end_;
+
+      if (wire_type != kLength || !length(&end)) return false;
+
+      next_element();
+      end_ = end;
+      if (!message(*field->message, 0)) return false;
+      end_ = outer_end;
+    } else if (wire_type == kLength && field->kind != FieldKind::Bytes) {
+      // Packed repeated scalars: one element per value.
+      const uint8_t *end;
+      const uint8_t *outer_end = end_;
+      uint32_t packed_type = WireTypeFor(field->kind);
+
+      if (!length(&end)) return false;
+
+      end_ = end;
+      while (cursor_ != end_) {
+        next_element();
+        if (!scalar(field->kind, 1, packed_type)) return false;
+      }
+
+      end_ = outer_end;
+    } else {
+      next_element();
+      if (!scalar(field->kind, 1, wire_type)) return false;
+    }
+  }
+
+  // Groups must end with their end tag.
+  if (group != 0) return false;
+
+  close_run();
+  return true;
+}
+
+bool ProtobufReader::scalar(FieldKind kind, uint32_t number,
+                            uint32_t wire_type) {
+  if (wire_type != WireTypeFor(kind)) return false;
+
+  switch (kind) {
+    case FieldKind::Varint:
+    case FieldKind::Bool: {
+      uint64_t value;
+
+      if (!ReadVarint(&cursor_, end_, &value)) return false;
+      meta_->field(number, (kind == FieldKind::Bool)
+                               ? data_->fixed<uint8_t>(value != 0)
+                               : data_->varint(value));
+      return true;
+    }
+
+    case FieldKind::Fixed32:
+    case FieldKind::Fixed64:
+    case FieldKind::Float:
+    case FieldKind::Double: {
+      size_t width = (WireTypeFor(kind) == kFixed32) ? 4 : 8;
+
+      if ((size_t)(end_ - cursor_) < width) return false;
+      meta_->field(number, data_->bytes(cursor_, width));
+      cursor_ += width;
+      return true;
+    }
+
+    case FieldKind::Bytes: {
+      const uint8_t *end;
+
+      if (!length(&end)) return false;
+      meta_->string(number, data_->bytes(cursor_, end - cursor_));
+      cursor_ = end;
+      return true;
+    }
+
+    case FieldKind::Message:
+    case FieldKind::Group:
+      break;
+  }
+
+  return false;
+}
+
+bool ProtobufReader::skip(uint32_t number, uint32_t wire_type, size_t depth) {
+  uint64_t value;
+  const uint8_t *end;
+
+  switch (wire_type) {
+    case kVarint:
+      return ReadVarint(&cursor_, end_, &value);
+
+    case kFixed64:
+    case kFixed32: {
+      size_t width = (wire_type == kFixed32) ? 4 : 8;
+
+      if ((size_t)(end_ - cursor_) < width) return false;
+      cursor_ += width;
+      return true;
+    }
+
+    case kLength:
+      if (!length(&end)) return false;
+      cursor_ = end;
+      return true;
+
+    case kStartGroup:
+      if (depth == MetaWriter::kMaxDepth) return false;
+
+      for (;;) {
+        uint64_t tag;
+
+        if (!ReadVarint(&cursor_, end_, &tag) || tag > UINT32_MAX)
+          return false;
+        if ((tag & 7) == kEndGroup) return (tag >> 3) == number;
+        if (!skip(tag >> 3, tag & 7, depth + 1)) return false;
+      }
+
+    default:
+      return false;
+  }
+}
+
+/// `Decode` visitor that writes protobuf bytes.
+class ProtobufWriter {
+ public:
+  ProtobufWriter(const MessageSchema &schema, WriteBuffer *out) : out_(out) {
+    stack_[0] = Frame{&schema, nullptr, 0};
+  }
+
+  bool ok() const { return ok_; }
+
+  void field(uint32_t number, size_t width, const uint8_t *src);
+  bool open(uint32_t number, uint64_t len_hint);
+  void separate(uint64_t message_size);
+  void close(uint64_t run_size);
+
+ private:
+  struct Frame {
+    /// Schema for the submessages of the run, nullptr for a run of
+    /// repeated scalars.
+    const MessageSchema *schema;
+    /// The run's field, nullptr for the top-level message.
+    const FieldSchema *field;
+    /// Offset of the current submessage's length prefix in `out_`.
+    size_t length_at;
+  };
+
+  /// Writes the prefix of a submessage in the current run.
+  void begin_element();
+
+  /// Writes the suffix of the current run's submessage, or patches
+  /// its length prefix.
+  void end_element();
+
+  WriteBuffer *out_;
+  bool ok_{true};
+  size_t depth_{0};
+  Frame stack_[decoder_internal::kMaxDepth + 1];
+};
+
+void ProtobufWriter::field(uint32_t number, size_t width, const uint8_t *src) {
+  const Frame &frame = stack_[depth_];
+  const FieldSchema *field;
+
+  if (frame.schema == nullptr) {
+    // Repeated scalars are field 1 of each submessage.
+    if (number != 1) return;
+    field = frame.field;
+  } else {
+    field = frame.schema->find(number);
+    if (field == nullptr) return;
+    if (field->repeated || field->message != nullptr) {
+      ok_ = false;
+      return;
+    }
+  }
+
+  bool word = width <= 8 && (width & (width - 1)) == 0;
+  switch (field->kind) {
+    case FieldKind::Varint:
+    case FieldKind::Bool: {
+      if (!word) break;
+
+      uint64_t value = DataReader::load(src, width);
+      PutTag(out_, field->number, kVarint);
+      PutVarint(out_, (field->kind == FieldKind::Bool) ? value != 0 : value);
+      return;
+    }
+
+    case FieldKind::Fixed32:
+    case FieldKind::Fixed64:
+    case FieldKind::Float:
+    case FieldKind::Double:
+      if (width != ((WireTypeFor(field->kind) == kFixed32) ? 4 : 8)) break;
+
+      PutTag(out_, field->number, WireTypeFor(field->kind));
+      PutBytes(out_, src, width);
+      return;
+
+    case FieldKind::Bytes:
+      PutTag(out_, field->number, kLength);
+      PutVarint(out_, width);
+      PutBytes(out_, src, width);
+      return;
+
+    case FieldKind::Message:
+    case FieldKind::Group:
+      break;
+  }
+
+  ok_ = false;
+  return;
+}
+
+bool ProtobufWriter::open(uint32_t number, uint64_t) {
+  const Frame &frame = stack_[depth_];
+
+  // Skip runs for unknown fields, and everything after an error.
+  if (!ok_ || frame.schema == nullptr) return false;
+
+  const FieldSchema *field = frame.schema->find(number);
+  if (field == nullptr) return false;
+  if (!field->repeated && field->message == nullptr) {
+    ok_ = false;
+    return false;
+  }
+
+  // `Decode` never opens more than `kMaxDepth` runs.
+  assert(depth_ < decoder_internal::kMaxDepth);
+  stack_[++depth_] = Frame{field->message, field, 0};
+  begin_element();
+  return true;
+}
+
+void ProtobufWriter::separate(uint64_t) {
+  if (depth_ == 0) {
+    ok_ = false;
+    return;
+  }
+
+  end_element();
+  begin_element();
+  return;
+}
+
+void ProtobufWriter::close(uint64_t) {
+  if (depth_ == 0) return;
+
+  end_element();
+  depth_--;
+  return;
+}
+
+void ProtobufWriter::begin_element() {
+  Frame &frame = stack_[depth_];
+
+  if (frame.schema == nullptr) return;
+
+  if (frame.field->kind == FieldKind::Group) {
+    PutTag(out_, frame.field->number, kStartGroup);
+    return;
+  }
+
+  // Optimistically assume the submessage is shorter than 128 bytes,
+  // and make room for longer length prefixes in `end_element`.
+  PutTag(out_, frame.field->number, kLength);
+  frame.length_at = out_->written();
+  out_->reserve(1);
+  out_->commit(1);
+  return;
+}
+
+void ProtobufWriter::end_element() {
+  const Frame &frame = stack_[depth_];
+
+  if (frame.schema == nullptr) return;
+
+  if (frame.field->kind == FieldKind::Group) {
+    PutTag(out_, frame.field->number, kEndGroup);
+    return;
+  }
+
+  size_t begin = frame.length_at + 1;
+  size_t size = out_->written() - begin;
+  if (__builtin_expect(size < 0x80, 1)) {
+    ((uint8_t *)out_->data())[frame.length_at] = (uint8_t)size;
+    return;
+  }
+
+  uint8_t prefix[10];
+  size_t prefix_size = EncodeVarint(prefix, size);
+
+  out_->reserve(prefix_size - 1);
+  out_->commit(prefix_size - 1);
+
+  uint8_t *base = (uint8_t *)out_->data();
+  memmove(base + begin + prefix_size - 1, base + begin, size);
+  memcpy(base + frame.length_at, prefix, prefix_size);
+  return;
+}
+}  // namespace
+
+bool ProtobufToSplit(const void *pb, size_t size, const MessageSchema &schema,
+                     MetaWriter *meta, DataWriter *data) {
+  const uint8_t *begin = (const uint8_t *)pb;
+  size_t data_begin = data->buf.written();
+  ProtobufReader reader(begin, begin + size, meta, data);
+
+  if (!reader.message(schema, 0)) return false;
+
+  meta->close(data->buf.written() - data_begin);
+  return true;
+}
+
+bool SplitToProtobuf(const void *meta, size_t meta_size, const void *data,
+                     size_t data_size, const MessageSchema &schema,
+                     WriteBuffer *out) {
+  ProtobufWriter writer(schema, out);
+
+  return Decode(meta, meta_size, data, data_size, &writer) && writer.ok();
+}
+
+namespace {
+// message Point {
+//   optional int32 x = 1;
+//   optional bool valid = 2;
+//   optional string label = 3;
+// }
+const FieldSchema kPointFields[] = {
+    {1, FieldKind::Varint, false, nullptr},
+    {2, FieldKind::Bool, false, nullptr},
+    {3, FieldKind::Bytes, false, nullptr},
+};
+
+const uint16_t kPointIndex[] = {0, 1, 2, 3};
+
+const MessageSchema kPointSchema = {"Point", kPointFields, 3, kPointIndex, 4};
+
+// group Style = 4 { optional fixed32 color = 1; }
+const FieldSchema kStyleFields[] = {
+    {1, FieldKind::Fixed32, false, nullptr},
+};
+
+const uint16_t kStyleIndex[] = {0, 1};
+
+const MessageSchema kStyleSchema = {"Style", kStyleFields, 1, kStyleIndex, 2};
+
+// message Shape {
+//   optional fixed64 id = 1;
+//   repeated Point points = 2;
+//   repeated int32 tags = 3;
+//   optional group Style = 4 { ... }
+//   optional float scale = 6;
+//   optional uint32 version = 2000;
+// }
+//
+// `version` isn't in the dense index.
+const FieldSchema kShapeFields[] = {
+    {1, FieldKind::Fixed64, false, nullptr},
+    {2, FieldKind::Message, true, &kPointSchema},
+    {3, FieldKind::Varint, true, nullptr},
+    {4, FieldKind::Group, false, &kStyleSchema},
+    {6, FieldKind::Float, false, nullptr},
+    {2000, FieldKind::Varint, false, nullptr},
+};
+
+const uint16_t kShapeIndex[] = {0, 1, 2, 3, 4, 0, 5};
+
+const MessageSchema kShapeSchema = {"Shape", kShapeFields, 6, kShapeIndex, 7};
+
+/// Appends protobuf fields to a string.
+struct Protobuf {
+  Protobuf &varint(uint64_t value) {
+    uint8_t buf[10];
+
+    bytes.append((const char *)buf, EncodeVarint(buf, value));
+    return *this;
+  }
+
+  Protobuf &tag(uint32_t field, uint32_t wire_type) {
+    return varint(((uint64_t)field << 3) | wire_type);
+  }
+
+  Protobuf &fixed(uint32_t field, const void *src, size_t size) {
+    tag(field, (size == 4) ? kFixed32 : kFixed64);
+    bytes.append((const char *)src, size);
+    return *this;
+  }
+
+  Protobuf &string(uint32_t field, const std::string &value) {
+    tag(field, kLength).varint(value.size());
+    bytes += value;
+    return *this;
+  }
+
+  std::string bytes;
+};
+
+Protobuf MakePoint(int32_t x, bool valid, const std::string &label) {
+  Protobuf ret;
+
+  ret.tag(1, kVarint).varint((uint64_t)(int64_t)x);
+  ret.tag(2, kVarint).varint(valid);
+  ret.string(3, label);
+  return ret;
+}
+
+/// Builds a `Shape`; `packed` and `unknown` select packed tags and
+/// extra unknown fields.  If `boundaries` isn't null, it receives the
+/// offset after each top-level field.
+std::string MakeShape(bool packed, bool unknown,
+                      std::vector<size_t> *boundaries = nullptr) {
+  uint64_t id = 0x0123456789abcdef;
+  uint32_t color = 0xff8000;
+  float scale = 1.5;
+  Protobuf ret;
+  auto boundary = [&] {
+    if (boundaries != nullptr) boundaries->push_back(ret.bytes.size());
+  };
+
+  ret.fixed(1, &id, sizeof(id));
+  boundary();
+  if (unknown) ret.string(1000, "unknown");
+  ret.string(2, MakePoint(-1, true, "origin").bytes);
+  boundary();
+  ret.string(2, MakePoint(300, false, std::string(200, 'x')).bytes);
+  boundary();
+  if (packed) {
+    Protobuf tags;
+
+    tags.varint(1).varint(300).varint(1UL << 40);
+    ret.string(3, tags.bytes);
+  } else {
+    for (uint64_t tag : {1UL, 300UL, 1UL << 40}) {
+      ret.tag(3, kVarint).varint(tag);
+      boundary();
+    }
+  }
+
+  ret.tag(4, kStartGroup);
+  if (unknown)
+    ret.tag(7, kStartGroup).tag(1, kVarint).varint(2).tag(7, kEndGroup);
+  ret.fixed(1, &color, sizeof(color));
+  ret.tag(4, kEndGroup);
+  boundary();
+  if (unknown) ret.tag(5, kVarint).varint(42);
+  ret.fixed(6, &scale, sizeof(scale));
+  boundary();
+  ret.tag(2000, kVarint).varint(7);
+  return ret.bytes;
+}
+
+/// Transcodes `pb` to split streams and back.  Returns false if
+/// either direction fails.
+bool RoundTrip(const std::string &pb, std::string *out) {
+  MetaWriter meta(16);
+  DataWriter data(16);
+  WriteBuffer buf(16);
+
+  if (!ProtobufToSplit(pb.data(), pb.size(), kShapeSchema, &meta, &data))
+    return false;
+  if (!SplitToProtobuf(meta.base.buf.data(), meta.base.buf.written(),
+                       data.buf.data(), data.buf.written(), kShapeSchema,
+                       &buf))
+    return false;
+
+  out->assign((const char *)buf.data(), buf.written());
+  return true;
+}
+}  // namespace
+
+void TranscodeSelfTest() {
+  std::vector<size_t> boundaries;
+  const std::string canonical = MakeShape(false, false, &boundaries);
+  std::string out;
+
+  (void)RoundTrip;
+  assert(kShapeSchema.find(5) == nullptr);
+  assert(kShapeSchema.find(2000) == &kShapeFields[5]);
+  assert(kShapeSchema.find(2001) == nullptr);
+
+  // The second point is longer than 128 bytes.
+  assert(RoundTrip(canonical, &out) && out == canonical);
+
+  // Packed tags come back unpacked, and unknown fields are dropped.
+  assert(RoundTrip(MakeShape(true, false), &out) && out == canonical);
+  assert(RoundTrip(MakeShape(false, true), &out) && out == canonical);
+
+  // An empty message.
+  assert(RoundTrip("", &out) && out.empty());
+
+  // Truncated inputs are only valid at field boundaries.
+  for (size_t i = 1; i < canonical.size(); i++) {
+    MetaWriter meta(16);
+    DataWriter data(16);
+    bool boundary = std::find(boundaries.begin(), boundaries.end(), i) !=
+                    boundaries.end();
+
+    (void)meta;
+    (void)data;
+    (void)boundary;
+    assert(ProtobufToSplit(canonical.data(), i, kShapeSchema, &meta,
+                           &data) == boundary);
+  }
+
+  {
+    // Out of order fields, a split repeated field, a repeated
+    // singular field, and a wire type mismatch.
+    const std::string bad[] = {
+        Protobuf().tag(3, kVarint).varint(1).tag(1, kFixed64).bytes +
+            std::string(8, '\0'),
+        Protobuf().tag(3, kVarint).varint(1).tag(6, kFixed32).bytes +
+            std::string(4, '\0') + Protobuf().tag(3, kVarint).varint(2).bytes,
+        Protobuf().tag(4, kStartGroup).tag(4, kEndGroup).tag(4, kStartGroup)
+            .tag(4, kEndGroup).bytes,
+        Protobuf().tag(1, kVarint).varint(1).bytes,
+    };
+
+    for (const std::string &pb : bad) {
+      MetaWriter meta(16);
+      DataWriter data(16);
+
+      (void)pb;
+      (void)meta;
+      (void)data;
+      assert(!ProtobufToSplit(pb.data(), pb.size(), kShapeSchema, &meta,
+                              &data));
+    }
+  }
+
+  {
+    // A split message with a word where the schema wants a string
+    // width (a 4-byte id).
+    MetaWriter meta(16);
+    DataWriter data(16);
+    WriteBuffer buf(16);
+
+    meta.field(1, data.fixed<uint32_t>(1));
+    meta.close(data.buf.written());
+    assert(!SplitToProtobuf(meta.base.buf.data(), meta.base.buf.written(),
+                            data.buf.data(), data.buf.written(), kShapeSchema,
+                            &buf));
+  }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "data_writer.h"
+#include "meta_writer.h"
+#include "schema.h"
+#include "write_buffer.h"
+
+/// Transcoders between the protobuf wire format and split streams,
+/// driven by runtime `MessageSchema`s (e.g., from `splitc`).
+///
+/// Singular scalars map to fields with the same number.  Repeated
+/// fields and submessages (or groups) map to runs of submessages, with
+/// scalars as field 1 of each submessage, like the generated code.
+/// Varints keep their 64-bit protobuf value, so negative `int32`s take
+/// 8 bytes in the data stream, and bools take one byte.
+
+/// Transcodes the `size` bytes of protobuf at `pb`, a message with
+/// `schema`, to `meta` and `data`, as a top-level message.
+///
+/// Fields must appear in increasing field number order (as protobuf
+/// serialisers write them), with the elements of repeated fields
+/// contiguous.  Packed repeated fields are accepted.  Fields that
+/// aren't in the schema are dropped.
+///
+/// Returns false if the input is malformed or out of order, or if a
+/// field's wire type doesn't match the schema.  `meta` and `data` are
+/// then in an unspecified state.
+bool ProtobufToSplit(const void *pb, size_t size, const MessageSchema &schema,
+                     MetaWriter *meta, DataWriter *data);
+
+/// Transcodes a split message with `schema` back to protobuf, and
+/// appends it to `out`.  Repeated scalars are written unpacked, and
+/// fields that aren't in the schema are dropped.
+///
+/// Returns false if the split streams are malformed, or if a field's
+/// width doesn't match the schema.
+bool SplitToProtobuf(const void *meta, size_t meta_size, const void *data,
+                     size_t data_size, const MessageSchema &schema,
+                     WriteBuffer *out);
+
+/// Round trips hand-written protobuf bytes through both transcoders.
+void TranscodeSelfTest();
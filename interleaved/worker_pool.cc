@@ -0,0 +1,116 @@
+#include "worker_pool.h"
+
+#include <atomic>
+
+WorkerPool::WorkerPool(size_t size) {
+  assert(size >= 1);
+
+  threads_.reserve(size - 1);
+  for (size_t i = 1; i < size; i++)
+    threads_.emplace_back([this, i] { work(i); });
+  return;
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    stop_ = true;
+  }
+
+  start_.notify_all();
+  for (std::thread &thread : threads_) thread.join();
+  return;
+}
+
+void WorkerPool::run_job(size_t n, void (*call)(void *, size_t),
+                         void *callee) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    assert(pending_ == 0);
+    call_ = call;
+    callee_ = callee;
+    num_shares_ = n;
+    pending_ = n - 1;
+    generation_++;
+  }
+
+  start_.notify_all();
+  call(callee, 0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return pending_ == 0; });
+  return;
+}
+
+void WorkerPool::work(size_t index) {
+  uint64_t seen = 0;
+
+  for (;;) {
+    void (*call)(void *, size_t);
+    void *callee;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) return;
+
+      seen = generation_;
+      // Jobs with fewer shares leave this thread parked.
+      if (index >= num_shares_) continue;
+
+      call = call_;
+      callee = callee_;
+    }
+
+    call(callee, index);
+
+    bool last;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      last = --pending_ == 0;
+    }
+
+    if (last) done_.notify_one();
+  }
+}
+
+void WorkerPool::SelfTest() {
+  for (size_t size : {1, 2, 5}) {
+    WorkerPool pool(size);
+
+    assert(pool.size() == size);
+
+    // Every share runs once per job, on its own thread, and the job
+    // returns after all of them.
+    for (size_t job = 0; job < 100; job++) {
+      size_t n = 1 + job % size;
+      std::vector<std::thread::id> ids(n);
+      std::atomic<size_t> calls{0};
+
+      pool.run(n, [&](size_t i) {
+        ids[i] = std::this_thread::get_id();
+        calls++;
+      });
+
+      assert(calls == n && ids[0] == std::this_thread::get_id());
+      for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < i; j++) assert(ids[i] != ids[j]);
+      }
+    }
+
+    // Shares run at once, so they can wait for each other.
+    std::atomic<size_t> arrived{0};
+
+    pool.run(size, [&](size_t) {
+      arrived++;
+      while (arrived < size) std::this_thread::yield();
+    });
+    assert(arrived == size);
+  }
+
+  return;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <assert.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// A `WorkerPool` keeps threads parked between parallel jobs, so that
+/// callers pay a wakeup per job instead of a thread start and join
+/// (tens of microseconds each).
+///
+/// A job runs `n` shares at once, one per worker, and the calling
+/// thread is always the first worker: a pool of size 1 starts no
+/// threads.  Jobs may synchronise their shares with each other (e.g.,
+/// with a `std::barrier` for `n`), since every share has its own
+/// thread.
+struct WorkerPool {
+  /// Starts `size - 1` threads.
+  explicit WorkerPool(size_t size);
+
+  /// `WorkerPool`s own threads: they can't be copied or moved.
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool(WorkerPool &&) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+  WorkerPool &operator=(WorkerPool &&) = delete;
+
+  /// Stops and joins the threads.
+  ~WorkerPool();
+
+  /// Number of workers, including the calling thread.
+  size_t size() const { return threads_.size() + 1; }
+
+  /// Calls `fn(i)` for every `i` in `[0, n)`, concurrently, on the
+  /// calling thread (`i` = 0) and `n - 1` of the pool's threads, and
+  /// returns once every call has.  `n` must be in `[1, size()]`.
+  ///
+  /// Jobs must not overlap: only one thread may `run` at a time.
+  template <typename Fn>
+  void run(size_t n, Fn &&fn) {
+    using Callee = std::remove_reference_t<Fn>;
+
+    assert(n >= 1 && n <= size());
+    if (n == 1) {
+      fn(0);
+      return;
+    }
+
+    run_job(n, [](void *callee, size_t i) { (*(Callee *)callee)(i); },
+            (void *)&fn);
+    return;
+  }
+
+  static void SelfTest();
+
+ private:
+  /// `run`, with the function's type erased.
+  void run_job(size_t n, void (*call)(void *, size_t), void *callee);
+
+  /// The loop of the thread for share `index`.
+  void work(size_t index);
+
+  std::mutex mutex_;
+  /// Signalled when a job starts, or the pool stops.
+  std::condition_variable start_;
+  /// Signalled when the last share of a job returns.
+  std::condition_variable done_;
+
+  /// The current job.
+  void (*call_)(void *, size_t){nullptr};
+  void *callee_{nullptr};
+  size_t num_shares_{0};
+
+  /// Shares of the current job still running on the pool's threads.
+  size_t pending_{0};
+  /// Incremented for each job, so threads tell new jobs from old ones.
+  uint64_t generation_{0};
+  bool stop_{false};
+
+  std::vector<std::thread> threads_;
+};
@@ -1,8 +1,10 @@
 #include "write_buffer.h"
 
 #include <assert.h>
+#include <sys/uio.h>
 #include <climits>
 #include <cstdlib>
+#include <cstring>
 
 WriteBuffer::WriteBuffer(size_t capacity) {
   buf_ = (uint8_t *)malloc(capacity);
@@ -13,7 +15,32 @@ WriteBuffer::WriteBuffer(size_t capacity) {
   return;
 }
 
+struct WriteBuffer::Segments {
+  struct Chunk {
+    uint8_t *base;
+    size_t capacity;
+    /// Bytes written in this chunk, once the buffer has moved past it.
+    size_t used;
+  };
+
+  size_t chunk_size;
+  /// Index of the current chunk in `chunks`.
+  size_t current;
+  /// Every chunk, including the current one.
+  std::vector<Chunk> chunks;
+};
+
+WriteBuffer WriteBuffer::Segmented(size_t chunk_size) {
+  WriteBuffer ret(chunk_size);
+
+  assert(chunk_size > 0);
+  ret.segments_ = new Segments{chunk_size, 0, {{ret.buf_, chunk_size, 0}}};
+  return ret;
+}
+
 void *WriteBuffer::reserve_slow(size_t count) __restrict__ {
+  if (segments_ != nullptr) return reserve_chunk(count);
+
   size_t size = write_cursor_ - buf_;
   size_t capacity = buf_end_ - buf_;
   size_t new_capacity = capacity;
@@ -34,3 +61,180 @@ void *WriteBuffer::reserve_slow(size_t count) __restrict__ {
   write_cursor_ = buf_ + size;
   return write_cursor_;
 }
+
+void *WriteBuffer::reserve_chunk(size_t count) {
+  std::vector<Segments::Chunk> &chunks = segments_->chunks;
+  size_t &current = segments_->current;
+  size_t used = write_cursor_ - buf_;
+
+  assert(count < SSIZE_MAX);
+  // An empty chunk is too small: replace it, rather than leave an
+  // empty chunk in the chain.
+  if (used > 0) {
+    chunks[current].used = used;
+    sealed_ += used;
+    current++;
+    if (current == chunks.size()) chunks.push_back({nullptr, 0, 0});
+  }
+
+  Segments::Chunk &chunk = chunks[current];
+  if (chunk.capacity < count) {
+    size_t capacity = std::max(segments_->chunk_size, count);
+
+    free(chunk.base);
+    chunk.base = (uint8_t *)malloc(capacity);
+    assert(chunk.base != nullptr);
+    chunk.capacity = capacity;
+  }
+
+  chunk.used = 0;
+  buf_ = chunk.base;
+  buf_end_ = chunk.base + chunk.capacity;
+  write_cursor_ = buf_;
+  remaining_ = chunk.capacity;
+  return write_cursor_;
+}
+
+void WriteBuffer::reset_sealed() {
+  sealed_ = 0;
+  if (segments_ == nullptr) {
+    write_cursor_ = buf_;
+    remaining_ = buf_end_ - buf_;
+    return;
+  }
+
+  const Segments::Chunk &first = segments_->chunks[0];
+
+  segments_->current = 0;
+  buf_ = first.base;
+  buf_end_ = first.base + first.capacity;
+  write_cursor_ = buf_;
+  remaining_ = first.capacity;
+  return;
+}
+
+void WriteBuffer::discard() {
+  size_t total = written();
+
+  reset_sealed();
+  sealed_ = total;
+  return;
+}
+
+void WriteBuffer::destroy_segments() {
+  for (const Segments::Chunk &chunk : segments_->chunks) free(chunk.base);
+
+  delete segments_;
+  return;
+}
+
+void WriteBuffer::append_iovecs(std::vector<iovec> *out) const {
+  if (segments_ != nullptr) {
+    for (size_t i = 0; i < segments_->current; i++) {
+      const Segments::Chunk &chunk = segments_->chunks[i];
+
+      out->push_back(iovec{chunk.base, chunk.used});
+    }
+  }
+
+  if (write_cursor_ != buf_)
+    out->push_back(iovec{buf_, (size_t)(write_cursor_ - buf_)});
+  return;
+}
+
+void WriteBuffer::SelfTest() {
+  // Linear buffers export one iovec.
+  {
+    WriteBuffer linear(4);
+    std::vector<iovec> iovs;
+
+    linear.append_iovecs(&iovs);
+    assert(iovs.empty());
+
+    memcpy(linear.reserve(10), "0123456789", 10);
+    linear.commit(10);
+    linear.append_iovecs(&iovs);
+    assert(iovs.size() == 1);
+    assert(iovs[0].iov_base == linear.data() && iovs[0].iov_len == 10);
+  }
+
+  // Segmented buffers write the same bytes as linear ones, without
+  // moving them, and reuse their chunks after `reset`.
+  WriteBuffer linear;
+  WriteBuffer segmented = WriteBuffer::Segmented(64);
+  std::vector<iovec> first;
+
+  for (size_t round = 0; round < 2; round++) {
+    std::vector<iovec> iovs;
+
+    linear.reset();
+    segmented.reset();
+    for (size_t i = 0; i < 200; i++) {
+      // Mostly small writes, with a few larger than a chunk.
+      size_t count = (i % 50 == 7) ? 100 : 1 + (i * 7) % 13;
+      uint8_t *dst = (uint8_t *)linear.reserve(count);
+      uint8_t *seg = (uint8_t *)segmented.reserve(count);
+      size_t actual = count - (i % 3 == 0);
+
+      for (size_t j = 0; j < count; j++) dst[j] = seg[j] = (uint8_t)(i + j);
+
+      linear.commit(actual);
+      segmented.commit(actual);
+      assert(linear.written() == segmented.written());
+
+      if (round == 0 && i == 100) segmented.append_iovecs(&first);
+    }
+
+    segmented.append_iovecs(&iovs);
+    assert(iovs.size() > 1);
+
+    size_t offset = 0;
+    for (const iovec &iov : iovs) {
+      assert(iov.iov_len > 0);
+      assert(memcmp((const uint8_t *)linear.data() + offset, iov.iov_base,
+                    iov.iov_len) == 0);
+      offset += iov.iov_len;
+    }
+
+    assert(offset == linear.written());
+
+    // Sealed chunks never move, and the second round reuses them.
+    for (size_t i = 0; i + 1 < first.size(); i++) {
+      assert(first[i].iov_base == iovs[i].iov_base);
+    }
+  }
+
+  // Discarded bytes still count in `written()`, and both kinds of
+  // buffers write over their memory again.
+  for (WriteBuffer *buffer : {&linear, &segmented}) {
+    const void *first_chunk;
+
+    buffer->reset();
+    first_chunk = buffer->write_cursor();
+    memcpy(buffer->reserve(4), "abcd", 4);
+    buffer->commit(4);
+    buffer->discard();
+    assert(buffer->written() == 4 && buffer->write_cursor() == first_chunk);
+
+    std::vector<iovec> iovs;
+
+    buffer->append_iovecs(&iovs);
+    assert(iovs.empty());
+    memcpy(buffer->reserve(2), "ef", 2);
+    buffer->commit(2);
+    buffer->append_iovecs(&iovs);
+    assert(buffer->written() == 6 && iovs.size() == 1 &&
+           iovs[0].iov_base == first_chunk && iovs[0].iov_len == 2);
+
+    buffer->reset();
+    assert(buffer->written() == 0 && buffer->data() == first_chunk);
+    (void)first_chunk;
+  }
+
+  WriteBuffer moved(std::move(segmented));
+  std::vector<iovec> iovs;
+
+  moved.append_iovecs(&iovs);
+  assert(segmented.written() == 0 && moved.written() == linear.written());
+  return;
+}
@@ -5,11 +5,19 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <vector>
+
+struct iovec;
 
 /// A WriteBuffer is a growable linear array of payload bytes, with an
 /// interface that makes it possible to write fixed size values (e.g.,
 /// 8-byte uint64_t), and only commit a fraction of the bytes actually
 /// written (e.g., only the low 2 bytes).
+///
+/// Segmented `WriteBuffer`s (see `Segmented`) instead chain chunks:
+/// they never copy bytes once written, but the bytes aren't
+/// contiguous, so they're exported with `append_iovecs` (for
+/// `writev` or `sendmsg`) rather than `data()`.
 class WriteBuffer {
  public:
   /// The default constructor creates a buffer with zero capacity
@@ -21,6 +29,12 @@ class WriteBuffer {
   /// `WriteBuffer`s grow on demand.
   explicit WriteBuffer(size_t capacity);
 
+  /// Returns an empty segmented buffer: when a `reserve` doesn't fit
+  /// in the current chunk, the buffer moves on to a new chunk of at
+  /// least `chunk_size` bytes (or `count`, if larger), rather than
+  /// reallocating and copying.  `reset` keeps the chunks for reuse.
+  static WriteBuffer Segmented(size_t chunk_size);
+
   /// `WriteBuffer`s are move-only: we don't want to accidentally
   /// pay for duplicating a variable-length array of bytes.
   WriteBuffer(const WriteBuffer &) = delete;
@@ -40,6 +54,15 @@ class WriteBuffer {
     return write_cursor_;
   }
 
+  /// Same as `reserve`, without the capacity check: the caller must
+  /// already have `reserve`d room for `count` bytes past everything
+  /// committed since.
+  inline void *reserve_unchecked(size_t count) __restrict__ {
+    assert(count <= remaining_);
+    (void)count;
+    return write_cursor_;
+  }
+
   /// Commits `actual` bytes after a `reserve` call.  The sum of
   /// `actual` bytes since the last call to `reserve` must not
   /// exceed the `count` value passed to that `reserve` call.
@@ -55,39 +78,112 @@ class WriteBuffer {
 
   /// Resets the write buffer to an empty state (nothing written).
   inline void reset() {
+    if (__builtin_expect(sealed_ != 0, 0)) return reset_sealed();
+
     write_cursor_ = buf_;
     remaining_ = buf_end_ - buf_;
     return;
   }
 
+  /// Drops the bytes written so far (e.g., once `append_iovecs` has
+  /// exported them), but keeps counting them in `written()`, so sizes
+  /// computed from `written()` stay valid.  The buffer keeps its
+  /// memory, and its chunks, for the bytes that follow.
+  void discard();
+
   /// Returns the linear byte buffer for the data written so far.
-  inline const void *data() const { return buf_; }
+  ///
+  /// Segmented buffers are only linear until they fill their first
+  /// chunk, and no buffer is after a `discard` (until `reset`).
+  inline const void *data() const {
+    assert(sealed_ == 0);
+    return buf_;
+  }
+
+  /// Same, to update bytes that were already committed.  The pointer
+  /// is invalidated by the next `reserve` call.
+  inline void *data() {
+    assert(sealed_ == 0);
+    return buf_;
+  }
 
   /// Returns the write cursor in the current `reserve`d section.
   inline void *write_cursor() const { return write_cursor_; }
 
   /// Returns the number of bytes written (committed) to this write
   /// buffer.
-  inline size_t written() const { return (size_t)(write_cursor_ - buf_); }
+  inline size_t written() const {
+    return sealed_ + (size_t)(write_cursor_ - buf_);
+  }
+
+  /// Returns the number of bytes the buffer can hold before it must
+  /// grow (or, for segmented buffers, move on to a new chunk),
+  /// counting those already written.
+  inline size_t capacity() const {
+    return sealed_ + (size_t)(buf_end_ - buf_);
+  }
+
+  /// Returns true for segmented buffers.
+  inline bool segmented() const { return segments_ != nullptr; }
+
+  /// Appends one `iovec` per non-empty chunk (a single one for linear
+  /// buffers) for the bytes written so far, in order.  The `iovec`s
+  /// are invalidated by the next `reserve` or `reset`.
+  ///
+  /// `writev` and `sendmsg` accept at most `IOV_MAX` (usually 1024)
+  /// `iovec`s per call.
+  void append_iovecs(std::vector<iovec> *out) const;
+
+  static void SelfTest();
 
  private:
+  friend struct WriteBufferPool;
+
+  /// The chunks of a segmented buffer.
+  struct Segments;
+
+  /// Adopts the `malloc`ed `capacity` bytes at `buf`.
+  WriteBuffer(uint8_t *buf, size_t capacity)
+      : write_cursor_(buf),
+        remaining_(capacity),
+        buf_(buf),
+        buf_end_(buf + capacity) {}
+
   __attribute__((noinline)) void *reserve_slow(size_t count) __restrict__;
 
+  /// Moves on to the next chunk, with room for at least `count` bytes.
+  void *reserve_chunk(size_t count);
+
+  /// `reset` for segmented buffers, and for discarded ones.
+  __attribute__((noinline)) void reset_sealed();
+
+  void destroy_segments();
+
   uint8_t *write_cursor_{nullptr};
   size_t remaining_{0};
   uint8_t *buf_{nullptr};
   uint8_t *buf_end_{nullptr};
+
+  /// Number of bytes in the chunks before the current one (or
+  /// discarded): 0 until a segmented buffer moves past its first chunk.
+  size_t sealed_{0};
+  /// nullptr for linear buffers.
+  Segments *segments_{nullptr};
 };
 
 WriteBuffer::WriteBuffer(WriteBuffer &&other)
     : write_cursor_(other.write_cursor_),
       remaining_(other.remaining_),
       buf_(other.buf_),
-      buf_end_(other.buf_end_) {
+      buf_end_(other.buf_end_),
+      sealed_(other.sealed_),
+      segments_(other.segments_) {
   other.write_cursor_ = nullptr;
   other.remaining_ = 0;
   other.buf_ = nullptr;
   other.buf_end_ = nullptr;
+  other.sealed_ = 0;
+  other.segments_ = nullptr;
   return;
 }
 
@@ -98,10 +194,17 @@ WriteBuffer &WriteBuffer::operator=(WriteBuffer &&other) {
   swap(remaining_, other.remaining_);
   swap(buf_, other.buf_);
   swap(buf_end_, other.buf_end_);
+  swap(sealed_, other.sealed_);
+  swap(segments_, other.segments_);
   return *this;
 }
 
 WriteBuffer::~WriteBuffer() {
+  if (__builtin_expect(segments_ != nullptr, 0)) {
+    destroy_segments();
+    return;
+  }
+
   if (buf_ != nullptr) free(buf_);
   return;
 }